@@ -0,0 +1,106 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+// Boot phase timeline for the Arduino sketch: the end of every startup phase
+// is stamped with esp_timer_get_time() (microseconds since the timer started
+// during early boot), and the time to the first emitted pulse is kept in a
+// small history that survives deep sleep. Free of Serial output so it can
+// also be used on the host.
+
+#include <stdint.h>
+
+// Startup phases in the order setup() runs them
+enum BootPhase {
+  PHASE_BOOT,          // ROM, bootloader and runtime until setup() is entered
+  PHASE_WIFI,          // WiFi retry loop
+  PHASE_NTP,           // getNTP(), or listening for peer beacons
+  PHASE_WIFI_OFF,      // WiFi_off()
+  PHASE_CHECK_SLEEP,   // checkSleep()
+  PHASE_LEDC,          // LEDC and LED pin setup
+  PHASE_CODE_TIME,     // first CodeTime()
+  PHASE_SECOND_ALIGN,  // arm the tick timer for the start of the next second
+  PHASE_FIRST_PULSE,   // until the first carrier reduction
+  BOOT_PHASE_COUNT
+};
+
+inline const char* bootPhaseName(int phase) {
+  static const char* const names[BOOT_PHASE_COUNT] = {
+    "boot", "wifi", "ntp", "wifi_off", "check_sleep",
+    "ledc", "code_time", "second_align", "first_pulse"
+  };
+  return (phase >= 0 && phase < BOOT_PHASE_COUNT) ? names[phase] : "?";
+}
+
+// End time of every phase in microseconds, 0 if the phase was not reached
+struct BootTimeline {
+  int64_t phaseEnd[BOOT_PHASE_COUNT];
+};
+
+// Duration of a phase: from the end of the last phase reached before it
+inline int64_t bootPhaseDuration(const BootTimeline& timeline, int phase) {
+  if (timeline.phaseEnd[phase] == 0) {
+    return -1;
+  }
+  for (int i = phase - 1; i >= 0; i--) {
+    if (timeline.phaseEnd[i] != 0) {
+      return timeline.phaseEnd[phase] - timeline.phaseEnd[i];
+    }
+  }
+  return timeline.phaseEnd[phase];
+}
+
+// One completed boot, as kept in the history
+struct BootRecord {
+  uint32_t wakeCause;                  // esp_sleep_wakeup_cause_t
+  uint32_t phaseUs[BOOT_PHASE_COUNT];  // phase durations, 0 if skipped
+};
+
+const int bootHistorySize = 8;
+const uint32_t bootHistoryMagic = 0xB0071E01;
+
+// Ring of the most recent boots. Place it in RTC memory (RTC_DATA_ATTR) to
+// keep it across deep sleep; a power-on reset clears it.
+struct BootHistory {
+  uint32_t magic;
+  uint32_t bootCount;  // completed boots since the history was cleared
+  BootRecord records[bootHistorySize];
+};
+
+// Clears the history unless it holds valid data from an earlier boot
+inline void bootHistoryInit(BootHistory& history) {
+  if (history.magic != bootHistoryMagic) {
+    history = BootHistory();
+    history.magic = bootHistoryMagic;
+  }
+}
+
+inline void bootHistoryAdd(BootHistory& history, const BootTimeline& timeline, uint32_t wakeCause) {
+  BootRecord& record = history.records[history.bootCount % bootHistorySize];
+  record.wakeCause = wakeCause;
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    int64_t duration = bootPhaseDuration(timeline, i);
+    record.phaseUs[i] = duration > 0 ? (uint32_t)duration : 0;
+  }
+  history.bootCount++;
+}
+
+// Number of records held, oldest first via bootHistoryRecord()
+inline int bootHistoryLength(const BootHistory& history) {
+  return history.bootCount < (uint32_t)bootHistorySize ? (int)history.bootCount : bootHistorySize;
+}
+
+inline const BootRecord& bootHistoryRecord(const BootHistory& history, int index) {
+  uint32_t first = history.bootCount - bootHistoryLength(history);
+  return history.records[(first + index) % bootHistorySize];
+}
+
+// Time from the start of the timer to the first pulse
+inline uint32_t bootTimeToFirstPulseUs(const BootRecord& record) {
+  uint32_t total = 0;
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    total += record.phaseUs[i];
+  }
+  return total;
+}
+
+#endif // BOOT_TIMELINE_H
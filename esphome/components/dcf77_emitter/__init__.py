@@ -1,28 +1,156 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome import pins
-from esphome.components import time, switch
-from esphome.const import CONF_ID, CONF_TIME_ID
+from esphome.components import sensor, switch, text_sensor, time, uart
+from esphome.const import (
+    CONF_ID,
+    CONF_INVERTED,
+    CONF_NUMBER,
+    CONF_PIN,
+    CONF_RESOLUTION,
+    CONF_TIME_ID,
+    CONF_UART_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+)
 
 import logging  # <- add this import
 
-DEPENDENCIES = ["time"]
+# No DEPENDENCIES: a time component is only needed for time_id or
+# time_sources; CONFIG_SCHEMA requires at least one time input.
+AUTO_LOAD = ["sensor", "text_sensor"]
 MULTI_CONF = True
 
 dcf77_emitter_ns = cg.esphome_ns.namespace("dcf77_emitter")
 DCF77Emitter = dcf77_emitter_ns.class_("DCF77Emitter", cg.Component)
+Protocol = cg.global_ns.namespace("dcf77").enum("Protocol", is_class=True)
 
 CONF_ANTENNA_PIN = "antenna_pin"
 CONF_LED_PIN = "led_pin"
 CONF_SYNC_SWITCH_ID = "sync_switch_id"
+CONF_PROFILING = "profiling"
+CONF_TRANSMITTERS = "transmitters"
+CONF_PROTOCOL = "protocol"
+CONF_STATIC_CONFIG = "static_config"
+CONF_TIME_SOURCES = "time_sources"
+CONF_TIME_ERROR = "time_error"
+CONF_TIME_SOURCE = "time_source"
+CONF_GPS = "gps"
+CONF_PPS_PIN = "pps_pin"
+CONF_TIME_PUSH = "time_push"
+CONF_STALL_THRESHOLD = "stall_threshold"
+CONF_STALLS = "stalls"
+CONF_INTEGRITY_ERRORS = "integrity_errors"
+CONF_FLIGHT_RECORDER = "flight_recorder"
+CONF_MINUTES = "minutes"
+CONF_RTC_MEMORY = "rtc_memory"
+CONF_DRIFT_THRESHOLD = "drift_threshold"
 
-CONFIG_SCHEMA = cv.Schema({
-    cv.GenerateID(): cv.declare_id(DCF77Emitter),
+PROTOCOLS = {
+    "msf": Protocol.MSF,
+    "wwvb": Protocol.WWVB,
+    "jjy40": Protocol.JJY40,
+    "jjy60": Protocol.JJY60,
+}
+
+# Extra time codes sent alongside DCF77, each on its own LEDC channel. The
+# antenna pin takes channel 0 of the 8, leaving 7.
+TRANSMITTER_SCHEMA = cv.Schema({
+    cv.Required(CONF_PROTOCOL): cv.enum(PROTOCOLS, lower=True),
+    cv.Required(CONF_PIN): pins.internal_gpio_output_pin_schema,
+})
+
+# Time components the clock is disciplined from. Readings are truncated to
+# the resolution: 1 s for Home Assistant, NMEA and most RTC chips.
+TIME_SOURCE_SCHEMA = cv.Schema({
     cv.Required(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+    cv.Required(CONF_RESOLUTION): cv.positive_time_period_microseconds,
+})
+
+# A GPS receiver's NMEA output, and optionally its PPS output, which marks
+# the start of each second to a few microseconds.
+GPS_SCHEMA = cv.Schema({
+    cv.GenerateID(CONF_UART_ID): cv.use_id(uart.UARTComponent),
+    cv.Optional(CONF_PPS_PIN): pins.internal_gpio_input_pin_schema,
+})
+
+# Ring of the last minutes of edges and events, dumped to the log when a
+# tick stalls, the self-decode fails or a reading shows a drift of the clock
+# (see flight_recorder.h). 128 records of 20 bytes per minute; RTC memory
+# keeps them across resets but has room for two minutes only.
+def _validate_flight_recorder(config):
+    if config[CONF_RTC_MEMORY] and config[CONF_MINUTES] > 2:
+        raise cv.Invalid("rtc_memory holds at most 2 minutes")
+    return config
+
+
+FLIGHT_RECORDER_SCHEMA = cv.All(cv.Schema({
+    cv.Optional(CONF_MINUTES, default=4): cv.int_range(min=1, max=16),
+    cv.Optional(CONF_RTC_MEMORY, default=False): cv.boolean,
+    cv.Optional(CONF_DRIFT_THRESHOLD, default="20ms"): cv.All(
+        cv.positive_time_period_microseconds,
+        cv.Range(min=cv.TimePeriod(milliseconds=1)),
+    ),
+}), _validate_flight_recorder)
+
+CONFIG_SCHEMA = cv.All(cv.Schema({
+    cv.GenerateID(): cv.declare_id(DCF77Emitter),
+    cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+    cv.Optional(CONF_TIME_SOURCES): cv.ensure_list(TIME_SOURCE_SCHEMA),
+    cv.Optional(CONF_GPS): GPS_SCHEMA,
+    # Home Assistant pushes its time through the dcf77_set_time service
+    cv.Optional(CONF_TIME_PUSH): cv.boolean,
+    cv.Optional(CONF_TIME_ERROR): sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=1,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    cv.Optional(CONF_TIME_SOURCE): text_sensor.text_sensor_schema(
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    # An edge later than this blanks the rest of the minute
+    cv.Optional(CONF_STALL_THRESHOLD, default="50ms"): cv.All(
+        cv.positive_time_period_microseconds,
+        cv.Range(min=cv.TimePeriod(milliseconds=5), max=cv.TimePeriod(milliseconds=80)),
+    ),
+    cv.Optional(CONF_STALLS): sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    # Errors the on-device decoder finds in the emitted DCF77 signal
+    cv.Optional(CONF_INTEGRITY_ERRORS): sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    cv.Optional(CONF_FLIGHT_RECORDER): FLIGHT_RECORDER_SCHEMA,
     cv.Required(CONF_ANTENNA_PIN): pins.gpio_output_pin_schema,
-    cv.Required(CONF_LED_PIN): pins.gpio_output_pin_schema,
+    cv.Optional(CONF_LED_PIN): pins.internal_gpio_output_pin_schema,
     cv.Required(CONF_SYNC_SWITCH_ID): cv.use_id(switch.Switch),
-}).extend(cv.COMPONENT_SCHEMA)
+    cv.Optional(CONF_PROFILING, default=False): cv.boolean,
+    cv.Optional(CONF_STATIC_CONFIG, default=False): cv.boolean,
+    cv.Optional(CONF_TRANSMITTERS, default=[]): cv.All(
+        cv.ensure_list(TRANSMITTER_SCHEMA), cv.Length(max=7)
+    ),
+}).extend(cv.COMPONENT_SCHEMA), cv.has_at_least_one_key(CONF_TIME_ID, CONF_TIME_SOURCES, CONF_GPS, CONF_TIME_PUSH))
+
+
+def _final_validate(config):
+    # The static configuration is a set of global build flags
+    if config[CONF_STATIC_CONFIG] and len(fv.full_config.get()["dcf77_emitter"]) > 1:
+        raise cv.Invalid("static_config requires a single dcf77_emitter")
+    # So is the flight recorder's ring
+    if CONF_FLIGHT_RECORDER in config and len(fv.full_config.get()["dcf77_emitter"]) > 1:
+        raise cv.Invalid("flight_recorder requires a single dcf77_emitter")
+    if config.get(CONF_TIME_PUSH) and "api" not in fv.full_config.get():
+        raise cv.Invalid("time_push requires the native API (api:)")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
 
 _LOGGER = logging.getLogger(__name__)  # <- logger for structured logs
 
@@ -39,20 +167,80 @@ async def to_code(config):
     # After registration show confirmation
     print("dcf77_emitter.to_code: registered component variable:", var)
 
-    time_ = await cg.get_variable(config[CONF_TIME_ID])
-    cg.add(var.set_time_id(time_))
-    print("dcf77_emitter.to_code: set_time_id done")
+    if CONF_TIME_ID in config:
+        time_ = await cg.get_variable(config[CONF_TIME_ID])
+        cg.add(var.set_time_id(time_))
+        print("dcf77_emitter.to_code: set_time_id done")
+
+    for source in config.get(CONF_TIME_SOURCES, []):
+        time_ = await cg.get_variable(source[CONF_TIME_ID])
+        cg.add(var.add_time_source(time_, str(source[CONF_TIME_ID]),
+                                   source[CONF_RESOLUTION].total_microseconds))
+        _LOGGER.debug("dcf77_emitter.to_code: add_time_source done -> %s", source[CONF_TIME_ID])
+
+    if CONF_GPS in config:
+        gps = config[CONF_GPS]
+        cg.add_build_flag("-DDCF77_GPS")
+        uart_ = await cg.get_variable(gps[CONF_UART_ID])
+        cg.add(var.set_gps_uart(uart_))
+        if CONF_PPS_PIN in gps:
+            pin = await cg.gpio_pin_expression(gps[CONF_PPS_PIN])
+            cg.add(var.set_gps_pps_pin(pin))
+        _LOGGER.debug("dcf77_emitter.to_code: GPS done -> %s", gps[CONF_UART_ID])
+
+    if config.get(CONF_TIME_PUSH):
+        cg.add_build_flag("-DDCF77_TIME_PUSH")
+
+    if CONF_TIME_ERROR in config:
+        sens = await sensor.new_sensor(config[CONF_TIME_ERROR])
+        cg.add(var.set_time_error_sensor(sens))
+
+    if CONF_TIME_SOURCE in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_TIME_SOURCE])
+        cg.add(var.set_time_source_sensor(sens))
+
+    cg.add(var.set_stall_threshold(config[CONF_STALL_THRESHOLD].total_microseconds))
+    if CONF_STALLS in config:
+        sens = await sensor.new_sensor(config[CONF_STALLS])
+        cg.add(var.set_stalls_sensor(sens))
+    if CONF_INTEGRITY_ERRORS in config:
+        sens = await sensor.new_sensor(config[CONF_INTEGRITY_ERRORS])
+        cg.add(var.set_integrity_errors_sensor(sens))
+
+    if CONF_FLIGHT_RECORDER in config:
+        recorder = config[CONF_FLIGHT_RECORDER]
+        cg.add_build_flag(f"-DDCF77_FLIGHT_RECORDER={recorder[CONF_MINUTES]}")
+        if recorder[CONF_RTC_MEMORY]:
+            cg.add_build_flag("-DDCF77_FLIGHT_RECORDER_RTC")
+        cg.add(var.set_drift_threshold(recorder[CONF_DRIFT_THRESHOLD].total_microseconds))
 
     pin = await cg.gpio_pin_expression(config[CONF_ANTENNA_PIN])
     cg.add(var.set_antenna_pin(pin))
     print("dcf77_emitter.to_code: set_antenna_pin done ->", pin)
 
-    pin = await cg.gpio_pin_expression(config[CONF_LED_PIN])
-    cg.add(var.set_led_pin(pin))
-    print("dcf77_emitter.to_code: set_led_pin done ->", pin)
+    if CONF_LED_PIN in config:
+        pin = await cg.gpio_pin_expression(config[CONF_LED_PIN])
+        cg.add(var.set_led_pin(pin))
+        print("dcf77_emitter.to_code: set_led_pin done ->", pin)
     
     switch_ = await cg.get_variable(config[CONF_SYNC_SWITCH_ID])
     cg.add(var.set_sync_switch(switch_))
     print("dcf77_emitter.to_code: set_sync_switch done ->", switch_)
 
+    for transmitter in config[CONF_TRANSMITTERS]:
+        pin = await cg.gpio_pin_expression(transmitter[CONF_PIN])
+        cg.add(var.add_transmitter(transmitter[CONF_PROTOCOL], pin))
+        _LOGGER.debug("dcf77_emitter.to_code: add_transmitter done -> %s %s", transmitter[CONF_PROTOCOL], pin)
+
+    if config[CONF_PROFILING]:
+        cg.add_build_flag("-DDCF77_PROFILING")
+
+    # Compile the output stage for exactly this configuration (see static_output.h)
+    if config[CONF_STATIC_CONFIG]:
+        led = config.get(CONF_LED_PIN)
+        cg.add_build_flag("-DDCF77_STATIC_CONFIG")
+        cg.add_build_flag(f"-DDCF77_STATIC_TRANSMITTERS={1 + len(config[CONF_TRANSMITTERS])}")
+        cg.add_build_flag(f"-DDCF77_STATIC_LED_GPIO={led[CONF_NUMBER] if led else -1}")
+        cg.add_build_flag(f"-DDCF77_STATIC_LED_INVERTED={int(bool(led and led[CONF_INVERTED]))}")
+
     _LOGGER.info("dcf77_emitter.to_code: finished") 
@@ -1,82 +1,195 @@
 #include "dcf77_emitter.h"
+#include "dcf77_probe.h"
+#include "static_output.h"
 #include "esphome/core/log.h"
 #include "esphome/core/hal.h"
 #include "esphome/core/application.h"
 
+#include "esp_attr.h"
 #include "esp_system.h"
 #include "esp_timer.h"
 #include "driver/ledc.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <sys/time.h>
 #include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 
 namespace esphome {
 namespace dcf77_emitter {
 
 static const char *TAG = "dcf77_emitter";
 
-// -----------------------------------------------------------------------------
-// Setup timer using ESP-IDF esp_timer (1 tick = 100 ms)
-// -----------------------------------------------------------------------------
-void DCF77Emitter::setup_timer_() {
-  // create periodic timer
-  const esp_timer_create_args_t timer_args = {
-      .callback = [](void *arg) {
-        auto *self = static_cast<DCF77Emitter *>(arg);
-        self->dcf_out_tick();
-      },
-      .arg = this,
-      .dispatch_method = ESP_TIMER_TASK,
-      .name = "dcf77_tick"};
-
-  esp_timer_create(&timer_args, &this->esp_timer_handle_);
-  esp_timer_start_periodic(this->esp_timer_handle_, 100000);  // 100 ms
-  ESP_LOGD(TAG, "ESP-IDF timer configured (100 ms period)");
+// 50 % duty at the 8-bit LEDC resolution
+static const uint32_t CARRIER_DUTY = 127;
+
+#ifdef DCF77_STATIC_CONFIG
+// Static builds also drop the log messages of the tick path
+static constexpr bool TICK_LOG = false;
+#else
+static constexpr bool TICK_LOG = true;
+#endif
+
+// 2019-01-01, the earliest time ESPTime::is_valid() accepts
+static const time_t MIN_VALID_EPOCH = 1546300800;
+// A change of the system clock against esp_timer by more than this is a
+// synchronisation by a source that did not call back
+static const int64_t SYSTEM_STEP_US = 1000;
+// A sole time component is read this often even without a step
+static const int64_t SOLE_SOURCE_SAMPLE_US = 60000000;
+// Ticks follow the clock's tenths within a few milliseconds either way; a
+// tick that fires slightly early still belongs to the coming second
+static const int64_t TICK_MARGIN_US = 20000;
+#ifdef DCF77_FLIGHT_RECORDER
+// DCF77_FLIGHT_RECORDER minutes of DCF77 alone: 118 edges, the frame and a
+// few readings a minute. Further transmitters add edges and shorten it.
+using FlightRing = dcf77::FlightRecorder<DCF77_FLIGHT_RECORDER * 128>;
+#ifdef DCF77_FLIGHT_RECORDER_RTC
+// Not cleared at reset, so the records before a crash can be dumped
+static RTC_NOINIT_ATTR FlightRing flight_ring;
+#else
+static FlightRing flight_ring;
+#endif
+// Dump lines written per main loop pass, to keep the loop short
+static const int FLIGHT_LINES_PER_LOOP = 8;
+#endif
+#ifdef DCF77_GPS
+// Without PPS, common receivers finish the time sentence within a quarter
+// second after the second it names; taken as a reading truncated to that
+static const uint32_t NMEA_RESOLUTION_US = 250000;
+#endif
+#ifdef DCF77_TIME_PUSH
+// Half the round trip is the worst error of a push; beyond this it is
+// worse than a one-second source
+static const int64_t MAX_PUSH_RTT_US = 500000;
+
+// "1729976400.123456" (seconds with up to six decimals, as Home Assistant's
+// now().timestamp() gives them) in microseconds
+static bool parse_timestamp_us(const std::string &text, int64_t *us) {
+  const char *p = text.c_str();
+  if (*p < '0' || *p > '9')
+    return false;
+  int64_t seconds = 0, micros = 0;
+  while (*p >= '0' && *p <= '9')
+    seconds = seconds * 10 + (*p++ - '0');
+  if (*p == '.') {
+    // Digits beyond the sixth are dropped
+    int64_t scale = 100000;
+    for (p++; *p >= '0' && *p <= '9'; p++, scale /= 10)
+      micros += (*p - '0') * scale;
+  }
+  *us = seconds * 1000000 + micros;
+  return *p == '\0';
 }
+#endif
 
 // -----------------------------------------------------------------------------
 // Setup
 // -----------------------------------------------------------------------------
+void DCF77Emitter::add_time_source(time::RealTimeClock *clock, const char *name, uint32_t resolution_us) {
+  this->time_sources_.push_back(clock);
+  this->fusion_.add_source(name, resolution_us);
+}
+
+void DCF77Emitter::add_transmitter(dcf77::Protocol protocol, InternalGPIOPin *pin) {
+  this->transmitters_.push_back(Transmitter{protocol, pin, LEDC_CHANNEL_0, {0, 0}});
+}
+
 void DCF77Emitter::setup() {
   ESP_LOGCONFIG(TAG, "Setting up DCF77 Emitter...");
   ESP_LOGI(TAG, "!!!!!!!!!!!!!!!!!!!!!!!!!!tesT!!!!!!!!!!!!!!!!!!!!!!!");
-  this->led_pin_->setup();
-  this->led_pin_->digital_write(false);
+  if (this->led_pin_ != nullptr) {
+    this->led_pin_->setup();
+    this->led_pin_->digital_write(false);
+  }
   this->antenna_pin_->setup();
 
-  // Configure LEDC PWM for 77.5 kHz
-  ledc_timer_config_t ledc_timer = {
-      .speed_mode = LEDC_LOW_SPEED_MODE,
-      .duty_resolution = LEDC_TIMER_8_BIT,
-      .timer_num = LEDC_TIMER_0,
-      .freq_hz = 77500,
-      .clk_cfg = LEDC_USE_PLL_DIV_CLK};
-  ledc_timer_config(&ledc_timer);
-
-  ledc_channel_config_t ledc_channel = {
-      .gpio_num = this->antenna_pin_->get_pin(),
-      .speed_mode = LEDC_LOW_SPEED_MODE,
-      .channel = LEDC_CHANNEL_0,
-      .timer_sel = LEDC_TIMER_0,
-      .duty = 0,
-      .hpoint = 0};
-  ledc_channel_config(&ledc_channel);
-
-  this->pwm_channel_ = LEDC_CHANNEL_0;
+  // DCF77 on the antenna pin is always the first transmitter
+  this->transmitters_.insert(this->transmitters_.begin(),
+                             Transmitter{dcf77::Protocol::DCF77, this->antenna_pin_, LEDC_CHANNEL_0, {0, 0}});
+
+  // One LEDC channel per transmitter and one timer per carrier frequency,
+  // so DCF77 keeps channel 0 and timer 0 at 77.5 kHz
+  uint32_t timer_hz[LEDC_TIMER_MAX] = {};
+  for (size_t i = 0; i < this->transmitters_.size(); i++) {
+    auto &tx = this->transmitters_[i];
+    if (i > 0)
+      tx.pin->setup();
+    const uint32_t hz = dcf77::protocol_carrier_hz(tx.protocol);
+    int timer = 0;
+    while (timer_hz[timer] != 0 && timer_hz[timer] != hz)
+      timer++;
+    if (timer_hz[timer] == 0) {
+      timer_hz[timer] = hz;
+      ledc_timer_config_t ledc_timer = {
+          .speed_mode = LEDC_LOW_SPEED_MODE,
+          .duty_resolution = LEDC_TIMER_8_BIT,
+          .timer_num = static_cast<ledc_timer_t>(timer),
+          .freq_hz = hz,
+          .clk_cfg = LEDC_USE_PLL_DIV_CLK};
+      ledc_timer_config(&ledc_timer);
+    }
+
+    tx.channel = static_cast<ledc_channel_t>(i);
+    ledc_channel_config_t ledc_channel = {
+        .gpio_num = tx.pin->get_pin(),
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = tx.channel,
+        .timer_sel = static_cast<ledc_timer_t>(timer),
+        .duty = 0,
+        .hpoint = 0};
+    ledc_channel_config(&ledc_channel);
+  }
+  // All carriers start off
+  this->reduced_ = static_cast<uint8_t>((1u << this->transmitters_.size()) - 1);
+#ifdef DCF77_FLIGHT_RECORDER
+  if (flight_ring.init()) {
+    ESP_LOGW(TAG, "Flight recorder kept %" PRIu32 " records across the reset",
+             std::min<uint32_t>(flight_ring.written.load(), FlightRing::CAPACITY));
+    flight_ring.trigger_dump(dcf77::FLIGHT_TRIGGER_RESET);
+  }
+#endif
+#ifdef DCF77_STATIC_CONFIG
+  if (this->transmitters_.size() != StaticConfig::TRANSMITTERS ||
+      (this->led_pin_ != nullptr) != (StaticConfig::LED_GPIO >= 0)) {
+    ESP_LOGE(TAG, "Configuration does not match the static build");
+    this->mark_failed();
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < this->time_sources_.size(); i++) {
+    const int source = static_cast<int>(i);
+    this->time_sources_[i]->add_on_time_sync_callback([this, source]() { this->sample_system_clock_(source); });
+  }
+  // A source may have set the system clock before this component started
+  sample_system_clock_(-1);
+#ifdef DCF77_GPS
+  if (this->gps_uart_ != nullptr) {
+    this->gps_source_ = this->fusion_.add_source("gps", this->gps_pps_pin_ != nullptr ? 0 : NMEA_RESOLUTION_US);
+    if (this->gps_pps_pin_ != nullptr) {
+      this->gps_pps_pin_->setup();
+      this->gps_pps_pin_->attach_interrupt(&DCF77Emitter::gps_pps_isr_, this, gpio::INTERRUPT_RISING_EDGE);
+    }
+  }
+#endif
+#ifdef DCF77_TIME_PUSH
+  this->push_source_ = this->fusion_.add_source("api", 0);
+  register_service(&DCF77Emitter::on_time_push_, "dcf77_set_time", {"epoch", "ack", "ack_received"});
+#endif
+  App.scheduler.set_interval(this, "dcf77_time_quality", 60000, [this]() { this->publish_time_quality_(); });
 
   code_time_();
 
   this->sync_start_millis_ = millis();
-  auto time = this->time_id_->now();
+  auto time = now_();
   if (time.is_valid()) {
     this->last_second_ = time.second;
   }
 
-  this->last_tick_time_ = 0;
-  this->timing_drift_ms_ = 0;
-  this->last_sync_millis_ = millis();
-
-  setup_timer_();
-
   ESP_LOGI(TAG, "DCF77 Emitter setup complete. Waiting for sync.");
 }
 
@@ -84,18 +197,38 @@ void DCF77Emitter::setup() {
 // Loop
 // -----------------------------------------------------------------------------
 void DCF77Emitter::loop() {
+  sample_system_clock_(-1);
+#ifdef DCF77_FLIGHT_RECORDER
+  write_flight_dump_();
+#endif
+#ifdef DCF77_GPS
+  if (this->gps_uart_ != nullptr)
+    read_gps_();
+#endif
+#ifdef DCF77_TIME_PUSH
+  // A pushed time takes effect at the next second of the clock it corrects.
+  // One without its round trip waits for the compensated push to replace it.
+  if (this->push_pending_ &&
+      (this->push_compensated_ || esp_timer_get_time() - this->push_local_us_ > MAX_PUSH_RTT_US) &&
+      (!this->fusion_.valid() || this->fusion_.utc_us(esp_timer_get_time()) / 1000000 != this->push_second_)) {
+    this->push_pending_ = false;
+    add_reading_(this->push_source_, this->push_local_us_, this->push_utc_us_);
+  }
+#endif
+
   if (!this->sync_switch_->state) {
     if (this->is_initialized_) {
       ESP_LOGW(TAG, "DCF77 synchronization disabled by switch");
       this->is_initialized_ = false;
       stop_carrier_();
-      this->led_pin_->digital_write(false);
     }
+    // Nothing is sent, so corrections may step the clock
+    this->fusion_.set_slewing(false);
     return;
   }
 
   if (!this->is_initialized_) {
-    auto current_time = this->time_id_->now();
+    auto current_time = now_();
     if (!current_time.is_valid()){
       ESP_LOGD(TAG, "time is not valid, leave loop");
       return;
@@ -106,7 +239,13 @@ void DCF77Emitter::loop() {
 
       code_time_();
       this->impulse_count_ = 0;
+      this->watchdog_.restart();
+      this->watchdog_steps_ = this->fusion_.steps();
+      this->integrity_.restart();
       this->is_initialized_ = true;
+      this->fusion_.set_slewing(true);
+      // Start the second's pulse now rather than one tick late
+      dcf_out_tick();
       schedule_next_tick_();
 
       ESP_LOGI(TAG, "DCF77 synchronization enabled. Starting signal generation");
@@ -114,7 +253,11 @@ void DCF77Emitter::loop() {
       ESP_LOGW(TAG, "Second sync timeout - continuing anyway");
       code_time_();
       this->impulse_count_ = 0;
+      this->watchdog_.restart();
+      this->watchdog_steps_ = this->fusion_.steps();
+      this->integrity_.restart();
       this->is_initialized_ = true;
+      this->fusion_.set_slewing(true);
       schedule_next_tick_();
     }
 
@@ -124,76 +267,38 @@ void DCF77Emitter::loop() {
   const uint32_t now = millis();
   if (now - this->last_status_log_ >= 10000) {
     this->last_status_log_ = now;
-    auto time = this->time_id_->now();
+    auto time = now_();
     if (time.is_valid()) {
-      ESP_LOGD(TAG, "DCF77 Status: %s, Time: %02d:%02d:%02d, DST: %s",
+      const int64_t local_us = esp_timer_get_time();
+      const int source = this->fusion_.selected(local_us);
+      ESP_LOGD(TAG, "DCF77 Status: %s, Time: %02d:%02d:%02d, DST: %s, Source: %s, Error: %.1f ms",
                this->is_initialized_ ? "Transmitting" : "Initializing",
                time.hour, time.minute, time.second,
-               time.is_dst ? "ON" : "OFF");
+               time.is_dst ? "ON" : "OFF", source < 0 ? "holdover" : this->fusion_.sources()[source].name,
+               this->fusion_.error_us(local_us) / 1000.0);
     } else {
       ESP_LOGE(TAG, "DCF77 Status: Waiting for valid time source");
     }
   }
-
-  if (this->is_initialized_) {
-    static uint32_t last_valid_time = millis();
-    auto time = this->time_id_->now();
-
-    if (time.is_valid()) {
-      last_valid_time = millis();
-    } else if (millis() - last_valid_time > 30000) {
-      ESP_LOGE(TAG, "No valid time for 30 seconds - forcing resynchronization");
-      this->is_initialized_ = false;
-      this->sync_start_millis_ = millis();
-    }
-  }
+  // Once set, the clock runs on through the loss of all sources (holdover),
+  // with a growing error estimate
 }
 
 // -----------------------------------------------------------------------------
-// Schedule next tick with drift correction
+// Schedule the next tick on the disciplined clock
 // -----------------------------------------------------------------------------
 void DCF77Emitter::schedule_next_tick_() {
-  uint32_t now = millis();
-
-  if (this->last_tick_time_ > 0) {
-    uint32_t elapsed = now - this->last_tick_time_;
-    int32_t drift = elapsed - 100;
-    if (abs(drift) < 50) {
-      this->timing_drift_ms_ += drift;
-    } else {
-      ESP_LOGW(TAG, "Abnormal timing drift detected: %dms", drift);
-    }
-  }
-
-  this->last_tick_time_ = now;
-  int32_t next_interval = 100;
-
-  if (abs(this->timing_drift_ms_) > 5) {
-    int32_t correction =
-        std::clamp(this->timing_drift_ms_, static_cast<int32_t>(-30),
-                   static_cast<int32_t>(30));
-    next_interval -= correction;
-    this->timing_drift_ms_ -= correction;
-
-    this->consecutive_drift_corrections_++;
-    if (this->consecutive_drift_corrections_ % 10 == 0) {
-      ESP_LOGD(TAG, "Drift compensation: %dms correction, %dms remaining drift",
-               correction, this->timing_drift_ms_);
-    }
-  } else {
-    this->consecutive_drift_corrections_ = 0;
-  }
-
-  if ((now - this->last_sync_millis_ > 600000) ||
-      (abs(this->timing_drift_ms_) > 100)) {
-    ESP_LOGI(TAG, "Performing periodic resynchronization with second boundary");
-    this->is_initialized_ = false;
-    this->timing_drift_ms_ = 0;
-    this->last_sync_millis_ = now;
-    this->sync_start_millis_ = now;
-    return;
-  }
-
+  DCF77_PROBE(EMITTER_SCHEDULE);
+  // Every tick is due on a tenth of a second of the disciplined clock, so
+  // the ticks keep their phase while it slews or corrects the frequency of
+  // the local oscillator,
+  // and scheduler delays do not add up. A late tick needs no restart: the
+  // next one is due on its own tenth again, and the watchdog has blanked
+  // what the late one corrupted.
+  const int64_t utc_us = this->fusion_.utc_us(esp_timer_get_time());
+  const int64_t due_us = (utc_us + TICK_MARGIN_US) / 100000 * 100000;
+
+  const uint32_t next_interval = static_cast<uint32_t>((due_us + 100000 - utc_us + 999) / 1000);
   App.scheduler.set_timeout(this, "dcf77_tick", next_interval, [this]() {
     this->dcf_out_tick();
     if (this->is_initialized_) {
@@ -206,89 +311,326 @@ void DCF77Emitter::schedule_next_tick_() {
 // Tick handler
 // -----------------------------------------------------------------------------
 void DCF77Emitter::dcf_out_tick() {
-  auto current_time = this->time_id_->now();
+  DCF77_PROBE(EMITTER_TICK);
+  auto current_time = now_(TICK_MARGIN_US);
   if (!current_time.is_valid() || !this->is_initialized_)
     return;
 
-  code_time_();
+  // The tenth this tick serves and how late it runs for it
+  const int64_t utc_us = this->fusion_.utc_us(esp_timer_get_time());
+  const int64_t tenth = (utc_us + TICK_MARGIN_US) / 100000;
+  const bool stepped = this->fusion_.steps() != this->watchdog_steps_;
+  this->watchdog_steps_ = this->fusion_.steps();
+  const int cause = this->watchdog_.check(tenth, utc_us - tenth * 100000, this->edge_tenths_, stepped);
+  if (TICK_LOG && cause >= 0)
+    ESP_LOGW(TAG, "Tick stall (%s), %" PRId64 " ms late: blanking until the next minute marker",
+             dcf77::stall_cause_name(cause), (utc_us - tenth * 100000) / 1000);
+#ifdef DCF77_FLIGHT_RECORDER
+  this->tick_tenth_ = tenth;
+  if (cause >= 0) {
+    flight_ring.record(dcf77::flight_record(dcf77::FLIGHT_STALL, tenth * 100000, utc_us - tenth * 100000, 0,
+                                            static_cast<uint8_t>(cause)));
+    flight_ring.trigger_dump(dcf77::FLIGHT_TRIGGER_STALL);
+  }
+#endif
+
+  // Frames only change with the minute
+  if (current_time.timestamp / 60 != this->encoded_minute_)
+    code_time_();
 
   int current_sec = current_time.second;
+  this->actual_second_ = current_sec;
 
   if (current_sec != this->last_second_) {
     if ((this->last_second_ != -1) &&
         (current_sec != ((this->last_second_ + 1) % 60))) {
-      ESP_LOGW(TAG, "Second transition irregular: %d → %d", this->last_second_,
-               current_sec);
-      this->timing_drift_ms_ = 0;
+      if (TICK_LOG) {
+        ESP_LOGW(TAG, "Second transition irregular: %d → %d", this->last_second_, current_sec);
+      }
     }
 
     this->last_second_ = current_sec;
     this->impulse_count_ = 0;
   }
 
-  generate_signal_(current_sec);
+  if (this->watchdog_.modulating()) {
+    generate_signal_(current_sec);
+  } else {
+    this->impulse_count_ = 0;
+    set_carriers_(0);
+    this->integrity_.restart();
+  }
+#ifdef DCF77_FLIGHT_RECORDER
+  this->tick_tenth_ = -1;
+#endif
 }
 
 // -----------------------------------------------------------------------------
-// Generate DCF77 modulation
+// Generate the modulation of all transmitters
 // -----------------------------------------------------------------------------
 void DCF77Emitter::generate_signal_(int current_sec) {
-  switch (this->impulse_count_++) {
-    case 0:
-      if (this->impulse_array_[current_sec] != 0) {
-        this->led_pin_->digital_write(false);
-        stop_carrier_();
-      } else {
-        this->led_pin_->digital_write(true);
-        setup_carrier_();
-      }
-      break;
+  const int tenth = this->impulse_count_++;
+  if (tenth == 0)
+    plan_second_(current_sec);
+  set_carriers_(this->reduced_at_[tenth]);
 
-    case 1:
-      if (this->impulse_array_[current_sec] == 1) {
-        this->led_pin_->digital_write(true);
-        setup_carrier_();
-      }
-      break;
-
-    case 2:
-      this->led_pin_->digital_write(true);
-      setup_carrier_();
-      break;
+  if (tenth == 9) {
+    this->impulse_count_ = 0;
+    if (TICK_LOG && current_sec == 59) {
+      ESP_LOGD(TAG, "DCF77 minute complete. Time: %02d:%02d:%02d",
+               actual_hours_, actual_minutes_, actual_second_);
+    }
+  }
+}
 
-    case 9:
-      this->impulse_count_ = 0;
-      if (current_sec == 59) {
-        ESP_LOGD(TAG, "DCF77 minute complete. Time: %02d:%02d:%02d",
-                 actual_hours_, actual_minutes_, actual_second_);
-      }
-      break;
-    default:
-      break;
+// Looks up the symbol of every transmitter once per second, so the ticks
+// within the second only compare bitsets.
+void DCF77Emitter::plan_second_(int current_sec) {
+  for (auto &reduced : this->reduced_at_)
+    reduced = 0;
+  for (size_t i = 0; i < this->transmitters_.size(); i++) {
+    const auto &tx = this->transmitters_[i];
+    for (uint32_t tenths = dcf77::reduced_tenths(tx.protocol, tx.frame, current_sec); tenths != 0;
+         tenths &= tenths - 1)
+      this->reduced_at_[__builtin_ctz(tenths)] |= 1u << i;
+  }
+  this->edge_tenths_ = this->reduced_at_[0] != 0 ? 1 : 0;
+  for (int k = 1; k < 10; k++) {
+    if (this->reduced_at_[k] != this->reduced_at_[k - 1])
+      this->edge_tenths_ |= 1u << k;
   }
 }
 
 // -----------------------------------------------------------------------------
-// Carrier control
+// Time sources
 // -----------------------------------------------------------------------------
-void DCF77Emitter::setup_carrier_() {
-  if (this->carrier_enabled_)
+// Reads the system clock against esp_timer. |source| >= 0 has just
+// synchronised it; -1 polls for a step made by a source without a callback.
+// The clock of a sole time component is the reference, as a single time_id
+// always was, so it is also read once a minute: time_error then follows that
+// clock instead of growing from the last synchronisation.
+void DCF77Emitter::sample_system_clock_(int source) {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  const int64_t local_us = esp_timer_get_time();
+  if (tv.tv_sec < MIN_VALID_EPOCH || this->time_sources_.empty())
     return;
+  const int64_t system_us = static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+  const int64_t offset_us = system_us - local_us;
+  if (source < 0) {
+    const bool sole_due = this->fusion_.sources().size() == 1 &&
+                          local_us - this->system_sampled_us_ >= SOLE_SOURCE_SAMPLE_US;
+    if (this->fusion_.valid() && !sole_due && std::abs(offset_us - this->system_offset_us_) < SYSTEM_STEP_US)
+      return;
+    source = this->last_synced_source_;
+  }
+  this->last_synced_source_ = source;
+  this->system_offset_us_ = offset_us;
+  this->system_sampled_us_ = local_us;
+  add_reading_(source, local_us, system_us);
+}
 
-  ledc_set_duty(LEDC_LOW_SPEED_MODE, this->pwm_channel_, 127);
-  ledc_update_duty(LEDC_LOW_SPEED_MODE, this->pwm_channel_);
-  this->carrier_enabled_ = true;
+void DCF77Emitter::add_reading_(int source, int64_t local_us, int64_t utc_us) {
+#ifdef DCF77_FLIGHT_RECORDER
+  // How far the emitted clock had drifted from this reading
+  const bool was_valid = this->fusion_.valid();
+  const int64_t offset_us = was_valid ? utc_us - this->fusion_.utc_us(local_us) : 0;
+#endif
+  const bool accepted = this->fusion_.add_reading(source, local_us, utc_us);
+  if (!accepted) {
+    ESP_LOGW(TAG, "Time from %s is %.3f s off the other sources, ignored", this->fusion_.sources()[source].name,
+             (utc_us - this->fusion_.utc_us(local_us)) / 1e6);
+  }
+#ifdef DCF77_FLIGHT_RECORDER
+  if (was_valid) {
+    flight_ring.record(dcf77::flight_record(dcf77::FLIGHT_READING, utc_us, offset_us, accepted ? 1 : 0,
+                                            static_cast<uint8_t>(source)));
+    // Readings scatter by half their resolution
+    const int64_t limit = this->drift_threshold_us_ + this->fusion_.sources()[source].resolution_us / 2;
+    if (this->is_initialized_ && std::abs(offset_us) > limit)
+      flight_ring.trigger_dump(dcf77::FLIGHT_TRIGGER_DRIFT);
+  }
+#endif
 }
 
-void DCF77Emitter::stop_carrier_() {
-  if (!this->carrier_enabled_)
+#ifdef DCF77_GPS
+void IRAM_ATTR DCF77Emitter::gps_pps_isr_(DCF77Emitter *self) {
+  self->pps_local_us_ = esp_timer_get_time();
+  self->pps_count_ = self->pps_count_ + 1;
+}
+
+void DCF77Emitter::read_gps_() {
+  uint8_t c;
+  while (this->gps_uart_->available() > 0 && this->gps_uart_->read_byte(&c)) {
+    if (!this->nmea_.feed(static_cast<char>(c)) || this->nmea_.epoch_ms() == this->gps_last_ms_)
+      continue;
+    this->gps_last_ms_ = this->nmea_.epoch_ms();
+    const int64_t utc_us = this->nmea_.epoch_ms() * 1000;
+    const int64_t local_us = esp_timer_get_time();
+    if (this->gps_pps_pin_ == nullptr) {
+      add_reading_(this->gps_source_, local_us, utc_us);
+      continue;
+    }
+    // The sentences of a second follow its pulse within the second; without
+    // a recent pulse (dropout, or the UART read late) the time is unused
+    uint32_t count;
+    int64_t pps_us;
+    do {
+      count = this->pps_count_;
+      pps_us = this->pps_local_us_;
+    } while (count != this->pps_count_);
+    if (count != 0 && local_us - pps_us < 1000000 && utc_us % 1000000 == 0)
+      add_reading_(this->gps_source_, pps_us, utc_us);
+  }
+}
+#endif
+
+#ifdef DCF77_TIME_PUSH
+// Called by Home Assistant in two steps, as in NTP: a push with only |epoch|
+// is answered with an esphome.dcf77_time_ack event carrying the local time
+// it arrived at (|ack|). The sender then pushes again, with the time it
+// received that event (|ack_received|) and its current time (|epoch|). The
+// round trip is the time between the two pushes here less the time the
+// sender held the event, and half of it is added to |epoch|.
+void DCF77Emitter::on_time_push_(std::string epoch, std::string ack, std::string ack_received) {
+  const int64_t local_us = esp_timer_get_time();
+  int64_t utc_us;
+  if (!parse_timestamp_us(epoch, &utc_us) || utc_us < MIN_VALID_EPOCH * 1000000LL) {
+    ESP_LOGW(TAG, "Time push with invalid epoch '%s' ignored", epoch.c_str());
     return;
+  }
+  if (ack.empty()) {
+    char text[24];
+    snprintf(text, sizeof(text), "%" PRId64 ".%06" PRId64, local_us / 1000000, local_us % 1000000);
+    fire_homeassistant_event("esphome.dcf77_time_ack", {{"ack", text}});
+    // Without its round trip a push only serves as the first time
+    if (this->fusion_.valid())
+      return;
+  } else {
+    int64_t ack_us, ack_received_us;
+    if (!parse_timestamp_us(ack, &ack_us) || !parse_timestamp_us(ack_received, &ack_received_us)) {
+      ESP_LOGW(TAG, "Time push with invalid ack '%s' / '%s' ignored", ack.c_str(), ack_received.c_str());
+      return;
+    }
+    const int64_t rtt_us = (local_us - ack_us) - (utc_us - ack_received_us);
+    if (rtt_us < 0 || rtt_us > MAX_PUSH_RTT_US) {
+      ESP_LOGW(TAG, "Time push with a round trip of %.1f ms ignored", rtt_us / 1e3);
+      return;
+    }
+    ESP_LOGD(TAG, "Time push with a round trip of %.1f ms", rtt_us / 1e3);
+    utc_us += rtt_us / 2;
+  }
+  this->push_pending_ = true;
+  this->push_compensated_ = !ack.empty();
+  this->push_local_us_ = local_us;
+  this->push_utc_us_ = utc_us;
+  this->push_second_ = this->fusion_.valid() ? this->fusion_.utc_us(local_us) / 1000000 : -1;
+}
+#endif
+
+ESPTime DCF77Emitter::now_(int64_t ahead_us) {
+  if (!this->fusion_.valid())
+    return ESPTime{};
+  const int64_t utc_us = this->fusion_.utc_us(esp_timer_get_time()) + ahead_us;
+  const time_t epoch = static_cast<time_t>(utc_us / 1000000);
+  if (epoch != this->now_epoch_) {
+    this->now_epoch_ = epoch;
+    this->now_cache_ = ESPTime::from_epoch_local(epoch);
+  }
+  return this->now_cache_;
+}
 
-  ledc_set_duty(LEDC_LOW_SPEED_MODE, this->pwm_channel_, 0);
-  ledc_update_duty(LEDC_LOW_SPEED_MODE, this->pwm_channel_);
-  this->carrier_enabled_ = false;
+void DCF77Emitter::publish_time_quality_() {
+  if (!this->fusion_.valid())
+    return;
+  const int64_t local_us = esp_timer_get_time();
+  const int selected = this->fusion_.selected(local_us);
+  if (selected != this->selected_source_) {
+    const char *name = selected < 0 ? "holdover" : this->fusion_.sources()[selected].name;
+    ESP_LOGI(TAG, "Time source: %s", name);
+    this->selected_source_ = selected;
+    if (this->time_source_sensor_ != nullptr)
+      this->time_source_sensor_->publish_state(name);
+  }
+  if (this->time_error_sensor_ != nullptr)
+    this->time_error_sensor_->publish_state(this->fusion_.error_us(local_us) / 1000.0f);
+
+  const uint32_t stalls = this->watchdog_.total_stalls();
+  if (stalls != this->stalls_published_) {
+    if (stalls != 0)
+      ESP_LOGI(TAG, "Tick stalls: %" PRIu32 " late tick, %" PRIu32 " skipped ticks, %" PRIu32 " clock step; blanked %" PRIu32
+               " times",
+               this->watchdog_.stalls(dcf77::STALL_LATE_TICK), this->watchdog_.stalls(dcf77::STALL_SKIPPED_TICKS),
+               this->watchdog_.stalls(dcf77::STALL_CLOCK_STEP), this->watchdog_.blanks());
+    this->stalls_published_ = stalls;
+    if (this->stalls_sensor_ != nullptr)
+      this->stalls_sensor_->publish_state(stalls);
+  }
+
+  const uint32_t errors = this->integrity_.total_errors();
+  if (errors != this->integrity_published_) {
+    if (errors != 0)
+      ESP_LOGI(TAG, "Self-decode: %" PRIu32 " of %" PRIu32 " minutes correct; errors: %" PRIu32 " width, %" PRIu32
+               " spacing, %" PRIu32 " framing, %" PRIu32 " parity, %" PRIu32 " mismatch",
+               this->integrity_.minutes_ok(), this->integrity_.minutes_checked(),
+               this->integrity_.errors(dcf77::IntegrityMonitor::ERROR_WIDTH),
+               this->integrity_.errors(dcf77::IntegrityMonitor::ERROR_SPACING),
+               this->integrity_.errors(dcf77::IntegrityMonitor::ERROR_FRAMING),
+               this->integrity_.errors(dcf77::IntegrityMonitor::ERROR_PARITY),
+               this->integrity_.errors(dcf77::IntegrityMonitor::ERROR_MISMATCH));
+    this->integrity_published_ = errors;
+    if (this->integrity_errors_sensor_ != nullptr)
+      this->integrity_errors_sensor_->publish_state(errors);
+  }
 }
 
+// -----------------------------------------------------------------------------
+// Carrier control
+// -----------------------------------------------------------------------------
+void DCF77Emitter::set_carriers_(uint8_t reduced) {
+  uint8_t changed = reduced ^ this->reduced_;
+  if (changed == 0)
+    return;
+  this->reduced_ = reduced;
+  const bool dcf77_edge = (changed & 1) != 0;
+
+#ifdef DCF77_STATIC_CONFIG
+  StaticOutput<StaticConfig>::write(reduced, changed, CARRIER_DUTY);
+#else
+  // The LED follows the DCF77 carrier
+  if ((changed & 1) && this->led_pin_ != nullptr)
+    this->led_pin_->digital_write((reduced & 1) == 0);
+  for (size_t i = 0; changed != 0; i++, changed >>= 1) {
+    if ((changed & 1) == 0)
+      continue;
+    const ledc_channel_t channel = this->transmitters_[i].channel;
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, (reduced >> i) & 1 ? 0 : CARRIER_DUTY);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, channel);
+  }
+#endif
+  // Time of the edge as it reached the LEDC peripheral
+#ifdef DCF77_FLIGHT_RECORDER
+  const int64_t written_us = esp_timer_get_time();
+  if (dcf77_edge)
+    this->integrity_.edge(written_us, (reduced & 1) != 0);
+  const int64_t written_utc_us = this->fusion_.utc_us(written_us);
+  const int64_t due_us = this->tick_tenth_ >= 0 ? this->tick_tenth_ * 100000 : written_utc_us;
+  flight_ring.record(dcf77::flight_record(dcf77::FLIGHT_EDGE, due_us, written_utc_us - due_us, reduced));
+  const uint32_t errors = this->integrity_.total_errors();
+  if (errors != this->integrity_recorded_) {
+    this->integrity_recorded_ = errors;
+    flight_ring.record(
+        dcf77::flight_record(dcf77::FLIGHT_INTEGRITY, written_utc_us, 0, errors, this->integrity_.last_error()));
+    flight_ring.trigger_dump(dcf77::FLIGHT_TRIGGER_INTEGRITY);
+  }
+#else
+  if (dcf77_edge)
+    this->integrity_.edge(esp_timer_get_time(), (reduced & 1) != 0);
+#endif
+}
+
+void DCF77Emitter::stop_carrier_() { set_carriers_(static_cast<uint8_t>((1u << this->transmitters_.size()) - 1)); }
+
 // -----------------------------------------------------------------------------
 // Dump config
 // -----------------------------------------------------------------------------
@@ -296,101 +638,196 @@ void DCF77Emitter::dump_config() {
   ESP_LOGCONFIG(TAG, "DCF77 Emitter:");
   LOG_PIN("  Antenna Pin: ", this->antenna_pin_);
   LOG_PIN("  LED Pin: ", this->led_pin_);
+  for (const auto &source : this->fusion_.sources())
+    ESP_LOGCONFIG(TAG, "  Time Source %s: resolution %" PRIu32 " us", source.name, source.resolution_us);
+#ifdef DCF77_GPS
+  if (this->gps_uart_ != nullptr)
+    ESP_LOGCONFIG(TAG, "  GPS: NMEA%s", this->gps_pps_pin_ != nullptr ? " with PPS" : " only");
+  LOG_PIN("  GPS PPS Pin: ", this->gps_pps_pin_);
+#endif
+#ifdef DCF77_TIME_PUSH
+  ESP_LOGCONFIG(TAG, "  Time Push: service dcf77_set_time");
+#endif
+  LOG_SENSOR("  ", "Time Error", this->time_error_sensor_);
+  LOG_TEXT_SENSOR("  ", "Time Source", this->time_source_sensor_);
+  ESP_LOGCONFIG(TAG, "  Stall Threshold: %" PRId64 " ms", this->watchdog_.threshold_us() / 1000);
+  LOG_SENSOR("  ", "Stalls", this->stalls_sensor_);
+  LOG_SENSOR("  ", "Integrity Errors", this->integrity_errors_sensor_);
+#ifdef DCF77_FLIGHT_RECORDER
+  ESP_LOGCONFIG(TAG, "  Flight Recorder: %" PRIu32 " records in %s, drift threshold %" PRId64 " ms",
+                FlightRing::CAPACITY,
+#ifdef DCF77_FLIGHT_RECORDER_RTC
+                "RTC memory",
+#else
+                "RAM",
+#endif
+                this->drift_threshold_us_ / 1000);
+#endif
+  for (size_t i = 1; i < this->transmitters_.size(); i++) {
+    ESP_LOGCONFIG(TAG, "  Transmitter %s:", dcf77::protocol_name(this->transmitters_[i].protocol));
+    LOG_PIN("    Pin: ", this->transmitters_[i].pin);
+  }
+#ifdef DCF77_PROFILING
+  ESP_LOGCONFIG(TAG, "  Profiling: enabled");
+#endif
+#ifdef DCF77_STATIC_CONFIG
+  ESP_LOGCONFIG(TAG, "  Static configuration: %u transmitters, LED %s", StaticConfig::TRANSMITTERS,
+                StaticConfig::LED_GPIO >= 0 ? "mirrored" : "off");
+#endif
+  this->dump_memory();
+}
+
+// -----------------------------------------------------------------------------
+// Dump profiling probes (call from a lambda, e.g. on a button press)
+// -----------------------------------------------------------------------------
+void DCF77Emitter::dump_probes() {
+#ifdef DCF77_PROFILING
+  ESP_LOGI(TAG, "Profiling probes:");
+  dcf77::probe::for_each([](const char *name, const char *unit, const dcf77::probe::Stats &s) {
+    ESP_LOGI(TAG, "  %-20s count=%" PRIu32 " min=%" PRIu32 " avg=%" PRIu32 " max=%" PRIu32 " %s", name, s.count,
+             s.min, static_cast<uint32_t>(s.total / s.count), s.max, unit);
+  });
+#else
+  ESP_LOGW(TAG, "Profiling is disabled; set 'profiling: true' to enable the probes");
+#endif
 }
 
 // -----------------------------------------------------------------------------
-// Utility helpers
+// Memory report (call dump_memory() from a lambda for current high-water marks)
+// -----------------------------------------------------------------------------
+void DCF77Emitter::dump_memory() {
+  const auto &sources = this->fusion_.sources();
+  ESP_LOGCONFIG(TAG, "  Memory (bytes):");
+  ESP_LOGCONFIG(TAG, "    Emitter: %" PRIu32 " (time fusion %" PRIu32 ", tick watchdog %" PRIu32
+                ", integrity monitor %" PRIu32 ")",
+                static_cast<uint32_t>(sizeof(*this)), static_cast<uint32_t>(sizeof(this->fusion_)),
+                static_cast<uint32_t>(sizeof(this->watchdog_)), static_cast<uint32_t>(sizeof(this->integrity_)));
+  ESP_LOGCONFIG(TAG, "    Frame buffers: %" PRIu32 " x %" PRIu32 ", time sources: %" PRIu32 " x %" PRIu32 " (heap)",
+                static_cast<uint32_t>(this->transmitters_.capacity()), static_cast<uint32_t>(sizeof(Transmitter)),
+                static_cast<uint32_t>(sources.capacity()),
+                static_cast<uint32_t>(sizeof(sources[0]) + sizeof(this->time_sources_[0])));
+#ifdef DCF77_GPS
+  ESP_LOGCONFIG(TAG, "    GPS reader: %" PRIu32 " (in the emitter)", static_cast<uint32_t>(sizeof(this->nmea_)));
+#endif
+#ifdef DCF77_FLIGHT_RECORDER
+  ESP_LOGCONFIG(TAG, "    Flight recorder: %" PRIu32 " (%s)", static_cast<uint32_t>(sizeof(flight_ring)),
+#ifdef DCF77_FLIGHT_RECORDER_RTC
+                "RTC memory"
+#else
+                "static"
+#endif
+  );
+#endif
+#ifdef DCF77_PROFILING
+  ESP_LOGCONFIG(TAG, "    Probe table: %" PRIu32 " (static)",
+                static_cast<uint32_t>(sizeof(dcf77::probe::Stats) * dcf77::probe::COUNT));
+#endif
+  // The ticks are scheduler timeouts (schedule_next_tick_()), so the loop
+  // task carries the tick path along with everything else of the emitter
+  ESP_LOGCONFIG(TAG, "    Stack never used: loop task %" PRIu32,
+                static_cast<uint32_t>(uxTaskGetStackHighWaterMark(nullptr)));
+  ESP_LOGCONFIG(TAG, "    Heap free: %" PRIu32 ", minimum since boot %" PRIu32, esp_get_free_heap_size(),
+                esp_get_minimum_free_heap_size());
+}
+
 // -----------------------------------------------------------------------------
-int DCF77Emitter::bin2bcd_(int dato) {
-  if (dato < 10)
-    return dato;
-  int msb = (dato / 10) << 4;
-  int lsb = dato % 10;
-  return msb + lsb;
+// Flight recorder (call dump_flight_recorder() from a lambda for a dump on demand)
+// -----------------------------------------------------------------------------
+void DCF77Emitter::dump_flight_recorder() {
+#ifdef DCF77_FLIGHT_RECORDER
+  flight_ring.trigger_dump(dcf77::FLIGHT_TRIGGER_MANUAL);
+#else
+  ESP_LOGW(TAG, "The flight recorder is disabled; add 'flight_recorder:' to enable it");
+#endif
+}
+
+#ifdef DCF77_FLIGHT_RECORDER
+// Writes a few lines of a running dump, or starts the one that is due
+void DCF77Emitter::write_flight_dump_() {
+  if (!this->flight_dump_.active()) {
+    const dcf77::FlightTrigger trigger = flight_ring.due();
+    if (trigger == dcf77::FLIGHT_TRIGGER_NONE)
+      return;
+    this->flight_dump_.begin(flight_ring, trigger);
+    ESP_LOGW(TAG, "Flight recorder dump (%s), analyse with host/dcf77_flight:", dcf77::flight_trigger_name(trigger));
+  }
+  char line[dcf77::FlightDump::LINE_SIZE];
+  for (int i = 0; i < FLIGHT_LINES_PER_LOOP && this->flight_dump_.next_line(flight_ring, line); i++)
+    ESP_LOGI(TAG, "%s", line);
+  if (!this->flight_dump_.active() && this->flight_dump_.lost() != 0)
+    ESP_LOGW(TAG, "Flight recorder: %" PRIu32 " records were overwritten during the dump", this->flight_dump_.lost());
 }
+#endif
 
 // -----------------------------------------------------------------------------
-// Encode time into impulse array (same logic as original)
+// Encode the frames of all transmitters
 // -----------------------------------------------------------------------------
+static dcf77::TimeCodeMinute time_code_minute(const ESPTime &time) {
+  dcf77::TimeCodeMinute t{};
+  t.minute = time.minute;
+  t.hour = time.hour;
+  t.day = time.day_of_month;
+  // ESPTime counts Sunday as 1, the time codes count Monday as 1 and Sunday as 7
+  t.day_of_week = time.day_of_week == 1 ? 7 : time.day_of_week - 1;
+  t.month = time.month;
+  t.year = time.year % 100;
+  t.dst = time.is_dst;
+  t.day_of_year = time.day_of_year;
+  t.leap_year = (time.year % 4 == 0 && time.year % 100 != 0) || time.year % 400 == 0;
+  return t;
+}
+
 void DCF77Emitter::code_time_() {
-  auto time = this->time_id_->now();
+  DCF77_PROBE(EMITTER_CODE_TIME);
+  auto time = now_();
   if (!time.is_valid())
     return;
 
-  this->day_of_week_ = time.day_of_week == 0 ? 7 : time.day_of_week;
-  this->actual_day_ = time.day_of_month;
-  this->actual_month_ = time.month;
-  this->actual_year_ = time.year % 100;
-  this->actual_hours_ = time.hour;
-  this->actual_minutes_ = time.minute + 1;
-  if (this->actual_minutes_ >= 60) {
-    this->actual_minutes_ = 0;
-    this->actual_hours_ = (this->actual_hours_ + 1) % 24;
-  }
-  this->actual_second_ = time.second;
-
-  int n, Tmp, TmpIn, ParityCount = 0;
-  for (n = 0; n < 20; n++)
-    this->impulse_array_[n] = 1;
-
-  if (!time.is_dst)
-    this->impulse_array_[18] = 2;
-  else
-    this->impulse_array_[17] = 2;
-
-  this->impulse_array_[20] = 2;
-
-  ParityCount = 0;
-  TmpIn = bin2bcd_(this->actual_minutes_);
-  for (n = 21; n < 28; n++) {
-    Tmp = TmpIn & 1;
-    this->impulse_array_[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  this->impulse_array_[28] = ((ParityCount & 1) == 0) ? 1 : 2;
-
-  ParityCount = 0;
-  TmpIn = bin2bcd_(this->actual_hours_);
-  for (n = 29; n < 35; n++) {
-    Tmp = TmpIn & 1;
-    this->impulse_array_[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  this->impulse_array_[35] = ((ParityCount & 1) == 0) ? 1 : 2;
-
-  ParityCount = 0;
-  TmpIn = bin2bcd_(this->actual_day_);
-  for (n = 36; n < 42; n++) {
-    Tmp = TmpIn & 1;
-    this->impulse_array_[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  TmpIn = bin2bcd_(this->day_of_week_);
-  for (n = 42; n < 45; n++) {
-    Tmp = TmpIn & 1;
-    this->impulse_array_[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  TmpIn = bin2bcd_(this->actual_month_);
-  for (n = 45; n < 50; n++) {
-    Tmp = TmpIn & 1;
-    this->impulse_array_[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  TmpIn = bin2bcd_(this->actual_year_);
-  for (n = 50; n < 58; n++) {
-    Tmp = TmpIn & 1;
-    this->impulse_array_[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  this->impulse_array_[58] = ((ParityCount & 1) == 0) ? 1 : 2;
-  this->impulse_array_[59] = 0;
+  this->encoded_minute_ = time.timestamp / 60;
+  const time_t minute_start = this->encoded_minute_ * 60;
+
+  // DCF77 and MSF transmit the time of the next minute. Going through the
+  // epoch keeps day, month, year and DST correct when that minute crosses them.
+  auto next = ESPTime::from_epoch_local(minute_start + 60);
+  const dcf77::TimeCodeMinute next_minute = time_code_minute(next);
+
+  this->day_of_week_ = next_minute.day_of_week;
+  this->actual_day_ = next.day_of_month;
+  this->actual_month_ = next.month;
+  this->actual_year_ = next.year % 100;
+  this->actual_hours_ = next.hour;
+  this->actual_minutes_ = next.minute;
+  this->integrity_.expect(dcf77::civil_from_time_code(next_minute));
+
+  for (auto &tx : this->transmitters_) {
+    dcf77::TimeCodeMinute t = next_minute;
+    switch (tx.protocol) {
+      case dcf77::Protocol::DCF77:
+        break;
+      case dcf77::Protocol::MSF:
+        // Set during the 61 minutes before a DST change
+        t.dst_change_soon = ESPTime::from_epoch_local(minute_start + 61 * 60).is_dst != time.is_dst;
+        break;
+      case dcf77::Protocol::WWVB: {
+        // UTC of this minute, with the local DST state at both ends of the UTC day
+        t = time_code_minute(ESPTime::from_epoch_utc(minute_start));
+        const time_t day_start = minute_start - minute_start % 86400;
+        t.dst_day_start = ESPTime::from_epoch_local(day_start).is_dst;
+        t.dst_day_end = ESPTime::from_epoch_local(day_start + 86400).is_dst;
+        break;
+      }
+      case dcf77::Protocol::JJY40:
+      case dcf77::Protocol::JJY60:
+        t = time_code_minute(time);
+        break;
+    }
+    tx.frame = dcf77::encode_time_code(tx.protocol, t);
+  }
+#ifdef DCF77_FLIGHT_RECORDER
+  const uint64_t frame = this->transmitters_[0].frame.a;
+  flight_ring.record(dcf77::flight_record(dcf77::FLIGHT_FRAME, minute_start * 1000000LL,
+                                          static_cast<int32_t>(frame >> 32), static_cast<uint32_t>(frame)));
+#endif
 }
 
 }  // namespace dcf77_emitter
@@ -4,6 +4,23 @@
 #include "esphome/core/hal.h"
 #include "esphome/components/time/real_time_clock.h"
 #include "esphome/components/switch/switch.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "dcf77_frame.h"
+#include "flight_recorder.h"
+#include "integrity_monitor.h"
+#include "tick_watchdog.h"
+#include "time_codes.h"
+#include "time_fusion.h"
+#ifdef DCF77_GPS
+#include "esphome/components/uart/uart.h"
+#include "nmea.h"
+#endif
+#ifdef DCF77_TIME_PUSH
+#include "esphome/components/api/custom_api_device.h"
+#endif
+
+#include <vector>
 
 // ESP-IDF platform includes
 #include "esp_timer.h"
@@ -13,13 +30,41 @@
 namespace esphome {
 namespace dcf77_emitter {
 
-class DCF77Emitter : public Component {
+class DCF77Emitter : public Component
+#ifdef DCF77_TIME_PUSH
+    , public api::CustomAPIDevice
+#endif
+{
  public:
   // === Configuration setters ===
-  void set_time_id(time::RealTimeClock *time_id) { this->time_id_ = time_id; }
+  /// Single time source, taken as exact (resolution 0).
+  void set_time_id(time::RealTimeClock *time_id) { this->add_time_source(time_id, "time", 0); }
+  /// Adds a time source whose readings are truncated to |resolution_us|
+  /// (1 s for Home Assistant, RTC chips and GPS, 0 for SNTP).
+  void add_time_source(time::RealTimeClock *clock, const char *name, uint32_t resolution_us);
+  void set_time_error_sensor(sensor::Sensor *sensor) { this->time_error_sensor_ = sensor; }
+  void set_time_source_sensor(text_sensor::TextSensor *sensor) { this->time_source_sensor_ = sensor; }
+  /// Ticks later than this blank the rest of the minute (tick_watchdog.h).
+  void set_stall_threshold(uint32_t threshold_us) { this->watchdog_.set_threshold_us(threshold_us); }
+  void set_stalls_sensor(sensor::Sensor *sensor) { this->stalls_sensor_ = sensor; }
+  void set_integrity_errors_sensor(sensor::Sensor *sensor) { this->integrity_errors_sensor_ = sensor; }
+#ifdef DCF77_FLIGHT_RECORDER
+  /// A reading this far off the clock, beyond its source's resolution,
+  /// dumps the flight recorder.
+  void set_drift_threshold(uint32_t threshold_us) { this->drift_threshold_us_ = threshold_us; }
+#endif
+#ifdef DCF77_GPS
+  /// Adds a GPS receiver's NMEA output as time source "gps". With a PPS pin
+  /// each pulse marks the exact start of the second named by the sentences
+  /// that follow it; without, only to the sentence's delay of up to 250 ms.
+  void set_gps_uart(uart::UARTComponent *uart) { this->gps_uart_ = uart; }
+  void set_gps_pps_pin(InternalGPIOPin *pin) { this->gps_pps_pin_ = pin; }
+#endif
   void set_antenna_pin(InternalGPIOPin *pin) { this->antenna_pin_ = pin; }
   void set_led_pin(InternalGPIOPin *pin) { this->led_pin_ = pin; }
   void set_sync_switch(switch_::Switch *sync_switch) { this->sync_switch_ = sync_switch; }
+  /// Sends |protocol| on |pin| alongside DCF77 on the antenna pin.
+  void add_transmitter(dcf77::Protocol protocol, InternalGPIOPin *pin);
 
   // === Core ESPHome lifecycle ===
   void setup() override;
@@ -29,27 +74,121 @@ class DCF77Emitter : public Component {
 
   // === Timer and signal callbacks ===
   void dcf_out_tick();
-  void setup_timer_();
+
+  // === Diagnostics ===
+  void dump_probes();
+  void dump_flight_recorder();
+  /// Logs static RAM by module, the stack high-water mark of the loop task,
+  /// which runs the tick path, and the heap low-water mark (also in
+  /// dump_config).
+  void dump_memory();
+  /// Heap taken per transmitter, for host/check_ram_budget.sh
+  static constexpr size_t transmitter_bytes() { return sizeof(Transmitter); }
+  const dcf77::TimeFusion &time_fusion() const { return this->fusion_; }
+  const dcf77::TickWatchdog &tick_watchdog() const { return this->watchdog_; }
+  const dcf77::IntegrityMonitor &integrity_monitor() const { return this->integrity_; }
 
  protected:
   // === Core functional methods ===
   void code_time_();
-  int bin2bcd_(int dato);
   void generate_signal_(int current_second);
-  void setup_carrier_();
   void stop_carrier_();
   void schedule_next_tick_();
+  void plan_second_(int current_second);
+  void set_carriers_(uint8_t reduced);
+
+  // === Time sources ===
+  /// Local time of the disciplined clock |ahead_us| from now.
+  ESPTime now_(int64_t ahead_us = 0);
+  void sample_system_clock_(int source);
+  void add_reading_(int source, int64_t local_us, int64_t utc_us);
+  void publish_time_quality_();
+#ifdef DCF77_FLIGHT_RECORDER
+  void write_flight_dump_();
+#endif
+#ifdef DCF77_GPS
+  static void gps_pps_isr_(DCF77Emitter *self);
+  void read_gps_();
+#endif
+#ifdef DCF77_TIME_PUSH
+  void on_time_push_(std::string epoch, std::string ack, std::string ack_received);
+#endif
 
   // === Dependencies ===
-  time::RealTimeClock *time_id_{nullptr};
+  std::vector<time::RealTimeClock *> time_sources_;
   InternalGPIOPin *antenna_pin_{nullptr};
   InternalGPIOPin *led_pin_{nullptr};
   switch_::Switch *sync_switch_{nullptr};
+  sensor::Sensor *time_error_sensor_{nullptr};
+  text_sensor::TextSensor *time_source_sensor_{nullptr};
+  sensor::Sensor *stalls_sensor_{nullptr};
+  sensor::Sensor *integrity_errors_sensor_{nullptr};
+
+  // === Disciplined clock ===
+  // All time components set the one system clock. A source's sync
+  // callback, or a step of the system clock against esp_timer, is a reading
+  // of the source that synchronised last. The GPS feeds its readings
+  // directly.
+  dcf77::TimeFusion fusion_;
+  int last_synced_source_{0};
+  int64_t system_offset_us_{0};
+  int64_t system_sampled_us_{0};
+  int selected_source_{-2};
+  time_t now_epoch_{-1};
+  ESPTime now_cache_{};
+
+#ifdef DCF77_GPS
+  // === GPS ===
+  uart::UARTComponent *gps_uart_{nullptr};
+  InternalGPIOPin *gps_pps_pin_{nullptr};
+  dcf77::NmeaTime nmea_;
+  int gps_source_{-1};
+  int64_t gps_last_ms_{0};
+  // Written by the PPS interrupt; the count tells a torn read of the time
+  volatile int64_t pps_local_us_{0};
+  volatile uint32_t pps_count_{0};
+#endif
+
+#ifdef DCF77_TIME_PUSH
+  // === Time push over the native API ===
+  int push_source_{-1};
+  bool push_pending_{false};
+  bool push_compensated_{false};
+  int64_t push_local_us_{0};
+  int64_t push_utc_us_{0};
+  int64_t push_second_{-1};  // second of the disciplined clock it arrived in
+#endif
 
   // === Signal generation ===
-  int impulse_array_[60];
+  // One LEDC channel per code; transmitters_[0] is DCF77 on the antenna pin.
+  struct Transmitter {
+    dcf77::Protocol protocol;
+    InternalGPIOPin *pin;
+    ledc_channel_t channel;
+    dcf77::TimeCodeFrame frame;
+  };
+  std::vector<Transmitter> transmitters_;
+  int64_t encoded_minute_{-1};
+  // Bit i set: transmitter i is reduced during that tenth of the second
+  uint8_t reduced_at_[10]{};
+  uint8_t reduced_{0};
+  // Bit k set: a carrier changes at tenth k of the current second
+  uint16_t edge_tenths_{0};
+  // Blanks the rest of a minute after a late tick or a clock step
+  dcf77::TickWatchdog watchdog_;
+  uint32_t watchdog_steps_{0};
+  uint32_t stalls_published_{UINT32_MAX};
+  // Decodes the DCF77 edges as they are written
+  dcf77::IntegrityMonitor integrity_;
+  uint32_t integrity_published_{UINT32_MAX};
+#ifdef DCF77_FLIGHT_RECORDER
+  // The ring itself is a global, so it can live in RTC memory
+  dcf77::FlightDump flight_dump_;
+  int64_t tick_tenth_{-1};  // tenth served by the running tick, -1 outside ticks
+  uint32_t integrity_recorded_{0};
+  int64_t drift_threshold_us_{20000};
+#endif
   volatile int impulse_count_ = 0;
-  volatile bool carrier_enabled_ = false;
 
   // === Time tracking ===
   int actual_hours_ = 0;
@@ -62,19 +201,9 @@ class DCF77Emitter : public Component {
   volatile int last_second_ = -1;
 
   // === Control and state ===
-  ledc_channel_t pwm_channel_ = LEDC_CHANNEL_0;
   uint32_t last_status_log_ = 0;
   uint32_t sync_start_millis_ = 0;
   bool is_initialized_ = false;
-
-  // === Timing drift compensation ===
-  uint32_t last_tick_time_ = 0;
-  int32_t timing_drift_ms_ = 0;
-  uint32_t last_sync_millis_ = 0;
-  uint16_t consecutive_drift_corrections_ = 0;
-
-  // === ESP-IDF timer handle ===
-  esp_timer_handle_t esp_timer_handle_{nullptr};
 };
 
 }  // namespace dcf77_emitter
@@ -0,0 +1,61 @@
+#pragma once
+
+// DCF77 frame encoding shared by the ESPHome component, the Arduino sketch
+// and the host tools. Header-only, free of platform dependencies and limited
+// to C++11 because arduino-esp32 2.x still builds sketches with gnu++11.
+//
+// A frame is a 64-bit word where bit n holds the value transmitted in
+// second n of the minute (seconds 0..58; second 59 carries no pulse).
+
+#include <cstdint>
+#include <ctime>
+
+#include "dcf77_layout.h"
+
+namespace dcf77 {
+
+/// DCF77 frame layout:
+///   0       start of minute, always 0
+///   17/18   DST on / DST off
+///   20      start of time information, always 1
+///   21..27  minute (BCD), 28 parity
+///   29..34  hour (BCD), 35 parity
+///   36..57  day, day of week, month, year (BCD), 58 parity
+/// Bits 1..16 and 19 (weather, call bit, announcements) are left at 0.
+using Dcf77Layout = Layout<ParityKind::EVEN,
+                           Field<source::Constant<0>, 0, 1, Coding::BINARY>,
+                           Field<source::Dst, 17, 1, Coding::BINARY>,
+                           Field<source::Standard, 18, 1, Coding::BINARY>,
+                           Field<source::Constant<1>, 20, 1, Coding::BINARY>,
+                           Field<source::Minute, 21, 7, Coding::BCD, 28>,
+                           Field<source::Hour, 29, 6, Coding::BCD, 35>,
+                           Field<source::Day, 36, 6, Coding::BCD, 58>,
+                           Field<source::DayOfWeek, 42, 3, Coding::BINARY, 58>,
+                           Field<source::Month, 45, 5, Coding::BCD, 58>,
+                           Field<source::Year, 50, 8, Coding::BCD, 58>>;
+
+/// Builds the frame announcing |t|.
+inline uint64_t encode_frame(const CivilMinute &t) { return Dcf77Layout::encode(t); }
+
+/// Decodes |frame| into |t|. Returns false on a parity, marker bit, BCD
+/// digit or range error.
+inline bool decode_frame(uint64_t frame, CivilMinute *t) { return Dcf77Layout::decode(frame, t); }
+
+/// Length of the reduced-carrier pulse at the start of |second|: 100 ms for
+/// a 0 bit, 200 ms for a 1 bit and none in second 59 (the minute marker).
+constexpr int pulse_ms(uint64_t frame, int second) {
+  return second >= 59 ? 0 : ((frame >> second) & 1) ? 200 : 100;
+}
+
+/// Frame fields from a broken-down local time (struct tm conventions).
+inline CivilMinute civil_from_tm(const struct tm &tm) {
+  return CivilMinute{static_cast<uint8_t>(tm.tm_min),
+                     static_cast<uint8_t>(tm.tm_hour),
+                     static_cast<uint8_t>(tm.tm_mday),
+                     static_cast<uint8_t>(tm.tm_wday == 0 ? 7 : tm.tm_wday),
+                     static_cast<uint8_t>(tm.tm_mon + 1),
+                     static_cast<uint8_t>(tm.tm_year % 100),
+                     tm.tm_isdst > 0};
+}
+
+}  // namespace dcf77
@@ -0,0 +1,256 @@
+#pragma once
+
+// Declarative bit layouts for minute time codes.
+//
+// A layout is a list of Field<> descriptors: where a value goes in the
+// 64-bit frame (bit n = second n), how wide it is, whether it is sent in
+// BCD or binary, in which bit order, and which parity bit covers it. Fields
+// that name the same parity bit form one parity group. Layout<> expands the
+// list at compile time into an encoder and a matching decoder that are fully
+// unrolled and free of data-dependent branches; a new time code is a new
+// table, not new loops.
+//
+// Limited to C++11 like dcf77_frame.h, which builds the DCF77 encoder from
+// it for the component, the sketch and the host tools.
+
+#include <cstdint>
+
+namespace dcf77 {
+
+/// Civil time announced by a frame.
+struct CivilMinute {
+  uint8_t minute;       // [0-59]
+  uint8_t hour;         // [0-23]
+  uint8_t day;          // [1-31]
+  uint8_t day_of_week;  // monday=1 [1-7]
+  uint8_t month;        // [1-12]
+  uint8_t year;         // two digits [0-99]
+  bool dst;
+};
+
+// Convert a decimal number to BCD
+constexpr uint32_t bin2bcd(uint32_t value) { return ((value / 10) << 4) | (value % 10); }
+
+// Even parity bit of |bits|
+inline uint32_t parity(uint32_t bits) {
+  bits ^= bits >> 16;
+  bits ^= bits >> 8;
+  bits ^= bits >> 4;
+  bits ^= bits >> 2;
+  bits ^= bits >> 1;
+  return bits & 1;
+}
+
+// BCD5 is BCD with a spare bit between the digits, as WWVB and JJY send it
+enum class Coding : uint8_t { BINARY, BCD, BCD5 };
+enum class BitOrder : uint8_t { LSB_FIRST, MSB_FIRST };
+enum class ParityKind : uint8_t { EVEN, ODD };
+
+/// Parity bit of a field that is not covered by parity.
+const unsigned NO_PARITY = 64;
+
+// -----------------------------------------------------------------------------
+// Value sources: how a field reads its value from a CivilMinute and stores
+// it back. put() returns false for values out of range. As with
+// encode_frame(), the encoder expects values in range and does not mask them.
+// -----------------------------------------------------------------------------
+namespace source {
+
+// Sources are templates over the time struct, so one table can read a
+// CivilMinute or any struct with the same member names.
+struct Minute {
+  template <class T> static uint32_t get(const T &t) { return t.minute; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->minute = static_cast<uint8_t>(v)) <= 59; }
+};
+struct Hour {
+  template <class T> static uint32_t get(const T &t) { return t.hour; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->hour = static_cast<uint8_t>(v)) <= 23; }
+};
+struct Day {
+  template <class T> static uint32_t get(const T &t) { return t.day; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->day = static_cast<uint8_t>(v)) - 1u < 31u; }
+};
+struct DayOfWeek {
+  template <class T> static uint32_t get(const T &t) { return t.day_of_week; }
+  template <class T> static bool put(T *t, uint32_t v) {
+    return (t->day_of_week = static_cast<uint8_t>(v)) - 1u < 7u;
+  }
+};
+struct Month {
+  template <class T> static uint32_t get(const T &t) { return t.month; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->month = static_cast<uint8_t>(v)) - 1u < 12u; }
+};
+struct Year {
+  template <class T> static uint32_t get(const T &t) { return t.year; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->year = static_cast<uint8_t>(v)) <= 99; }
+};
+struct Dst {
+  template <class T> static uint32_t get(const T &t) { return t.dst; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->dst = v != 0), true; }
+};
+// Inverse of Dst; must come after the Dst field so the check sees it.
+struct Standard {
+  template <class T> static uint32_t get(const T &t) { return !t.dst; }
+  template <class T> static bool put(T *t, uint32_t v) { return v == static_cast<uint32_t>(!t->dst); }
+};
+template <uint32_t Value> struct Constant {
+  template <class T> static uint32_t get(const T &) { return Value; }
+  template <class T> static bool put(T *, uint32_t v) { return v == Value; }
+};
+
+}  // namespace source
+
+// -----------------------------------------------------------------------------
+// Coding helpers
+// -----------------------------------------------------------------------------
+namespace detail {
+
+template <unsigned Digits, unsigned Stride> struct Bcd {
+  static uint32_t encode(uint32_t v) { return Bcd<Digits - 1, Stride>::encode(v / 10) << Stride | v % 10; }
+  static uint32_t decode(uint32_t raw) { return Bcd<Digits - 1, Stride>::decode(raw >> Stride) * 10 + (raw & 0xF); }
+  static bool valid(uint32_t raw) { return ((raw & 0xF) <= 9) & Bcd<Digits - 1, Stride>::valid(raw >> Stride); }
+};
+// The top digit takes what is left; the field width masks it.
+template <unsigned Stride> struct Bcd<1, Stride> {
+  static uint32_t encode(uint32_t v) { return v; }
+  static uint32_t decode(uint32_t raw) { return raw; }
+  static bool valid(uint32_t raw) { return raw <= 9; }
+};
+
+// True if every nibble of |raw| is a decimal digit: adding 6 to each nibble
+// must not carry out of any of them.
+inline bool bcd_digits_valid(uint32_t raw) {
+  const uint64_t sum = uint64_t{raw} + 0x66666666u;
+  return ((sum ^ raw ^ 0x66666666u) & 0x111111110u) == 0;
+}
+
+// Digit coding of a field
+template <Coding Code, unsigned Width> struct Coder {
+  static uint32_t encode(uint32_t v) { return v; }
+  static uint32_t decode(uint32_t raw) { return raw; }
+  static bool valid(uint32_t) { return true; }
+};
+template <unsigned Width> struct Coder<Coding::BCD, Width> {
+  static uint32_t encode(uint32_t v) { return Bcd<(Width + 3) / 4, 4>::encode(v); }
+  static uint32_t decode(uint32_t raw) { return Bcd<(Width + 3) / 4, 4>::decode(raw); }
+  static bool valid(uint32_t raw) { return bcd_digits_valid(raw); }
+};
+template <unsigned Width> struct Coder<Coding::BCD5, Width> {
+  static uint32_t encode(uint32_t v) { return Bcd<(Width + 4) / 5, 5>::encode(v); }
+  static uint32_t decode(uint32_t raw) { return Bcd<(Width + 4) / 5, 5>::decode(raw); }
+  static bool valid(uint32_t raw) { return Bcd<(Width + 4) / 5, 5>::valid(raw); }
+};
+
+template <unsigned Width> inline uint32_t reverse_bits(uint32_t v) {
+  uint32_t r = 0;
+  for (unsigned i = 0; i < Width; i++)
+    r |= ((v >> i) & 1) << (Width - 1 - i);
+  return r;
+}
+
+constexpr unsigned lowest_bit(uint64_t mask) { return mask == 0 || (mask & 1) != 0 ? 0 : 1 + lowest_bit(mask >> 1); }
+
+// Parity of the bits of |value| under the constant |mask|, in 32-bit
+// arithmetic when the mask spans at most 32 bits.
+template <uint64_t Mask> inline uint32_t masked_parity(uint64_t value) {
+  return (Mask >> lowest_bit(Mask)) <= 0xFFFFFFFFu
+             ? parity(static_cast<uint32_t>((value & Mask) >> lowest_bit(Mask)))
+             : parity(static_cast<uint32_t>((value & Mask) ^ ((value & Mask) >> 32)));
+}
+
+}  // namespace detail
+
+// -----------------------------------------------------------------------------
+// Field descriptor
+// -----------------------------------------------------------------------------
+template <class Source, unsigned Start, unsigned Width, Coding Code = Coding::BCD, unsigned ParityBit = NO_PARITY,
+          BitOrder Order = BitOrder::LSB_FIRST>
+struct Field {
+  static_assert(Width >= 1 && Width <= 32 && Start + Width <= 64, "field outside the frame");
+  static_assert(ParityBit == NO_PARITY || ParityBit < Start || ParityBit >= Start + Width, "parity inside the field");
+
+  static constexpr unsigned PARITY_BIT = ParityBit;
+  static constexpr uint64_t MASK = ((uint64_t{1} << Width) - 1) << Start;
+
+  template <class T> static uint64_t encode(const T &t) {
+    uint32_t raw = detail::Coder<Code, Width>::encode(Source::get(t));
+    if (Order == BitOrder::MSB_FIRST)
+      raw = detail::reverse_bits<Width>(raw);
+    return uint64_t{raw} << Start;
+  }
+
+  template <class T> static bool decode(uint64_t frame, T *t) {
+    uint32_t raw = static_cast<uint32_t>(frame >> Start) & static_cast<uint32_t>((uint64_t{1} << Width) - 1);
+    if (Order == BitOrder::MSB_FIRST)
+      raw = detail::reverse_bits<Width>(raw);
+    return detail::Coder<Code, Width>::valid(raw) & Source::put(t, detail::Coder<Code, Width>::decode(raw));
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Layout: the encoder and decoder generated from a field list
+// -----------------------------------------------------------------------------
+template <ParityKind Kind, class... Fields> struct Layout;
+
+template <ParityKind Kind> struct Layout<Kind> {
+  static constexpr uint64_t group_mask(unsigned) { return 0; }
+  static constexpr uint64_t data_mask() { return 0; }
+  template <class T> static uint64_t encode_data(const T &) { return 0; }
+  template <class Full> static uint64_t encode_parity(uint64_t) { return 0; }
+  template <class T> static bool decode_data(uint64_t, T *) { return true; }
+  template <class Full> static bool check_parity(uint64_t) { return true; }
+};
+
+template <ParityKind Kind, class F, class... Rest> struct Layout<Kind, F, Rest...> {
+  using Tail = Layout<Kind, Rest...>;
+
+  /// Data bits covered by parity bit |bit|.
+  static constexpr uint64_t group_mask(unsigned bit) {
+    return (F::PARITY_BIT == bit ? F::MASK : 0) | Tail::group_mask(bit);
+  }
+  /// Bits carried by the fields.
+  static constexpr uint64_t data_mask() { return F::MASK | Tail::data_mask(); }
+
+  /// Frame announcing |t|.
+  template <class T> static uint64_t encode(const T &t) {
+    const uint64_t data = encode_data(t);
+    return data | encode_parity<Layout>(data);
+  }
+
+  /// Decodes |frame| into |t|. Returns false if a parity, constant bit,
+  /// BCD digit or field range is wrong; |t| is filled in either way.
+  template <class T> static bool decode(uint64_t frame, T *t) {
+    // Non-short-circuit & keeps every field decoded and the code branch-free
+    return decode_data(frame, t) & check_parity<Layout>(frame);
+  }
+
+  template <class T> static uint64_t encode_data(const T &t) { return F::encode(t) | Tail::encode_data(t); }
+
+  // Each parity group is handled once, by its last field, with the group
+  // mask taken from the full layout.
+  template <class Full> static uint64_t encode_parity(uint64_t data) {
+    return (last_in_group_() ? uint64_t{detail::masked_parity<Full::group_mask(F::PARITY_BIT)>(data) ^
+                                        (Kind == ParityKind::ODD)}
+                                   << (F::PARITY_BIT & 63)
+                             : 0) |
+           Tail::template encode_parity<Full>(data);
+  }
+
+  template <class T> static bool decode_data(uint64_t frame, T *t) {
+    return F::decode(frame, t) & Tail::decode_data(frame, t);
+  }
+
+  template <class Full> static bool check_parity(uint64_t frame) {
+    return (!last_in_group_() ||
+            (detail::masked_parity<Full::group_mask(F::PARITY_BIT) | (uint64_t{1} << (F::PARITY_BIT & 63))>(frame) ==
+             static_cast<uint32_t>(Kind == ParityKind::ODD))) &
+           Tail::template check_parity<Full>(frame);
+  }
+
+ protected:
+  static constexpr bool last_in_group_() {
+    return F::PARITY_BIT != NO_PARITY && Tail::group_mask(F::PARITY_BIT) == 0;
+  }
+};
+
+}  // namespace dcf77
@@ -0,0 +1,145 @@
+#pragma once
+
+// Compile-time switchable profiling scopes for the transmitter's hot paths,
+// shared by the ESPHome component, the Arduino sketch and the host tools.
+//
+// Define DCF77_PROFILING to enable them. Without it DCF77_PROBE() and
+// DCF77_PROBE_LONG() expand to nothing (host/check_probe_size.sh verifies
+// that the component's object code is unchanged).
+//
+// DCF77_PROBE() times short scopes with the Xtensa CCOUNT register (CPU
+// cycles, wraps after about 17 s at 240 MHz). DCF77_PROBE_LONG() is for
+// scopes that may take seconds and uses esp_timer microseconds. On the host
+// both fall back to std::chrono::steady_clock (nanoseconds and
+// microseconds). Statistics live in one static table; updates are not
+// atomic, so a rare lost update between tasks is accepted.
+
+#ifdef DCF77_PROFILING
+
+#include <cstdint>
+
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#else
+#include <chrono>
+#endif
+
+namespace dcf77 {
+namespace probe {
+
+enum Id : uint8_t {
+  // Arduino sketch
+  WIFI_ON,
+  GET_NTP,
+  CHECK_SLEEP,
+  CODE_TIME,
+  DCF_OUT,
+  // ESPHome component
+  EMITTER_CODE_TIME,
+  EMITTER_TICK,
+  EMITTER_SCHEDULE,
+  COUNT,
+};
+
+struct Stats {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+};
+
+inline const char *name(Id id) {
+  static const char *const NAMES[COUNT] = {
+      "WiFi_on",   "getNTP",     "checkSleep",          "CodeTime",
+      "DcfOut",    "code_time_", "dcf_out_tick",        "schedule_next_tick_",
+  };
+  return id < COUNT ? NAMES[id] : "?";
+}
+
+// Probes measured with DCF77_PROBE_LONG()
+inline bool is_long(Id id) { return id == WIFI_ON || id == GET_NTP || id == CHECK_SLEEP; }
+
+#if defined(__XTENSA__)
+inline uint32_t cycles() {
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+  return ccount;
+}
+inline uint32_t micros() { return static_cast<uint32_t>(esp_timer_get_time()); }
+static const char *const CYCLE_UNIT = "cycles";
+#elif defined(ESP_PLATFORM)
+// RISC-V targets have no CCOUNT; fall back to microseconds.
+inline uint32_t cycles() { return static_cast<uint32_t>(esp_timer_get_time()); }
+inline uint32_t micros() { return static_cast<uint32_t>(esp_timer_get_time()); }
+static const char *const CYCLE_UNIT = "us";
+#else
+inline uint32_t cycles() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+inline uint32_t micros() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+static const char *const CYCLE_UNIT = "ns";
+#endif
+
+inline const char *unit(Id id) { return is_long(id) ? "us" : CYCLE_UNIT; }
+
+inline Stats *table() {
+  static Stats stats[COUNT];
+  return stats;
+}
+
+inline void record(Id id, uint32_t elapsed) {
+  Stats &s = table()[id];
+  if (s.count == 0 || elapsed < s.min)
+    s.min = elapsed;
+  if (elapsed > s.max)
+    s.max = elapsed;
+  s.total += elapsed;
+  s.count++;
+}
+
+inline void reset() {
+  for (int i = 0; i < COUNT; i++)
+    table()[i] = Stats{0, 0, 0, 0};
+}
+
+// Calls f(name, unit, stats) for every probe that has fired
+template<typename F> void for_each(F f) {
+  for (int i = 0; i < COUNT; i++) {
+    const Stats &s = table()[i];
+    if (s.count != 0)
+      f(name(static_cast<Id>(i)), unit(static_cast<Id>(i)), s);
+  }
+}
+
+template<uint32_t (*Clock)()> class Scope {
+ public:
+  explicit Scope(Id id) : id_(id), start_(Clock()) {}
+  ~Scope() { record(this->id_, Clock() - this->start_); }
+
+ private:
+  Id id_;
+  uint32_t start_;
+};
+
+}  // namespace probe
+}  // namespace dcf77
+
+#define DCF77_PROBE_CAT_(a, b) a##b
+#define DCF77_PROBE_CAT(a, b) DCF77_PROBE_CAT_(a, b)
+#define DCF77_PROBE(id) \
+  ::dcf77::probe::Scope<::dcf77::probe::cycles> DCF77_PROBE_CAT(dcf77_probe_, __LINE__)(::dcf77::probe::id)
+#define DCF77_PROBE_LONG(id) \
+  ::dcf77::probe::Scope<::dcf77::probe::micros> DCF77_PROBE_CAT(dcf77_probe_, __LINE__)(::dcf77::probe::id)
+
+#else
+
+#define DCF77_PROBE(id)
+#define DCF77_PROBE_LONG(id)
+
+#endif  // DCF77_PROFILING
@@ -0,0 +1,335 @@
+#pragma once
+
+// Flight recorder of the emitted signal, shared by the ESPHome component
+// and the Arduino sketch. Header-only, free of platform dependencies and
+// limited to C++11 like dcf77_frame.h.
+//
+// A ring of fixed-size records: every carrier edge with its deadline and
+// how late it was written, the frame of every minute, time readings and
+// the stalls and integrity errors found. The tick path writes, the main
+// loop reads. Writes take no lock: like the slots of linux/schedule_ring.h
+// the ring counts writes started and writes finished, and a reader drops a
+// record that a write started on while it copied it. The recorder is a
+// plain aggregate without constructors, so it can be placed in RTC memory
+// that is not cleared at reset (init() checks what it finds there).
+//
+// An anomaly triggers a dump of the ring once a few more records show its
+// aftermath. The dump is one binary image (FlightDumpHeader and the
+// records, little-endian, with an FNV-1a check), written as lines of hex to
+// the log, a few per main loop pass. host/dcf77_flight.cpp extracts it from
+// a log and analyses it.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace dcf77 {
+
+enum FlightKind : uint8_t {
+  FLIGHT_NONE,       // empty, or overwritten while dumped
+  FLIGHT_EDGE,       // carriers written: data = reduced carriers, bit i = transmitter i
+  FLIGHT_FRAME,      // DCF77 frame sent in the minute from |second|: data = bits 0..31, lag_us = bits 32..63
+  FLIGHT_READING,    // time reading: aux = source, lag_us = reading minus the clock, data = 1 if accepted
+  FLIGHT_STALL,      // tick watchdog stall: aux = StallCause, lag_us = lateness
+  FLIGHT_INTEGRITY,  // self-decode error: aux = IntegrityMonitor::Error, data = errors so far
+  FLIGHT_KINDS,
+};
+
+enum FlightTrigger : uint8_t {
+  FLIGHT_TRIGGER_NONE,
+  FLIGHT_TRIGGER_STALL,
+  FLIGHT_TRIGGER_INTEGRITY,
+  FLIGHT_TRIGGER_DRIFT,
+  FLIGHT_TRIGGER_RESET,   // records kept in RTC memory across a reset
+  FLIGHT_TRIGGER_MANUAL,
+  FLIGHT_TRIGGERS,
+};
+
+inline const char *flight_kind_name(int kind) {
+  static const char *const NAMES[FLIGHT_KINDS] = {"none", "edge", "frame", "reading", "stall", "integrity"};
+  return kind >= 0 && kind < FLIGHT_KINDS ? NAMES[kind] : "?";
+}
+
+inline const char *flight_trigger_name(int trigger) {
+  static const char *const NAMES[FLIGHT_TRIGGERS] = {"none", "stall", "integrity", "drift", "reset", "manual"};
+  return trigger >= 0 && trigger < FLIGHT_TRIGGERS ? NAMES[trigger] : "?";
+}
+
+/// One event, 20 bytes. Times are UTC of the emitted clock: |second| since
+/// the epoch and |due_us| into it, the deadline of an edge or the time of
+/// an event. |lag_us| of an edge is the time it reached the LEDC peripheral
+/// minus its deadline.
+struct FlightRecord {
+  uint32_t second;
+  int32_t due_us;
+  int32_t lag_us;
+  uint32_t data;
+  uint16_t sequence;  // low bits of the record's index in the ring
+  uint8_t kind;       // FlightKind
+  uint8_t aux;
+};
+
+static_assert(sizeof(FlightRecord) == 20, "flight records are 20 bytes");
+
+inline FlightRecord flight_record(FlightKind kind, int64_t utc_us, int64_t lag_us, uint32_t data, uint8_t aux = 0) {
+  FlightRecord r;
+  r.second = static_cast<uint32_t>(utc_us / 1000000);
+  r.due_us = static_cast<int32_t>(utc_us % 1000000);
+  r.lag_us = static_cast<int32_t>(lag_us < INT32_MIN ? INT32_MIN : lag_us > INT32_MAX ? INT32_MAX : lag_us);
+  r.data = data;
+  r.sequence = 0;
+  r.kind = kind;
+  r.aux = aux;
+  return r;
+}
+
+/// Header of a dump image, followed by |count| records.
+struct FlightDumpHeader {
+  uint32_t magic;    // FLIGHT_DUMP_MAGIC
+  uint8_t version;   // FLIGHT_DUMP_VERSION
+  uint8_t trigger;   // FlightTrigger
+  uint16_t record_size;
+  uint32_t count;
+  uint32_t first;    // index of the first record in the ring
+};
+
+static const uint32_t FLIGHT_DUMP_MAGIC = 0x52464344;  // "DCFR"
+static const uint8_t FLIGHT_DUMP_VERSION = 1;
+static const size_t FLIGHT_DUMP_HEADER_SIZE = 16;
+/// Marks the dump lines in a log
+#define DCF77_FLIGHT_PREFIX "DCF77FR"
+
+inline void flight_put(uint8_t *out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++)
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+inline uint32_t flight_get(const uint8_t *in, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++)
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  return value;
+}
+
+inline void flight_encode(const FlightDumpHeader &h, uint8_t *out) {
+  flight_put(out, h.magic, 4);
+  out[4] = h.version;
+  out[5] = h.trigger;
+  flight_put(out + 6, h.record_size, 2);
+  flight_put(out + 8, h.count, 4);
+  flight_put(out + 12, h.first, 4);
+}
+
+inline void flight_encode(const FlightRecord &r, uint8_t *out) {
+  flight_put(out, r.second, 4);
+  flight_put(out + 4, static_cast<uint32_t>(r.due_us), 4);
+  flight_put(out + 8, static_cast<uint32_t>(r.lag_us), 4);
+  flight_put(out + 12, r.data, 4);
+  flight_put(out + 16, r.sequence, 2);
+  out[18] = r.kind;
+  out[19] = r.aux;
+}
+
+inline bool flight_decode(const uint8_t *in, FlightDumpHeader *h) {
+  h->magic = flight_get(in, 4);
+  h->version = in[4];
+  h->trigger = in[5];
+  h->record_size = static_cast<uint16_t>(flight_get(in + 6, 2));
+  h->count = flight_get(in + 8, 4);
+  h->first = flight_get(in + 12, 4);
+  return h->magic == FLIGHT_DUMP_MAGIC && h->version == FLIGHT_DUMP_VERSION && h->record_size == sizeof(FlightRecord);
+}
+
+inline void flight_decode(const uint8_t *in, FlightRecord *r) {
+  r->second = flight_get(in, 4);
+  r->due_us = static_cast<int32_t>(flight_get(in + 4, 4));
+  r->lag_us = static_cast<int32_t>(flight_get(in + 8, 4));
+  r->data = flight_get(in + 12, 4);
+  r->sequence = static_cast<uint16_t>(flight_get(in + 16, 2));
+  r->kind = in[18];
+  r->aux = in[19];
+}
+
+inline uint32_t flight_fnv1a(uint32_t hash, const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ data[i]) * 16777619u;
+  return hash;
+}
+static const uint32_t FLIGHT_FNV_SEED = 2166136261u;
+
+/// Ring of the last N records. One writer, any number of readers.
+template<uint32_t N> struct FlightRecorder {
+  static const uint32_t CAPACITY = N;
+  /// Records written after a trigger before the dump starts
+  static const uint32_t AFTERMATH = N / 8;
+
+  static const uint32_t MAGIC = 0x46524543;  // "CERF"
+
+  uint32_t magic;
+  std::atomic<uint32_t> claimed;    // writes started
+  std::atomic<uint32_t> written;    // writes finished
+  std::atomic<uint8_t> trigger;     // FlightTrigger waiting for its dump
+  uint32_t trigger_at;              // |written| when it was triggered
+  std::atomic<uint32_t> dumped_at;  // |written| when the last dump started, 0 before the first
+  uint32_t suppressed;              // triggers while one was pending or too soon after a dump
+  FlightRecord records[N];
+
+  /// Prepares the ring. Returns true if it holds records from before a
+  /// reset, as RTC memory can; anything else found there is cleared.
+  bool init() {
+    this->trigger.store(FLIGHT_TRIGGER_NONE, std::memory_order_relaxed);
+    this->dumped_at.store(0, std::memory_order_relaxed);
+    if (this->magic == MAGIC) {
+      uint32_t w = this->written.load(std::memory_order_relaxed);
+      if (this->claimed.load(std::memory_order_relaxed) != w) {
+        // A write cut off by the reset: its slot is lost
+        this->records[w % N] = FlightRecord{};
+        this->records[w % N].sequence = static_cast<uint16_t>(w);
+        w++;
+        this->written.store(w, std::memory_order_relaxed);
+      }
+      this->claimed.store(w, std::memory_order_relaxed);
+      return w != 0;
+    }
+    this->claimed.store(0, std::memory_order_relaxed);
+    this->written.store(0, std::memory_order_relaxed);
+    this->trigger_at = 0;
+    this->suppressed = 0;
+    for (FlightRecord &r : this->records)
+      r.kind = FLIGHT_NONE;
+    this->magic = MAGIC;
+    return false;
+  }
+
+  void record(FlightRecord r) {
+    const uint32_t i = this->claimed.load(std::memory_order_relaxed);
+    r.sequence = static_cast<uint16_t>(i);
+    this->claimed.store(i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->records[i % N] = r;
+    this->written.store(i + 1, std::memory_order_release);
+  }
+
+  /// Asks for a dump. Ignored while one is pending, or until half the ring
+  /// was rewritten since the last, so dumps of one incident do not repeat.
+  void trigger_dump(FlightTrigger reason) {
+    const uint32_t w = this->written.load(std::memory_order_relaxed);
+    const uint32_t dumped = this->dumped_at.load(std::memory_order_relaxed);
+    if (this->trigger.load(std::memory_order_relaxed) != FLIGHT_TRIGGER_NONE || (dumped != 0 && w - dumped < N / 2)) {
+      this->suppressed++;
+      return;
+    }
+    this->trigger_at = w;
+    this->trigger.store(reason, std::memory_order_release);
+  }
+
+  /// The trigger whose dump is due now, after its aftermath was recorded.
+  FlightTrigger due() const {
+    const uint8_t t = this->trigger.load(std::memory_order_acquire);
+    if (t == FLIGHT_TRIGGER_NONE)
+      return FLIGHT_TRIGGER_NONE;
+    const uint32_t w = this->written.load(std::memory_order_relaxed);
+    return (w - this->trigger_at >= AFTERMATH || t == FLIGHT_TRIGGER_RESET) ? static_cast<FlightTrigger>(t)
+                                                                             : FLIGHT_TRIGGER_NONE;
+  }
+
+  /// Copies record |index|. False if it was not written yet or was
+  /// overwritten before the copy completed.
+  bool read(uint32_t index, FlightRecord *out) const {
+    if (index - this->written.load(std::memory_order_acquire) < 0x80000000u)
+      return false;
+    *out = this->records[index % N];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return this->claimed.load(std::memory_order_relaxed) - index <= N;
+  }
+};
+
+/// Writes a dump of a FlightRecorder as hex lines, a few at a time.
+class FlightDump {
+ public:
+  /// Bytes of the image per line
+  static const size_t LINE_BYTES = 40;
+  /// Large enough for one line
+  static const size_t LINE_SIZE = sizeof(DCF77_FLIGHT_PREFIX) + 6 + 2 * LINE_BYTES + 1;
+
+  bool active() const { return this->active_; }
+
+  /// Starts a dump of everything in |ring| for |reason|. Leaves room for
+  /// the records written while it runs, so few of the oldest are lost.
+  template<uint32_t N> void begin(FlightRecorder<N> &ring, FlightTrigger reason, uint32_t margin = N / 16) {
+    const uint32_t w = ring.written.load(std::memory_order_acquire);
+    const uint32_t keep = N - margin;
+    this->first_ = w > keep ? w - keep : 0;
+    this->count_ = w - this->first_;
+    FlightDumpHeader h{FLIGHT_DUMP_MAGIC, FLIGHT_DUMP_VERSION, static_cast<uint8_t>(reason),
+                       static_cast<uint16_t>(sizeof(FlightRecord)), this->count_, this->first_};
+    flight_encode(h, this->header_);
+    ring.dumped_at.store(w == 0 ? 1 : w, std::memory_order_relaxed);
+    ring.trigger.store(FLIGHT_TRIGGER_NONE, std::memory_order_release);
+    this->offset_ = 0;
+    this->hash_ = FLIGHT_FNV_SEED;
+    this->lost_ = 0;
+    this->active_ = true;
+  }
+
+  /// Formats the next line into |line| (LINE_SIZE bytes). Returns false
+  /// once the dump is complete.
+  template<uint32_t N> bool next_line(const FlightRecorder<N> &ring, char *line) {
+    if (!this->active_)
+      return false;
+    const size_t total = FLIGHT_DUMP_HEADER_SIZE + static_cast<size_t>(this->count_) * sizeof(FlightRecord);
+    if (this->offset_ >= total) {
+      snprintf(line, LINE_SIZE, DCF77_FLIGHT_PREFIX " end %08x", static_cast<unsigned>(this->hash_));
+      this->active_ = false;
+      return true;
+    }
+    uint8_t bytes[LINE_BYTES];
+    size_t n = 0;
+    for (; n < LINE_BYTES && this->offset_ + n < total; n++)
+      bytes[n] = this->byte_(ring, this->offset_ + n);
+    this->hash_ = flight_fnv1a(this->hash_, bytes, n);
+    static const char HEX[] = "0123456789abcdef";
+    int pos = snprintf(line, LINE_SIZE, DCF77_FLIGHT_PREFIX " %05x ", static_cast<unsigned>(this->offset_));
+    for (size_t i = 0; i < n; i++) {
+      line[pos++] = HEX[bytes[i] >> 4];
+      line[pos++] = HEX[bytes[i] & 15];
+    }
+    line[pos] = '\0';
+    this->offset_ += n;
+    return true;
+  }
+
+  /// Records overwritten before they were dumped, sent as FLIGHT_NONE
+  uint32_t lost() const { return this->lost_; }
+
+ protected:
+  template<uint32_t N> uint8_t byte_(const FlightRecorder<N> &ring, size_t offset) {
+    if (offset < FLIGHT_DUMP_HEADER_SIZE)
+      return this->header_[offset];
+    const size_t at = offset - FLIGHT_DUMP_HEADER_SIZE;
+    const uint32_t index = this->first_ + static_cast<uint32_t>(at / sizeof(FlightRecord));
+    if (at % sizeof(FlightRecord) == 0) {
+      // Each record is copied once, when its first byte is due
+      FlightRecord r;
+      if (!ring.read(index, &r)) {
+        r = FlightRecord{};
+        r.sequence = static_cast<uint16_t>(index);
+        this->lost_++;
+      }
+      flight_encode(r, this->record_);
+    }
+    return this->record_[at % sizeof(FlightRecord)];
+  }
+
+  bool active_{false};
+  uint8_t header_[FLIGHT_DUMP_HEADER_SIZE]{};
+  uint8_t record_[sizeof(FlightRecord)]{};
+  uint32_t first_{0};
+  uint32_t count_{0};
+  size_t offset_{0};
+  uint32_t hash_{0};
+  uint32_t lost_{0};
+};
+
+}  // namespace dcf77
@@ -0,0 +1,174 @@
+#pragma once
+
+// On-device decoder of the emitted DCF77 signal, shared by the ESPHome
+// component and the Arduino sketch. Header-only, free of platform
+// dependencies and limited to C++11 like dcf77_frame.h.
+//
+// The transmitter reports every DCF77 carrier edge with the esp_timer time
+// at which it was written to the LEDC peripheral. The monitor measures the
+// pulses from those times, the way a receiver would from the air: a pulse
+// starts every second, 100 ms for a 0 and 200 ms for a 1, and the missing
+// pulse of second 59 marks the minute. At the end of second 58 it decodes
+// the minute and compares it with the civil minute the frame was coded
+// for. Each edge costs a few comparisons; the decode runs once a minute.
+//
+// The tolerances are tighter than a receiver's, so a violation shows up
+// here before clocks miss a minute.
+
+#include <cstdint>
+
+#include "dcf77_frame.h"
+
+namespace dcf77 {
+
+class IntegrityMonitor {
+ public:
+  /// Deviation of a pulse width or a pulse spacing that is counted as a
+  /// violation, short of the 50 ms at which a 0 reads as a 1.
+  static const int64_t TOLERANCE_US = 30000;
+
+  enum Error : uint8_t {
+    ERROR_WIDTH,     // a pulse not 100 or 200 ms long
+    ERROR_SPACING,   // a pulse not 1 s after the previous one, or 2 s at the marker
+    ERROR_FRAMING,   // a minute marker after other than 59 pulses, or bits 0/20 wrong
+    ERROR_PARITY,    // a parity bit that does not match its field
+    ERROR_MISMATCH,  // a minute that decodes to another time than intended
+    ERRORS,
+  };
+
+  /// Forgets the current minute, e.g. while the signal is off or blanked.
+  /// Checking resumes after the next minute marker. The counters are kept.
+  void restart() {
+    this->synced_ = false;
+    this->last_start_us_ = -1;
+    this->in_pulse_ = false;
+  }
+
+  /// Sets the civil minute the frame now being emitted announces.
+  void expect(const CivilMinute &t) {
+    this->expected_ = t;
+    this->has_expected_ = true;
+  }
+
+  /// Reports a DCF77 carrier edge written at |time_us|: |reduced| for the
+  /// start of a pulse, false for its end.
+  void edge(int64_t time_us, bool reduced) {
+    if (reduced) {
+      this->pulse_start_(time_us);
+    } else if (this->in_pulse_) {
+      this->pulse_end_(time_us);
+    }
+  }
+
+  uint32_t errors(int error) const { return this->errors_[error]; }
+  uint32_t total_errors() const {
+    uint32_t total = 0;
+    for (uint32_t n : this->errors_)
+      total += n;
+    return total;
+  }
+  /// Minutes decoded and compared, correct or not
+  uint32_t minutes_checked() const { return this->checked_; }
+  uint32_t minutes_ok() const { return this->ok_; }
+  /// The Error counted last
+  uint8_t last_error() const { return this->last_error_; }
+
+ protected:
+  void pulse_start_(int64_t time_us) {
+    const int64_t last = this->last_start_us_;
+    this->last_start_us_ = time_us;
+    this->start_us_ = time_us;
+    this->in_pulse_ = true;
+    if (last < 0) {
+      this->second_ = -1;
+      return;
+    }
+    const int64_t spacing = time_us - last;
+    if (spacing > 1500000) {
+      // The minute marker: second 59 carried no pulse
+      if (spacing < 2000000 - TOLERANCE_US || spacing > 2000000 + TOLERANCE_US) {
+        this->count_(ERROR_SPACING);
+      } else if (this->synced_ && this->second_ != 58) {
+        this->count_(ERROR_FRAMING);
+      }
+      this->synced_ = true;
+      this->second_ = 0;
+      this->bits_ = 0;
+      return;
+    }
+    if (spacing < 1000000 - TOLERANCE_US || spacing > 1000000 + TOLERANCE_US)
+      this->count_(ERROR_SPACING);
+    if (this->second_ >= 0)
+      this->second_++;
+    if (this->synced_ && this->second_ > 58) {
+      // No marker where one was due
+      this->count_(ERROR_FRAMING);
+      this->synced_ = false;
+    }
+  }
+
+  void pulse_end_(int64_t time_us) {
+    this->in_pulse_ = false;
+    const int64_t width = time_us - this->start_us_;
+    const bool one = width >= 150000;
+    const int64_t nominal = one ? 200000 : 100000;
+    if (width < nominal - TOLERANCE_US || width > nominal + TOLERANCE_US)
+      this->count_(ERROR_WIDTH);
+    if (!this->synced_ || this->second_ < 0)
+      return;
+    if (one)
+      this->bits_ |= uint64_t(1) << this->second_;
+    if (this->second_ == 58)
+      this->check_minute_();
+  }
+
+  void check_minute_() {
+    if (!this->has_expected_)
+      return;
+    this->checked_++;
+    const uint64_t bits = this->bits_;
+    if ((bits & 1) != 0 || ((bits >> 20) & 1) == 0) {
+      this->count_(ERROR_FRAMING);
+      return;
+    }
+    // Even parity over 21..28, 29..35 and 36..58
+    if (parity(static_cast<uint32_t>(bits >> 21) & 0xFF) != 0 || parity(static_cast<uint32_t>(bits >> 29) & 0x7F) != 0 ||
+        parity(static_cast<uint32_t>(bits >> 36) & 0x7FFFFF) != 0) {
+      this->count_(ERROR_PARITY);
+      return;
+    }
+    CivilMinute t;
+    const CivilMinute &e = this->expected_;
+    if (!decode_frame(bits, &t) || t.minute != e.minute || t.hour != e.hour || t.day != e.day ||
+        t.day_of_week != e.day_of_week || t.month != e.month || t.year != e.year || t.dst != e.dst) {
+      this->count_(ERROR_MISMATCH);
+      return;
+    }
+    this->ok_++;
+  }
+
+  void count_(Error error) {
+    this->errors_[error]++;
+    this->last_error_ = error;
+  }
+
+  int64_t last_start_us_{-1};
+  int64_t start_us_{0};
+  bool in_pulse_{false};
+  bool synced_{false};
+  int second_{-1};
+  uint64_t bits_{0};
+  CivilMinute expected_{};
+  bool has_expected_{false};
+  uint32_t errors_[ERRORS]{};
+  uint8_t last_error_{0};
+  uint32_t checked_{0};
+  uint32_t ok_{0};
+};
+
+inline const char *integrity_error_name(int error) {
+  static const char *const NAMES[IntegrityMonitor::ERRORS] = {"width", "spacing", "framing", "parity", "mismatch"};
+  return error >= 0 && error < IntegrityMonitor::ERRORS ? NAMES[error] : "?";
+}
+
+}  // namespace dcf77
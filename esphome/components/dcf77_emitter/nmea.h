@@ -0,0 +1,157 @@
+#pragma once
+
+// Minimal NMEA 0183 time reader for a GPS receiver on a UART. C++11 like the
+// other shared headers; used by the component and the host replay tools.
+//
+// Only the sentences that carry a full UTC date and time are read: RMC (with
+// a valid fix, status A) and ZDA, from any talker (GP, GN, GL, ...). Each
+// sentence's checksum must match. Receivers send them shortly after the PPS
+// pulse that starts the second they name, so that pulse is the exact moment
+// of the time in the sentence. Leap seconds (second 60) are skipped.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dcf77 {
+
+/// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's
+/// days_from_civil).
+inline int64_t days_from_civil(int year, int month, int day) {
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const int64_t yoe = year - era * 400;
+  const int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+class NmeaTime {
+ public:
+  /// Feeds one received character. Returns true when it completed a valid
+  /// sentence with a date and time, which epoch_ms() then returns.
+  bool feed(char c) {
+    if (c == '$') {
+      this->length_ = 0;
+      this->in_sentence_ = true;
+      return false;
+    }
+    if (!this->in_sentence_)
+      return false;
+    if (c == '\r' || c == '\n') {
+      this->in_sentence_ = false;
+      return this->parse_();
+    }
+    // NMEA limits sentences to 82 characters
+    if (this->length_ == sizeof(this->buffer_) - 1) {
+      this->in_sentence_ = false;
+      return false;
+    }
+    this->buffer_[this->length_++] = c;
+    return false;
+  }
+
+  /// UTC of the last time sentence, milliseconds since 1970.
+  int64_t epoch_ms() const { return this->epoch_ms_; }
+  uint32_t sentences() const { return this->sentences_; }
+  uint32_t checksum_errors() const { return this->checksum_errors_; }
+
+ protected:
+  static const size_t MAX_FIELDS = 16;
+
+  // Value of |n| decimal digits at |p|, -1 if any is not a digit
+  static int digits_(const char *p, int n) {
+    int value = 0;
+    for (int i = 0; i < n; i++) {
+      if (p[i] < '0' || p[i] > '9')
+        return -1;
+      value = value * 10 + (p[i] - '0');
+    }
+    return value;
+  }
+
+  static int hex_(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  // hhmmss[.sss] in milliseconds of the day, -1 if malformed
+  static int64_t time_of_day_ms_(const char *p) {
+    const int h = digits_(p, 2), m = digits_(p + 2, 2), s = digits_(p + 4, 2);
+    if (h < 0 || h > 23 || m < 0 || m > 59 || s < 0 || s > 59)
+      return -1;
+    int ms = 0;
+    if (p[6] == '.') {
+      int scale = 100;
+      for (const char *q = p + 7; *q >= '0' && *q <= '9' && scale > 0; q++, scale /= 10)
+        ms += (*q - '0') * scale;
+    }
+    return ((h * 60 + m) * 60 + s) * 1000LL + ms;
+  }
+
+  bool parse_() {
+    this->buffer_[this->length_] = '\0';
+    size_t star = 0;
+    uint8_t sum = 0;
+    while (star < this->length_ && this->buffer_[star] != '*')
+      sum ^= static_cast<uint8_t>(this->buffer_[star++]);
+    if (star + 3 > this->length_ || hex_(this->buffer_[star + 1]) < 0 || hex_(this->buffer_[star + 2]) < 0 ||
+        hex_(this->buffer_[star + 1]) * 16 + hex_(this->buffer_[star + 2]) != sum) {
+      this->checksum_errors_++;
+      return false;
+    }
+    this->buffer_[star] = '\0';
+
+    // Split into fields in place
+    const char *fields[MAX_FIELDS];
+    size_t count = 0;
+    fields[count++] = this->buffer_;
+    for (size_t i = 0; i < star && count < MAX_FIELDS; i++) {
+      if (this->buffer_[i] == ',') {
+        this->buffer_[i] = '\0';
+        fields[count++] = this->buffer_ + i + 1;
+      }
+    }
+    if (this->buffer_[0] == '\0' || this->buffer_[1] == '\0')
+      return false;
+    const char *type = fields[0] + 2;
+    int64_t time_ms;
+    int day, month, year;
+    if (type[0] == 'R' && type[1] == 'M' && type[2] == 'C' && type[3] == '\0' && count > 9) {
+      // RMC,hhmmss.ss,A,lat,N,lon,E,speed,course,ddmmyy,...
+      if (fields[2][0] != 'A')
+        return false;
+      time_ms = time_of_day_ms_(fields[1]);
+      day = digits_(fields[9], 2);
+      month = digits_(fields[9] + 2, 2);
+      year = digits_(fields[9] + 4, 2);
+      if (year < 0 || fields[9][6] != '\0')
+        return false;
+      year += 2000;
+    } else if (type[0] == 'Z' && type[1] == 'D' && type[2] == 'A' && type[3] == '\0' && count > 4) {
+      // ZDA,hhmmss.ss,dd,mm,yyyy,...
+      time_ms = time_of_day_ms_(fields[1]);
+      day = digits_(fields[2], 2);
+      month = digits_(fields[3], 2);
+      year = digits_(fields[4], 4);
+    } else {
+      return false;
+    }
+    if (time_ms < 0 || day < 1 || day > 31 || month < 1 || month > 12 || year < 2000)
+      return false;
+    this->epoch_ms_ = days_from_civil(year, month, day) * 86400000LL + time_ms;
+    this->sentences_++;
+    return true;
+  }
+
+  char buffer_[83];
+  size_t length_{0};
+  bool in_sentence_{false};
+  int64_t epoch_ms_{0};
+  uint32_t sentences_{0};
+  uint32_t checksum_errors_{0};
+};
+
+}  // namespace dcf77
@@ -0,0 +1,74 @@
+#pragma once
+
+// Compile-time configured output stage of the emitter.
+//
+// With `static_config: true` the code generator passes the emitter's
+// configuration as DCF77_STATIC_* build flags. StaticConfig turns them into
+// constants and StaticOutput<StaticConfig> replaces the generic carrier and
+// LED writes: LEDC channels and the LED pin become immediates and the
+// registers are written through ESP-IDF's inline HAL instead of the locking
+// driver calls and virtual pin methods. A build without an LED pin drops the
+// LED mirroring entirely. Only the number of transmitters and the LED are
+// fixed at compile time; the carrier frequency, resolution, timer and
+// antenna pin are still set up at runtime by the generic code.
+
+#ifdef DCF77_STATIC_CONFIG
+
+#include <cstdint>
+
+#include "driver/ledc.h"
+#include "esp_idf_version.h"
+#include "hal/gpio_ll.h"
+#include "hal/ledc_ll.h"
+
+namespace esphome {
+namespace dcf77_emitter {
+
+struct StaticConfig {
+  /// DCF77 on channel 0 plus the extra transmitters on channels 1..N-1.
+  static constexpr unsigned TRANSMITTERS = DCF77_STATIC_TRANSMITTERS;
+  /// LED GPIO, or -1 without LED mirroring.
+  static constexpr int LED_GPIO = DCF77_STATIC_LED_GPIO;
+  static constexpr bool LED_INVERTED = DCF77_STATIC_LED_INVERTED;
+};
+
+static_assert(StaticConfig::TRANSMITTERS >= 1 && StaticConfig::TRANSMITTERS <= 8, "one LEDC channel per transmitter");
+
+template <class Config> struct StaticOutput {
+  /// Applies |reduced| (bit i: transmitter i reduced) to the channels in
+  /// |changed|.
+  static void write(uint8_t reduced, uint8_t changed, uint32_t carrier_duty) {
+    if (Config::LED_GPIO >= 0 && (changed & 1))
+      gpio_ll_set_level(&GPIO, Config::LED_GPIO, ((reduced & 1) == 0) != Config::LED_INVERTED);
+    write_channel_<0>(reduced, changed, carrier_duty);
+  }
+
+ protected:
+  // The register sequence of ledc_set_duty() and ledc_update_duty(): the
+  // duty, a fade of one step without change, the output enable, then start
+  // and latch. ledc_ll_set_duty_start() lost its flag in ESP-IDF 5.2.
+  template <unsigned I> static void write_channel_(uint8_t reduced, uint8_t changed, uint32_t carrier_duty) {
+    if ((changed >> I) & 1) {
+      const ledc_channel_t channel = static_cast<ledc_channel_t>(I);
+      ledc_ll_set_duty_int_part(&LEDC, LEDC_LOW_SPEED_MODE, channel, (reduced >> I) & 1 ? 0 : carrier_duty);
+      ledc_ll_set_duty_direction(&LEDC, LEDC_LOW_SPEED_MODE, channel, LEDC_DUTY_DIR_INCREASE);
+      ledc_ll_set_duty_num(&LEDC, LEDC_LOW_SPEED_MODE, channel, 1);
+      ledc_ll_set_duty_cycle(&LEDC, LEDC_LOW_SPEED_MODE, channel, 1);
+      ledc_ll_set_duty_scale(&LEDC, LEDC_LOW_SPEED_MODE, channel, 0);
+      ledc_ll_set_sig_out_en(&LEDC, LEDC_LOW_SPEED_MODE, channel, true);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+      ledc_ll_set_duty_start(&LEDC, LEDC_LOW_SPEED_MODE, channel);
+#else
+      ledc_ll_set_duty_start(&LEDC, LEDC_LOW_SPEED_MODE, channel, true);
+#endif
+      ledc_ll_ls_channel_update(&LEDC, LEDC_LOW_SPEED_MODE, channel);
+    }
+    if constexpr (I + 1 < Config::TRANSMITTERS)
+      write_channel_<I + 1>(reduced, changed, carrier_duty);
+  }
+};
+
+}  // namespace dcf77_emitter
+}  // namespace esphome
+
+#endif  // DCF77_STATIC_CONFIG
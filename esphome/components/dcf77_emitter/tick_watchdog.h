@@ -0,0 +1,120 @@
+#pragma once
+
+// Stall watchdog for the 100 ms tick, shared by the ESPHome component and
+// the Arduino sketch. Header-only, free of platform dependencies and limited
+// to C++11 like dcf77_frame.h.
+//
+// Every tick reports the tenth of a second it serves and how late it ran.
+// Lateness alone does no harm while the carriers hold their state; it is a
+// stall when a carrier edge was due: the tick's own edge later than the
+// threshold, or the edge of a tenth that got no tick at all. A clock step
+// under the running schedule moves all edges at once. In each case the
+// minute can no longer decode, so the rest of it is blanked: the carriers
+// stay on without reductions. Modulation resumes with second 58, or with
+// second 0 after a stall in seconds 58 and 59, so the minute marker that
+// follows is complete and receivers pick up the next minute at once. They
+// discard the blanked minute by its missing pulses instead of decoding
+// wrong bits from it.
+
+#include <cstdint>
+
+namespace dcf77 {
+
+/// Lateness of an edge above which it counts as a stall: half a tick, at
+/// which a 100 ms pulse can no longer be told from a 200 ms one.
+static const int64_t DEFAULT_STALL_THRESHOLD_US = 50000;
+
+enum StallCause : uint8_t {
+  STALL_LATE_TICK,      // a tick with an edge ran late
+  STALL_SKIPPED_TICKS,  // tenths with edges got no tick: a stall longer than a tick
+  STALL_CLOCK_STEP,     // the clock was stepped under the running schedule
+  STALL_CAUSES,
+};
+
+inline const char *stall_cause_name(int cause) {
+  static const char *const NAMES[STALL_CAUSES] = {"late tick", "skipped ticks", "clock step"};
+  return cause >= 0 && cause < STALL_CAUSES ? NAMES[cause] : "?";
+}
+
+class TickWatchdog {
+ public:
+  /// Tenth of the minute that starts second 58
+  static const int RESUME_TENTH = 580;
+
+  explicit TickWatchdog(int64_t threshold_us = DEFAULT_STALL_THRESHOLD_US) : threshold_us_(threshold_us) {}
+
+  void set_threshold_us(int64_t threshold_us) { this->threshold_us_ = threshold_us; }
+  int64_t threshold_us() const { return this->threshold_us_; }
+
+  /// Forgets the tick sequence, e.g. when the signal is switched off. The
+  /// counters are kept.
+  void restart() {
+    this->last_tenth_ = -1;
+    this->blanking_ = false;
+  }
+
+  /// Checks the tick serving |tenth| (tenths of a second since the epoch)
+  /// that ran |lag_us| after its deadline. Bit k of |edge_tenths| is set if
+  /// a carrier changes at tenth k of the second the previous tick served;
+  /// the first tenth of every other second is taken to have an edge.
+  /// |stepped| is set if the clock was stepped since the previous tick.
+  /// Returns the cause of the stall this tick detected, or -1.
+  int check(int64_t tenth, int64_t lag_us, uint16_t edge_tenths, bool stepped) {
+    const int64_t last = this->last_tenth_;
+    const bool own_edge =
+        tenth % 10 == 0 || (last >= 0 && tenth / 10 == last / 10 && ((edge_tenths >> (tenth % 10)) & 1) != 0);
+    bool skipped_edge = false;
+    if (last >= 0 && tenth > last + 1) {
+      if ((tenth - 1) / 10 != last / 10) {
+        // The start of a second got no tick
+        skipped_edge = true;
+      } else {
+        // All skipped tenths are in the second of the previous tick
+        const int from = static_cast<int>((last + 1) % 10);
+        const int count = static_cast<int>(tenth - last - 1);
+        skipped_edge = ((edge_tenths >> from) & ((1u << count) - 1)) != 0;
+      }
+    }
+    this->last_tenth_ = tenth;
+
+    int cause = -1;
+    if (stepped) {
+      cause = STALL_CLOCK_STEP;
+    } else if (skipped_edge) {
+      cause = STALL_SKIPPED_TICKS;
+    } else if (own_edge && lag_us > this->threshold_us_) {
+      cause = STALL_LATE_TICK;
+    }
+    if (cause >= 0) {
+      this->stalls_[cause]++;
+      if (!this->blanking_)
+        this->blanks_++;
+      this->blanking_ = true;
+    } else if (this->blanking_ && (tenth % 600 == RESUME_TENTH || tenth % 600 == 0)) {
+      this->blanking_ = false;
+    }
+    return cause;
+  }
+
+  /// False while the rest of a minute is blanked.
+  bool modulating() const { return !this->blanking_; }
+
+  uint32_t stalls(int cause) const { return this->stalls_[cause]; }
+  uint32_t total_stalls() const {
+    uint32_t total = 0;
+    for (uint32_t n : this->stalls_)
+      total += n;
+    return total;
+  }
+  /// Times modulation was blanked; a stall during a blank adds none.
+  uint32_t blanks() const { return this->blanks_; }
+
+ protected:
+  int64_t threshold_us_;
+  int64_t last_tenth_{-1};
+  bool blanking_{false};
+  uint32_t stalls_[STALL_CAUSES]{};
+  uint32_t blanks_{0};
+};
+
+}  // namespace dcf77
@@ -0,0 +1,283 @@
+#pragma once
+
+// Minute time codes besides DCF77 (MSF, WWVB, JJY), built from field tables
+// like the DCF77 one in dcf77_frame.h. Shared by the component and the host
+// tools; C++11 like the other shared headers.
+//
+// Every code is sent one symbol per second as a carrier reduction of whole
+// tenths of a second, so one 100 ms tick drives all of them:
+//
+//   code   carrier  time sent            symbols (reduced tenths)
+//   DCF77  77.5 kHz local, next minute   0: 0.1 s, 1: 0.2 s, second 59: none
+//   MSF    60 kHz   local, next minute   00: 0.1 s, 10: 0.2 s, 01: 0.1 s + 0.1 s
+//                                        after a gap, 11: 0.3 s, marker: 0.5 s
+//   WWVB   60 kHz   UTC, this minute     0: 0.2 s, 1: 0.5 s, marker: 0.8 s
+//   JJY    40/60    local, this minute   full carrier first, then reduced for
+//                                        the rest: 0: 0.2 s, 1: 0.5 s, marker: 0.8 s
+//
+// "Local" is the time zone of the time source: MSF clocks expect UK time and
+// JJY clocks Japan time. WWVB clocks apply their own zone offset and use the
+// DST bits to follow US rules.
+//
+// Frames hold one bit per second (bit n = second n) in |a|, plus MSF's
+// second bit stream in |b|. WWVB and JJY markers are fixed per code.
+
+#include <cstdint>
+
+#include "dcf77_frame.h"
+#include "dcf77_layout.h"
+
+namespace dcf77 {
+
+enum class Protocol : uint8_t { DCF77, MSF, WWVB, JJY40, JJY60 };
+
+/// Time fields of one minute for any of the codes.
+struct TimeCodeMinute {
+  uint8_t minute;       // [0-59]
+  uint8_t hour;         // [0-23]
+  uint8_t day;          // [1-31]
+  uint8_t day_of_week;  // monday=1 [1-7]
+  uint8_t month;        // [1-12]
+  uint8_t year;         // two digits [0-99]
+  bool dst;
+  uint16_t day_of_year;  // [1-366]
+  bool leap_year;
+  bool dst_change_soon;  // DST starts or ends within the next hour (MSF)
+  bool dst_day_start;    // DST in effect at 00:00 UTC of this UTC day (WWVB)
+  bool dst_day_end;      // DST in effect at 24:00 UTC of this UTC day (WWVB)
+};
+
+struct TimeCodeFrame {
+  uint64_t a;
+  uint64_t b;
+};
+
+namespace source {
+
+struct DayOfYear {
+  template <class T> static uint32_t get(const T &t) { return t.day_of_year; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->day_of_year = static_cast<uint16_t>(v)) - 1u < 366u; }
+};
+// Day of week with sunday=0, as MSF and JJY send it
+struct WeekdayFromSunday {
+  template <class T> static uint32_t get(const T &t) { return t.day_of_week % 7; }
+  template <class T> static bool put(T *t, uint32_t v) {
+    t->day_of_week = static_cast<uint8_t>(v == 0 ? 7 : v);
+    return v <= 6;
+  }
+};
+struct LeapYear {
+  template <class T> static uint32_t get(const T &t) { return t.leap_year; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->leap_year = v != 0), true; }
+};
+struct DstChangeSoon {
+  template <class T> static uint32_t get(const T &t) { return t.dst_change_soon; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->dst_change_soon = v != 0), true; }
+};
+struct DstDayStart {
+  template <class T> static uint32_t get(const T &t) { return t.dst_day_start; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->dst_day_start = v != 0), true; }
+};
+struct DstDayEnd {
+  template <class T> static uint32_t get(const T &t) { return t.dst_day_end; }
+  template <class T> static bool put(T *t, uint32_t v) { return (t->dst_day_end = v != 0), true; }
+};
+
+}  // namespace source
+
+// -----------------------------------------------------------------------------
+// Layouts. MSF, WWVB and JJY send their fields most significant bit first.
+// -----------------------------------------------------------------------------
+const BitOrder MSB_FIRST = BitOrder::MSB_FIRST;
+
+/// MSF A bits: 17..24 year, 25..29 month, 30..35 day, 36..38 day of week,
+/// 39..44 hour, 45..51 minute, 52..59 the 01111110 minute identifier.
+using MsfLayoutA = Layout<ParityKind::ODD,
+                          Field<source::Year, 17, 8, Coding::BCD, NO_PARITY, MSB_FIRST>,
+                          Field<source::Month, 25, 5, Coding::BCD, NO_PARITY, MSB_FIRST>,
+                          Field<source::Day, 30, 6, Coding::BCD, NO_PARITY, MSB_FIRST>,
+                          Field<source::WeekdayFromSunday, 36, 3, Coding::BINARY, NO_PARITY, MSB_FIRST>,
+                          Field<source::Hour, 39, 6, Coding::BCD, NO_PARITY, MSB_FIRST>,
+                          Field<source::Minute, 45, 7, Coding::BCD, NO_PARITY, MSB_FIRST>,
+                          Field<source::Constant<0x7E>, 52, 8, Coding::BINARY, NO_PARITY, MSB_FIRST>>;
+
+/// MSF B bits: 53 DST change soon, 54..57 odd parity over A 17..24,
+/// 25..35, 36..38 and 39..51, 58 DST. DUT1 (1..16) is sent as zero.
+using MsfLayoutB = Layout<ParityKind::ODD,
+                          Field<source::DstChangeSoon, 53, 1, Coding::BINARY>,
+                          Field<source::Dst, 58, 1, Coding::BINARY>>;
+
+// Odd parity bits 54..57 of MSF's B stream for the A bits
+inline uint64_t msf_parity_bits(uint64_t a) {
+  return uint64_t{detail::masked_parity<((uint64_t{1} << 8) - 1) << 17>(a) ^ 1} << 54 |
+         uint64_t{detail::masked_parity<((uint64_t{1} << 11) - 1) << 25>(a) ^ 1} << 55 |
+         uint64_t{detail::masked_parity<((uint64_t{1} << 3) - 1) << 36>(a) ^ 1} << 56 |
+         uint64_t{detail::masked_parity<((uint64_t{1} << 13) - 1) << 39>(a) ^ 1} << 57;
+}
+const uint64_t MSF_PARITY_BITS = uint64_t{0xF} << 54;
+
+/// WWVB (UTC): 1..8 minute, 12..18 hour, 22..33 day of year, 36..38 DUT1
+/// sign (sent as +), 40..43 DUT1 (0), 45..53 year, 55 leap year, 56 leap
+/// second (0), 57/58 DST at the end / start of the UTC day.
+using WwvbLayout = Layout<ParityKind::EVEN,
+                          Field<source::Minute, 1, 8, Coding::BCD5, NO_PARITY, MSB_FIRST>,
+                          Field<source::Hour, 12, 7, Coding::BCD5, NO_PARITY, MSB_FIRST>,
+                          Field<source::DayOfYear, 22, 12, Coding::BCD5, NO_PARITY, MSB_FIRST>,
+                          Field<source::Constant<5>, 36, 3, Coding::BINARY, NO_PARITY, MSB_FIRST>,
+                          Field<source::Year, 45, 9, Coding::BCD5, NO_PARITY, MSB_FIRST>,
+                          Field<source::LeapYear, 55, 1, Coding::BINARY>,
+                          Field<source::DstDayEnd, 57, 1, Coding::BINARY>,
+                          Field<source::DstDayStart, 58, 1, Coding::BINARY>>;
+
+/// JJY: 1..8 minute, 12..18 hour, 22..33 day of year, 36/37 even parity of
+/// hour / minute, 41..48 year, 50..52 day of week.
+using JjyLayout = Layout<ParityKind::EVEN,
+                         Field<source::Minute, 1, 8, Coding::BCD5, 37, MSB_FIRST>,
+                         Field<source::Hour, 12, 7, Coding::BCD5, 36, MSB_FIRST>,
+                         Field<source::DayOfYear, 22, 12, Coding::BCD5, NO_PARITY, MSB_FIRST>,
+                         Field<source::Year, 41, 8, Coding::BCD, NO_PARITY, MSB_FIRST>,
+                         Field<source::WeekdayFromSunday, 50, 3, Coding::BINARY, NO_PARITY, MSB_FIRST>>;
+
+/// Position markers of WWVB and JJY: seconds 0, 9, 19, 29, 39, 49 and 59.
+const uint64_t MARKER_SECONDS = uint64_t{1} | uint64_t{1} << 9 | uint64_t{1} << 19 | uint64_t{1} << 29 |
+                                uint64_t{1} << 39 | uint64_t{1} << 49 | uint64_t{1} << 59;
+
+// -----------------------------------------------------------------------------
+// Protocol properties
+// -----------------------------------------------------------------------------
+inline const char *protocol_name(Protocol protocol) {
+  switch (protocol) {
+    case Protocol::DCF77:
+      return "DCF77";
+    case Protocol::MSF:
+      return "MSF";
+    case Protocol::WWVB:
+      return "WWVB";
+    case Protocol::JJY40:
+      return "JJY40";
+    case Protocol::JJY60:
+      return "JJY60";
+  }
+  return "?";
+}
+
+inline uint32_t protocol_carrier_hz(Protocol protocol) {
+  return protocol == Protocol::DCF77 ? 77500 : protocol == Protocol::JJY40 ? 40000 : 60000;
+}
+
+/// WWVB sends UTC; the others the time source's local time.
+inline bool protocol_uses_utc(Protocol protocol) { return protocol == Protocol::WWVB; }
+
+/// DCF77 and MSF announce the minute that starts at the next marker, WWVB
+/// and JJY the minute the frame is sent in.
+inline bool protocol_sends_next_minute(Protocol protocol) {
+  return protocol == Protocol::DCF77 || protocol == Protocol::MSF;
+}
+
+// -----------------------------------------------------------------------------
+// Encoding and decoding
+// -----------------------------------------------------------------------------
+inline CivilMinute civil_from_time_code(const TimeCodeMinute &t) {
+  return CivilMinute{t.minute, t.hour, t.day, t.day_of_week, t.month, t.year, t.dst};
+}
+
+inline TimeCodeFrame encode_time_code(Protocol protocol, const TimeCodeMinute &t) {
+  TimeCodeFrame frame{0, 0};
+  switch (protocol) {
+    case Protocol::DCF77:
+      frame.a = encode_frame(civil_from_time_code(t));
+      break;
+    case Protocol::MSF:
+      frame.a = MsfLayoutA::encode(t);
+      frame.b = MsfLayoutB::encode(t) | msf_parity_bits(frame.a);
+      break;
+    case Protocol::WWVB:
+      frame.a = WwvbLayout::encode(t);
+      break;
+    case Protocol::JJY40:
+    case Protocol::JJY60:
+      frame.a = JjyLayout::encode(t);
+      break;
+  }
+  return frame;
+}
+
+/// Decodes the fields |protocol| carries into |t|; the others are left as
+/// they are. Returns false on a parity, marker, digit or range error.
+inline bool decode_time_code(Protocol protocol, const TimeCodeFrame &frame, TimeCodeMinute *t) {
+  switch (protocol) {
+    case Protocol::DCF77: {
+      CivilMinute civil;
+      const bool ok = decode_frame(frame.a, &civil);
+      t->minute = civil.minute;
+      t->hour = civil.hour;
+      t->day = civil.day;
+      t->day_of_week = civil.day_of_week;
+      t->month = civil.month;
+      t->year = civil.year;
+      t->dst = civil.dst;
+      return ok;
+    }
+    case Protocol::MSF: {
+      return MsfLayoutA::decode(frame.a, t) & MsfLayoutB::decode(frame.b, t) &
+             ((frame.b & MSF_PARITY_BITS) == msf_parity_bits(frame.a));
+    }
+    case Protocol::WWVB:
+      return WwvbLayout::decode(frame.a, t);
+    case Protocol::JJY40:
+    case Protocol::JJY60:
+      return JjyLayout::decode(frame.a, t);
+  }
+  return false;
+}
+
+/// Tenths of |second| during which the carrier is reduced, bit k = tenth k.
+inline uint16_t reduced_tenths(Protocol protocol, const TimeCodeFrame &frame, int second) {
+  const bool a = ((frame.a >> second) & 1) != 0;
+  const bool marker = ((MARKER_SECONDS >> second) & 1) != 0;
+  switch (protocol) {
+    case Protocol::DCF77:
+      return second >= 59 ? 0 : a ? 0x003 : 0x001;
+    case Protocol::MSF: {
+      if (second == 0)
+        return 0x01F;
+      const bool b = ((frame.b >> second) & 1) != 0;
+      return a ? (b ? 0x007 : 0x003) : (b ? 0x005 : 0x001);
+    }
+    case Protocol::WWVB:
+      return marker ? 0x0FF : a ? 0x01F : 0x003;
+    case Protocol::JJY40:
+    case Protocol::JJY60:
+      return marker ? 0x3FC : a ? 0x3E0 : 0x300;
+  }
+  return 0;
+}
+
+/// Inverse of reduced_tenths(): the symbol sent in one second. Returns
+/// false if |tenths| is no symbol of |protocol|.
+inline bool symbol_from_tenths(Protocol protocol, uint16_t tenths, bool *a, bool *b, bool *marker) {
+  *a = *b = *marker = false;
+  switch (protocol) {
+    case Protocol::DCF77:
+      *marker = tenths == 0x000;
+      *a = tenths == 0x003;
+      return tenths == 0x000 || tenths == 0x001 || tenths == 0x003;
+    case Protocol::MSF:
+      *marker = tenths == 0x01F;
+      *a = tenths == 0x003 || tenths == 0x007;
+      *b = tenths == 0x005 || tenths == 0x007;
+      return tenths == 0x01F || tenths == 0x001 || tenths == 0x003 || tenths == 0x005 || tenths == 0x007;
+    case Protocol::WWVB:
+      *marker = tenths == 0x0FF;
+      *a = tenths == 0x01F;
+      return tenths == 0x0FF || tenths == 0x01F || tenths == 0x003;
+    case Protocol::JJY40:
+    case Protocol::JJY60:
+      *marker = tenths == 0x3FC;
+      *a = tenths == 0x3E0;
+      return tenths == 0x3FC || tenths == 0x3E0 || tenths == 0x300;
+  }
+  return false;
+}
+
+}  // namespace dcf77
@@ -0,0 +1,241 @@
+#pragma once
+
+// Combines the readings of several time sources (SNTP, Home Assistant, GPS,
+// an RTC chip) into one clock for the emitter, running on the local
+// microsecond counter (esp_timer). C++11 like the other shared headers.
+//
+// Each reading is a pair (local time, UTC) from one source. A two-state
+// Kalman filter tracks the UTC offset and the frequency error of the local
+// counter and weights every reading by the quality of its source:
+//
+//   resolution  configured; readings truncated to it (1 s for Home
+//               Assistant, RTC chips and NMEA) are centred and add
+//               resolution^2 / 12 to the variance
+//   jitter      estimated from the source's innovations, so a noisy source
+//               loses weight by itself
+//   age         time since the source's last reading; a source is active
+//               until it misses three of its usual intervals, and at
+//               least for a minute
+//
+// The selected source is the active one with the smallest variance. Without
+// any active source the clock is in holdover.
+//
+// The emitter does not read the filter directly but a steered clock that
+// follows it. After the first reading, corrections are slewed at
+// MAX_SLEW_PPM, so the length of a second changes by at most half a
+// millisecond and no emitted second jumps when the best source changes or
+// fails. Only corrections above STEP_US, or any correction while slewing is
+// off, step the clock. Between readings the clock runs on at the estimated
+// frequency (holdover), and the error estimate grows accordingly.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace dcf77 {
+
+class TimeFusion {
+ public:
+  static const int64_t MAX_SLEW_PPM = 500;
+  static const int64_t STEP_US = 1000000;
+
+  struct Source {
+    const char *name;
+    uint32_t resolution_us;
+    double jitter2;        // estimated variance of the readings beyond the resolution, us^2
+    int64_t last_local_us;  // local time of the last accepted reading
+    int64_t interval_us;    // average time between readings, 0 until known
+    uint32_t readings;
+    uint32_t outliers;
+    uint8_t outlier_run;
+
+    /// Variance of one reading, us^2.
+    double variance() const {
+      return jitter2 + static_cast<double>(this->resolution_us) * this->resolution_us / 12.0;
+    }
+  };
+
+  /// Adds a source and returns its index for add_reading().
+  int add_source(const char *name, uint32_t resolution_us) {
+    this->sources_.push_back(Source{name, resolution_us, INITIAL_JITTER_US * INITIAL_JITTER_US, 0, 0, 0, 0, 0});
+    return static_cast<int>(this->sources_.size()) - 1;
+  }
+
+  /// Steps are allowed while false, e.g. while nothing is transmitted.
+  void set_slewing(bool slewing) { this->slewing_ = slewing; }
+
+  /// Feeds the UTC time |utc_us| that |source| reported at local time
+  /// |local_us|. Returns false if the reading was rejected as an outlier.
+  bool add_reading(int source, int64_t local_us, int64_t utc_us) {
+    Source &s = this->sources_[source];
+    // Truncated readings are on average half a step behind
+    const int64_t z = utc_us + s.resolution_us / 2;
+    const double r = s.variance();
+    if (!this->valid_) {
+      this->theta_us_ = z;
+      this->freq_ppm_ = 0;
+      this->p_[0][0] = r;
+      this->p_[0][1] = this->p_[1][0] = 0;
+      this->p_[1][1] = INITIAL_FREQ_PPM * INITIAL_FREQ_PPM;
+      this->anchor_local_us_ = local_us;
+      this->valid_ = true;
+      this->steer_(local_us, true);
+      this->accept_(s, local_us, NAN);
+      return true;
+    }
+
+    // Predict the filter to |local_us|; the innovation is formed in integers
+    // first, as epoch microseconds exceed a double's precision
+    const int64_t elapsed = local_us - this->anchor_local_us_;
+    const double dt = elapsed / 1e6;
+    const double drift = this->freq_ppm_ * dt;
+    const double p00 = this->p_[0][0] + dt * (this->p_[0][1] + this->p_[1][0]) + dt * dt * this->p_[1][1] +
+                       Q_PHASE * dt + Q_FREQ * dt * dt * dt / 3;
+    const double p01 = this->p_[0][1] + dt * this->p_[1][1] + Q_FREQ * dt * dt / 2;
+    const double p11 = this->p_[1][1] + Q_FREQ * dt;
+
+    const double y = static_cast<double>(z - this->theta_us_ - elapsed) - drift;
+    const double innovation_var = p00 + r;
+    if (y * y > OUTLIER_SIGMA2 * innovation_var) {
+      s.outliers++;
+      // A source that keeps disagreeing while it is the best one is right:
+      // the time itself changed, so start over from it
+      if (++s.outlier_run < 3 || this->selected(local_us) != source)
+        return false;
+      this->valid_ = false;
+      this->steps_++;
+      return this->add_reading(source, local_us, utc_us);
+    }
+
+    const double k0 = p00 / innovation_var;
+    const double k1 = p01 / innovation_var;
+    this->theta_us_ += elapsed + std::llround(drift + k0 * y);
+    this->freq_ppm_ += k1 * y;
+    this->p_[0][0] = (1 - k0) * p00;
+    this->p_[0][1] = this->p_[1][0] = (1 - k0) * p01;
+    this->p_[1][1] = p11 - k1 * p01;
+    this->anchor_local_us_ = local_us;
+    this->steer_(local_us, false);
+    this->accept_(s, local_us, y * y - p00 - (r - s.jitter2));
+    return true;
+  }
+
+  /// True once a reading arrived.
+  bool valid() const { return this->valid_; }
+
+  /// UTC microseconds of the steered clock at local time |local_us|.
+  int64_t utc_us(int64_t local_us) const {
+    const int64_t dt = local_us - this->out_local_us_;
+    int64_t correction = dt * MAX_SLEW_PPM / 1000000;
+    if (correction > std::abs(this->pending_us_))
+      correction = std::abs(this->pending_us_);
+    return this->out_utc_us_ + dt + dt * this->out_rate_ppb_ / 1000000000 +
+           (this->pending_us_ < 0 ? -correction : correction);
+  }
+
+  /// Estimated error of the steered clock at |local_us|, in microseconds:
+  /// the filter's uncertainty plus any correction still being slewed.
+  double error_us(int64_t local_us) const {
+    if (!this->valid_)
+      return INFINITY;
+    const double dt = (local_us - this->anchor_local_us_) / 1e6;
+    const double p00 = this->p_[0][0] + dt * (this->p_[0][1] + this->p_[1][0]) + dt * dt * this->p_[1][1] +
+                       Q_PHASE * dt + Q_FREQ * dt * dt * dt / 3;
+    const int64_t filter_us =
+        this->theta_us_ + (local_us - this->anchor_local_us_) + std::llround(this->freq_ppm_ * dt);
+    return std::sqrt(p00) + std::abs(static_cast<double>(filter_us - this->utc_us(local_us)));
+  }
+
+  /// True while |source| delivers readings at its usual interval.
+  bool active(int source, int64_t local_us) const {
+    const Source &s = this->sources_[source];
+    if (s.readings == 0)
+      return false;
+    const int64_t timeout = s.interval_us != 0 ? 3 * s.interval_us : DEFAULT_TIMEOUT_US;
+    return local_us - s.last_local_us < (timeout > MIN_TIMEOUT_US ? timeout : MIN_TIMEOUT_US);
+  }
+
+  /// Index of the active source with the smallest variance, -1 in holdover.
+  int selected(int64_t local_us) const {
+    int best = -1;
+    for (size_t i = 0; i < this->sources_.size(); i++) {
+      if (this->active(static_cast<int>(i), local_us) &&
+          (best < 0 || this->sources_[i].variance() < this->sources_[best].variance()))
+        best = static_cast<int>(i);
+    }
+    return best;
+  }
+
+  /// Estimated frequency error of the local counter, ppm (positive: slow).
+  double frequency_ppm() const { return this->freq_ppm_; }
+  uint32_t steps() const { return this->steps_; }
+  const std::vector<Source> &sources() const { return this->sources_; }
+
+ protected:
+  static constexpr double INITIAL_JITTER_US = 10000;
+  static constexpr double MIN_JITTER_US = 1;
+  static constexpr double INITIAL_FREQ_PPM = 30;
+  // Random walk of the phase (us^2/s) and of the frequency (ppm^2/s) of a
+  // crystal at room temperature; the frequency's covers a daily swing of a
+  // few ppm, so the holdover error stays within the estimate
+  static constexpr double Q_PHASE = 1;
+  static constexpr double Q_FREQ = 1e-3;
+  static constexpr double OUTLIER_SIGMA2 = 25;
+  static const int64_t DEFAULT_TIMEOUT_US = 3600000000LL;
+  static const int64_t MIN_TIMEOUT_US = 60000000;
+
+  // |jitter2| is the part of the innovation's square beyond the filter's own
+  // uncertainty and the resolution, NAN for the first reading
+  void accept_(Source &s, int64_t local_us, double jitter2) {
+    if (!std::isnan(jitter2)) {
+      if (jitter2 < MIN_JITTER_US * MIN_JITTER_US)
+        jitter2 = MIN_JITTER_US * MIN_JITTER_US;
+      s.jitter2 += (jitter2 - s.jitter2) / 8;
+    }
+    if (s.readings != 0) {
+      const int64_t gap = local_us - s.last_local_us;
+      s.interval_us = s.interval_us == 0 ? gap : s.interval_us + (gap - s.interval_us) / 8;
+    }
+    s.last_local_us = local_us;
+    s.readings++;
+    s.outlier_run = 0;
+  }
+
+  // Re-anchors the steered clock at |local_us| without moving it, and slews
+  // it towards the filter from there
+  void steer_(int64_t local_us, bool first) {
+    const int64_t target = this->theta_us_;
+    const int64_t current = first ? target : this->utc_us(local_us);
+    this->out_local_us_ = local_us;
+    this->out_rate_ppb_ = static_cast<int64_t>(std::llround(this->freq_ppm_ * 1000));
+    this->pending_us_ = target - current;
+    if (!this->slewing_ || std::abs(this->pending_us_) > STEP_US) {
+      if (!first && this->pending_us_ != 0)
+        this->steps_++;
+      this->out_utc_us_ = target;
+      this->pending_us_ = 0;
+    } else {
+      this->out_utc_us_ = current;
+    }
+  }
+
+  std::vector<Source> sources_;
+  bool valid_{false};
+  bool slewing_{false};
+
+  // Filter: UTC at the anchor, frequency error and their covariance
+  int64_t anchor_local_us_{0};
+  int64_t theta_us_{0};
+  double freq_ppm_{0};
+  double p_[2][2]{};
+
+  // Steered clock: UTC at the anchor, rate and the correction still to slew
+  int64_t out_local_us_{0};
+  int64_t out_utc_us_{0};
+  int64_t out_rate_ppb_{0};
+  int64_t pending_us_{0};
+  uint32_t steps_{0};
+};
+
+}  // namespace dcf77
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Checks that the profiling probes cost nothing when DCF77_PROFILING is off.
+#
+# Compiles the component twice against the host stubs: once as it is and once
+# with every DCF77_PROBE line blanked out (line numbers are kept, so
+# __LINE__-dependent code stays identical). The disassembly and section sizes
+# of both objects must match. The size of a profiling build is reported for
+# reference.
+#
+# Run from the repository root:
+#   sh host/check_probe_size.sh
+# CXX and CXXFLAGS override the compiler and flags (default g++ -O2).
+
+set -eu
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SRC=esphome/components/dcf77_emitter/dcf77_emitter.cpp
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+compile() {
+  # $1 source, $2 object, remaining arguments are extra flags
+  src=$1
+  obj=$2
+  shift 2
+  $CXX -std=gnu++17 $CXXFLAGS "$@" -Ihost/stubs -I. -Iesphome/components/dcf77_emitter -c "$src" -o "$obj"
+}
+
+sed 's/^[[:space:]]*DCF77_PROBE\(_LONG\)\{0,1\}(.*);[[:space:]]*$//' "$SRC" >"$WORK/stripped.cpp"
+if cmp -s "$SRC" "$WORK/stripped.cpp"; then
+  echo "no DCF77_PROBE lines found in $SRC" >&2
+  exit 1
+fi
+
+compile "$SRC" "$WORK/probed.o"
+compile "$WORK/stripped.cpp" "$WORK/stripped.o"
+compile "$SRC" "$WORK/profiling.o" -DDCF77_PROFILING
+
+# Skip the header line naming the object file
+objdump -d --no-show-raw-insn "$WORK/probed.o" | tail -n +3 >"$WORK/probed.dis"
+objdump -d --no-show-raw-insn "$WORK/stripped.o" | tail -n +3 >"$WORK/stripped.dis"
+
+size "$WORK/stripped.o" "$WORK/probed.o" "$WORK/profiling.o" | sed "s|$WORK/||"
+
+if ! cmp -s "$WORK/probed.dis" "$WORK/stripped.dis"; then
+  echo "FAIL: disabled probes change the generated code" >&2
+  diff "$WORK/stripped.dis" "$WORK/probed.dis" | head -n 40 >&2
+  exit 1
+fi
+if [ "$(size "$WORK/probed.o" | tail -n 1 | cut -f 1-4)" != "$(size "$WORK/stripped.o" | tail -n 1 | cut -f 1-4)" ]; then
+  echo "FAIL: disabled probes change the section sizes" >&2
+  exit 1
+fi
+echo "OK: disabled probes add no code or data"
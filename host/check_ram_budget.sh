@@ -0,0 +1,106 @@
+#!/bin/sh
+# Checks the memory footprint of the DCF77 core against a budget.
+#
+# Compiles the component against the host stubs for the default
+# configuration (DCF77 alone, one time source) and reports its RAM by
+# module: the emitter object ESPHome allocates at boot and its parts, the
+# frame buffers and time source entries on the heap, and the .data and .bss
+# of the object file. Module sizes are read with nm from arrays sized with
+# sizeof(), so nothing has to run. A build with every option (GPS, time
+# push, a 4-minute flight recorder and profiling) is reported for reference.
+#
+# The host has 8-byte pointers against 4 on the ESP32, so the figures are
+# upper bounds of the device's. Stack and heap use can only be measured on
+# the device: see dump_memory() in the component and 'm' in the sketch.
+#
+# Fails if the RAM or the code (text) of the default build exceeds its
+# budget. Run from the repository root:
+#   sh host/check_ram_budget.sh
+# RAM_BUDGET and CODE_BUDGET set the budgets in bytes (default 1024 and
+# 32768). CXX and CXXFLAGS override the compiler and flags (default g++ -O2).
+
+set -eu
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+RAM_BUDGET=${RAM_BUDGET:-1024}
+CODE_BUDGET=${CODE_BUDGET:-32768}
+SRC=esphome/components/dcf77_emitter/dcf77_emitter.cpp
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+ALL="-DDCF77_GPS -DDCF77_TIME_PUSH -DDCF77_FLIGHT_RECORDER=4 -DDCF77_PROFILING"
+
+compile() {
+  # $1 source, $2 object, remaining arguments are extra flags
+  src=$1
+  obj=$2
+  shift 2
+  $CXX -std=gnu++17 $CXXFLAGS "$@" -Ihost/stubs -I. -Iesphome/components/dcf77_emitter -c "$src" -o "$obj"
+}
+
+cat >"$WORK/sizes.cpp" <<'EOF'
+#include "dcf77_emitter.h"
+
+using esphome::dcf77_emitter::DCF77Emitter;
+
+char emitter[sizeof(DCF77Emitter)];
+char time_fusion[sizeof(dcf77::TimeFusion)];
+char tick_watchdog[sizeof(dcf77::TickWatchdog)];
+char integrity_monitor[sizeof(dcf77::IntegrityMonitor)];
+char transmitter[DCF77Emitter::transmitter_bytes()];
+char time_source[sizeof(dcf77::TimeFusion::Source) + sizeof(void *)];
+EOF
+
+# Size in bytes of symbol $2 in object $1
+symbol() { nm -S --radix=d "$1" | awk -v name="$2" '$4 == name { print $2 + 0 }'; }
+# Sum of the sizes of sections $2... in object $1
+sections() {
+  obj=$1
+  shift
+  total=0
+  for section in "$@"; do
+    bytes=$(size -A "$obj" | awk -v name="$section" '$1 == name { print $2 }')
+    total=$((total + ${bytes:-0}))
+  done
+  echo "$total"
+}
+
+ram=0
+for build in default all; do
+  flags=""
+  [ "$build" = all ] && flags=$ALL
+  compile "$SRC" "$WORK/$build.o" $flags
+  compile "$WORK/sizes.cpp" "$WORK/${build}_sizes.o" $flags
+
+  s="$WORK/${build}_sizes.o"
+  emitter=$(symbol "$s" emitter)
+  heap=$(($(symbol "$s" transmitter) + $(symbol "$s" time_source)))
+  data=$(sections "$WORK/$build.o" .data)
+  bss=$(sections "$WORK/$build.o" .bss)
+  text=$(size "$WORK/$build.o" | tail -n 1 | cut -f 1 | tr -d ' ')
+  total=$((emitter + heap + data + bss))
+
+  echo "$build build (bytes):"
+  echo "  emitter object     $emitter (time fusion $(symbol "$s" time_fusion), tick watchdog $(symbol "$s" tick_watchdog), integrity monitor $(symbol "$s" integrity_monitor))"
+  echo "  heap               $heap (frame buffer $(symbol "$s" transmitter), time source $(symbol "$s" time_source))"
+  echo "  static .data/.bss  $data / $bss"
+  echo "  RAM                $total"
+  echo "  code (text)        $text"
+  if [ "$build" = default ]; then
+    ram=$total
+    code=$text
+  fi
+done
+
+status=0
+if [ "$ram" -gt "$RAM_BUDGET" ]; then
+  echo "FAIL: RAM $ram exceeds the budget of $RAM_BUDGET bytes" >&2
+  status=1
+fi
+if [ "$code" -gt "$CODE_BUDGET" ]; then
+  echo "FAIL: code $code exceeds the budget of $CODE_BUDGET bytes" >&2
+  status=1
+fi
+[ "$status" -eq 0 ] && echo "OK: RAM $ram of $RAM_BUDGET bytes, code $code of $CODE_BUDGET bytes"
+exit $status
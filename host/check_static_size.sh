@@ -0,0 +1,55 @@
+#!/bin/sh
+# Compares the code size of the generic component with a static-config build.
+#
+# Compiles the component against the host stubs as it is and with the
+# DCF77_STATIC_* flags `static_config: true` generates for the default
+# configuration (DCF77 only, LED on GPIO2), plus a build without the LED.
+# Reports section sizes and the sizes of the tick-path functions, and fails
+# if the static builds are not smaller than the generic one.
+#
+# Run from the repository root:
+#   sh host/check_static_size.sh
+# CXX and CXXFLAGS override the compiler and flags (default g++ -O2).
+
+set -eu
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SRC=esphome/components/dcf77_emitter/dcf77_emitter.cpp
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+STATIC="-DDCF77_STATIC_CONFIG -DDCF77_STATIC_TRANSMITTERS=1 -DDCF77_STATIC_LED_INVERTED=0"
+
+compile() {
+  # $1 object, remaining arguments are extra flags
+  obj=$1
+  shift
+  $CXX -std=gnu++17 $CXXFLAGS "$@" -Ihost/stubs -I. -Iesphome/components/dcf77_emitter -c "$SRC" -o "$obj"
+}
+
+compile "$WORK/generic.o"
+compile "$WORK/static.o" $STATIC -DDCF77_STATIC_LED_GPIO=2
+compile "$WORK/static_no_led.o" $STATIC -DDCF77_STATIC_LED_GPIO=-1
+
+size "$WORK/generic.o" "$WORK/static.o" "$WORK/static_no_led.o" | sed "s|$WORK/||"
+
+echo "tick path (bytes):"
+for obj in generic static static_no_led; do
+  printf '  %-14s' "$obj"
+  for fn in dcf_out_tick generate_signal_ set_carriers_ schedule_next_tick_; do
+    bytes=$(nm -C --size-sort --radix=d "$WORK/$obj.o" | grep "DCF77Emitter::$fn(" | awk '{ s += $1 } END { print s + 0 }')
+    printf ' %s=%s' "$fn" "$bytes"
+  done
+  echo
+done
+
+text() { size "$1" | tail -n 1 | cut -f 1 | tr -d ' '; }
+generic=$(text "$WORK/generic.o")
+for obj in static static_no_led; do
+  if [ "$(text "$WORK/$obj.o")" -ge "$generic" ]; then
+    echo "FAIL: $obj build is not smaller than the generic one" >&2
+    exit 1
+  fi
+done
+echo "OK: static builds are smaller than the generic one"
@@ -0,0 +1,313 @@
+/*
+  Loopback test of the time push over the native API (time_push: true).
+
+  The DCF77Emitter component runs under the host stub layer, paced to the
+  real clock, behind a TCP socket on 127.0.0.1 that stands in for the native
+  API connection. A client thread plays Home Assistant: every --interval
+  seconds it calls the dcf77_set_time service with its time, and answers
+  each esphome.dcf77_time_ack event with the compensated push, as the
+  automation in the README does. Both directions are delayed by --delay-ms
+  (towards the device, towards Home Assistant) on top of the loopback.
+
+  The report gives the round trips the device measured and the error of
+  its clock against the real one over the second half of the run. Half the
+  difference between the two delays cannot be seen from either end, so the
+  error should settle at (DOWN - UP) / 2; the tool exits non-zero if it is
+  more than a millisecond away from that.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -pthread -DDCF77_TIME_PUSH -Ihost/stubs -I. \
+        -o dcf77_api_push host/dcf77_api_push.cpp host/stubs/host_env.cpp \
+        esphome/components/dcf77_emitter/dcf77_emitter.cpp
+
+  Usage:
+    dcf77_api_push [--seconds=60] [--interval=10] [--delay-ms=UP,DOWN]
+                   [--ppm=N] [--tz=POSIX_TZ]
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esphome/components/dcf77_emitter/dcf77_emitter.h"
+#include "esphome/core/log.h"
+#include "host_env.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  int seconds{60};
+  int interval{10};
+  int up_ms{5};
+  int down_ms{5};
+  double ppm{20};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--seconds", &value)) {
+      options->seconds = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--interval", &value)) {
+      options->interval = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--delay-ms", &value)) {
+      auto ms = host::parse_list(value);
+      if (ms.size() != 2 || ms[0] < 0 || ms[1] < 0) {
+        fprintf(stderr, "--delay-ms needs UP,DOWN\n");
+        return false;
+      }
+      options->up_ms = static_cast<int>(ms[0]);
+      options->down_ms = static_cast<int>(ms[1]);
+    } else if (parse_option(argv[i], "--ppm", &value)) {
+      options->ppm = atof(value.c_str());
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->seconds < 2 * options->interval || options->interval < 1) {
+    fprintf(stderr, "--seconds must cover at least two --interval periods\n");
+    return false;
+  }
+  return true;
+}
+
+int64_t realtime_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Timestamps travel as seconds with six decimals, as in Home Assistant
+std::string timestamp(int64_t us) {
+  char text[32];
+  snprintf(text, sizeof(text), "%" PRId64 ".%06" PRId64, us / 1000000, us % 1000000);
+  return text;
+}
+
+void send_line(int fd, const std::string &line) {
+  const std::string data = line + "\n";
+  if (write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+    perror("write");
+}
+
+// Lines received on a socket
+class LineReader {
+ public:
+  explicit LineReader(int fd) : fd_(fd) {}
+
+  /// Waits up to |timeout_ms| for data. Returns false once the peer closed.
+  bool poll_lines(int timeout_ms, std::vector<std::string> *lines) {
+    struct pollfd pfd = {this->fd_, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+      return true;
+    char data[512];
+    const ssize_t n = read(this->fd_, data, sizeof(data));
+    if (n <= 0)
+      return false;
+    this->buffer_.append(data, n);
+    size_t end;
+    while ((end = this->buffer_.find('\n')) != std::string::npos) {
+      lines->push_back(this->buffer_.substr(0, end));
+      this->buffer_.erase(0, end + 1);
+    }
+    return true;
+  }
+
+ protected:
+  int fd_;
+  std::string buffer_;
+};
+
+// "name key=value ..." into the name and the arguments
+std::string split_call(const std::string &line, host::ServiceArgs *args) {
+  size_t start = line.find(' ');
+  const std::string name = line.substr(0, start);
+  while (start != std::string::npos) {
+    const size_t end = line.find(' ', start + 1);
+    const std::string arg = line.substr(start + 1, end == std::string::npos ? std::string::npos : end - start - 1);
+    const size_t eq = arg.find('=');
+    if (eq != std::string::npos)
+      (*args)[arg.substr(0, eq)] = arg.substr(eq + 1);
+    start = end;
+  }
+  return name;
+}
+
+// Home Assistant's side: the periodic push and the answer to each ack event
+void run_client(int port, const Options &options, const std::atomic<bool> *stop) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+    perror("connect");
+    close(fd);
+    return;
+  }
+  LineReader reader(fd);
+  int64_t next_push_us = realtime_us();
+  while (!*stop) {
+    if (realtime_us() >= next_push_us) {
+      const std::string epoch = timestamp(realtime_us());
+      std::this_thread::sleep_for(std::chrono::milliseconds(options.up_ms));
+      send_line(fd, "dcf77_set_time epoch=" + epoch);
+      next_push_us += options.interval * 1000000LL;
+    }
+    std::vector<std::string> lines;
+    if (!reader.poll_lines(10, &lines))
+      break;
+    for (const auto &line : lines) {
+      host::ServiceArgs data;
+      if (split_call(line, &data) != "esphome.dcf77_time_ack")
+        continue;
+      // The event reaches Home Assistant, which stamps it (time_fired) ...
+      std::this_thread::sleep_for(std::chrono::milliseconds(options.down_ms));
+      const std::string ack_received = timestamp(realtime_us());
+      // ... and the automation pushes its time back
+      const std::string epoch = timestamp(realtime_us());
+      std::this_thread::sleep_for(std::chrono::milliseconds(options.up_ms));
+      send_line(fd, "dcf77_set_time epoch=" + epoch + " ack=" + data["ack"] + " ack_received=" + ack_received);
+    }
+  }
+  close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+
+  // The API connection
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listener, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+      getsockname(listener, reinterpret_cast<struct sockaddr *>(&addr), &addr_len) != 0) {
+    perror("127.0.0.1");
+    return 2;
+  }
+  std::atomic<bool> stop{false};
+  std::thread client(run_client, ntohs(addr.sin_port), std::cref(options), &stop);
+  const int conn = accept(listener, nullptr, nullptr);
+  close(listener);
+  if (conn < 0) {
+    perror("accept");
+    stop = true;
+    client.join();
+    return 2;
+  }
+
+  const int64_t start_us = realtime_us();
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+  host::reset(start_us, options.tz.c_str());
+  host::set_oscillator_ppm(options.ppm);
+  host::set_time_valid(false);
+
+  std::vector<double> round_trips_ms;
+  uint32_t ignored = 0;
+  host::set_log_sink([&](int level, const char *tag, const char *message) {
+    double ms;
+    if (sscanf(message, "Time push with a round trip of %lf ms", &ms) == 1 && strstr(message, "ignored") == nullptr)
+      round_trips_ms.push_back(ms);
+    if (level <= ESPHOME_LOG_LEVEL_WARN) {
+      printf("  t=%6.3f s  %s\n", (realtime_us() - start_us) / 1e6, message);
+      ignored += strstr(message, "ignored") != nullptr;
+    }
+  });
+  host::set_event_sink([conn](const std::string &name, const host::ServiceArgs &data) {
+    std::string line = name;
+    for (const auto &arg : data)
+      line += " " + arg.first + "=" + arg.second;
+    send_line(conn, line);
+  });
+
+  esphome::switch_::Switch sync_switch;
+  sync_switch.publish_state(true);
+  host::RecordingPin antenna_pin(18);
+  esphome::dcf77_emitter::DCF77Emitter emitter;
+  emitter.set_antenna_pin(&antenna_pin);
+  emitter.set_sync_switch(&sync_switch);
+  host::add_component(&emitter);
+
+  printf("Time push over 127.0.0.1 for %d s, every %d s, %d ms towards the device, %d ms back, %.1f ppm\n",
+         options.seconds, options.interval, options.up_ms, options.down_ms, options.ppm);
+  LineReader reader(conn);
+  const int64_t end_us = start_us + options.seconds * 1000000LL;
+  const int64_t measure_us = start_us + options.seconds * 500000LL;
+  int64_t next_sample_us = measure_us;
+  double error_sum = 0, error_min = INFINITY, error_max = -INFINITY;
+  int samples = 0;
+  uint32_t calls = 0;
+  while (realtime_us() < end_us) {
+    host::run_until(host::time_at_epoch(realtime_us()));
+    std::vector<std::string> lines;
+    if (!reader.poll_lines(1, &lines))
+      break;
+    for (const auto &line : lines) {
+      // The call arrives now, not when the loop last ran
+      host::run_until(host::time_at_epoch(realtime_us()));
+      host::ServiceArgs args;
+      const std::string name = split_call(line, &args);
+      if (!host::call_service(name, args))
+        fprintf(stderr, "unknown service: %s\n", name.c_str());
+      calls++;
+    }
+    const dcf77::TimeFusion &fusion = emitter.time_fusion();
+    if (realtime_us() >= next_sample_us && fusion.valid()) {
+      const double error_ms = (fusion.utc_us(host::now_us()) - host::epoch_us()) / 1e3;
+      error_sum += error_ms;
+      error_min = std::min(error_min, error_ms);
+      error_max = std::max(error_max, error_ms);
+      samples++;
+      next_sample_us += 100000;
+    }
+  }
+  stop = true;
+  client.join();
+  close(conn);
+
+  printf("Service calls: %" PRIu32 ", compensated pushes: %zu, ignored: %" PRIu32 "\n", calls, round_trips_ms.size(),
+         ignored);
+  if (round_trips_ms.empty() || samples == 0) {
+    printf("FAIL: no compensated push was applied\n");
+    return 1;
+  }
+  std::sort(round_trips_ms.begin(), round_trips_ms.end());
+  printf("Round trip: min %.3f ms, median %.3f ms, max %.3f ms\n", round_trips_ms.front(),
+         round_trips_ms[round_trips_ms.size() / 2], round_trips_ms.back());
+  const double expected_ms = (options.down_ms - options.up_ms) / 2.0;
+  const double mean_ms = error_sum / samples;
+  printf("Clock error over the second half: mean %.3f ms, min %.3f ms, max %.3f ms (expected %.3f ms)\n", mean_ms,
+         error_min, error_max, expected_ms);
+  if (std::abs(mean_ms - expected_ms) > 1.0) {
+    printf("FAIL: clock error is more than 1 ms off the path asymmetry\n");
+    return 1;
+  }
+  return 0;
+}
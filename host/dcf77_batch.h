@@ -0,0 +1,337 @@
+#pragma once
+
+// Batch DCF77 frame encoding for the host tools that produce frames by the
+// million (dcf77_frames, dcf77_golden).
+//
+// A frame splits into two parts. The date part (DST bits, day, weekday,
+// month, year and their parity) stays the same for a whole local day at a
+// fixed offset. The time part (bits 21..35: minute and hour in BCD with
+// their parity) depends only on the minute of the day. BatchFrameEncoder
+// finds spans of constant offset that end at the next local midnight.
+// It calls localtime_r() at both ends of a span and bisects when they
+// differ. It encodes the date part once per span. It then hands every run
+// of consecutive minutes to a run kernel, which computes the time part in
+// 16-bit lanes:
+//   hour   = m * 1093 >> 16          (m / 60 for m < 1440)
+//   minute = m - 60 * hour
+//   bcd(v) = v + 6 * (v * 205 >> 11) (v / 10 for v < 60)
+//   parity = xor-fold of the BCD bits
+// The kernels exist in SSE2, AVX2 and NEON versions. The scalar fallback
+// does the same integer steps, so all kernels give identical frames, and
+// they match dcf77::encode_frame() for every minute of the day.
+//
+// Like LocalMinuteCalendar, this assumes a zone never changes its offset
+// twice between two sampled points. Here the points are a local day apart
+// rather than an hour, which holds for every rule set the tools use.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DCF77_BATCH_HAVE_AVX2 1
+#ifdef __SSE2__
+#define DCF77_BATCH_HAVE_SSE2 1
+#endif
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DCF77_BATCH_HAVE_NEON 1
+#endif
+
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+
+namespace host {
+
+/// Bits 21..35 of a DCF77 frame: minute, hour and their parity bits.
+const unsigned FRAME_TIME_SHIFT = 21;
+const uint64_t FRAME_TIME_MASK = uint64_t{0x7FFF} << FRAME_TIME_SHIFT;
+
+// -----------------------------------------------------------------------------
+// Run kernels: frames[i] = date_frame | time bits of minute_of_day + i, with
+// minute_of_day + n <= 1440
+// -----------------------------------------------------------------------------
+using RunKernel = void (*)(uint64_t date_frame, uint32_t minute_of_day, uint64_t *frames, size_t n);
+
+/// Frame bits 21..35 of minute |m| of the day, shifted down to bit 0.
+inline uint32_t frame_time_bits(uint32_t m) {
+  const uint32_t hour = (m * 1093) >> 16;
+  const uint32_t minute = m - hour * 60;
+  const uint32_t minute_bcd = minute + 6 * ((minute * 205) >> 11);
+  const uint32_t hour_bcd = hour + 6 * ((hour * 205) >> 11);
+  auto parity = [](uint32_t x) {
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+  };
+  return minute_bcd | parity(minute_bcd) << 7 | hour_bcd << 8 | parity(hour_bcd) << 14;
+}
+
+inline void encode_run_scalar(uint64_t date_frame, uint32_t minute_of_day, uint64_t *frames, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    frames[i] = date_frame | uint64_t{frame_time_bits(minute_of_day + static_cast<uint32_t>(i))} << FRAME_TIME_SHIFT;
+}
+
+#ifdef DCF77_BATCH_HAVE_SSE2
+inline __m128i frame_time_bits_sse2(__m128i m) {
+  const __m128i hour = _mm_mulhi_epu16(m, _mm_set1_epi16(1093));
+  const __m128i minute = _mm_sub_epi16(m, _mm_mullo_epi16(hour, _mm_set1_epi16(60)));
+  auto bcd = [](__m128i v) {
+    const __m128i tens = _mm_srli_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(205)), 11);
+    return _mm_add_epi16(v, _mm_mullo_epi16(tens, _mm_set1_epi16(6)));
+  };
+  auto parity = [](__m128i x) {
+    x = _mm_xor_si128(x, _mm_srli_epi16(x, 4));
+    x = _mm_xor_si128(x, _mm_srli_epi16(x, 2));
+    x = _mm_xor_si128(x, _mm_srli_epi16(x, 1));
+    return _mm_and_si128(x, _mm_set1_epi16(1));
+  };
+  const __m128i minute_bcd = bcd(minute);
+  const __m128i hour_bcd = bcd(hour);
+  return _mm_or_si128(_mm_or_si128(minute_bcd, _mm_slli_epi16(parity(minute_bcd), 7)),
+                      _mm_or_si128(_mm_slli_epi16(hour_bcd, 8), _mm_slli_epi16(parity(hour_bcd), 14)));
+}
+
+inline void encode_run_sse2(uint64_t date_frame, uint32_t minute_of_day, uint64_t *frames, size_t n) {
+  const __m128i date = _mm_set1_epi64x(static_cast<int64_t>(date_frame));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i m = _mm_add_epi16(_mm_set1_epi16(static_cast<int16_t>(minute_of_day)), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i t = frame_time_bits_sse2(m);
+    const __m128i lo = _mm_unpacklo_epi16(t, zero);
+    const __m128i hi = _mm_unpackhi_epi16(t, zero);
+    __m128i *out = reinterpret_cast<__m128i *>(frames + i);
+    _mm_storeu_si128(out + 0, _mm_or_si128(date, _mm_slli_epi64(_mm_unpacklo_epi32(lo, zero), FRAME_TIME_SHIFT)));
+    _mm_storeu_si128(out + 1, _mm_or_si128(date, _mm_slli_epi64(_mm_unpackhi_epi32(lo, zero), FRAME_TIME_SHIFT)));
+    _mm_storeu_si128(out + 2, _mm_or_si128(date, _mm_slli_epi64(_mm_unpacklo_epi32(hi, zero), FRAME_TIME_SHIFT)));
+    _mm_storeu_si128(out + 3, _mm_or_si128(date, _mm_slli_epi64(_mm_unpackhi_epi32(hi, zero), FRAME_TIME_SHIFT)));
+    m = _mm_add_epi16(m, _mm_set1_epi16(8));
+  }
+  encode_run_scalar(date_frame, minute_of_day + static_cast<uint32_t>(i), frames + i, n - i);
+}
+#endif
+
+#ifdef DCF77_BATCH_HAVE_AVX2
+__attribute__((target("avx2"))) inline __m256i frame_time_bits_avx2(__m256i m) {
+  const __m256i hour = _mm256_mulhi_epu16(m, _mm256_set1_epi16(1093));
+  const __m256i minute = _mm256_sub_epi16(m, _mm256_mullo_epi16(hour, _mm256_set1_epi16(60)));
+  const __m256i minute_tens = _mm256_srli_epi16(_mm256_mullo_epi16(minute, _mm256_set1_epi16(205)), 11);
+  const __m256i hour_tens = _mm256_srli_epi16(_mm256_mullo_epi16(hour, _mm256_set1_epi16(205)), 11);
+  const __m256i minute_bcd = _mm256_add_epi16(minute, _mm256_mullo_epi16(minute_tens, _mm256_set1_epi16(6)));
+  const __m256i hour_bcd = _mm256_add_epi16(hour, _mm256_mullo_epi16(hour_tens, _mm256_set1_epi16(6)));
+  // Both parities at once: minute BCD in the low byte, hour BCD in the high
+  __m256i x = _mm256_or_si256(minute_bcd, _mm256_slli_epi16(hour_bcd, 8));
+  x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 4));
+  x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 2));
+  x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 1));
+  const __m256i parity = _mm256_and_si256(x, _mm256_set1_epi16(0x0101));
+  // Minute parity to bit 7, hour parity to bit 14
+  return _mm256_or_si256(_mm256_or_si256(minute_bcd, _mm256_slli_epi16(hour_bcd, 8)),
+                         _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(parity, _mm256_set1_epi16(1)), 7),
+                                         _mm256_slli_epi16(_mm256_srli_epi16(parity, 8), 14)));
+}
+
+// Frames of the four time words in the low half of |time_bits|
+__attribute__((target("avx2"))) inline __m256i frames_from_time_bits_avx2(__m256i date, __m128i time_bits) {
+  return _mm256_or_si256(date, _mm256_slli_epi64(_mm256_cvtepu16_epi64(time_bits), FRAME_TIME_SHIFT));
+}
+
+__attribute__((target("avx2"))) inline void encode_run_avx2(uint64_t date_frame, uint32_t minute_of_day,
+                                                            uint64_t *frames, size_t n) {
+  const __m256i date = _mm256_set1_epi64x(static_cast<int64_t>(date_frame));
+  __m256i m = _mm256_add_epi16(_mm256_set1_epi16(static_cast<int16_t>(minute_of_day)),
+                               _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i t = frame_time_bits_avx2(m);
+    const __m128i lo = _mm256_castsi256_si128(t);
+    const __m128i hi = _mm256_extracti128_si256(t, 1);
+    __m256i *out = reinterpret_cast<__m256i *>(frames + i);
+    _mm256_storeu_si256(out + 0, frames_from_time_bits_avx2(date, lo));
+    _mm256_storeu_si256(out + 1, frames_from_time_bits_avx2(date, _mm_srli_si128(lo, 8)));
+    _mm256_storeu_si256(out + 2, frames_from_time_bits_avx2(date, hi));
+    _mm256_storeu_si256(out + 3, frames_from_time_bits_avx2(date, _mm_srli_si128(hi, 8)));
+    m = _mm256_add_epi16(m, _mm256_set1_epi16(16));
+  }
+  encode_run_scalar(date_frame, minute_of_day + static_cast<uint32_t>(i), frames + i, n - i);
+}
+#endif
+
+#ifdef DCF77_BATCH_HAVE_NEON
+inline uint16x8_t frame_time_bits_neon(uint16x8_t m) {
+  const uint16x8_t hour = vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(m), 1093), 16),
+                                       vshrn_n_u32(vmull_high_n_u16(m, 1093), 16));
+  const uint16x8_t minute = vmlsq_n_u16(m, hour, 60);
+  const uint16x8_t minute_bcd = vmlaq_n_u16(minute, vshrq_n_u16(vmulq_n_u16(minute, 205), 11), 6);
+  const uint16x8_t hour_bcd = vmlaq_n_u16(hour, vshrq_n_u16(vmulq_n_u16(hour, 205), 11), 6);
+  // Both parities at once: minute BCD in the low byte, hour BCD in the high
+  const uint16x8_t bcd = vorrq_u16(minute_bcd, vshlq_n_u16(hour_bcd, 8));
+  uint16x8_t x = veorq_u16(bcd, vshrq_n_u16(bcd, 4));
+  x = veorq_u16(x, vshrq_n_u16(x, 2));
+  x = veorq_u16(x, vshrq_n_u16(x, 1));
+  const uint16x8_t parity = vandq_u16(x, vdupq_n_u16(0x0101));
+  return vorrq_u16(bcd, vorrq_u16(vshlq_n_u16(vandq_u16(parity, vdupq_n_u16(1)), 7),
+                                  vshlq_n_u16(vshrq_n_u16(parity, 8), 14)));
+}
+
+inline void encode_run_neon(uint64_t date_frame, uint32_t minute_of_day, uint64_t *frames, size_t n) {
+  static const uint16_t STEP[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+  const uint64x2_t date = vdupq_n_u64(date_frame);
+  uint16x8_t m = vaddq_u16(vdupq_n_u16(static_cast<uint16_t>(minute_of_day)), vld1q_u16(STEP));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint16x8_t t = frame_time_bits_neon(m);
+    const uint32x4_t lo = vmovl_u16(vget_low_u16(t));
+    const uint32x4_t hi = vmovl_high_u16(t);
+    vst1q_u64(frames + i + 0, vorrq_u64(date, vshlq_n_u64(vmovl_u32(vget_low_u32(lo)), FRAME_TIME_SHIFT)));
+    vst1q_u64(frames + i + 2, vorrq_u64(date, vshlq_n_u64(vmovl_high_u32(lo), FRAME_TIME_SHIFT)));
+    vst1q_u64(frames + i + 4, vorrq_u64(date, vshlq_n_u64(vmovl_u32(vget_low_u32(hi)), FRAME_TIME_SHIFT)));
+    vst1q_u64(frames + i + 6, vorrq_u64(date, vshlq_n_u64(vmovl_high_u32(hi), FRAME_TIME_SHIFT)));
+    m = vaddq_u16(m, vdupq_n_u16(8));
+  }
+  encode_run_scalar(date_frame, minute_of_day + static_cast<uint32_t>(i), frames + i, n - i);
+}
+#endif
+
+/// Returns the kernel named |name| ("auto", "scalar", "sse2", "avx2" or
+/// "neon"), or nullptr if it is not available on this machine.
+inline RunKernel select_run_kernel(const std::string &name) {
+#ifdef DCF77_BATCH_HAVE_AVX2
+  if (name == "avx2")
+    return __builtin_cpu_supports("avx2") ? encode_run_avx2 : nullptr;
+  if (name == "auto" && __builtin_cpu_supports("avx2"))
+    return encode_run_avx2;
+#endif
+#ifdef DCF77_BATCH_HAVE_SSE2
+  if (name == "sse2" || name == "auto")
+    return encode_run_sse2;
+#endif
+#ifdef DCF77_BATCH_HAVE_NEON
+  if (name == "neon" || name == "auto")
+    return encode_run_neon;
+#endif
+  if (name == "scalar" || name == "auto")
+    return encode_run_scalar;
+  return nullptr;
+}
+
+inline const char *run_kernel_name(RunKernel kernel) {
+#ifdef DCF77_BATCH_HAVE_AVX2
+  if (kernel == encode_run_avx2)
+    return "avx2";
+#endif
+#ifdef DCF77_BATCH_HAVE_SSE2
+  if (kernel == encode_run_sse2)
+    return "sse2";
+#endif
+#ifdef DCF77_BATCH_HAVE_NEON
+  if (kernel == encode_run_neon)
+    return "neon";
+#endif
+  return "scalar";
+}
+
+// -----------------------------------------------------------------------------
+// Batch encoder
+// -----------------------------------------------------------------------------
+
+/// Frames announcing UTC minutes in the process TZ, as
+/// dcf77::encode_frame(civil_from_tm(localtime_r(minute))) gives them. Not
+/// thread-safe; use one instance per thread.
+class BatchFrameEncoder {
+ public:
+  explicit BatchFrameEncoder(RunKernel kernel = select_run_kernel("auto")) : kernel_(kernel) {}
+
+  /// frames[i] = frame announcing epoch_minutes[i], for i < count. Any order
+  /// works; consecutive ascending minutes are the fast path.
+  void encode_many(const int64_t *epoch_minutes, uint64_t *frames, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+      const int64_t first = epoch_minutes[i];
+      if (first < this->span_start_ || first >= this->span_end_)
+        this->load_span_(first);
+      const size_t limit = static_cast<size_t>(std::min<int64_t>(this->span_end_ - first, count - i));
+      size_t n = 1;
+      while (n < limit && epoch_minutes[i + n] == first + static_cast<int64_t>(n))
+        n++;
+      this->kernel_(this->date_frame_, static_cast<uint32_t>(this->span_minute_of_day_ + (first - this->span_start_)),
+                    frames + i, n);
+      i += n;
+    }
+  }
+
+  /// frames[i] = frame announcing first_minute + i, for i < count.
+  void encode_range(int64_t first_minute, uint64_t *frames, size_t count) {
+    while (count > 0) {
+      if (first_minute < this->span_start_ || first_minute >= this->span_end_)
+        this->load_span_(first_minute);
+      const size_t n = static_cast<size_t>(std::min<int64_t>(this->span_end_ - first_minute, count));
+      this->kernel_(this->date_frame_,
+                    static_cast<uint32_t>(this->span_minute_of_day_ + (first_minute - this->span_start_)), frames, n);
+      first_minute += n;
+      frames += n;
+      count -= n;
+    }
+  }
+
+  RunKernel kernel() const { return this->kernel_; }
+
+ protected:
+  static void local_(int64_t epoch_minute, struct tm *tm) {
+    const time_t t = static_cast<time_t>(epoch_minute * 60);
+    localtime_r(&t, tm);
+  }
+
+  // Caches the span of minutes from |epoch_minute| up to the next local
+  // midnight or offset change, whichever comes first.
+  void load_span_(int64_t epoch_minute) {
+    struct tm tm {};
+    local_(epoch_minute, &tm);
+    dcf77::CivilMinute date = dcf77::civil_from_tm(tm);
+    this->span_start_ = epoch_minute;
+    this->span_minute_of_day_ = date.hour * 60 + date.minute;
+    date.hour = 0;
+    date.minute = 0;
+    this->date_frame_ = dcf77::encode_frame(date);
+    if (tm.tm_gmtoff % 60 != 0) {
+      // Minutes do not start on local minute boundaries
+      this->span_end_ = epoch_minute + 1;
+      return;
+    }
+    auto same_offset = [&](int64_t minute) {
+      struct tm other {};
+      local_(minute, &other);
+      return other.tm_gmtoff == tm.tm_gmtoff && other.tm_isdst == tm.tm_isdst;
+    };
+    int64_t good = epoch_minute;
+    int64_t end = epoch_minute + (1440 - this->span_minute_of_day_);
+    if (!same_offset(end - 1)) {
+      // First minute with the new offset
+      int64_t bad = end - 1;
+      while (bad - good > 1) {
+        const int64_t mid = good + (bad - good) / 2;
+        (same_offset(mid) ? good : bad) = mid;
+      }
+      end = bad;
+    }
+    this->span_end_ = end;
+  }
+
+  RunKernel kernel_;
+  int64_t span_start_{0};
+  int64_t span_end_{0};  // exclusive; empty until the first load
+  int32_t span_minute_of_day_{0};
+  uint64_t date_frame_{0};
+};
+
+/// One-shot form of BatchFrameEncoder::encode_many() with the best kernel.
+inline void encode_many(const int64_t *epoch_minutes, uint64_t *frames, size_t count) {
+  BatchFrameEncoder encoder;
+  encoder.encode_many(epoch_minutes, frames, count);
+}
+
+}  // namespace host
@@ -0,0 +1,104 @@
+#pragma once
+
+// Fast UTC minute to local civil time conversion for the host tools that
+// encode millions of frames.
+//
+// localtime_r() costs a few hundred nanoseconds and takes a process-wide
+// lock in glibc, which serialises worker threads. LocalMinuteCalendar calls
+// it only twice per UTC hour, at the first and the last minute; when the
+// offset and DST flag agree, every minute of that hour is derived with plain
+// integer arithmetic. Hours that contain a transition fall back to
+// localtime_r() per minute, so the result always matches the C library.
+
+#include <cstdint>
+#include <ctime>
+
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+
+namespace host {
+
+inline int64_t floor_div(int64_t a, int64_t b) { return a >= 0 ? a / b : (a - b + 1) / b; }
+
+/// Proleptic Gregorian date of |days| since 1970-01-01 (H. Hinnant's
+/// civil_from_days).
+inline void civil_from_days(int64_t days, int *year, int *month, int *day) {
+  days += 719468;
+  const int64_t era = floor_div(days, 146097);
+  const int64_t doe = days - era * 146097;
+  const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const int64_t mp = (5 * doy + 2) / 153;
+  *day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+  *month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+  *year = static_cast<int>(yoe + era * 400 + (*month <= 2));
+}
+
+/// Frame fields for local minute |local_minute| (minutes since the epoch in
+/// local time).
+inline dcf77::CivilMinute civil_from_local_minute(int64_t local_minute, bool dst) {
+  const int64_t days = floor_div(local_minute, 1440);
+  const int64_t minute_of_day = local_minute - days * 1440;
+  int year, month, day;
+  civil_from_days(days, &year, &month, &day);
+  const int64_t weekday = ((days + 3) % 7 + 7) % 7;  // 1970-01-01 was a thursday; monday=0
+  return dcf77::CivilMinute{static_cast<uint8_t>(minute_of_day % 60),
+                            static_cast<uint8_t>(minute_of_day / 60),
+                            static_cast<uint8_t>(day),
+                            static_cast<uint8_t>(weekday + 1),
+                            static_cast<uint8_t>(month),
+                            static_cast<uint8_t>(((year % 100) + 100) % 100),
+                            dst};
+}
+
+/// Local civil time of UTC minutes using the process TZ. Not thread-safe;
+/// use one instance per thread.
+class LocalMinuteCalendar {
+ public:
+  dcf77::CivilMinute at(int64_t epoch_minute) {
+    const int64_t hour = floor_div(epoch_minute, 60);
+    if (hour != this->hour_)
+      this->load_hour_(hour);
+    if (this->uniform_) {
+      // Only the time of day changes between consecutive minutes; the date
+      // is derived once per local day.
+      const int64_t local_minute = epoch_minute + this->offset_minutes_;
+      const int64_t minute_of_day = local_minute - this->day_start_;
+      if (minute_of_day < 0 || minute_of_day >= 1440) {
+        this->date_ = civil_from_local_minute(local_minute, this->dst_);
+        this->day_start_ = local_minute - (this->date_.hour * 60 + this->date_.minute);
+        return this->date_;
+      }
+      dcf77::CivilMinute t = this->date_;
+      t.hour = static_cast<uint8_t>(minute_of_day / 60);
+      t.minute = static_cast<uint8_t>(minute_of_day % 60);
+      return t;
+    }
+    struct tm tm {};
+    time_t t = static_cast<time_t>(epoch_minute * 60);
+    localtime_r(&t, &tm);
+    return dcf77::civil_from_tm(tm);
+  }
+
+ protected:
+  void load_hour_(int64_t hour) {
+    struct tm first {}, last {};
+    time_t t = static_cast<time_t>(hour * 3600);
+    localtime_r(&t, &first);
+    t += 59 * 60;
+    localtime_r(&t, &last);
+    this->hour_ = hour;
+    this->uniform_ = first.tm_gmtoff == last.tm_gmtoff && first.tm_isdst == last.tm_isdst && first.tm_gmtoff % 60 == 0;
+    this->offset_minutes_ = first.tm_gmtoff / 60;
+    this->dst_ = first.tm_isdst > 0;
+    this->date_.dst = this->dst_;
+  }
+
+  int64_t hour_{INT64_MIN};
+  bool uniform_{false};
+  int64_t offset_minutes_{0};
+  bool dst_{false};
+  int64_t day_start_{INT64_MIN / 2};  // local minute of the cached date's midnight
+  dcf77::CivilMinute date_{};
+};
+
+}  // namespace host
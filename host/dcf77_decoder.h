@@ -0,0 +1,189 @@
+#pragma once
+
+// Reference DCF77 receiver used by the host tools.
+//
+// It is written independently of the firmware encoders on purpose: it sees
+// only carrier edges, classifies the reduced-amplitude pulses the way a
+// consumer receiver (HD-1688 class) does, and decodes a minute when it sees
+// the missing second-59 pulse. Frames are kept as a 64-bit word where bit n
+// is the value transmitted in second n.
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+
+namespace host {
+
+struct Dcf77Time {
+  int minute;
+  int hour;
+  int day;
+  int day_of_week;  // monday=1 [1-7]
+  int month;
+  int year;  // two digits
+  bool dst;
+
+  bool operator==(const Dcf77Time &other) const {
+    return minute == other.minute && hour == other.hour && day == other.day && day_of_week == other.day_of_week &&
+           month == other.month && year == other.year && dst == other.dst;
+  }
+  bool operator!=(const Dcf77Time &other) const { return !(*this == other); }
+};
+
+/// Civil time a correct transmitter announces at the minute marker that
+/// starts UTC epoch minute |epoch_minute|, using the process TZ.
+inline Dcf77Time dcf77_expected_time(int64_t epoch_minute) {
+  time_t epoch = static_cast<time_t>(epoch_minute * 60);
+  struct tm tm {};
+  localtime_r(&epoch, &tm);
+  return Dcf77Time{tm.tm_min,  tm.tm_hour,         tm.tm_mday, tm.tm_wday == 0 ? 7 : tm.tm_wday,
+                   tm.tm_mon + 1, tm.tm_year % 100, tm.tm_isdst > 0};
+}
+
+/// Decodes the 59 data bits of a frame. Returns nullptr on success or a
+/// short description of the first structural or parity error.
+inline const char *dcf77_decode_frame(uint64_t bits, Dcf77Time *out) {
+  auto bit = [bits](int n) { return static_cast<int>((bits >> n) & 1); };
+  auto field = [&](int first, int width, int *parity) {
+    int value = 0;
+    for (int n = 0; n < width; n++) {
+      int b = bit(first + n);
+      *parity ^= b;
+      value |= b << n;
+    }
+    return (value >> 4) * 10 + (value & 0x0F);
+  };
+
+  if (bit(0) != 0)
+    return "start bit";
+  if (bit(20) != 1)
+    return "time start bit";
+  if (bit(17) == bit(18))
+    return "dst flags";
+
+  int parity = 0;
+  out->minute = field(21, 7, &parity);
+  if (parity != bit(28))
+    return "minute parity";
+  parity = 0;
+  out->hour = field(29, 6, &parity);
+  if (parity != bit(35))
+    return "hour parity";
+  parity = 0;
+  out->day = field(36, 6, &parity);
+  out->day_of_week = field(42, 3, &parity);
+  out->month = field(45, 5, &parity);
+  out->year = field(50, 8, &parity);
+  if (parity != bit(58))
+    return "date parity";
+  out->dst = bit(17) != 0;
+
+  if (out->minute > 59 || out->hour > 23 || out->day < 1 || out->day > 31 || out->day_of_week < 1 ||
+      out->month < 1 || out->month > 12 || out->year > 99)
+    return "field range";
+  return nullptr;
+}
+
+/// Pulse-width and spacing windows of the receiver. The defaults follow the
+/// tolerances of common consumer receiver modules.
+struct Dcf77ReceiverWindows {
+  int32_t zero_min_us{40000};
+  int32_t zero_max_us{130000};
+  int32_t one_min_us{140000};
+  int32_t one_max_us{250000};
+  int32_t second_min_us{900000};
+  int32_t second_max_us{1100000};
+  int32_t marker_min_us{1800000};
+  int32_t marker_max_us{2200000};
+};
+
+struct Dcf77Minute {
+  int64_t marker_us;  // carrier drop that starts the decoded minute
+  uint64_t bits;
+  int bit_count;       // pulses seen since the previous marker (59 when complete)
+  const char *error;   // nullptr when the frame decoded cleanly
+  Dcf77Time time;
+};
+
+/// Edge-driven receiver state machine. Feed it carrier level changes in time
+/// order; every detected minute marker produces one Dcf77Minute.
+class Dcf77Receiver {
+ public:
+  explicit Dcf77Receiver(Dcf77ReceiverWindows windows = {}) : windows_(windows) {}
+
+  void set_callback(std::function<void(const Dcf77Minute &)> callback) { this->callback_ = std::move(callback); }
+
+  void feed(int64_t t_us, bool carrier_on) {
+    if (carrier_on == this->carrier_on_)
+      return;
+    this->carrier_on_ = carrier_on;
+    if (!carrier_on) {
+      this->on_fall_(t_us);
+    } else if (this->fall_us_ >= 0) {
+      this->on_rise_(t_us - this->fall_us_);
+    }
+  }
+
+  uint32_t pulse_errors() const { return this->pulse_errors_; }
+  uint32_t spacing_errors() const { return this->spacing_errors_; }
+
+ protected:
+  void on_fall_(int64_t t_us) {
+    if (this->fall_us_ >= 0) {
+      int64_t gap = t_us - this->fall_us_;
+      if (gap >= this->windows_.marker_min_us && gap <= this->windows_.marker_max_us) {
+        if (this->synced_) {
+          Dcf77Minute minute{t_us, this->bits_, this->bit_count_, nullptr, {}};
+          if (this->bit_count_ != 59 || this->broken_) {
+            minute.error = this->broken_ ? "bad pulse" : "bit count";
+          } else {
+            minute.error = dcf77_decode_frame(this->bits_, &minute.time);
+          }
+          if (this->callback_)
+            this->callback_(minute);
+        }
+        this->synced_ = true;
+        this->reset_minute_();
+      } else if (gap < this->windows_.second_min_us || gap > this->windows_.second_max_us) {
+        this->spacing_errors_++;
+        this->broken_ = true;
+      }
+    }
+    this->fall_us_ = t_us;
+  }
+
+  void on_rise_(int64_t width_us) {
+    int value;
+    if (width_us >= this->windows_.zero_min_us && width_us <= this->windows_.zero_max_us) {
+      value = 0;
+    } else if (width_us >= this->windows_.one_min_us && width_us <= this->windows_.one_max_us) {
+      value = 1;
+    } else {
+      this->pulse_errors_++;
+      this->broken_ = true;
+      return;
+    }
+    if (this->bit_count_ < 64 && value != 0)
+      this->bits_ |= uint64_t{1} << this->bit_count_;
+    this->bit_count_++;
+  }
+
+  void reset_minute_() {
+    this->bits_ = 0;
+    this->bit_count_ = 0;
+    this->broken_ = false;
+  }
+
+  Dcf77ReceiverWindows windows_;
+  std::function<void(const Dcf77Minute &)> callback_;
+  bool carrier_on_{false};
+  int64_t fall_us_{-1};
+  bool synced_{false};
+  bool broken_{false};
+  uint64_t bits_{0};
+  int bit_count_{0};
+  uint32_t pulse_errors_{0};
+  uint32_t spacing_errors_{0};
+};
+
+}  // namespace host
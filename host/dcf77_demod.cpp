@@ -0,0 +1,312 @@
+/*
+  Envelope demodulator for PCM captures of the DCF77 signal.
+
+  Reads a mono 16-bit WAV/RF64 recording (an SDR or scope capture of the
+  antenna, or dcf77_render output), mixes it with the carrier and integrates
+  over short windows to get the amplitude envelope. Pulse edges are found on
+  the envelope with hysteresis and timed by interpolating the half-level
+  crossing between windows, which resolves them far below one window. The
+  edges feed the reference receiver. The report lists minutes that fail to
+  decode and gives pulse widths and the deviation of the pulse starts from
+  a whole-second grid: the jitter of the transmitter.
+
+  The file is memory-mapped and processed in fixed-size chunks that are
+  released after use, so resident memory does not grow with the file.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -I. -o dcf77_demod host/dcf77_demod.cpp
+
+  Usage:
+    dcf77_demod --in=FILE [--carrier-hz=77500] [--window-us=100]
+                [--edges=FILE|-] [--start=EPOCH] [--tz=POSIX_TZ]
+                [--kernel=auto|scalar|avx2|neon]
+
+  --edges writes one CSV line per pulse: start and end time in seconds from
+  the start of the capture, width and distance to the previous pulse start
+  in microseconds, and the bit value the receiver assigns. With --start (the
+  UTC second of the first sample) every decoded minute is also checked
+  against the expected civil time.
+*/
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "dcf77_decoder.h"
+#include "dcf77_pcm.h"
+#include "mapped_file.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  std::string in;
+  std::string edges;
+  uint32_t carrier_hz{77500};
+  double window_us{100};
+  bool check_time{false};
+  int64_t start_epoch{0};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  std::string kernel{"auto"};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--in", &value)) {
+      options->in = value;
+    } else if (parse_option(argv[i], "--edges", &value)) {
+      options->edges = value;
+    } else if (parse_option(argv[i], "--carrier-hz", &value)) {
+      options->carrier_hz = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--window-us", &value)) {
+      options->window_us = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--start", &value)) {
+      options->start_epoch = strtoll(value.c_str(), nullptr, 10);
+      options->check_time = true;
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--kernel", &value)) {
+      options->kernel = value;
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->in.empty()) {
+    fprintf(stderr, "--in is required\n");
+    return false;
+  }
+  return options->window_us > 0;
+}
+
+struct Stat {
+  int64_t count{0};
+  double min{INFINITY};
+  double max{-INFINITY};
+  double sum{0};
+  double sum_sq{0};
+
+  void add(double v) {
+    count++;
+    min = std::min(min, v);
+    max = std::max(max, v);
+    sum += v;
+    sum_sq += v * v;
+  }
+  double mean() const { return sum / count; }
+  double stddev() const { return std::sqrt(std::max(0.0, sum_sq / count - mean() * mean())); }
+
+  void print(const char *label, const char *unit) const {
+    if (count == 0) {
+      printf("  %-28s none\n", label);
+      return;
+    }
+    printf("  %-28s n=%-7" PRId64 " mean=%9.1f sd=%8.1f min=%9.1f max=%9.1f %s\n", label, count, mean(), stddev(),
+           min, max, unit);
+  }
+};
+
+// Turns envelope samples into carrier edges. The full carrier level is
+// tracked with a slowly decaying peak and the reduced level with the floor of
+// the last pulse. The state changes at 40 % and 60 % of the way between them,
+// and each edge is timed at the interpolated 50 % crossing.
+class EdgeDetector {
+ public:
+  EdgeDetector(double window_s, std::function<void(double t_s, bool carrier_on)> on_edge)
+      : window_s_(window_s), decay_(1.0 - window_s / 10.0), on_edge_(std::move(on_edge)) {}
+
+  void feed(const float *envelope, size_t n) {
+    for (size_t k = 0; k < n; k++, this->index_++) {
+      const double e = envelope[k];
+      this->peak_ = std::max(e, this->peak_ * this->decay_);
+      const double span = this->peak_ - this->floor_;
+      const double half = this->floor_ + 0.5 * span;
+      // Window centres are at (index + 0.5) windows
+      const double t = (this->index_ + 0.5) * this->window_s_;
+      if (this->index_ > 0 && (this->previous_ - half) * (e - half) < 0)
+        this->crossing_s_ = t - this->window_s_ * (e - half) / (e - this->previous_);
+      this->previous_ = e;
+      if (this->carrier_on_ && e < this->floor_ + 0.4 * span) {
+        this->carrier_on_ = false;
+        this->pulse_min_ = e;
+        this->on_edge_(this->crossing_s_, false);
+      } else if (!this->carrier_on_ && e > this->floor_ + 0.6 * span) {
+        this->carrier_on_ = true;
+        if (this->index_ > 0) {
+          this->floor_ = std::min(this->pulse_min_, 0.5 * this->peak_);
+          this->on_edge_(this->crossing_s_, true);
+        }
+      } else if (!this->carrier_on_) {
+        this->pulse_min_ = std::min(this->pulse_min_, e);
+      }
+    }
+  }
+
+ protected:
+  double window_s_;
+  double decay_;
+  std::function<void(double, bool)> on_edge_;
+  uint64_t index_{0};
+  double peak_{0};
+  double floor_{0};
+  double pulse_min_{0};
+  double previous_{0};
+  double crossing_s_{0};
+  bool carrier_on_{false};
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  host::MappedFile file;
+  if (!file.open(options.in)) {
+    fprintf(stderr, "%s\n", file.error().c_str());
+    return 1;
+  }
+  host::WavInfo wav{};
+  if (const char *error = host::parse_wav_header(file.data(), file.size(), &wav)) {
+    fprintf(stderr, "%s: %s\n", options.in.c_str(), error);
+    return 1;
+  }
+  if (wav.format != 1 || wav.bits_per_sample != 16 || wav.channels != 1) {
+    fprintf(stderr, "%s: need mono 16-bit PCM (convert with: sox IN -c 1 -b 16 -e signed OUT.wav)\n",
+            options.in.c_str());
+    return 1;
+  }
+  if (wav.data_offset % 2 != 0) {
+    fprintf(stderr, "%s: sample data is not 16-bit aligned\n", options.in.c_str());
+    return 1;
+  }
+
+  host::MixKernel kernel = host::select_mix_kernel(options.kernel);
+  if (kernel == nullptr) {
+    fprintf(stderr, "kernel '%s' is not available on this machine\n", options.kernel.c_str());
+    return 2;
+  }
+  const uint32_t window =
+      std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(wav.sample_rate * options.window_us / 1e6)));
+  host::PcmEnvelopeDemodulator demodulator(wav.sample_rate, options.carrier_hz, window, kernel);
+  if (demodulator.error() != nullptr) {
+    fprintf(stderr, "%s\n", demodulator.error());
+    return 2;
+  }
+
+  FILE *edges = nullptr;
+  if (!options.edges.empty()) {
+    edges = options.edges == "-" ? stdout : fopen(options.edges.c_str(), "w");
+    if (edges == nullptr) {
+      perror(options.edges.c_str());
+      return 1;
+    }
+    fprintf(edges, "start_s,end_s,width_us,interval_us,bit\n");
+  }
+
+  // Receiver and statistics
+  host::Dcf77ReceiverWindows windows;
+  host::Dcf77Receiver receiver(windows);
+  int64_t minutes_ok = 0, minutes_bad = 0, wrong_time = 0;
+  receiver.set_callback([&](const host::Dcf77Minute &minute) {
+    if (minute.error != nullptr) {
+      minutes_bad++;
+      printf("  minute at %10.3f s: %s\n", minute.marker_us / 1e6, minute.error);
+      return;
+    }
+    minutes_ok++;
+    if (!options.check_time)
+      return;
+    int64_t epoch_us = options.start_epoch * 1000000 + minute.marker_us;
+    if (minute.time == host::dcf77_expected_time((epoch_us + 30000000) / 60000000))
+      return;
+    wrong_time++;
+    const host::Dcf77Time &t = minute.time;
+    printf("  minute at %10.3f s: got 20%02d-%02d-%02d %02d:%02d, not the expected time\n", minute.marker_us / 1e6,
+           t.year, t.month, t.day, t.hour, t.minute);
+  });
+
+  Stat zero_width, one_width, interval, grid_offset;
+  double fall_s = -1, previous_fall_s = -1;
+  auto on_edge = [&](double t_s, bool carrier_on) {
+    int64_t t_us = static_cast<int64_t>(std::llround(t_s * 1e6));
+    receiver.feed(t_us, carrier_on);
+    if (!carrier_on) {
+      previous_fall_s = fall_s;
+      fall_s = t_s;
+      return;
+    }
+    if (fall_s < 0)
+      return;
+    double width_us = (t_s - fall_s) * 1e6;
+    double interval_us = previous_fall_s < 0 ? 0 : (fall_s - previous_fall_s) * 1e6;
+    const char *bit = "?";
+    if (width_us >= windows.zero_min_us && width_us <= windows.zero_max_us) {
+      bit = "0";
+      zero_width.add(width_us);
+    } else if (width_us >= windows.one_min_us && width_us <= windows.one_max_us) {
+      bit = "1";
+      one_width.add(width_us);
+    }
+    if (previous_fall_s >= 0) {
+      // Deviation from the nearest whole number of seconds, so the marker gap
+      // counts as well
+      double deviation = interval_us - std::round(interval_us / 1e6) * 1e6;
+      interval.add(deviation);
+    }
+    // Offset of the pulse start from the nearest second of the capture
+    grid_offset.add((fall_s - std::round(fall_s)) * 1e6);
+    if (edges != nullptr)
+      fprintf(edges, "%.6f,%.6f,%.1f,%.1f,%s\n", fall_s, t_s, width_us, interval_us, bit);
+  };
+  EdgeDetector detector(static_cast<double>(window) / wav.sample_rate, on_edge);
+
+  // Chunks of whole windows; about 8 MiB of samples each
+  const size_t chunk_samples = (size_t{4} << 20) / window * window;
+  const int16_t *samples = reinterpret_cast<const int16_t *>(file.data() + wav.data_offset);
+  const uint64_t total = wav.data_bytes / 2 / window * window;
+  std::vector<float> envelope(chunk_samples / window);
+
+  auto wall_start = std::chrono::steady_clock::now();
+  for (uint64_t done = 0; done < total;) {
+    size_t n = static_cast<size_t>(std::min<uint64_t>(chunk_samples, total - done));
+    demodulator.process(samples + done, n, envelope.data());
+    detector.feed(envelope.data(), n / window);
+    file.release(wav.data_offset + done * 2, n * 2);
+    done += n;
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  if (edges != nullptr && edges != stdout)
+    fclose(edges);
+
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  const double duration_s = static_cast<double>(total) / wav.sample_rate;
+  printf("%s: %.1f s at %" PRIu32 " Hz, carrier %" PRIu32 " Hz, window %" PRIu32 " samples (%.1f us), %s kernel\n",
+         options.in.c_str(), duration_s, wav.sample_rate, options.carrier_hz, window, window * 1e6 / wav.sample_rate,
+         host::mix_kernel_name(kernel));
+  printf("Demodulated in %.2f s (%.1f Msamples/s, %.0fx real time), max RSS %ld MiB\n", wall_s, total / wall_s / 1e6,
+         duration_s / wall_s, usage.ru_maxrss / 1024);
+  printf("Minutes decoded OK: %" PRId64 ", with errors: %" PRId64, minutes_ok, minutes_bad);
+  if (options.check_time)
+    printf(", wrong time: %" PRId64, wrong_time);
+  printf("\nReceiver pulse errors: %u, spacing errors: %u\n", receiver.pulse_errors(), receiver.spacing_errors());
+  zero_width.print("'0' pulse width", "us");
+  one_width.print("'1' pulse width", "us");
+  interval.print("pulse start interval error", "us");
+  grid_offset.print("pulse start in second", "us");
+
+  const bool failed = minutes_ok == 0 || minutes_bad > 0 || wrong_time > 0;
+  return failed ? 1 : 0;
+}
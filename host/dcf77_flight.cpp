@@ -0,0 +1,407 @@
+/*
+  Flight recorder analyser: extracts the dumps of flight_recorder.h from a
+  device log and reports what the transmitter emitted around the anomaly
+  that triggered each one.
+
+  A dump is a binary image written as "DCF77FR" lines of hex, which may be
+  mixed with any other log output and prefixed by the logger. The tool
+  joins the lines of each dump, checks their offsets and the FNV-1a check
+  of the end line, and decodes the records. --out writes every image to
+  PREFIX-N.bin; such a file can be given as --in again.
+
+  For each dump the report gives:
+    - the trigger, the time span and records lost while it was written;
+    - the edges written and how late they were against their deadlines,
+      with the ones later than --lag-ms listed;
+    - the DCF77 pulses measured from the edges against the pulses of the
+      recorded frames, with missing, extra and mis-sized ones listed and
+      blanked seconds grouped;
+    - the frames and the minutes they announce;
+    - the stalls, time readings and self-decode errors.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -I. -Ihost -o dcf77_flight host/dcf77_flight.cpp
+
+  Usage:
+    dcf77_flight --in=FILE|- [--out=PREFIX] [--lag-ms=20] [--records]
+                 [--limit=20]
+
+  --records prints every record. --limit caps each listing. The exit status
+  is non-zero when no dump was found or one is damaged.
+*/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+#include "esphome/components/dcf77_emitter/flight_recorder.h"
+#include "esphome/components/dcf77_emitter/integrity_monitor.h"
+#include "esphome/components/dcf77_emitter/tick_watchdog.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  std::string in;
+  std::string out;
+  double lag_ms{20};
+  bool records{false};
+  int limit{20};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--in", &value)) {
+      options->in = value;
+    } else if (parse_option(argv[i], "--out", &value)) {
+      options->out = value;
+    } else if (parse_option(argv[i], "--lag-ms", &value)) {
+      options->lag_ms = strtod(value.c_str(), nullptr);
+    } else if (strcmp(argv[i], "--records") == 0) {
+      options->records = true;
+    } else if (parse_option(argv[i], "--limit", &value)) {
+      options->limit = atoi(value.c_str());
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->in.empty()) {
+    fprintf(stderr, "--in is required\n");
+    return false;
+  }
+  return options->lag_ms >= 0 && options->limit >= 0;
+}
+
+// -----------------------------------------------------------------------------
+// Extraction
+// -----------------------------------------------------------------------------
+
+struct Image {
+  std::vector<uint8_t> bytes;
+  std::string error;  // empty if intact
+};
+
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Joins the dump lines of a log into images
+std::vector<Image> extract(std::istream &in) {
+  std::vector<Image> images;
+  Image *open = nullptr;
+  uint32_t hash = dcf77::FLIGHT_FNV_SEED;
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t at = line.find(DCF77_FLIGHT_PREFIX " ");
+    if (at == std::string::npos)
+      continue;
+    const char *p = line.c_str() + at + sizeof(DCF77_FLIGHT_PREFIX);
+    if (strncmp(p, "end ", 4) == 0) {
+      if (open != nullptr && open->error.empty() && strtoul(p + 4, nullptr, 16) != hash)
+        open->error = "check mismatch";
+      open = nullptr;
+      continue;
+    }
+    char *end;
+    const unsigned long offset = strtoul(p, &end, 16);
+    if (end == p || *end != ' ')
+      continue;
+    if (offset == 0) {
+      if (open != nullptr && open->error.empty())
+        open->error = "no end line";
+      images.push_back(Image());
+      open = &images.back();
+      hash = dcf77::FLIGHT_FNV_SEED;
+    }
+    if (open == nullptr)
+      continue;
+    if (offset != open->bytes.size()) {
+      if (open->error.empty())
+        open->error = "missing lines";
+      continue;
+    }
+    const size_t first = open->bytes.size();
+    for (const char *h = end + 1; hex_digit(h[0]) >= 0 && hex_digit(h[1]) >= 0; h += 2)
+      open->bytes.push_back(static_cast<uint8_t>(hex_digit(h[0]) << 4 | hex_digit(h[1])));
+    hash = dcf77::flight_fnv1a(hash, open->bytes.data() + first, open->bytes.size() - first);
+  }
+  if (open != nullptr && open->error.empty())
+    open->error = "no end line";
+  return images;
+}
+
+// -----------------------------------------------------------------------------
+// Analysis
+// -----------------------------------------------------------------------------
+
+std::string utc_text(int64_t utc_us) {
+  const time_t seconds = static_cast<time_t>(utc_us / 1000000);
+  struct tm tm {};
+  gmtime_r(&seconds, &tm);
+  char text[80];
+  snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d:%02d.%03d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+           tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(utc_us % 1000000 / 1000));
+  return text;
+}
+
+int64_t due_of(const dcf77::FlightRecord &r) { return r.second * int64_t(1000000) + r.due_us; }
+
+void print_record(uint32_t index, const dcf77::FlightRecord &r) {
+  printf("  %8" PRIu32 " %-9s %s %+9" PRId32 " us data=%08" PRIx32 " aux=%u\n", index, dcf77::flight_kind_name(r.kind),
+         utc_text(due_of(r)).c_str(), r.lag_us, r.data, r.aux);
+}
+
+struct Pulse {
+  int64_t start_us;  // written
+  int64_t width_us;
+};
+
+bool analyse(const Image &image, const Options &options) {
+  dcf77::FlightDumpHeader header;
+  const size_t record_size = sizeof(dcf77::FlightRecord);
+  if (image.bytes.size() < dcf77::FLIGHT_DUMP_HEADER_SIZE || !dcf77::flight_decode(image.bytes.data(), &header)) {
+    printf("  not a version %u flight recorder image\n", dcf77::FLIGHT_DUMP_VERSION);
+    return false;
+  }
+  if (image.bytes.size() != dcf77::FLIGHT_DUMP_HEADER_SIZE + header.count * record_size) {
+    printf("  %zu bytes, expected %zu for %" PRIu32 " records\n", image.bytes.size(),
+           dcf77::FLIGHT_DUMP_HEADER_SIZE + header.count * record_size, header.count);
+    return false;
+  }
+  std::vector<dcf77::FlightRecord> records(header.count);
+  uint32_t lost = 0;
+  for (uint32_t i = 0; i < header.count; i++) {
+    dcf77::flight_decode(image.bytes.data() + dcf77::FLIGHT_DUMP_HEADER_SIZE + i * record_size, &records[i]);
+    if (records[i].kind == dcf77::FLIGHT_NONE || records[i].sequence != static_cast<uint16_t>(header.first + i)) {
+      records[i].kind = dcf77::FLIGHT_NONE;
+      lost++;
+    }
+  }
+  int64_t first_us = INT64_MAX, last_us = INT64_MIN;
+  for (const auto &r : records) {
+    if (r.kind != dcf77::FLIGHT_NONE) {
+      first_us = std::min(first_us, due_of(r));
+      last_us = std::max(last_us, due_of(r));
+    }
+  }
+  printf("  trigger: %s, records %" PRIu32 "..%" PRIu32 ", %" PRIu32 " lost\n", dcf77::flight_trigger_name(header.trigger),
+         header.first, header.first + header.count, lost);
+  if (first_us > last_us)
+    return true;
+  printf("  span: %s to %s UTC (%.1f s)\n", utc_text(first_us).c_str(), utc_text(last_us).c_str(),
+         (last_us - first_us) / 1e6);
+  if (options.records) {
+    for (uint32_t i = 0; i < header.count; i++)
+      print_record(header.first + i, records[i]);
+  }
+
+  // Edges and their lateness
+  std::vector<int32_t> lags;
+  int listed = 0;
+  for (uint32_t i = 0; i < header.count; i++) {
+    const auto &r = records[i];
+    if (r.kind != dcf77::FLIGHT_EDGE)
+      continue;
+    lags.push_back(r.lag_us);
+    if (r.lag_us > options.lag_ms * 1000 && listed++ < options.limit)
+      printf("  late edge: %s, %.1f ms late, carriers %02" PRIx32 "\n", utc_text(due_of(r)).c_str(), r.lag_us / 1e3,
+             r.data);
+  }
+  if (!lags.empty()) {
+    std::vector<int32_t> sorted = lags;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (int32_t lag : sorted)
+      sum += lag;
+    printf("  edges: %zu, lag min %.3f avg %.3f p99 %.3f max %.3f ms, %d later than %.1f ms\n", sorted.size(),
+           sorted.front() / 1e3, sum / sorted.size() / 1e3, sorted[sorted.size() * 99 / 100] / 1e3,
+           sorted.back() / 1e3, listed, options.lag_ms);
+  }
+
+  // DCF77 pulses from the edges of carrier 0, by UTC second
+  std::vector<std::pair<int64_t, Pulse>> pulses;
+  bool reduced = false;
+  int64_t fall_us = -1;
+  for (const auto &r : records) {
+    if (r.kind == dcf77::FLIGHT_NONE) {
+      fall_us = -1;  // a gap in the record
+      continue;
+    }
+    if (r.kind != dcf77::FLIGHT_EDGE)
+      continue;
+    const bool now_reduced = (r.data & 1) != 0;
+    const int64_t written_us = due_of(r) + r.lag_us;
+    if (now_reduced && !reduced) {
+      fall_us = written_us;
+    } else if (!now_reduced && reduced && fall_us >= 0) {
+      pulses.push_back({(fall_us + 500000) / 1000000, Pulse{fall_us, written_us - fall_us}});
+      fall_us = -1;
+    }
+    reduced = now_reduced;
+  }
+
+  // Expected pulses of every second the frames cover
+  int checked = 0, good = 0, wrong = 0, missing = 0, extra = 0;
+  listed = 0;
+  int64_t blank_from = -1, blank_to = -1;
+  auto flush_blank = [&]() {
+    if (blank_from >= 0 && listed++ < options.limit)
+      printf("  no pulses: %s to %s (%" PRId64 " s)\n", utc_text(blank_from * 1000000).c_str(),
+             utc_text(blank_to * 1000000).c_str(), blank_to - blank_from + 1);
+    blank_from = -1;
+  };
+  size_t next = 0;
+  for (const auto &r : records) {
+    if (r.kind != dcf77::FLIGHT_FRAME)
+      continue;
+    const uint64_t frame = static_cast<uint64_t>(static_cast<uint32_t>(r.lag_us)) << 32 | r.data;
+    for (int s = 0; s < 60; s++) {
+      const int64_t second = r.second + s;
+      if (second * 1000000 < first_us || second * 1000000 > last_us)
+        continue;
+      while (next < pulses.size() && pulses[next].first < second) {
+        extra++;
+        next++;
+      }
+      const int expected_ms = dcf77::pulse_ms(frame, s);
+      const bool have = next < pulses.size() && pulses[next].first == second;
+      checked++;
+      if (!have) {
+        if (expected_ms != 0) {
+          missing++;
+          if (blank_from < 0)
+            blank_from = second;
+          blank_to = second;
+        } else {
+          good++;
+        }
+        continue;
+      }
+      flush_blank();
+      const Pulse pulse = pulses[next++].second;
+      const int64_t error_us = pulse.width_us - expected_ms * 1000;
+      if (expected_ms != 0 && std::llabs(error_us) <= dcf77::IntegrityMonitor::TOLERANCE_US) {
+        good++;
+      } else {
+        wrong++;
+        if (listed++ < options.limit)
+          printf("  pulse %s: %.1f ms, expected %d ms\n", utc_text(pulse.start_us).c_str(), pulse.width_us / 1e3,
+                 expected_ms);
+      }
+    }
+  }
+  flush_blank();
+  printf("  seconds checked: %d, as framed: %d, wrong width: %d, missing: %d, extra: %d\n", checked, good, wrong,
+         missing, extra);
+
+  // Frames and events
+  for (const auto &r : records) {
+    switch (r.kind) {
+      case dcf77::FLIGHT_FRAME: {
+        const uint64_t frame = static_cast<uint64_t>(static_cast<uint32_t>(r.lag_us)) << 32 | r.data;
+        dcf77::CivilMinute t;
+        if (dcf77::decode_frame(frame, &t)) {
+          printf("  frame from %s: announces 20%02u-%02u-%02u %02u:%02u%s\n", utc_text(due_of(r)).c_str(), t.year,
+                 t.month, t.day, t.hour, t.minute, t.dst ? " DST" : "");
+        } else {
+          printf("  frame from %s: %015" PRIx64 " does not decode\n", utc_text(due_of(r)).c_str(), frame);
+        }
+        break;
+      }
+      case dcf77::FLIGHT_STALL:
+        printf("  stall at %s: %s, %.1f ms late\n", utc_text(due_of(r)).c_str(), dcf77::stall_cause_name(r.aux),
+               r.lag_us / 1e3);
+        break;
+      case dcf77::FLIGHT_READING:
+        printf("  reading at %s: source %u, %+.3f ms off the clock%s\n", utc_text(due_of(r)).c_str(), r.aux,
+               r.lag_us / 1e3, r.data != 0 ? "" : ", rejected");
+        break;
+      case dcf77::FLIGHT_INTEGRITY:
+        printf("  self-decode at %s: %s error (%" PRIu32 " so far)\n", utc_text(due_of(r)).c_str(),
+               dcf77::integrity_error_name(r.aux), r.data);
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+bool read_file(const std::string &path, std::vector<uint8_t> *bytes) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    return false;
+  uint8_t buffer[65536];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    bytes->insert(bytes->end(), buffer, buffer + n);
+  fclose(f);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+
+  std::vector<Image> images;
+  if (options.in == "-") {
+    images = extract(std::cin);
+  } else {
+    std::vector<uint8_t> bytes;
+    if (!read_file(options.in, &bytes)) {
+      fprintf(stderr, "%s: cannot read\n", options.in.c_str());
+      return 2;
+    }
+    dcf77::FlightDumpHeader header;
+    if (bytes.size() >= dcf77::FLIGHT_DUMP_HEADER_SIZE && dcf77::flight_decode(bytes.data(), &header)) {
+      // An image written by --out
+      images.push_back(Image{bytes, ""});
+    } else {
+      std::ifstream in(options.in);
+      images = extract(in);
+    }
+  }
+  if (images.empty()) {
+    fprintf(stderr, "no flight recorder dump found\n");
+    return 1;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < images.size(); i++) {
+    const Image &image = images[i];
+    printf("Dump %zu: %zu bytes%s%s\n", i + 1, image.bytes.size(), image.error.empty() ? "" : ", ",
+           image.error.c_str());
+    ok &= image.error.empty() && analyse(image, options);
+    if (!options.out.empty()) {
+      const std::string path = options.out + "-" + std::to_string(i + 1) + ".bin";
+      FILE *f = fopen(path.c_str(), "wb");
+      if (f == nullptr || fwrite(image.bytes.data(), 1, image.bytes.size(), f) != image.bytes.size()) {
+        fprintf(stderr, "%s: cannot write\n", path.c_str());
+        ok = false;
+      }
+      if (f != nullptr)
+        fclose(f);
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+/*
+  DCF77 frame generator: emits the frame of every minute in a UTC range for
+  a time zone, for golden vectors, rig tests and cross-checks with other
+  DCF77 implementations.
+
+  Record n is the frame announcing UTC minute FROM + n, i.e. the frame sent
+  during the minute before it (bit k = value of second k, as in
+  dcf77_frame.h). Formats:
+    bin  8 bytes per minute, the frame as a little-endian uint64
+    hex  16 hex digits per line
+    csv  epoch,yy,month,day,hour,minute,day_of_week,dst,frame with the fields
+         the frame carries (day_of_week: monday=1) and the frame in hex
+
+  The range is split into slices that worker threads encode into a fixed
+  set of reusable buffers; a writer thread emits them strictly in order, so
+  the output is identical for any thread count and nothing is allocated per
+  frame.
+
+  bin and hex frames come from host::BatchFrameEncoder (dcf77_batch.h) with
+  the run kernel picked by --kernel; csv also needs the civil fields and
+  encodes minute by minute.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -pthread -I. -o dcf77_frames host/dcf77_frames.cpp
+
+  Usage:
+    dcf77_frames [--from=2000-01-01] [--to=2100-01-01] [--tz=POSIX_TZ]
+                 [--format=bin|hex|csv] [--threads=N] [--out=FILE]
+                 [--kernel=auto|scalar|sse2|avx2|neon]
+
+  --from and --to (exclusive) take UTC dates as YYYY-MM-DD[THH:MM] or epoch
+  seconds. Output goes to stdout unless --out is given.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dcf77_batch.h"
+#include "dcf77_calendar.h"
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+#include "tool_args.h"
+
+namespace {
+
+enum class Format { BIN, HEX, CSV };
+
+struct Options {
+  int64_t from_minute{0};
+  int64_t to_minute{0};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  Format format{Format::BIN};
+  int threads{0};
+  std::string out;
+  std::string kernel{"auto"};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  host::parse_utc_minute("2000-01-01", &options->from_minute);
+  host::parse_utc_minute("2100-01-01", &options->to_minute);
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--from", &value)) {
+      if (!host::parse_utc_minute(value, &options->from_minute)) {
+        fprintf(stderr, "bad --from: %s\n", value.c_str());
+        return false;
+      }
+    } else if (parse_option(argv[i], "--to", &value)) {
+      if (!host::parse_utc_minute(value, &options->to_minute)) {
+        fprintf(stderr, "bad --to: %s\n", value.c_str());
+        return false;
+      }
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--format", &value)) {
+      if (value == "bin") {
+        options->format = Format::BIN;
+      } else if (value == "hex") {
+        options->format = Format::HEX;
+      } else if (value == "csv") {
+        options->format = Format::CSV;
+      } else {
+        fprintf(stderr, "unknown format: %s\n", value.c_str());
+        return false;
+      }
+    } else if (parse_option(argv[i], "--threads", &value)) {
+      options->threads = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--out", &value)) {
+      options->out = value;
+    } else if (parse_option(argv[i], "--kernel", &value)) {
+      options->kernel = value;
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->threads <= 0)
+    options->threads = std::max(1u, std::thread::hardware_concurrency());
+  return options->to_minute > options->from_minute;
+}
+
+// -----------------------------------------------------------------------------
+// Record formatting, into a caller-provided buffer
+// -----------------------------------------------------------------------------
+
+// Longest record of any format, in bytes
+const size_t MAX_RECORD = 64;
+
+char *put_hex(char *p, uint64_t frame) {
+  static const char DIGITS[] = "0123456789abcdef";
+  for (int shift = 60; shift >= 0; shift -= 4)
+    *p++ = DIGITS[(frame >> shift) & 0xF];
+  return p;
+}
+
+char *put_2digits(char *p, unsigned value) {
+  *p++ = static_cast<char>('0' + value / 10);
+  *p++ = static_cast<char>('0' + value % 10);
+  return p;
+}
+
+char *put_int(char *p, int64_t value) {
+  char digits[20];
+  int n = 0;
+  uint64_t v = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  do {
+    digits[n++] = static_cast<char>('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  if (value < 0)
+    *p++ = '-';
+  while (n > 0)
+    *p++ = digits[--n];
+  return p;
+}
+
+char *put_record(char *p, Format format, int64_t epoch_minute, const dcf77::CivilMinute &t, uint64_t frame) {
+  switch (format) {
+    case Format::BIN:
+      for (int i = 0; i < 8; i++)
+        *p++ = static_cast<char>((frame >> (8 * i)) & 0xFF);
+      break;
+    case Format::HEX:
+      p = put_hex(p, frame);
+      *p++ = '\n';
+      break;
+    case Format::CSV:
+      p = put_int(p, epoch_minute * 60);
+      *p++ = ',';
+      p = put_2digits(p, t.year);
+      *p++ = ',';
+      p = put_2digits(p, t.month);
+      *p++ = ',';
+      p = put_2digits(p, t.day);
+      *p++ = ',';
+      p = put_2digits(p, t.hour);
+      *p++ = ',';
+      p = put_2digits(p, t.minute);
+      *p++ = ',';
+      *p++ = static_cast<char>('0' + t.day_of_week);
+      *p++ = ',';
+      *p++ = t.dst ? '1' : '0';
+      *p++ = ',';
+      p = put_hex(p, frame);
+      *p++ = '\n';
+      break;
+  }
+  return p;
+}
+
+// -----------------------------------------------------------------------------
+// Ordered parallel output
+// -----------------------------------------------------------------------------
+const int64_t SLICE_MINUTES = 1 << 16;
+
+struct Slot {
+  std::vector<char> data;
+  size_t size{0};
+  int64_t slice{-1};  // slice held, valid once filled
+  bool filled{false};
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+  host::RunKernel kernel = host::select_run_kernel(options.kernel);
+  if (kernel == nullptr) {
+    fprintf(stderr, "kernel '%s' is not available on this machine\n", options.kernel.c_str());
+    return 2;
+  }
+
+  FILE *out = stdout;
+  if (!options.out.empty() && (out = fopen(options.out.c_str(), "wb")) == nullptr) {
+    perror(options.out.c_str());
+    return 1;
+  }
+  if (options.format == Format::CSV)
+    fputs("epoch,yy,month,day,hour,minute,day_of_week,dst,frame\n", out);
+
+  const int64_t total = options.to_minute - options.from_minute;
+  const int64_t slices = (total + SLICE_MINUTES - 1) / SLICE_MINUTES;
+  // Two buffers per worker keep everyone busy while the writer drains one
+  std::vector<Slot> slots(2 * options.threads);
+  // Slot i % N starts out "freed" by slice i - N
+  for (size_t i = 0; i < slots.size(); i++) {
+    slots[i].data.resize(SLICE_MINUTES * MAX_RECORD);
+    slots[i].slice = static_cast<int64_t>(i) - static_cast<int64_t>(slots.size());
+  }
+  std::mutex mutex;
+  std::condition_variable slot_filled, slot_free;
+  std::atomic<int64_t> next_slice{0};
+
+  auto wall_start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < options.threads; w++) {
+    workers.emplace_back([&]() {
+      host::LocalMinuteCalendar calendar;
+      host::BatchFrameEncoder encoder(kernel);
+      std::vector<uint64_t> frames(SLICE_MINUTES);
+      for (int64_t s = next_slice++; s < slices; s = next_slice++) {
+        Slot &slot = slots[s % slots.size()];
+        {
+          // The writer frees a slot once it has written the slice before
+          std::unique_lock<std::mutex> lock(mutex);
+          slot_free.wait(lock, [&]() { return !slot.filled && slot.slice == s - static_cast<int64_t>(slots.size()); });
+        }
+        const int64_t first = options.from_minute + s * SLICE_MINUTES;
+        const int64_t last = std::min(first + SLICE_MINUTES, options.to_minute);
+        char *p = slot.data.data();
+        if (options.format == Format::CSV) {
+          for (int64_t minute = first; minute < last; minute++) {
+            dcf77::CivilMinute t = calendar.at(minute);
+            p = put_record(p, options.format, minute, t, dcf77::encode_frame(t));
+          }
+        } else {
+          encoder.encode_range(first, frames.data(), last - first);
+          for (int64_t minute = first; minute < last; minute++)
+            p = put_record(p, options.format, minute, dcf77::CivilMinute{}, frames[minute - first]);
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          slot.size = p - slot.data.data();
+          slot.slice = s;
+          slot.filled = true;
+        }
+        slot_filled.notify_all();
+      }
+    });
+  }
+
+  uint64_t bytes = 0;
+  bool write_error = false;
+  for (int64_t s = 0; s < slices; s++) {
+    Slot &slot = slots[s % slots.size()];
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      slot_filled.wait(lock, [&]() { return slot.filled && slot.slice == s; });
+    }
+    if (!write_error && fwrite(slot.data.data(), 1, slot.size, out) != slot.size)
+      write_error = true;
+    bytes += slot.size;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      slot.filled = false;
+    }
+    slot_free.notify_all();
+  }
+  for (auto &worker : workers)
+    worker.join();
+  if (fflush(out) != 0 || write_error || (out != stdout && fclose(out) != 0)) {
+    perror("write");
+    return 1;
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  fprintf(stderr, "%" PRId64 " frames, %" PRIu64 " bytes in %.2f s with %d threads (%.1f M frames/s, %s)\n",
+          total, bytes, wall_s, options.threads, total / wall_s / 1e6,
+          options.format == Format::CSV ? "calendar" : host::run_kernel_name(kernel));
+  return 0;
+}
@@ -0,0 +1,383 @@
+/*
+  Golden frame corpus writer and regression checker for the frame encoder
+  (dcf77::encode_frame(), used by code_time_() in the component and
+  CodeTime() in the sketch). The file format is described in dcf77_golden.h.
+
+  --check maps a corpus and re-encodes every record on all cores, zone by
+  zone, and decodes every golden frame with dcf77::decode_frame() to check
+  the decoder too. Civil time comes from host::LocalMinuteCalendar, or from
+  localtime_r() per record with --exact (the sketch's own path, much
+  slower). --batch=KERNEL encodes each chunk with host::BatchFrameEncoder
+  and the named run kernel instead (auto, scalar, sse2, avx2 or neon), which
+  checks the batch encoder bit for bit against the corpus. Mismatches are listed with both frames decoded, and the exit
+  status is non-zero if there are any.
+
+  --write builds a corpus with the straightforward localtime_r() +
+  civil_from_tm() + encode_frame() path, for a fixed set of zones that
+  covers both hemispheres, half- and quarter-hour offsets, 30-minute DST
+  and transitions at negative local times. By default it keeps the minutes
+  around every DST transition and every local month boundary from 1990 to
+  2060; this is the corpus checked in as host/testdata/dcf77_golden.bin.
+  --full keeps every minute instead (12 zones x 10 years is 63 million
+  records, 1 GB), for throughput runs.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -pthread -I. -o dcf77_golden host/dcf77_golden.cpp
+
+  Usage:
+    dcf77_golden --check=FILE [--exact | --batch=KERNEL] [--threads=N]
+    dcf77_golden --write=FILE [--full] [--from=DATE] [--to=DATE]
+
+  DATE is YYYY-MM-DD[THH:MM] in UTC or epoch seconds. --from/--to default
+  to 1990-01-01/2060-01-01, or 2020-01-01/2030-01-01 with --full.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dcf77_batch.h"
+#include "dcf77_calendar.h"
+#include "dcf77_decoder.h"
+#include "dcf77_golden.h"
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+#include "tool_args.h"
+
+namespace {
+
+// Zones of the generated corpus
+const char *const ZONES[] = {
+    "CET-1CEST,M3.5.0,M10.5.0/3",                      // Central Europe, what DCF77 itself carries
+    "GMT0BST,M3.5.0/1,M10.5.0",                        // UK, zero standard offset
+    "EET-2EEST,M3.5.0/3,M10.5.0/4",                    // Eastern Europe
+    "EST5EDT,M3.2.0,M11.1.0",                          // US rules
+    "NST3:30NDT,M3.2.0,M11.1.0",                       // Newfoundland, negative half-hour offset
+    "<-02>2<-01>,M3.5.0/-1,M10.5.0/0",                 // Greenland, transitions at negative local times
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",                    // Sydney, DST across the new year
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",            // Lord Howe, 30-minute DST
+    "<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45",    // Chatham, quarter-hour offset
+    "<+0545>-5:45",                                    // Nepal, no DST
+    "<-10>10",                                         // Hawaii, no DST
+    "UTC0",
+};
+
+struct Options {
+  std::string check;
+  std::string write;
+  bool exact{false};
+  std::string batch;  // run kernel of the batch encoder, empty for encode_frame()
+  bool full{false};
+  int threads{0};
+  int64_t from_minute{INT64_MIN};
+  int64_t to_minute{INT64_MIN};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--check", &value)) {
+      options->check = value;
+    } else if (parse_option(argv[i], "--write", &value)) {
+      options->write = value;
+    } else if (strcmp(argv[i], "--exact") == 0) {
+      options->exact = true;
+    } else if (parse_option(argv[i], "--batch", &value)) {
+      options->batch = value;
+    } else if (strcmp(argv[i], "--full") == 0) {
+      options->full = true;
+    } else if (parse_option(argv[i], "--threads", &value)) {
+      options->threads = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--from", &value)) {
+      if (!host::parse_utc_minute(value, &options->from_minute)) {
+        fprintf(stderr, "bad --from: %s\n", value.c_str());
+        return false;
+      }
+    } else if (parse_option(argv[i], "--to", &value)) {
+      if (!host::parse_utc_minute(value, &options->to_minute)) {
+        fprintf(stderr, "bad --to: %s\n", value.c_str());
+        return false;
+      }
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->from_minute == INT64_MIN)
+    host::parse_utc_minute(options->full ? "2020-01-01" : "1990-01-01", &options->from_minute);
+  if (options->to_minute == INT64_MIN)
+    host::parse_utc_minute(options->full ? "2030-01-01" : "2060-01-01", &options->to_minute);
+  if (options->threads <= 0)
+    options->threads = std::max(1u, std::thread::hardware_concurrency());
+  if (options->exact && !options->batch.empty()) {
+    fprintf(stderr, "--exact and --batch exclude each other\n");
+    return false;
+  }
+  if (options->check.empty() == options->write.empty()) {
+    fprintf(stderr, "give either --check=FILE or --write=FILE\n");
+    return false;
+  }
+  return options->to_minute > options->from_minute;
+}
+
+void set_tz(const char *tz) {
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+// The civil time path of the sketch: localtime_r(), civil_from_tm()
+dcf77::CivilMinute exact_civil(int64_t epoch_minute) {
+  time_t t = static_cast<time_t>(epoch_minute * 60);
+  struct tm tm {};
+  localtime_r(&t, &tm);
+  return dcf77::civil_from_tm(tm);
+}
+
+uint64_t exact_frame(int64_t epoch_minute) { return dcf77::encode_frame(exact_civil(epoch_minute)); }
+
+bool same_civil(const dcf77::CivilMinute &a, const dcf77::CivilMinute &b) {
+  return a.minute == b.minute && a.hour == b.hour && a.day == b.day && a.day_of_week == b.day_of_week &&
+         a.month == b.month && a.year == b.year && a.dst == b.dst;
+}
+
+std::string format_utc(int64_t epoch_minute) {
+  time_t t = static_cast<time_t>(epoch_minute * 60);
+  struct tm tm {};
+  gmtime_r(&t, &tm);
+  char text[32];
+  strftime(text, sizeof(text), "%Y-%m-%d %H:%M UTC", &tm);
+  return text;
+}
+
+std::string describe_frame(uint64_t frame) {
+  host::Dcf77Time t{};
+  const char *error = host::dcf77_decode_frame(frame, &t);
+  char text[64];
+  if (error != nullptr) {
+    snprintf(text, sizeof(text), "%016" PRIx64 " (%s)", frame, error);
+  } else {
+    snprintf(text, sizeof(text), "%016" PRIx64 " (%02d-%02d-%02d %02d:%02d dow %d%s)", frame, t.year, t.month, t.day,
+             t.hour, t.minute, t.day_of_week, t.dst ? " DST" : "");
+  }
+  return text;
+}
+
+// -----------------------------------------------------------------------------
+// Corpus generation
+// -----------------------------------------------------------------------------
+
+// Minutes around the DST transitions and local month boundaries in
+// [from, to) for the process TZ, sorted and unique
+std::vector<int64_t> interesting_minutes(int64_t from, int64_t to) {
+  struct Local {
+    long gmtoff;
+    int isdst;
+    int mday;
+  };
+  auto local = [](int64_t epoch_minute) {
+    time_t t = static_cast<time_t>(epoch_minute * 60);
+    struct tm tm {};
+    localtime_r(&t, &tm);
+    return Local{tm.tm_gmtoff, tm.tm_isdst, tm.tm_mday};
+  };
+  std::vector<int64_t> minutes;
+  auto add = [&](int64_t first, int64_t last) {
+    for (int64_t m = std::max(first, from); m < std::min(last, to); m++)
+      minutes.push_back(m);
+  };
+
+  // Scan hour by hour, then find the exact minute inside an hour that changed
+  const int64_t first_hour = host::floor_div(from, 60);
+  Local previous = local(first_hour * 60);
+  for (int64_t hour = first_hour + 1; hour * 60 < to + 60; hour++) {
+    Local current = local(hour * 60);
+    const bool zone_change = current.gmtoff != previous.gmtoff || current.isdst != previous.isdst;
+    const bool month_change = current.mday < previous.mday;
+    if (zone_change) {
+      int64_t m = (hour - 1) * 60 + 1;
+      while (m < hour * 60 && local(m).gmtoff == previous.gmtoff && local(m).isdst == previous.isdst)
+        m++;
+      add(m - 10, m + 10);
+    }
+    if (month_change) {
+      int64_t m = (hour - 1) * 60 + 1;
+      while (m < hour * 60 && local(m).mday >= previous.mday)
+        m++;
+      add(m - 2, m + 2);
+    }
+    previous = current;
+  }
+  std::sort(minutes.begin(), minutes.end());
+  minutes.erase(std::unique(minutes.begin(), minutes.end()), minutes.end());
+  return minutes;
+}
+
+int write_corpus(const Options &options) {
+  const uint32_t zone_count = sizeof(ZONES) / sizeof(ZONES[0]);
+  std::vector<host::GoldenZone> zones(zone_count);
+  host::GoldenHeader header{};
+  memcpy(header.magic, host::GOLDEN_MAGIC, sizeof(header.magic));
+  header.version = host::GOLDEN_VERSION;
+  header.header_size = static_cast<uint32_t>(sizeof(host::GoldenHeader) + zone_count * sizeof(host::GoldenZone));
+  header.record_size = sizeof(host::GoldenRecord);
+  header.zone_count = zone_count;
+
+  FILE *out = fopen(options.write.c_str(), "wb");
+  if (out == nullptr) {
+    perror(options.write.c_str());
+    return 1;
+  }
+  // Records go first, behind a placeholder header that is rewritten at the end
+  fseek(out, header.header_size, SEEK_SET);
+  std::vector<host::GoldenRecord> records;
+  for (uint32_t z = 0; z < zone_count; z++) {
+    set_tz(ZONES[z]);
+    snprintf(zones[z].tz, sizeof(zones[z].tz), "%s", ZONES[z]);
+    zones[z].first_record = header.record_count;
+    records.clear();
+    if (options.full) {
+      for (int64_t m = options.from_minute; m < options.to_minute; m++)
+        records.push_back({m, exact_frame(m)});
+    } else {
+      for (int64_t m : interesting_minutes(options.from_minute, options.to_minute))
+        records.push_back({m, exact_frame(m)});
+    }
+    zones[z].record_count = records.size();
+    header.record_count += records.size();
+    if (fwrite(records.data(), sizeof(host::GoldenRecord), records.size(), out) != records.size())
+      break;
+    fprintf(stderr, "%-48s %10" PRIu64 " records\n", ZONES[z], zones[z].record_count);
+  }
+  fseek(out, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, out);
+  fwrite(zones.data(), sizeof(host::GoldenZone), zones.size(), out);
+  if (ferror(out) || fclose(out) != 0) {
+    perror(options.write.c_str());
+    return 1;
+  }
+  fprintf(stderr, "%" PRIu64 " records in %u zones written to %s\n", header.record_count, zone_count,
+          options.write.c_str());
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Corpus check
+// -----------------------------------------------------------------------------
+
+struct Mismatch {
+  uint64_t index;
+  uint64_t expected;
+  uint64_t actual;
+  bool decodes;  // decode_frame() reads the golden frame back as the expected time
+};
+
+const uint64_t CHUNK_RECORDS = 1 << 16;
+const size_t MAX_REPORTED = 10;
+
+int check_corpus(const Options &options) {
+  host::GoldenCorpus corpus;
+  if (!corpus.open(options.check)) {
+    fprintf(stderr, "%s\n", corpus.error().c_str());
+    return 1;
+  }
+  const host::GoldenRecord *records = corpus.records();
+  host::RunKernel batch_kernel = nullptr;
+  if (!options.batch.empty() && (batch_kernel = host::select_run_kernel(options.batch)) == nullptr) {
+    fprintf(stderr, "kernel '%s' is not available on this machine\n", options.batch.c_str());
+    return 2;
+  }
+  uint64_t total_mismatches = 0;
+  std::vector<Mismatch> reported;
+  auto wall_start = std::chrono::steady_clock::now();
+
+  for (uint32_t z = 0; z < corpus.zone_count(); z++) {
+    const host::GoldenZone &zone = corpus.zone(z);
+    set_tz(zone.tz);
+    const uint64_t end = zone.first_record + zone.record_count;
+    std::atomic<uint64_t> next{zone.first_record};
+    std::atomic<uint64_t> mismatches{0};
+    std::vector<Mismatch> found;
+    std::mutex mutex;
+
+    auto worker = [&]() {
+      host::LocalMinuteCalendar calendar;
+      host::BatchFrameEncoder encoder(batch_kernel);
+      std::vector<int64_t> minutes;
+      std::vector<uint64_t> frames;
+      for (uint64_t first = next.fetch_add(CHUNK_RECORDS); first < end; first = next.fetch_add(CHUNK_RECORDS)) {
+        const uint64_t last = std::min(first + CHUNK_RECORDS, end);
+        if (batch_kernel != nullptr) {
+          minutes.resize(last - first);
+          frames.resize(last - first);
+          for (uint64_t i = first; i < last; i++)
+            minutes[i - first] = records[i].epoch_minute;
+          encoder.encode_many(minutes.data(), frames.data(), minutes.size());
+        }
+        uint64_t bad = 0;
+        for (uint64_t i = first; i < last; i++) {
+          const int64_t minute = records[i].epoch_minute;
+          const dcf77::CivilMinute t = options.exact ? exact_civil(minute) : calendar.at(minute);
+          const uint64_t frame = batch_kernel != nullptr ? frames[i - first] : dcf77::encode_frame(t);
+          dcf77::CivilMinute decoded;
+          const bool decodes = dcf77::decode_frame(records[i].frame, &decoded) && same_civil(decoded, t);
+          if (frame == records[i].frame && decodes)
+            continue;
+          if (bad++ < MAX_REPORTED) {
+            std::lock_guard<std::mutex> lock(mutex);
+            found.push_back({i, records[i].frame, frame, decodes});
+          }
+        }
+        mismatches += bad;
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < options.threads; t++)
+      threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+      thread.join();
+
+    total_mismatches += mismatches;
+    std::sort(found.begin(), found.end(), [](const Mismatch &a, const Mismatch &b) { return a.index < b.index; });
+    for (size_t i = 0; i < found.size() && reported.size() < MAX_REPORTED; i++)
+      reported.push_back(found[i]);
+    printf("%-48s %10" PRIu64 " records %8" PRIu64 " mismatches\n", zone.tz, zone.record_count,
+           mismatches.load());
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+  for (const Mismatch &m : reported) {
+    const host::GoldenZone *zone = &corpus.zone(0);
+    for (uint32_t z = 0; z < corpus.zone_count(); z++) {
+      if (m.index >= corpus.zone(z).first_record)
+        zone = &corpus.zone(z);
+    }
+    printf("  %s in %s\n    golden  %s\n    encoder %s\n", format_utc(records[m.index].epoch_minute).c_str(), zone->tz,
+           describe_frame(m.expected).c_str(), describe_frame(m.actual).c_str());
+    if (!m.decodes)
+      printf("    decode_frame() does not read the golden frame back as the expected time\n");
+  }
+  printf("%" PRIu64 " records checked in %.2f s with %d threads (%.1f M records/s, %s): %" PRIu64 " mismatches\n",
+         corpus.record_count(), wall_s, options.threads, corpus.record_count() / wall_s / 1e6,
+         batch_kernel != nullptr ? host::run_kernel_name(batch_kernel) : options.exact ? "localtime_r" : "calendar",
+         total_mismatches);
+  return total_mismatches == 0 ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  return options.write.empty() ? check_corpus(options) : write_corpus(options);
+}
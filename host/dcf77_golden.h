@@ -0,0 +1,108 @@
+#pragma once
+
+// Golden frame corpus: a versioned, memory-mappable file of reference
+// frames that the host tools check the encoder against.
+//
+// Layout (little-endian, every part a multiple of 16 bytes):
+//   GoldenHeader                  64 bytes
+//   GoldenZone[zone_count]        64 bytes each
+//   GoldenRecord[record_count]    16 bytes each, starting at header_size
+//
+// Each zone names a POSIX TZ string and the contiguous run of records that
+// were encoded in it. A record holds the frame announcing the UTC minute
+// |epoch_minute|, i.e. the frame sent during the minute before it, with
+// bit n = second n as in dcf77_frame.h. POSIX TZ rules rather than tzdata
+// names keep the corpus independent of the zone database installed on the
+// machine that checks it.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "mapped_file.h"
+
+namespace host {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the golden corpus is read in place");
+
+const char GOLDEN_MAGIC[8] = {'D', 'C', 'F', '7', '7', 'G', 'L', 'D'};
+const uint32_t GOLDEN_VERSION = 1;
+
+struct GoldenHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;  // offset of the first record
+  uint32_t record_size;
+  uint32_t zone_count;
+  uint64_t record_count;
+  uint8_t reserved[32];
+};
+
+struct GoldenZone {
+  char tz[48];  // NUL-terminated POSIX TZ string
+  uint64_t first_record;
+  uint64_t record_count;
+};
+
+struct GoldenRecord {
+  int64_t epoch_minute;
+  uint64_t frame;
+};
+
+static_assert(sizeof(GoldenHeader) == 64, "GoldenHeader layout");
+static_assert(sizeof(GoldenZone) == 64, "GoldenZone layout");
+static_assert(sizeof(GoldenRecord) == 16, "GoldenRecord layout");
+
+/// Read-only view of a mapped corpus.
+class GoldenCorpus {
+ public:
+  /// Maps and validates |path|. Returns false and sets error() on failure.
+  bool open(const std::string &path) {
+    if (!this->file_.open(path))
+      return this->fail_(this->file_.error());
+    const size_t size = this->file_.size();
+    if (size < sizeof(GoldenHeader))
+      return this->fail_(path + ": too short for a golden corpus");
+    this->header_ = reinterpret_cast<const GoldenHeader *>(this->file_.data());
+    const GoldenHeader &h = *this->header_;
+    if (memcmp(h.magic, GOLDEN_MAGIC, sizeof(h.magic)) != 0)
+      return this->fail_(path + ": not a golden corpus");
+    if (h.version != GOLDEN_VERSION)
+      return this->fail_(path + ": unsupported version " + std::to_string(h.version));
+    if (h.record_size != sizeof(GoldenRecord) || h.header_size % 16 != 0 ||
+        h.header_size < sizeof(GoldenHeader) + uint64_t{h.zone_count} * sizeof(GoldenZone) ||
+        h.header_size > size || (size - h.header_size) / sizeof(GoldenRecord) != h.record_count ||
+        (size - h.header_size) % sizeof(GoldenRecord) != 0)
+      return this->fail_(path + ": inconsistent header");
+    for (uint32_t i = 0; i < h.zone_count; i++) {
+      const GoldenZone &zone = this->zone(i);
+      if (memchr(zone.tz, '\0', sizeof(zone.tz)) == nullptr || zone.first_record > h.record_count ||
+          zone.record_count > h.record_count - zone.first_record)
+        return this->fail_(path + ": bad zone entry " + std::to_string(i));
+    }
+    return true;
+  }
+
+  uint32_t zone_count() const { return this->header_->zone_count; }
+  const GoldenZone &zone(uint32_t i) const {
+    return reinterpret_cast<const GoldenZone *>(this->file_.data() + sizeof(GoldenHeader))[i];
+  }
+  uint64_t record_count() const { return this->header_->record_count; }
+  const GoldenRecord *records() const {
+    return reinterpret_cast<const GoldenRecord *>(this->file_.data() + this->header_->header_size);
+  }
+  const std::string &error() const { return this->error_; }
+
+ protected:
+  bool fail_(const std::string &error) {
+    this->error_ = error;
+    this->file_.close();
+    return false;
+  }
+
+  MappedFile file_;
+  const GoldenHeader *header_{nullptr};
+  std::string error_;
+};
+
+}  // namespace host
@@ -0,0 +1,303 @@
+/*
+  Monte Carlo receiver-lock benchmark.
+
+  Each trial boots the DCF77Emitter component at a random moment of the year
+  under the host stub layer, injects main loop and timer-task latency from a
+  jitter model, and feeds the carrier into the reference receiver. A trial
+  locks when the receiver has decoded --confirm consecutive, mutually
+  consistent minutes; the report gives the distribution of minutes from
+  power-on to lock for each jitter scale.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -pthread -Ihost/stubs -I. -o dcf77_lock_bench \
+        host/dcf77_lock_bench.cpp host/stubs/host_env.cpp \
+        esphome/components/dcf77_emitter/dcf77_emitter.cpp
+
+  Usage:
+    dcf77_lock_bench [--jitter=none|gauss|pareto] [--scale-us=0,500,2000]
+                     [--alpha=1.5] [--burst-period-ms=N] [--burst-length-ms=N]
+                     [--trials=N] [--minutes=N] [--confirm=N] [--threads=N]
+                     [--windows=ZMIN:ZMAX:OMIN:OMAX] [--tz=POSIX_TZ] [--seed=N]
+
+  gauss draws |N(0, scale)|, pareto draws a Lomax (shifted Pareto) latency
+  with the given scale and tail index. A burst adds a blocking period of
+  --burst-length-ms every --burst-period-ms, as a WiFi reconnect or flash
+  write would, at a random phase per trial. --windows sets the receiver's
+  '0' and '1' pulse-width windows in milliseconds.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dcf77_decoder.h"
+#include "esphome/components/dcf77_emitter/dcf77_emitter.h"
+#include "esphome/core/log.h"
+#include "host_env.h"
+#include "tool_args.h"
+
+namespace {
+
+enum class JitterKind { NONE, GAUSSIAN, PARETO };
+
+struct Options {
+  JitterKind jitter{JitterKind::GAUSSIAN};
+  std::vector<double> scales_us{0, 1000, 2000, 5000, 10000, 20000};
+  double alpha{1.5};
+  uint32_t burst_period_ms{0};
+  uint32_t burst_length_ms{0};
+  int trials{1000};
+  int minutes{30};
+  int confirm{2};
+  int threads{0};
+  host::Dcf77ReceiverWindows windows{};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  uint64_t seed{1};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--jitter", &value)) {
+      if (value == "none") {
+        options->jitter = JitterKind::NONE;
+      } else if (value == "gauss") {
+        options->jitter = JitterKind::GAUSSIAN;
+      } else if (value == "pareto") {
+        options->jitter = JitterKind::PARETO;
+      } else {
+        fprintf(stderr, "unknown jitter model: %s\n", value.c_str());
+        return false;
+      }
+    } else if (parse_option(argv[i], "--scale-us", &value)) {
+      options->scales_us = host::parse_list(value);
+    } else if (parse_option(argv[i], "--alpha", &value)) {
+      options->alpha = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--burst-period-ms", &value)) {
+      options->burst_period_ms = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--burst-length-ms", &value)) {
+      options->burst_length_ms = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--trials", &value)) {
+      options->trials = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--minutes", &value)) {
+      options->minutes = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--confirm", &value)) {
+      options->confirm = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--threads", &value)) {
+      options->threads = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--windows", &value)) {
+      auto ms = host::parse_list(value);
+      if (ms.size() != 4) {
+        fprintf(stderr, "--windows needs four values\n");
+        return false;
+      }
+      options->windows.zero_min_us = static_cast<int32_t>(ms[0] * 1000);
+      options->windows.zero_max_us = static_cast<int32_t>(ms[1] * 1000);
+      options->windows.one_min_us = static_cast<int32_t>(ms[2] * 1000);
+      options->windows.one_max_us = static_cast<int32_t>(ms[3] * 1000);
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--seed", &value)) {
+      options->seed = strtoull(value.c_str(), nullptr, 10);
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->threads <= 0)
+    options->threads = std::max(1u, std::thread::hardware_concurrency());
+  return options->trials > 0 && options->minutes > 0 && options->confirm > 0 && !options->scales_us.empty();
+}
+
+// Latency generator shared by the main loop and timer-task models of a trial.
+class JitterSource {
+ public:
+  JitterSource(const Options &options, double scale_us, uint64_t seed)
+      : options_(options), scale_us_(scale_us), rng_(seed) {
+    if (options.burst_period_ms > 0)
+      this->burst_offset_us_ =
+          std::uniform_int_distribution<int64_t>(0, options.burst_period_ms * 1000LL - 1)(this->rng_);
+  }
+
+  uint32_t sample() {
+    double latency = 0;
+    switch (this->options_.jitter) {
+      case JitterKind::NONE:
+        break;
+      case JitterKind::GAUSSIAN:
+        latency = std::fabs(this->normal_(this->rng_)) * this->scale_us_;
+        break;
+      case JitterKind::PARETO: {
+        double u = 1.0 - this->uniform_(this->rng_);
+        latency = this->scale_us_ * (std::pow(u, -1.0 / this->options_.alpha) - 1.0);
+        break;
+      }
+    }
+    if (this->options_.burst_period_ms > 0) {
+      int64_t period = this->options_.burst_period_ms * 1000LL;
+      int64_t length = this->options_.burst_length_ms * 1000LL;
+      int64_t phase = (host::now_us() + this->burst_offset_us_) % period;
+      if (phase < length)
+        latency += static_cast<double>(length - phase);
+    }
+    return static_cast<uint32_t>(std::min(latency, 10e6));
+  }
+
+ protected:
+  const Options &options_;
+  double scale_us_;
+  std::mt19937_64 rng_;
+  std::normal_distribution<double> normal_{0.0, 1.0};
+  std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+  int64_t burst_offset_us_{0};
+};
+
+struct TrialResult {
+  bool locked;
+  bool false_lock;  // locked onto a consistent but wrong time
+  double minutes;
+};
+
+// Local civil minutes since 2000, used to check that consecutive frames
+// advance by one minute (or by one hour either way across a DST change).
+int64_t civil_minutes(const host::Dcf77Time &t) {
+  int y = 2000 + t.year;
+  int m = t.month;
+  y -= m <= 2;
+  int era = y / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + t.day - 1;
+  int64_t days = era * 146097LL + yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (days * 24 + t.hour) * 60 + t.minute;
+}
+
+bool consecutive(const host::Dcf77Time &prev, const host::Dcf77Time &next) {
+  int64_t step = civil_minutes(next) - civil_minutes(prev);
+  if (prev.dst == next.dst)
+    return step == 1;
+  return step == (next.dst ? 61 : -59);
+}
+
+TrialResult run_trial(const Options &options, double scale_us, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  // Random boot moment in 2024, including the sub-second phase.
+  int64_t boot_epoch_us = 1704067200LL * 1000000 +
+                          std::uniform_int_distribution<int64_t>(0, 366LL * 86400 * 1000000 - 1)(rng);
+
+  host::reset(boot_epoch_us, options.tz.c_str());
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+  auto jitter = std::make_shared<JitterSource>(options, scale_us, rng());
+  host::LoopModel model;
+  model.loop_latency_us = [jitter]() { return jitter->sample(); };
+  model.timer_latency_us = [jitter]() { return jitter->sample(); };
+  host::set_loop_model(model);
+
+  TrialResult result{false, false, 0};
+  host::Dcf77Receiver receiver(options.windows);
+  int run = 0;
+  host::Dcf77Time previous{};
+  receiver.set_callback([&](const host::Dcf77Minute &minute) {
+    if (result.locked)
+      return;
+    if (minute.error != nullptr) {
+      run = 0;
+      return;
+    }
+    run = (run > 0 && consecutive(previous, minute.time)) ? run + 1 : 1;
+    previous = minute.time;
+    if (run < options.confirm)
+      return;
+    result.locked = true;
+    result.minutes = minute.marker_us / 60e6;
+    int64_t epoch_us = boot_epoch_us + minute.marker_us;
+    result.false_lock = minute.time != host::dcf77_expected_time((epoch_us + 30000000) / 60000000);
+  });
+  host::set_edge_sink([&receiver](const host::Edge &edge) {
+    if (edge.source == host::EdgeSource::CARRIER && edge.id == LEDC_CHANNEL_0)
+      receiver.feed(edge.t_us, edge.level != 0);
+  });
+
+  esphome::time::RealTimeClock rtc;
+  esphome::switch_::Switch sync_switch;
+  sync_switch.publish_state(true);
+  host::RecordingPin antenna_pin(18);
+  host::RecordingPin led_pin(2);
+  esphome::dcf77_emitter::DCF77Emitter emitter;
+  emitter.set_time_id(&rtc);
+  emitter.set_antenna_pin(&antenna_pin);
+  emitter.set_led_pin(&led_pin);
+  emitter.set_sync_switch(&sync_switch);
+  host::add_component(&emitter);
+
+  const int64_t limit_us = options.minutes * 60000000LL;
+  for (int64_t t = 0; t < limit_us && !result.locked;) {
+    t = std::min(t + 10000000, limit_us);
+    host::run_until(t);
+  }
+  host::set_edge_sink(nullptr);
+  return result;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+  size_t index = static_cast<size_t>(std::ceil(p * sorted.size())) - 1;
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  // Set TZ once before the workers start; host::reset() then leaves it alone.
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  printf("%d trials of %d min per scale, %d threads, lock after %d consistent minute(s)\n", options.trials,
+         options.minutes, options.threads, options.confirm);
+  printf("%10s %7s %7s %7s %7s %7s %7s\n", "scale_us", "lock%", "p50", "p90", "p99", "max", "false");
+
+  for (double scale_us : options.scales_us) {
+    std::vector<TrialResult> results(options.trials);
+    std::atomic<int> next{0};
+    std::vector<std::thread> workers;
+    for (int w = 0; w < options.threads; w++) {
+      workers.emplace_back([&]() {
+        for (int i = next++; i < options.trials; i = next++)
+          results[i] = run_trial(options, scale_us, options.seed * 1000003 + i);
+      });
+    }
+    for (auto &worker : workers)
+      worker.join();
+
+    // Trials that never lock sort as infinitely slow.
+    std::vector<double> minutes;
+    int locked = 0, false_locks = 0;
+    for (const auto &r : results) {
+      minutes.push_back(r.locked ? r.minutes : INFINITY);
+      locked += r.locked;
+      false_locks += r.false_lock;
+    }
+    std::sort(minutes.begin(), minutes.end());
+    printf("%10.0f %6.1f%%", scale_us, 100.0 * locked / options.trials);
+    for (double v : {percentile(minutes, 0.50), percentile(minutes, 0.90), percentile(minutes, 0.99), minutes.back()}) {
+      if (std::isinf(v)) {
+        printf(" %7s", "-");
+      } else {
+        printf(" %7.1f", v);
+      }
+    }
+    printf(" %7d\n", false_locks);
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,618 @@
+/*
+  Logic-analyzer capture importer: measures the real edge timing of the
+  antenna and LED pins and checks it against the expected DCF77 frames.
+
+  Reads CSV exports of the antenna pin (ANTENNAPIN, GPIO18) and optionally
+  the LED pin, in either of the two common layouts:
+    - sigrok-cli -O csv: ';' comment lines (with "; Samplerate: 1 MHz"), an
+      optional header line and one row per sample;
+    - exports with a time column in seconds ("Time [s],...", e.g. Saleae or
+      sigrok with time=true), possibly one row per transition only.
+
+  The file is memory-mapped and split at line boundaries into chunks that are
+  parsed in parallel. Each chunk reduces the antenna channel to carrier
+  bursts (runs of rising edges closer than --gap-us) and the LED channel to
+  its edges; the bursts are then joined across chunks in order. The gaps
+  between bursts are the carrier-off pulses, which feed the reference
+  receiver and are matched one by one against the frames of the shared
+  encoder.
+
+  The expected second grid comes from --start (UTC time of the first row) or
+  else from the first minute the receiver decodes. The report gives the
+  carrier frequency, pulse start and width deviations, missing, extra and
+  wrong pulses, and the LED edge offsets; --pulses writes one CSV line per
+  pulse.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -pthread -I. -o dcf77_logic host/dcf77_logic.cpp
+
+  Usage:
+    dcf77_logic --in=FILE [--antenna=D0] [--led=D1] [--rate=HZ]
+                [--start=EPOCH] [--tz=POSIX_TZ] [--gap-us=200]
+                [--threads=N] [--pulses=FILE|-]
+
+  --antenna and --led name a column of the header line or give its index
+  among the channel columns (0 = first channel). --rate overrides the sample
+  rate of exports without a time column. --led=none skips the LED.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dcf77_decoder.h"
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+#include "mapped_file.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  std::string in;
+  std::string antenna{"D0"};
+  std::string led{"D1"};
+  double rate{0};
+  bool have_start{false};
+  double start_epoch{0};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  double gap_us{200};
+  int threads{0};
+  std::string pulses;
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--in", &value)) {
+      options->in = value;
+    } else if (parse_option(argv[i], "--antenna", &value)) {
+      options->antenna = value;
+    } else if (parse_option(argv[i], "--led", &value)) {
+      options->led = value;
+    } else if (parse_option(argv[i], "--rate", &value)) {
+      options->rate = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--start", &value)) {
+      options->start_epoch = strtod(value.c_str(), nullptr);
+      options->have_start = true;
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--gap-us", &value)) {
+      options->gap_us = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--threads", &value)) {
+      options->threads = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--pulses", &value)) {
+      options->pulses = value;
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->in.empty()) {
+    fprintf(stderr, "--in is required\n");
+    return false;
+  }
+  if (options->threads <= 0)
+    options->threads = std::max(1u, std::thread::hardware_concurrency());
+  return options->gap_us > 0;
+}
+
+// -----------------------------------------------------------------------------
+// CSV layout
+// -----------------------------------------------------------------------------
+
+// Where the data rows start and which columns to read. Times are kept as
+// integer ticks: nanoseconds with a time column, sample numbers without.
+struct Layout {
+  size_t data_offset{0};
+  bool time_column{false};
+  int antenna{-1};  // column index, time column included
+  int led{-1};
+  double ticks_per_s{0};
+};
+
+const char *line_end(const char *p, const char *end) {
+  const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+  return nl != nullptr ? nl : end;
+}
+
+std::vector<std::string> split_fields(const char *p, const char *end) {
+  std::vector<std::string> fields;
+  std::string field;
+  for (; p < end && *p != '\r'; p++) {
+    if (*p == ',') {
+      fields.push_back(field);
+      field.clear();
+    } else if (*p != '"' && !(field.empty() && *p == ' ')) {
+      field.push_back(*p);
+    }
+  }
+  fields.push_back(field);
+  return fields;
+}
+
+// "1 MHz", "250 kHz", "24000000"
+double parse_rate(const char *p) {
+  char *unit;
+  double value = strtod(p, &unit);
+  while (*unit == ' ')
+    unit++;
+  if (*unit == 'G')
+    value *= 1e9;
+  if (*unit == 'M')
+    value *= 1e6;
+  if (*unit == 'k' || *unit == 'K')
+    value *= 1e3;
+  return value;
+}
+
+// Decimal seconds to nanoseconds without going through double, which is
+// both faster and exact for long captures. Falls back to strtod() for
+// exponent notation.
+int64_t parse_time_ns(const char *p) {
+  const char *start = p;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+')
+    p++;
+  int64_t ns = 0;
+  for (; *p >= '0' && *p <= '9'; p++)
+    ns = ns * 10 + (*p - '0');
+  ns *= 1000000000;
+  if (*p == '.') {
+    p++;
+    int64_t scale = 100000000;
+    for (; *p >= '0' && *p <= '9'; p++, scale /= 10)
+      ns += (*p - '0') * scale;
+  }
+  if (*p == 'e' || *p == 'E')
+    return static_cast<int64_t>(std::llround(strtod(start, nullptr) * 1e9));
+  return negative ? -ns : ns;
+}
+
+// Resolves a channel given by name or by index among the channel columns.
+int find_column(const std::string &spec, const std::vector<std::string> &header, bool time_column) {
+  for (size_t i = 0; i < header.size(); i++) {
+    if (header[i] == spec)
+      return static_cast<int>(i);
+  }
+  char *end;
+  long index = strtol(spec.c_str(), &end, 10);
+  if (*end != '\0' || spec.empty() || index < 0)
+    return -1;
+  return static_cast<int>(index) + (time_column ? 1 : 0);
+}
+
+bool parse_layout(const host::MappedFile &file, const Options &options, Layout *layout) {
+  const char *p = reinterpret_cast<const char *>(file.data());
+  const char *end = p + file.size();
+  double rate = options.rate;
+  std::vector<std::string> header;
+  // Comment lines, then an optional header line
+  while (p < end) {
+    const char *eol = line_end(p, end);
+    if (*p == ';') {
+      std::string line(p, eol);
+      size_t key = line.find("Samplerate:");
+      if (key != std::string::npos && rate == 0)
+        rate = parse_rate(line.c_str() + key + strlen("Samplerate:"));
+      p = eol + 1;
+      continue;
+    }
+    std::vector<std::string> fields = split_fields(p, eol);
+    if (!fields.empty() && !fields[0].empty() && (isalpha(static_cast<unsigned char>(fields[0][0])) != 0)) {
+      header = fields;
+      p = eol + 1;
+    } else {
+      // No header: name the columns by position
+      for (size_t i = 0; i < fields.size(); i++)
+        header.push_back(std::to_string(i));
+    }
+    break;
+  }
+  layout->data_offset = p - reinterpret_cast<const char *>(file.data());
+  layout->time_column =
+      !header.empty() && (header[0].compare(0, 4, "Time") == 0 || header[0].compare(0, 4, "time") == 0);
+  layout->antenna = find_column(options.antenna, header, layout->time_column);
+  layout->led = options.led == "none" ? -1 : find_column(options.led, header, layout->time_column);
+  if (layout->antenna < 0 || layout->antenna >= static_cast<int>(header.size())) {
+    fprintf(stderr, "antenna channel '%s' not found\n", options.antenna.c_str());
+    return false;
+  }
+  if (layout->led >= static_cast<int>(header.size()) || (layout->led < 0 && options.led != "none")) {
+    fprintf(stderr, "LED channel '%s' not found (use --led=none to skip it)\n", options.led.c_str());
+    return false;
+  }
+  if (layout->time_column) {
+    layout->ticks_per_s = 1e9;
+  } else if (rate > 0) {
+    layout->ticks_per_s = rate;
+  } else {
+    fprintf(stderr, "no time column and no sample rate in the file; pass --rate\n");
+    return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Parallel chunk parsing
+// -----------------------------------------------------------------------------
+
+// Run of antenna rising edges with no gap longer than the gap threshold.
+struct Burst {
+  int64_t first;
+  int64_t last;
+  uint64_t rises;
+};
+
+struct LedEdge {
+  int64_t tick;
+  bool level;
+};
+
+struct ChunkResult {
+  std::vector<Burst> bursts;
+  std::vector<LedEdge> led;
+  uint64_t rows{0};
+  int64_t first_tick{0};  // chunk-relative row numbers without a time column
+  int64_t last_tick{0};
+  bool first_antenna{false}, last_antenna{false};
+  bool first_led{false}, last_led{false};
+  const char *error{nullptr};
+};
+
+void add_rise(std::vector<Burst> *bursts, int64_t tick, int64_t gap) {
+  if (!bursts->empty() && tick - bursts->back().last <= gap) {
+    bursts->back().last = tick;
+    bursts->back().rises++;
+  } else {
+    bursts->push_back(Burst{tick, tick, 1});
+  }
+}
+
+// Parses rows in [p, end). The first row only sets the initial levels; the
+// merge step turns it into an edge if it differs from the previous chunk.
+void parse_chunk(const char *p, const char *end, const Layout &layout, int64_t gap_ticks, ChunkResult *result) {
+  const int last_column = std::max(layout.antenna, layout.led);
+  bool antenna = false, led = false;
+  int64_t row = 0;
+  while (p < end) {
+    const char *eol = line_end(p, end);
+    if (p == eol || *p == ';' || *p == '\r') {
+      p = eol + 1;
+      continue;
+    }
+    int64_t tick = row;
+    bool a = antenna, l = led;
+    int column = 0;
+    for (const char *f = p; column <= last_column; column++) {
+      if (f >= eol) {
+        result->error = "row with too few columns";
+        return;
+      }
+      if (column == 0 && layout.time_column) {
+        tick = parse_time_ns(f);
+      } else if (column == layout.antenna) {
+        a = *f == '1';
+      } else if (column == layout.led) {
+        l = *f == '1';
+      }
+      const char *comma = static_cast<const char *>(memchr(f, ',', eol - f));
+      f = comma != nullptr ? comma + 1 : eol;
+    }
+    if (result->rows == 0) {
+      result->first_tick = tick;
+      result->first_antenna = a;
+      result->first_led = l;
+    } else {
+      if (a && !antenna)
+        add_rise(&result->bursts, tick, gap_ticks);
+      if (layout.led >= 0 && l != led)
+        result->led.push_back(LedEdge{tick, l});
+    }
+    antenna = a;
+    led = l;
+    result->last_tick = tick;
+    result->rows++;
+    row++;
+    p = eol + 1;
+  }
+  result->last_antenna = antenna;
+  result->last_led = led;
+}
+
+// -----------------------------------------------------------------------------
+// Analysis
+// -----------------------------------------------------------------------------
+struct Stat {
+  int64_t count{0};
+  double min{INFINITY};
+  double max{-INFINITY};
+  double sum{0};
+  double sum_sq{0};
+
+  void add(double v) {
+    count++;
+    min = std::min(min, v);
+    max = std::max(max, v);
+    sum += v;
+    sum_sq += v * v;
+  }
+  double mean() const { return sum / count; }
+  double stddev() const { return std::sqrt(std::max(0.0, sum_sq / count - mean() * mean())); }
+
+  void print(const char *label, const char *unit) const {
+    if (count == 0) {
+      printf("  %-30s none\n", label);
+      return;
+    }
+    printf("  %-30s n=%-7" PRId64 " mean=%10.1f sd=%8.1f min=%10.1f max=%10.1f %s\n", label, count, mean(), stddev(),
+           min, max, unit);
+  }
+};
+
+// Carrier-off period between two bursts, in seconds from the first row
+struct Pulse {
+  double start_s;
+  double end_s;
+};
+
+// Frame sent during the UTC minute starting at |minute| * 60
+uint64_t expected_frame(int64_t minute) {
+  time_t next = static_cast<time_t>((minute + 1) * 60);
+  struct tm tm {};
+  localtime_r(&next, &tm);
+  return dcf77::encode_frame(dcf77::civil_from_tm(tm));
+}
+
+int64_t floor_div(int64_t a, int64_t b) { return a >= 0 ? a / b : (a - b + 1) / b; }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  host::MappedFile file;
+  if (!file.open(options.in)) {
+    fprintf(stderr, "%s\n", file.error().c_str());
+    return 1;
+  }
+  Layout layout;
+  if (!parse_layout(file, options, &layout))
+    return 1;
+  const int64_t gap_ticks = static_cast<int64_t>(options.gap_us * 1e-6 * layout.ticks_per_s);
+
+  // Split the data at line boundaries, several chunks per thread so that a
+  // slow chunk does not hold up the others
+  auto wall_start = std::chrono::steady_clock::now();
+  const char *base = reinterpret_cast<const char *>(file.data());
+  const char *data_end = base + file.size();
+  std::vector<const char *> bounds{base + layout.data_offset};
+  const size_t data_size = data_end - bounds[0];
+  const size_t chunk_size = std::max<size_t>(1 << 20, data_size / (options.threads * 8) + 1);
+  while (bounds.back() < data_end) {
+    const char *next = bounds.back() + std::min(chunk_size, static_cast<size_t>(data_end - bounds.back()));
+    bounds.push_back(next < data_end ? line_end(next, data_end) + 1 : data_end);
+  }
+  std::vector<ChunkResult> chunks(bounds.size() - 1);
+  std::atomic<size_t> next_chunk{0};
+  std::vector<std::thread> workers;
+  for (int w = 0; w < options.threads; w++) {
+    workers.emplace_back([&]() {
+      for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+        parse_chunk(bounds[i], std::min(bounds[i + 1], data_end), layout, gap_ticks, &chunks[i]);
+        file.release(bounds[i] - base, bounds[i + 1] - bounds[i]);
+      }
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+
+  // Join the chunks in order; without a time column, ticks are row numbers
+  std::vector<Burst> bursts;
+  std::vector<LedEdge> led_edges;
+  uint64_t rows = 0;
+  bool have_previous = false, antenna = false, led = false;
+  int64_t first_tick = 0, last_tick = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    ChunkResult &chunk = chunks[i];
+    if (chunk.error != nullptr) {
+      fprintf(stderr, "%s: %s in chunk %zu\n", options.in.c_str(), chunk.error, i);
+      return 1;
+    }
+    if (chunk.rows == 0)
+      continue;
+    const int64_t offset = layout.time_column ? 0 : static_cast<int64_t>(rows);
+    const int64_t chunk_first = chunk.first_tick + offset;
+    if (!have_previous) {
+      first_tick = chunk_first;
+    } else {
+      if (chunk.first_antenna && !antenna)
+        add_rise(&bursts, chunk_first, gap_ticks);
+      if (layout.led >= 0 && chunk.first_led != led)
+        led_edges.push_back(LedEdge{chunk_first, chunk.first_led});
+    }
+    for (const Burst &b : chunk.bursts) {
+      add_rise(&bursts, b.first + offset, gap_ticks);
+      bursts.back().last = b.last + offset;
+      bursts.back().rises += b.rises - 1;
+    }
+    for (const LedEdge &e : chunk.led)
+      led_edges.push_back(LedEdge{e.tick + offset, e.level});
+    last_tick = chunk.last_tick + offset;
+    rows += chunk.rows;
+    antenna = chunk.last_antenna;
+    led = chunk.last_led;
+    have_previous = true;
+    std::vector<Burst>().swap(chunk.bursts);
+    std::vector<LedEdge>().swap(chunk.led);
+  }
+  double parse_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  if (bursts.empty()) {
+    fprintf(stderr, "%s: no carrier on the antenna channel\n", options.in.c_str());
+    return 1;
+  }
+
+  const double tps = layout.ticks_per_s;
+  auto seconds = [&](int64_t tick) { return static_cast<double>(tick - first_tick) / tps; };
+  printf("%s: %" PRIu64 " rows, %.3f s, %s, parsed in %.2f s with %d threads (%.0f MB/s)\n", options.in.c_str(), rows,
+         seconds(last_tick), layout.time_column ? "time column" : "sample rows", parse_s, options.threads,
+         data_size / parse_s / 1e6);
+
+  // Carrier frequency from the bursts long enough to measure
+  Stat carrier_hz;
+  double total_rises = 0, total_span_s = 0;
+  for (const Burst &b : bursts) {
+    if (b.rises < 100)
+      continue;
+    double span_s = (b.last - b.first) / tps;
+    carrier_hz.add((b.rises - 1) / span_s);
+    total_rises += b.rises - 1;
+    total_span_s += span_s;
+  }
+  printf("Carrier: %zu bursts, %.2f Hz overall\n", bursts.size(), total_span_s > 0 ? total_rises / total_span_s : 0.0);
+  carrier_hz.print("burst frequency", "Hz");
+
+  // Carrier-off pulses. The carrier stops after the last rising edge of a
+  // burst; the pulse starts where the next edge would have come.
+  const double nominal_period_s = 1.0 / 77500;
+  std::vector<Pulse> pulses;
+  host::Dcf77Receiver receiver;
+  int64_t minutes_ok = 0, minutes_bad = 0;
+  bool have_anchor = options.have_start;
+  double anchor_epoch = options.start_epoch;  // UTC time of first_tick
+  receiver.set_callback([&](const host::Dcf77Minute &minute) {
+    if (minute.error != nullptr) {
+      minutes_bad++;
+      printf("  minute at %10.3f s: %s\n", minute.marker_us / 1e6, minute.error);
+      return;
+    }
+    minutes_ok++;
+    if (have_anchor)
+      return;
+    // The marker starts the decoded minute: anchor the grid on it
+    struct tm tm {};
+    tm.tm_year = 100 + minute.time.year;
+    tm.tm_mon = minute.time.month - 1;
+    tm.tm_mday = minute.time.day;
+    tm.tm_hour = minute.time.hour;
+    tm.tm_min = minute.time.minute;
+    tm.tm_isdst = minute.time.dst ? 1 : 0;
+    anchor_epoch = static_cast<double>(mktime(&tm)) - minute.marker_us / 1e6;
+    have_anchor = true;
+  });
+  int64_t dropouts = 0;
+  for (size_t i = 0; i + 1 < bursts.size(); i++) {
+    const Burst &b = bursts[i];
+    double period_s = b.rises > 1 ? (b.last - b.first) / tps / (b.rises - 1) : nominal_period_s;
+    Pulse pulse{seconds(b.last) + period_s, seconds(bursts[i + 1].first)};
+    if (pulse.end_s - pulse.start_s < 0.02) {
+      dropouts++;
+      continue;
+    }
+    pulses.push_back(pulse);
+    receiver.feed(std::llround(pulse.start_s * 1e6), false);
+    receiver.feed(std::llround(pulse.end_s * 1e6), true);
+  }
+  printf("Pulses: %zu, carrier dropouts under 20 ms: %" PRId64 "\n", pulses.size(), dropouts);
+  printf("Minutes decoded OK: %" PRId64 ", with errors: %" PRId64 "\n", minutes_ok, minutes_bad);
+
+  // Match every pulse with the second it belongs to
+  FILE *out = nullptr;
+  if (!options.pulses.empty()) {
+    out = options.pulses == "-" ? stdout : fopen(options.pulses.c_str(), "w");
+    if (out == nullptr) {
+      perror(options.pulses.c_str());
+      return 1;
+    }
+    fprintf(out, "start_s,width_us,utc_second,expected_ms,start_dev_us,width_dev_us\n");
+  }
+  int64_t missing = 0, extra = 0, wrong = 0, matched = 0;
+  Stat start_dev, width_dev_zero, width_dev_one, led_fall, led_rise;
+  if (!have_anchor) {
+    printf("No decoded minute and no --start: cannot check against the expected frames\n");
+  } else {
+    printf("Second grid: %s, first row at UTC %.6f\n", options.have_start ? "--start" : "first decoded minute",
+           anchor_epoch);
+    size_t next_pulse = 0;
+    size_t next_led = 0;
+    const int64_t first_second = static_cast<int64_t>(std::ceil(anchor_epoch + seconds(bursts.front().last)));
+    const int64_t last_second = static_cast<int64_t>(std::floor(anchor_epoch + seconds(bursts.back().first))) - 1;
+    int64_t frame_minute = INT64_MIN;
+    uint64_t frame = 0;
+    for (int64_t second = first_second; second <= last_second; second++) {
+      const int64_t minute = floor_div(second, 60);
+      if (minute != frame_minute) {
+        frame = expected_frame(minute);
+        frame_minute = minute;
+      }
+      const int expected_ms = dcf77::pulse_ms(frame, static_cast<int>(second - minute * 60));
+      // Pulses before this second that belong to none are extra
+      while (next_pulse < pulses.size() && anchor_epoch + pulses[next_pulse].start_s < second - 0.5) {
+        extra++;
+        next_pulse++;
+      }
+      const bool found =
+          next_pulse < pulses.size() && anchor_epoch + pulses[next_pulse].start_s < second + 0.5;
+      if (!found) {
+        missing += expected_ms != 0;
+        continue;
+      }
+      const Pulse &pulse = pulses[next_pulse++];
+      if (expected_ms == 0) {
+        extra++;
+        continue;
+      }
+      matched++;
+      const double dev_us = (anchor_epoch + pulse.start_s - second) * 1e6;
+      const double width_us = (pulse.end_s - pulse.start_s) * 1e6;
+      const double width_dev_us = width_us - expected_ms * 1000.0;
+      start_dev.add(dev_us);
+      (expected_ms == 100 ? width_dev_zero : width_dev_one).add(width_dev_us);
+      if (std::fabs(width_dev_us) > 40000)
+        wrong++;
+      if (out != nullptr)
+        fprintf(out, "%.6f,%.1f,%" PRId64 ",%d,%.1f,%.1f\n", pulse.start_s, width_us, second, expected_ms, dev_us,
+                width_dev_us);
+
+      // LED edges within 50 ms of the pulse start and end
+      while (next_led < led_edges.size() && seconds(led_edges[next_led].tick) < pulse.start_s - 0.05)
+        next_led++;
+      for (size_t j = next_led; j < led_edges.size() && seconds(led_edges[j].tick) < pulse.end_s + 0.05; j++) {
+        double t = seconds(led_edges[j].tick);
+        if (!led_edges[j].level && std::fabs(t - pulse.start_s) < 0.05)
+          led_fall.add((t - pulse.start_s) * 1e6);
+        if (led_edges[j].level && std::fabs(t - pulse.end_s) < 0.05)
+          led_rise.add((t - pulse.end_s) * 1e6);
+      }
+    }
+    printf("Expected-frame check: %" PRId64 " pulses matched, %" PRId64 " missing, %" PRId64 " extra, %" PRId64
+           " with the wrong width\n",
+           matched, missing, extra, wrong);
+    start_dev.print("pulse start - second", "us");
+    width_dev_zero.print("'0' width - 100 ms", "us");
+    width_dev_one.print("'1' width - 200 ms", "us");
+    if (layout.led >= 0) {
+      printf("LED: %zu edges\n", led_edges.size());
+      led_fall.print("LED off - pulse start", "us");
+      led_rise.print("LED on - pulse end", "us");
+    }
+  }
+  if (out != nullptr && out != stdout)
+    fclose(out);
+
+  const bool failed = !have_anchor || minutes_bad > 0 || missing > 0 || extra > 0 || wrong > 0;
+  return failed ? 1 : 0;
+}
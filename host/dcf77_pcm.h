@@ -0,0 +1,451 @@
+#pragma once
+
+// PCM rendering and demodulation of the DCF77 signal for the host tools.
+//
+// The carrier is a sine at an integer frequency, amplitude-keyed the way the
+// firmware does it: full level except for the 100/200 ms pulse at the start
+// of every second, none in second 59. Frames come from the shared encoder,
+// so the rendered minutes match what the sketch and the component send.
+//
+// Rendering streams in caller-sized blocks with constant memory. Because the
+// carrier and the sample rate are integers, the carrier repeats exactly every
+// rate / gcd(rate, carrier) samples; one period is computed up front and the
+// hot loop only scales it by the current envelope level and converts it to
+// 16-bit samples. That loop has AVX2 and NEON versions with a scalar
+// fallback, picked at run time on x86.
+//
+// Demodulation mixes the input with the same tabulated carrier (I/Q) and
+// integrates over short windows, giving one envelope sample per window.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DCF77_PCM_HAVE_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DCF77_PCM_HAVE_NEON 1
+#endif
+
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+
+namespace host {
+
+// -----------------------------------------------------------------------------
+// Scale kernels: out[i] = round(in[i] * gain), |in[i] * gain| <= 32767
+// -----------------------------------------------------------------------------
+using ScaleKernel = void (*)(const float *in, float gain, int16_t *out, size_t n);
+
+inline void scale_to_s16_scalar(const float *in, float gain, int16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    out[i] = static_cast<int16_t>(lrintf(in[i] * gain));
+}
+
+#ifdef DCF77_PCM_HAVE_AVX2
+__attribute__((target("avx2"))) inline void scale_to_s16_avx2(const float *in, float gain, int16_t *out, size_t n) {
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+    __m256i hi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), g));
+    // packs works per 128-bit lane; restore sample order across lanes
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+  }
+  scale_to_s16_scalar(in + i, gain, out + i, n - i);
+}
+#endif
+
+#ifdef DCF77_PCM_HAVE_NEON
+inline void scale_to_s16_neon(const float *in, float gain, int16_t *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), gain));
+    int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i + 4), gain));
+    vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+  }
+  scale_to_s16_scalar(in + i, gain, out + i, n - i);
+}
+#endif
+
+/// Returns the kernel named |name| ("auto", "scalar", "avx2" or "neon"), or
+/// nullptr if it is not available on this machine.
+inline ScaleKernel select_scale_kernel(const std::string &name) {
+#ifdef DCF77_PCM_HAVE_AVX2
+  if (name == "avx2" || name == "auto")
+    return __builtin_cpu_supports("avx2") ? scale_to_s16_avx2 : (name == "auto" ? scale_to_s16_scalar : nullptr);
+#endif
+#ifdef DCF77_PCM_HAVE_NEON
+  if (name == "neon" || name == "auto")
+    return scale_to_s16_neon;
+#endif
+  if (name == "scalar" || name == "auto")
+    return scale_to_s16_scalar;
+  return nullptr;
+}
+
+inline const char *scale_kernel_name(ScaleKernel kernel) {
+#ifdef DCF77_PCM_HAVE_AVX2
+  if (kernel == scale_to_s16_avx2)
+    return "avx2";
+#endif
+#ifdef DCF77_PCM_HAVE_NEON
+  if (kernel == scale_to_s16_neon)
+    return "neon";
+#endif
+  return "scalar";
+}
+
+// -----------------------------------------------------------------------------
+// WAV output
+// -----------------------------------------------------------------------------
+
+/// Writes the header of a mono 16-bit PCM file holding |samples| samples.
+/// Files with more than 4 GiB of data get an RF64 header (EBU Tech 3306),
+/// which sox, ffmpeg and Audacity read.
+inline bool write_wav_header(FILE *file, uint32_t sample_rate, uint64_t samples) {
+  std::string header;
+  auto put = [&header](uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+      header.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  };
+  const uint64_t data_bytes = samples * 2;
+  const bool rf64 = data_bytes + 36 > 0xFFFFFFFFu;
+
+  header += rf64 ? "RF64" : "RIFF";
+  put(rf64 ? 0xFFFFFFFFu : data_bytes + 36, 4);
+  header += "WAVE";
+  if (rf64) {
+    header += "ds64";
+    put(28, 4);
+    put(data_bytes + 36 + 36, 8);  // RIFF size including the ds64 chunk
+    put(data_bytes, 8);
+    put(samples, 8);
+    put(0, 4);  // no table entries
+  }
+  header += "fmt ";
+  put(16, 4);
+  put(1, 2);  // PCM
+  put(1, 2);  // mono
+  put(sample_rate, 4);
+  put(sample_rate * 2, 4);
+  put(2, 2);   // block align
+  put(16, 2);  // bits per sample
+  header += "data";
+  put(rf64 ? 0xFFFFFFFFu : data_bytes, 4);
+  return fwrite(header.data(), 1, header.size(), file) == header.size();
+}
+
+/// Layout of the sample data in a WAV or RF64 file.
+struct WavInfo {
+  uint32_t sample_rate;
+  uint16_t channels;
+  uint16_t bits_per_sample;
+  uint16_t format;  // 1 = PCM, 3 = IEEE float
+  size_t data_offset;
+  uint64_t data_bytes;
+};
+
+/// Parses the header of an in-memory WAV/RF64 file. Returns nullptr on
+/// success or a short description of what is wrong.
+inline const char *parse_wav_header(const uint8_t *data, size_t size, WavInfo *info) {
+  auto get = [data](size_t offset, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+      value = value << 8 | data[offset + i];
+    return value;
+  };
+  if (size < 12 || (memcmp(data, "RIFF", 4) != 0 && memcmp(data, "RF64", 4) != 0) || memcmp(data + 8, "WAVE", 4) != 0)
+    return "not a WAV file";
+  uint64_t ds64_data_bytes = 0;
+  bool have_fmt = false;
+  for (size_t offset = 12; offset + 8 <= size;) {
+    const uint8_t *id = data + offset;
+    uint64_t chunk = get(offset + 4, 4);
+    size_t body = offset + 8;
+    if (memcmp(id, "ds64", 4) == 0 && body + 16 <= size) {
+      ds64_data_bytes = get(body + 8, 8);
+    } else if (memcmp(id, "fmt ", 4) == 0 && body + 16 <= size) {
+      info->format = static_cast<uint16_t>(get(body, 2));
+      info->channels = static_cast<uint16_t>(get(body + 2, 2));
+      info->sample_rate = static_cast<uint32_t>(get(body + 4, 4));
+      info->bits_per_sample = static_cast<uint16_t>(get(body + 14, 2));
+      if (info->format == 0xFFFE && chunk >= 26 && body + 26 <= size)
+        info->format = static_cast<uint16_t>(get(body + 24, 2));  // WAVE_FORMAT_EXTENSIBLE sub-format
+      have_fmt = true;
+    } else if (memcmp(id, "data", 4) == 0) {
+      if (!have_fmt)
+        return "data chunk before fmt chunk";
+      info->data_offset = body;
+      info->data_bytes = chunk == 0xFFFFFFFFu ? ds64_data_bytes : chunk;
+      // Tolerate truncated captures and streamed files with a placeholder size
+      info->data_bytes = std::min<uint64_t>(info->data_bytes, size - body);
+      return nullptr;
+    }
+    offset = body + chunk + (chunk & 1);
+  }
+  return "no data chunk";
+}
+
+// -----------------------------------------------------------------------------
+// Mix kernels: *i = sum x[k] * lo_cos[k], *q = sum x[k] * lo_sin[k]
+// -----------------------------------------------------------------------------
+using MixKernel = void (*)(const int16_t *x, const float *lo_cos, const float *lo_sin, size_t n, float *i, float *q);
+
+inline void mix_scalar(const int16_t *x, const float *lo_cos, const float *lo_sin, size_t n, float *i, float *q) {
+  float si = 0, sq = 0;
+  for (size_t k = 0; k < n; k++) {
+    si += x[k] * lo_cos[k];
+    sq += x[k] * lo_sin[k];
+  }
+  *i = si;
+  *q = sq;
+}
+
+#ifdef DCF77_PCM_HAVE_AVX2
+__attribute__((target("avx2,fma"))) inline float hsum_avx2(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma"))) inline void mix_avx2(const int16_t *x, const float *lo_cos, const float *lo_sin,
+                                                         size_t n, float *i, float *q) {
+  __m256 ai = _mm256_setzero_ps(), aq = _mm256_setzero_ps();
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(x + k))));
+    ai = _mm256_fmadd_ps(v, _mm256_loadu_ps(lo_cos + k), ai);
+    aq = _mm256_fmadd_ps(v, _mm256_loadu_ps(lo_sin + k), aq);
+  }
+  float ti, tq;
+  mix_scalar(x + k, lo_cos + k, lo_sin + k, n - k, &ti, &tq);
+  *i = hsum_avx2(ai) + ti;
+  *q = hsum_avx2(aq) + tq;
+}
+#endif
+
+#ifdef DCF77_PCM_HAVE_NEON
+inline void mix_neon(const int16_t *x, const float *lo_cos, const float *lo_sin, size_t n, float *i, float *q) {
+  float32x4_t ai = vdupq_n_f32(0), aq = vdupq_n_f32(0);
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    float32x4_t v = vcvtq_f32_s32(vmovl_s16(vld1_s16(x + k)));
+    ai = vfmaq_f32(ai, v, vld1q_f32(lo_cos + k));
+    aq = vfmaq_f32(aq, v, vld1q_f32(lo_sin + k));
+  }
+  float ti, tq;
+  mix_scalar(x + k, lo_cos + k, lo_sin + k, n - k, &ti, &tq);
+  *i = vaddvq_f32(ai) + ti;
+  *q = vaddvq_f32(aq) + tq;
+}
+#endif
+
+/// Mix kernel counterpart of select_scale_kernel().
+inline MixKernel select_mix_kernel(const std::string &name) {
+#ifdef DCF77_PCM_HAVE_AVX2
+  if (name == "avx2" || name == "auto") {
+    bool usable = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return usable ? mix_avx2 : (name == "auto" ? mix_scalar : nullptr);
+  }
+#endif
+#ifdef DCF77_PCM_HAVE_NEON
+  if (name == "neon" || name == "auto")
+    return mix_neon;
+#endif
+  if (name == "scalar" || name == "auto")
+    return mix_scalar;
+  return nullptr;
+}
+
+inline const char *mix_kernel_name(MixKernel kernel) {
+#ifdef DCF77_PCM_HAVE_AVX2
+  if (kernel == mix_avx2)
+    return "avx2";
+#endif
+#ifdef DCF77_PCM_HAVE_NEON
+  if (kernel == mix_neon)
+    return "neon";
+#endif
+  return "scalar";
+}
+
+/// Returns rate / gcd(rate, carrier): the number of samples after which an
+/// integer-frequency carrier repeats exactly.
+inline uint32_t carrier_period(uint32_t sample_rate, uint32_t carrier_hz) {
+  uint32_t a = sample_rate, b = carrier_hz;
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return sample_rate / a;
+}
+
+/// Tabulates |length| samples of peak * sin (or cos) of the carrier.
+inline std::vector<float> carrier_table(uint32_t sample_rate, uint32_t carrier_hz, size_t length, double peak,
+                                        bool cosine) {
+  std::vector<float> table(length);
+  for (size_t n = 0; n < length; n++) {
+    uint64_t phase = (static_cast<uint64_t>(carrier_hz) * n) % sample_rate;
+    double angle = 2 * M_PI * phase / sample_rate;
+    table[n] = static_cast<float>(peak * (cosine ? std::cos(angle) : std::sin(angle)));
+  }
+  return table;
+}
+
+// -----------------------------------------------------------------------------
+// Signal renderer
+// -----------------------------------------------------------------------------
+struct PcmSignalConfig {
+  int64_t start_epoch{0};  // UTC second of the first sample
+  uint32_t sample_rate{192000};
+  uint32_t carrier_hz{77500};
+  double amplitude{0.5};   // carrier peak, fraction of full scale
+  double low_level{0.0};   // carrier during a pulse, fraction of the peak
+};
+
+class PcmSignalRenderer {
+ public:
+  /// Longest carrier period, in samples, the renderer will tabulate.
+  static constexpr uint32_t MAX_PERIOD = 1u << 22;
+
+  PcmSignalRenderer(const PcmSignalConfig &config, ScaleKernel kernel) : config_(config), kernel_(kernel) {
+    if (config.sample_rate == 0 || config.carrier_hz == 0 || 2ull * config.carrier_hz >= config.sample_rate) {
+      this->error_ = "carrier must be above 0 Hz and below half the sample rate";
+      return;
+    }
+    this->period_ = carrier_period(config.sample_rate, config.carrier_hz);
+    if (this->period_ > MAX_PERIOD) {
+      this->error_ = "sample rate and carrier share no useful common period";
+      return;
+    }
+    // Repeat the period so every kernel call covers at least BLOCK samples.
+    const uint32_t BLOCK = 8192;
+    size_t length = this->period_ * ((BLOCK + 2 * this->period_ - 1) / this->period_);
+    this->table_ = carrier_table(config.sample_rate, config.carrier_hz, length, config.amplitude * 32767.0, false);
+    this->start_second_(config.start_epoch);
+  }
+
+  /// nullptr if the configuration is usable, otherwise the reason it is not.
+  const char *error() const { return this->error_; }
+  uint32_t period() const { return this->period_; }
+  uint64_t position() const { return this->position_; }
+
+  /// Renders the next |n| samples.
+  void render(int16_t *out, size_t n) {
+    while (n > 0) {
+      if (this->position_ == this->next_second_)
+        this->start_second_(this->second_ + 1);
+      const bool in_pulse = this->position_ < this->pulse_end_;
+      const uint64_t segment_end = in_pulse ? this->pulse_end_ : this->next_second_;
+      size_t count = static_cast<size_t>(std::min<uint64_t>(n, segment_end - this->position_));
+      const float gain = in_pulse ? static_cast<float>(this->config_.low_level) : 1.0f;
+      n -= count;
+      while (count > 0) {
+        size_t offset = this->position_ % this->period_;
+        size_t chunk = std::min(count, this->table_.size() - offset);
+        this->kernel_(&this->table_[offset], gain, out, chunk);
+        out += chunk;
+        count -= chunk;
+        this->position_ += chunk;
+      }
+    }
+  }
+
+ protected:
+  // Sets up the envelope for UTC second |second|, which starts at position_.
+  void start_second_(int64_t second) {
+    int64_t minute = second >= 0 ? second / 60 : (second - 59) / 60;
+    if (minute != this->minute_) {
+      // The frame sent during a minute announces the following one
+      time_t next = static_cast<time_t>((minute + 1) * 60);
+      struct tm tm {};
+      localtime_r(&next, &tm);
+      this->frame_ = dcf77::encode_frame(dcf77::civil_from_tm(tm));
+      this->minute_ = minute;
+    }
+    const uint32_t rate = this->config_.sample_rate;
+    const int pulse = dcf77::pulse_ms(this->frame_, static_cast<int>(second - minute * 60));
+    this->second_ = second;
+    this->pulse_end_ = this->position_ + (static_cast<uint64_t>(pulse) * rate + 500) / 1000;
+    this->next_second_ = this->position_ + rate;
+  }
+
+  PcmSignalConfig config_;
+  ScaleKernel kernel_;
+  const char *error_{nullptr};
+  uint32_t period_{0};
+  std::vector<float> table_;
+  uint64_t position_{0};
+  int64_t second_{0};
+  int64_t minute_{INT64_MIN};
+  uint64_t frame_{0};
+  uint64_t pulse_end_{0};
+  uint64_t next_second_{0};
+};
+
+// -----------------------------------------------------------------------------
+// Envelope demodulator
+// -----------------------------------------------------------------------------
+
+/// I/Q envelope detector. Every |window| input samples are mixed with the
+/// carrier and integrated into one envelope sample, the carrier amplitude as
+/// a fraction of full scale.
+class PcmEnvelopeDemodulator {
+ public:
+  PcmEnvelopeDemodulator(uint32_t sample_rate, uint32_t carrier_hz, uint32_t window, MixKernel kernel)
+      : window_(window), kernel_(kernel) {
+    if (sample_rate == 0 || carrier_hz == 0 || 2ull * carrier_hz >= sample_rate) {
+      this->error_ = "carrier must be above 0 Hz and below half the sample rate";
+      return;
+    }
+    if (window == 0) {
+      this->error_ = "window must hold at least one sample";
+      return;
+    }
+    this->period_ = carrier_period(sample_rate, carrier_hz);
+    if (this->period_ > PcmSignalRenderer::MAX_PERIOD) {
+      this->error_ = "sample rate and carrier share no useful common period";
+      return;
+    }
+    this->cos_ = carrier_table(sample_rate, carrier_hz, this->period_ + window, 1.0, true);
+    this->sin_ = carrier_table(sample_rate, carrier_hz, this->period_ + window, 1.0, false);
+    this->scale_ = 2.0f / (32768.0f * window);
+  }
+
+  const char *error() const { return this->error_; }
+  uint32_t window() const { return this->window_; }
+
+  /// Demodulates |n| samples, a multiple of window(), that follow the ones
+  /// passed before, writing n / window() envelope samples to |out|.
+  void process(const int16_t *x, size_t n, float *out) {
+    for (size_t k = 0; k + this->window_ <= n; k += this->window_) {
+      size_t offset = this->position_ % this->period_;
+      float i, q;
+      this->kernel_(x + k, &this->cos_[offset], &this->sin_[offset], this->window_, &i, &q);
+      *out++ = std::sqrt(i * i + q * q) * this->scale_;
+      this->position_ += this->window_;
+    }
+  }
+
+ protected:
+  uint32_t window_;
+  MixKernel kernel_;
+  const char *error_{nullptr};
+  uint32_t period_{0};
+  float scale_{0};
+  std::vector<float> cos_;
+  std::vector<float> sin_;
+  uint64_t position_{0};
+};
+
+}  // namespace host
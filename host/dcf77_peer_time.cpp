@@ -0,0 +1,340 @@
+/*
+  Simulation of the sketch's peer time distribution (peer_time.h).
+
+  A group of units wakes for every sync window, runs the protocol and
+  sleeps again, on a virtual clock. Each unit has its own crystal error and
+  its own UDP socket on 127.0.0.1, which stands in for ESP-NOW: beacons are
+  encoded, broadcast to every other unit's socket, read back and decoded.
+  Each copy is dropped with probability --loss or delivered after a latency
+  drawn from --latency-ms. A unit that has to use WiFi takes --wifi-s for
+  the association and NTP sync, which gets a Gaussian error of
+  --ntp-error-ms.
+
+  The report counts the WiFi sessions against one per unit and window, and
+  the leaders per window. It lists the followers' actual clock errors
+  against the error they estimated. With --kill=N the leader of window N
+  fails for good, and the others have to take over. The tool exits
+  non-zero if a follower's error exceeds its own estimate.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -I. -o dcf77_peer_time host/dcf77_peer_time.cpp
+
+  Usage:
+    dcf77_peer_time [--units=8] [--windows=48] [--period-h=3] [--skew-s=5]
+                    [--latency-ms=MIN,MAX] [--loss=P] [--ntp-error-ms=N]
+                    [--wifi-s=MIN,MAX] [--ppm=N] [--kill=WINDOW] [--seed=N]
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "peer_time.h"
+#include "sync_schedule.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  int units{8};
+  int windows{48};
+  double period_h{3};
+  double skew_s{5};
+  double latency_min_ms{0.3};
+  double latency_max_ms{5};
+  double loss{0.1};
+  double ntp_error_ms{5};
+  double wifi_min_s{2};
+  double wifi_max_s{6};
+  double ppm{20};
+  int kill{-1};
+  uint64_t seed{1};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    std::vector<double> range;
+    if (parse_option(argv[i], "--units", &value)) {
+      options->units = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--windows", &value)) {
+      options->windows = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--period-h", &value)) {
+      options->period_h = atof(value.c_str());
+    } else if (parse_option(argv[i], "--skew-s", &value)) {
+      options->skew_s = atof(value.c_str());
+    } else if (parse_option(argv[i], "--latency-ms", &value)) {
+      range = host::parse_list(value);
+      if (range.size() != 2 || range[0] < 0 || range[1] < range[0]) {
+        fprintf(stderr, "--latency-ms needs MIN,MAX\n");
+        return false;
+      }
+      options->latency_min_ms = range[0];
+      options->latency_max_ms = range[1];
+    } else if (parse_option(argv[i], "--loss", &value)) {
+      options->loss = atof(value.c_str());
+    } else if (parse_option(argv[i], "--ntp-error-ms", &value)) {
+      options->ntp_error_ms = atof(value.c_str());
+    } else if (parse_option(argv[i], "--wifi-s", &value)) {
+      range = host::parse_list(value);
+      if (range.size() != 2 || range[0] < 0 || range[1] < range[0]) {
+        fprintf(stderr, "--wifi-s needs MIN,MAX\n");
+        return false;
+      }
+      options->wifi_min_s = range[0];
+      options->wifi_max_s = range[1];
+    } else if (parse_option(argv[i], "--ppm", &value)) {
+      options->ppm = atof(value.c_str());
+    } else if (parse_option(argv[i], "--kill", &value)) {
+      options->kill = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--seed", &value)) {
+      options->seed = strtoull(value.c_str(), nullptr, 10);
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->units < 1 || options->windows < 1 || options->period_h * 60 <= syncWindowMinutes) {
+    fprintf(stderr, "need at least one unit and window, and windows shorter than the period\n");
+    return false;
+  }
+  return true;
+}
+
+enum class Phase { ASLEEP, LISTEN, WIFI, LEAD, FOLLOW, DEAD };
+
+struct Unit {
+  uint32_t id;
+  double ppm;
+  int64_t local_base_us;  // local time at true time 0
+  int fd;
+  sockaddr_in addr;
+  PeerTimeState state;
+
+  // Current window
+  Phase phase{Phase::ASLEEP};
+  PeerListen listen;
+  int64_t offset_us{0};   // UTC minus local time
+  int64_t synced_us{0};   // true time of the NTP sync
+  bool beaconing{false};
+};
+
+int64_t local_us(const Unit &unit, int64_t t_us) {
+  return unit.local_base_us + t_us + static_cast<int64_t>(t_us * unit.ppm / 1e6);
+}
+
+struct Stat {
+  std::vector<double> values;
+  void add(double v) { this->values.push_back(v); }
+  double percentile(double p) {
+    if (this->values.empty())
+      return NAN;
+    std::sort(this->values.begin(), this->values.end());
+    return this->values[static_cast<size_t>(p * (this->values.size() - 1))];
+  }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+
+  std::mt19937_64 rng(options.seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::normal_distribution<double> gauss;
+
+  // The radio: one UDP socket per unit on the loopback interface
+  std::vector<Unit> units(options.units);
+  for (auto &unit : units) {
+    do {
+      unit.id = static_cast<uint32_t>(rng());
+    } while (unit.id == 0);
+    unit.ppm = (2 * uniform(rng) - 1) * options.ppm;
+    unit.local_base_us = static_cast<int64_t>(uniform(rng) * 1e9);
+    unit.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    unit.addr = sockaddr_in{};
+    unit.addr.sin_family = AF_INET;
+    unit.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(unit.addr);
+    if (unit.fd < 0 || bind(unit.fd, reinterpret_cast<sockaddr *>(&unit.addr), len) != 0 ||
+        getsockname(unit.fd, reinterpret_cast<sockaddr *>(&unit.addr), &len) != 0) {
+      perror("127.0.0.1");
+      return 2;
+    }
+    peerTimeInit(unit.state);
+  }
+
+  std::multimap<int64_t, std::function<void()>> events;
+  int64_t now = 0;
+  const int64_t period_us = static_cast<int64_t>(options.period_h * 3600e6);
+  const int64_t window_us = syncWindowMinutes * 60000000LL;
+
+  uint32_t wifi_sessions = 0, beacons_sent = 0, copies_lost = 0, violations = 0, dead = 0;
+  std::vector<int> leaders_per_window(options.windows);
+  std::vector<int> followers_per_window(options.windows);
+  Stat follower_error_ms, estimate_ms;
+
+  std::function<void(Unit *, int64_t)> send_beacon;
+  std::function<void(Unit *, int)> start_wifi = [&](Unit *unit, int window) {
+    unit->phase = Phase::WIFI;
+    wifi_sessions++;
+    const double wifi_s = options.wifi_min_s + uniform(rng) * (options.wifi_max_s - options.wifi_min_s);
+    events.emplace(now + static_cast<int64_t>(wifi_s * 1e6), [&, unit, window]() {
+      if (unit->phase != Phase::WIFI)
+        return;
+      const int64_t error_us = static_cast<int64_t>(gauss(rng) * options.ntp_error_ms * 1000);
+      unit->offset_us = now + error_us - local_us(*unit, now);
+      unit->synced_us = now;
+      unit->phase = Phase::LEAD;
+      unit->beaconing = true;
+      peerLeaderStart(unit->state, 6);
+      leaders_per_window[window]++;
+      send_beacon(unit, window * period_us + window_us);
+    });
+  };
+
+  // A beacon goes to every other socket; each copy is read back at once
+  // (loopback delivers synchronously) and handed over after its latency
+  send_beacon = [&](Unit *unit, int64_t until_us) {
+    if (unit->phase != Phase::LEAD || !unit->beaconing || now >= until_us)
+      return;
+    const PeerBeacon beacon =
+        peerLeaderBeacon(unit->state, unit->id, local_us(*unit, now) + unit->offset_us, now - unit->synced_us);
+    uint8_t packet[peerBeaconSize];
+    peerBeaconEncode(beacon, packet);
+    beacons_sent++;
+    for (auto &peer : units) {
+      if (&peer == unit)
+        continue;
+      sendto(unit->fd, packet, sizeof(packet), 0, reinterpret_cast<const sockaddr *>(&peer.addr), sizeof(peer.addr));
+      uint8_t received[64];
+      ssize_t n;
+      while ((n = recv(peer.fd, received, sizeof(received), MSG_DONTWAIT)) > 0) {
+        if (uniform(rng) < options.loss) {
+          copies_lost++;
+          continue;
+        }
+        const double latency_ms =
+            options.latency_min_ms + uniform(rng) * (options.latency_max_ms - options.latency_min_ms);
+        std::vector<uint8_t> data(received, received + n);
+        Unit *receiver = &peer;
+        events.emplace(now + static_cast<int64_t>(latency_ms * 1000), [&, receiver, data]() {
+          PeerBeacon heard;
+          if (!peerBeaconDecode(data.data(), data.size(), &heard))
+            return;
+          if (receiver->phase == Phase::LISTEN) {
+            peerListenAdd(receiver->listen, heard, local_us(*receiver, now));
+          } else if (receiver->phase == Phase::LEAD && receiver->beaconing &&
+                     peerLeaderHeard(receiver->state, receiver->id, heard)) {
+            receiver->beaconing = false;
+          }
+        });
+      }
+    }
+    events.emplace(now + peerBeaconIntervalUs, [&, unit, until_us]() { send_beacon(unit, until_us); });
+  };
+
+  for (int window = 0; window < options.windows; window++) {
+    const int64_t start_us = window * period_us;
+    const int64_t end_us = start_us + window_us;
+    if (window == options.kill) {
+      // The leader of the last window fails for good
+      for (auto &unit : units) {
+        if (unit.phase != Phase::DEAD && unit.state.role == PEER_ROLE_LEADER) {
+          unit.phase = Phase::DEAD;
+          dead++;
+          break;
+        }
+      }
+    }
+    for (auto &unit : units) {
+      if (unit.phase == Phase::DEAD)
+        continue;
+      Unit *u = &unit;
+      const bool lead = unit.state.role == PEER_ROLE_LEADER;
+      const int64_t wake_us = std::max<int64_t>(
+          start_us + static_cast<int64_t>((2 * uniform(rng) - 1) * options.skew_s * 1e6) -
+              (lead ? peerLeaderLeadSeconds * 1000000LL : 0),
+          window == 0 ? 0 : start_us - period_us + window_us);
+      events.emplace(wake_us, [&, u, window]() {
+        const int64_t listen_us = peerListenWindowUs(u->state);
+        if (listen_us == 0) {
+          start_wifi(u, window);
+          return;
+        }
+        u->phase = Phase::LISTEN;
+        u->listen = PeerListen();
+        events.emplace(now + listen_us, [&, u, window]() {
+          if (!peerListenDone(u->state, u->listen)) {
+            start_wifi(u, window);
+            return;
+          }
+          u->phase = Phase::FOLLOW;
+          u->offset_us = u->listen.offsetUs;
+          followers_per_window[window]++;
+          const double error_ms = (local_us(*u, now) + u->offset_us - now) / 1e3;
+          const double estimate = peerFollowerErrorUs(u->listen) / 1e3;
+          follower_error_ms.add(std::abs(error_ms));
+          estimate_ms.add(estimate);
+          if (std::abs(error_ms) > estimate) {
+            violations++;
+            printf("  window %d: unit %08" PRIx32 " is %.3f ms off, estimated %.3f ms\n", window, u->id, error_ms,
+                   estimate);
+          }
+        });
+      });
+      events.emplace(end_us, [u]() {
+        if (u->phase != Phase::DEAD)
+          u->phase = Phase::ASLEEP;
+      });
+    }
+    while (!events.empty() && events.begin()->first <= end_us) {
+      auto event = events.begin();
+      now = event->first;
+      auto action = std::move(event->second);
+      events.erase(event);
+      action();
+    }
+  }
+  for (auto &unit : units)
+    close(unit.fd);
+
+  const int total = options.units * options.windows;
+  printf("%d units, %d windows every %.1f h, latency %.1f-%.1f ms, loss %.0f %%\n", options.units, options.windows,
+         options.period_h, options.latency_min_ms, options.latency_max_ms, options.loss * 100);
+  printf("WiFi sessions: %" PRIu32 " of %d without peers (%.1f %%)\n", wifi_sessions, total,
+         100.0 * wifi_sessions / total);
+  printf("Beacons: %" PRIu32 " sent, %" PRIu32 " copies lost\n", beacons_sent, copies_lost);
+  std::map<int, int> leader_histogram;
+  for (int window = 0; window < options.windows; window++)
+    leader_histogram[leaders_per_window[window]]++;
+  printf("Leaders per window:");
+  for (const auto &entry : leader_histogram)
+    printf(" %d in %d windows,", entry.first, entry.second);
+  printf(" first windows: ");
+  for (int window = 0; window < std::min(options.windows, 6); window++)
+    printf("%d ", leaders_per_window[window]);
+  printf("\n");
+  if (dead > 0)
+    printf("Units failed: %" PRIu32 " (from window %d)\n", dead, options.kill);
+  printf("Follower clock error: p50 %.3f ms, p95 %.3f ms, max %.3f ms (estimated %.3f ms)\n",
+         follower_error_ms.percentile(0.5), follower_error_ms.percentile(0.95), follower_error_ms.percentile(1),
+         estimate_ms.percentile(0.5));
+  printf("Error above the estimate: %" PRIu32 " of %zu\n", violations, follower_error_ms.values.size());
+  return violations == 0 && (options.units == 1 || !follower_error_ms.values.empty()) ? 0 : 1;
+}
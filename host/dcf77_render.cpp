@@ -0,0 +1,158 @@
+/*
+  Renders the transmitted DCF77 signal to a mono 16-bit WAV file.
+
+  The carrier is keyed with the frames of the shared encoder, starting at a
+  given UTC second. Output is written in fixed-size blocks, so memory use does
+  not depend on the duration; recordings over 4 GiB use an RF64 header.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -I. -o dcf77_render host/dcf77_render.cpp
+
+  Usage:
+    dcf77_render --out=FILE|- [--start=EPOCH] [--seconds=N] [--days=N]
+                 [--rate=192000] [--carrier-hz=77500] [--subharmonic=N]
+                 [--amplitude=0.5] [--low-level=0] [--tz=POSIX_TZ]
+                 [--kernel=auto|scalar|avx2|neon]
+    dcf77_render --bench [...]
+
+  --subharmonic=N renders 77500/N Hz instead of the carrier itself, e.g. for
+  a 48 kHz sound card. --low-level is the carrier level during a pulse
+  relative to the peak: 0 matches the firmware, which switches the PWM off,
+  about 0.15 matches the real DCF77 transmitter. --bench renders without
+  writing and reports throughput in samples per second.
+*/
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "dcf77_pcm.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  std::string out;
+  bool bench{false};
+  host::PcmSignalConfig signal{};
+  uint32_t subharmonic{1};
+  double seconds{120};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  std::string kernel{"auto"};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  options->signal.start_epoch = 1729976400;  // 2024-10-26 21:00 UTC
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--out", &value)) {
+      options->out = value;
+    } else if (strcmp(argv[i], "--bench") == 0) {
+      options->bench = true;
+    } else if (parse_option(argv[i], "--start", &value)) {
+      options->signal.start_epoch = strtoll(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--seconds", &value)) {
+      options->seconds = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--days", &value)) {
+      options->seconds = strtod(value.c_str(), nullptr) * 86400;
+    } else if (parse_option(argv[i], "--rate", &value)) {
+      options->signal.sample_rate = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--carrier-hz", &value)) {
+      options->signal.carrier_hz = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--subharmonic", &value)) {
+      options->subharmonic = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--amplitude", &value)) {
+      options->signal.amplitude = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--low-level", &value)) {
+      options->signal.low_level = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--kernel", &value)) {
+      options->kernel = value;
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->subharmonic == 0 || options->signal.carrier_hz % options->subharmonic != 0) {
+    fprintf(stderr, "--subharmonic must divide the carrier frequency %" PRIu32 " Hz\n", options->signal.carrier_hz);
+    return false;
+  }
+  options->signal.carrier_hz /= options->subharmonic;
+  if (options->signal.amplitude <= 0 || options->signal.amplitude > 1 || options->signal.low_level < 0 ||
+      options->signal.low_level > 1) {
+    fprintf(stderr, "--amplitude and --low-level must be within [0, 1]\n");
+    return false;
+  }
+  if (options->out.empty() && !options->bench) {
+    fprintf(stderr, "either --out or --bench is required\n");
+    return false;
+  }
+  return options->seconds > 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  host::ScaleKernel kernel = host::select_scale_kernel(options.kernel);
+  if (kernel == nullptr) {
+    fprintf(stderr, "kernel '%s' is not available on this machine\n", options.kernel.c_str());
+    return 2;
+  }
+  host::PcmSignalRenderer renderer(options.signal, kernel);
+  if (renderer.error() != nullptr) {
+    fprintf(stderr, "%s\n", renderer.error());
+    return 2;
+  }
+
+  FILE *file = nullptr;
+  if (!options.bench) {
+    file = options.out == "-" ? stdout : fopen(options.out.c_str(), "wb");
+    if (file == nullptr) {
+      perror(options.out.c_str());
+      return 1;
+    }
+  }
+
+  const uint64_t total = static_cast<uint64_t>(options.seconds * options.signal.sample_rate);
+  if (file != nullptr && !host::write_wav_header(file, options.signal.sample_rate, total)) {
+    perror("write");
+    return 1;
+  }
+
+  // One block of output at a time; 64 Ki samples keeps it within L2.
+  std::vector<int16_t> block(1 << 16);
+  auto wall_start = std::chrono::steady_clock::now();
+  for (uint64_t done = 0; done < total;) {
+    size_t n = static_cast<size_t>(std::min<uint64_t>(block.size(), total - done));
+    renderer.render(block.data(), n);
+    if (file != nullptr && fwrite(block.data(), sizeof(int16_t), n, file) != n) {
+      perror("write");
+      return 1;
+    }
+    done += n;
+  }
+  if (file != nullptr && file != stdout && fclose(file) != 0) {
+    perror(options.out.c_str());
+    return 1;
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+  fprintf(stderr, "Rendered %" PRIu64 " samples (%.1f s at %" PRIu32 " Hz, carrier %" PRIu32 " Hz, period %" PRIu32
+          " samples) with the %s kernel\n",
+          total, options.seconds, options.signal.sample_rate, options.signal.carrier_hz, renderer.period(),
+          host::scale_kernel_name(kernel));
+  fprintf(stderr, "%.2f s wall, %.1f Msamples/s, %.0fx real time\n", wall_s, total / wall_s / 1e6,
+          options.seconds / wall_s);
+  return 0;
+}
@@ -0,0 +1,673 @@
+/*
+  Runs the unmodified DCF77Emitter component on the host virtual clock and
+  checks every transmitted minute with the reference receiver. Extra
+  transmitters given with --protocols run on their own LEDC channels and are
+  checked with the loopback receiver in timecode_receiver.h.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -Ihost/stubs -I. -o dcf77_sim host/dcf77_sim.cpp \
+        host/stubs/host_env.cpp esphome/components/dcf77_emitter/dcf77_emitter.cpp
+
+  Add -DDCF77_PROFILING to print the component's profiling probes at exit,
+  and -DDCF77_GPS for the GPS options.
+
+  Usage:
+    dcf77_sim [--days=N] [--start=EPOCH] [--tz=POSIX_TZ] [--seed=N]
+              [--loop-latency-us=N] [--timer-latency-us=N] [--log-level=N]
+              [--protocols=msf,wwvb,jjy40,jjy60] [--led-pin=N] [--ppm=N] [--ppm-swing=N]
+              [--source=NAME,INTERVAL_S,RESOLUTION_MS,JITTER_MS[,STOP_H[,START_H]]]...
+              [--gps=PPS_JITTER_US,DROPOUT[,STOP_H[,START_H]]] [--nmea=FILE] [--no-pps]
+
+  Latencies are drawn uniformly from [0, N] for every main loop wake-up and
+  every esp_timer dispatch. The component's ticks are scheduler timeouts in
+  the main loop, so only the loop latency delays its edges. The exit status
+  is non-zero when any minute after the receiver's first lock decodes to a
+  wrong time, or fails to decode other than by the tick watchdog's blanking
+  (one minute per blank), on any channel, or when the component's own
+  decoder of its edges (integrity_monitor.h) finds a minute other than the
+  one intended. It is also non-zero when a second within two minutes of a
+  change of the selected source is longer or shorter than the slew rate, the
+  scheduler, the oscillator and the loop latency allow; when, with --source
+  or --gps, the clock error exceeds CONVERGED_PPS_US plus three times the
+  PPS jitter (with PPS) or CONVERGED_US plus half the resolution of sources
+  truncated to whole seconds, once a source has been selected for an hour;
+  or when the actual error in holdover exceeds the estimate the component
+  reports.
+
+  --ppm makes the local oscillator run fast (or slow, if negative), and
+  --ppm-swing adds a daily sine of that amplitude, as from room temperature.
+  Each --source adds a time source to the component's list. It sets the
+  system clock every INTERVAL_S seconds to the true time plus Gaussian
+  jitter, truncated to RESOLUTION_MS, from START_H until STOP_H hours into
+  the run. Without --source or --gps the component has one exact source
+  that never synchronises after boot.
+
+  --gps connects a GPS receiver (gps_replay.h). Its PPS pulse fires at every
+  true second with Gaussian jitter, followed 100-150 ms later by the RMC
+  sentence on the UART. Each pulse and each sentence is lost with
+  probability DROPOUT. --nmea replays a log instead of synthesising the
+  sentences: the run starts 10 s before the log's first fix and the GPS
+  stops after its last. --no-pps leaves the PPS pin unconnected.
+
+  The report shows the selected source over time, how far each second's
+  length deviated from 1 s and the error of the component's disciplined
+  clock against true time over the run, with the estimated error at the
+  end.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dcf77_decoder.h"
+#include "gps_replay.h"
+#include "esphome/components/dcf77_emitter/dcf77_emitter.h"
+#include "esphome/components/dcf77_emitter/dcf77_probe.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "esphome/core/log.h"
+#include "host_env.h"
+#include "timecode_receiver.h"
+#include "tool_args.h"
+
+namespace {
+
+// Bounds on the clock error against true time once a source has been
+// selected for CONVERGENCE_US
+const int64_t CONVERGENCE_US = 3600000000LL;
+const double CONVERGED_PPS_US = 3;  // plus three times the PPS jitter
+const double CONVERGED_US = 100000;
+// Sources truncated to whole seconds may also be off by half their step
+const uint32_t WHOLE_SECOND_US = 1000000;
+// Seconds this close to a logged change of the selected source are checked
+// against the slew rate; the change is logged up to a minute late
+const int64_t SELECTION_WINDOW_US = 120000000;
+// Ticks are scheduler timeouts in whole milliseconds
+const int64_t SCHEDULER_RESOLUTION_US = 1000;
+
+// A time source that synchronises the system clock periodically.
+struct SourceModel {
+  std::string name;
+  int64_t interval_us;
+  uint32_t resolution_us;
+  double jitter_us;
+  int64_t start_us;
+  int64_t stop_us;
+  int64_t next_us;
+  int64_t syncs;
+  esphome::time::RealTimeClock clock;
+};
+
+struct Options {
+  double days{2.0};
+  // 2024-10-26 21:00 UTC, a few hours before the EU switch back to CET.
+  int64_t start_epoch{1729976400};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  uint32_t seed{1};
+  uint32_t loop_latency_us{0};
+  uint32_t timer_latency_us{0};
+  int log_level{ESPHOME_LOG_LEVEL_WARN};
+  std::vector<dcf77::Protocol> protocols;
+  int led_pin{2};  // -1 for none
+  double ppm{0};
+  double ppm_swing{0};
+  std::vector<SourceModel> sources;
+  // GPS receiver
+  bool gps{false};
+  double pps_jitter_us{0};
+  double gps_dropout{0};
+  int64_t gps_start_us{0};
+  int64_t gps_stop_us{INT64_MAX};
+  std::string nmea_file;
+  bool pps{true};
+};
+
+bool parse_source(const std::string &value, std::vector<SourceModel> *sources) {
+  const size_t comma = value.find(',');
+  const std::vector<double> numbers = host::parse_list(comma == std::string::npos ? "" : value.substr(comma + 1));
+  if (comma == 0 || numbers.size() < 3 || numbers[0] <= 0 || numbers[1] < 0 || numbers[2] < 0) {
+    fprintf(stderr, "--source=NAME,INTERVAL_S,RESOLUTION_MS,JITTER_MS[,STOP_H[,START_H]]: %s\n", value.c_str());
+    return false;
+  }
+  const int64_t start_us = numbers.size() > 4 ? static_cast<int64_t>(numbers[4] * 3600e6) : 0;
+  // Sources start a few seconds apart
+  const int64_t offset_us = 2000000 + static_cast<int64_t>(sources->size()) * 7000000;
+  sources->push_back(SourceModel{value.substr(0, comma), static_cast<int64_t>(numbers[0] * 1e6),
+                                 static_cast<uint32_t>(numbers[1] * 1000), numbers[2] * 1000, start_us,
+                                 numbers.size() > 3 ? static_cast<int64_t>(numbers[3] * 3600e6) : INT64_MAX,
+                                 start_us + offset_us, 0, {}});
+  return true;
+}
+
+#ifdef DCF77_GPS
+bool parse_gps(const std::string &value, Options *options) {
+  const std::vector<double> numbers = host::parse_list(value);
+  if (numbers.size() < 2 || numbers[0] < 0 || numbers[1] < 0 || numbers[1] > 1) {
+    fprintf(stderr, "--gps=PPS_JITTER_US,DROPOUT[,STOP_H[,START_H]]: %s\n", value.c_str());
+    return false;
+  }
+  options->gps = true;
+  options->pps_jitter_us = numbers[0];
+  options->gps_dropout = numbers[1];
+  if (numbers.size() > 2)
+    options->gps_stop_us = static_cast<int64_t>(numbers[2] * 3600e6);
+  if (numbers.size() > 3)
+    options->gps_start_us = static_cast<int64_t>(numbers[3] * 3600e6);
+  return true;
+}
+#endif
+
+bool parse_protocols(const std::string &value, std::vector<dcf77::Protocol> *protocols) {
+  size_t begin = 0;
+  while (begin < value.size()) {
+    size_t end = value.find(',', begin);
+    if (end == std::string::npos)
+      end = value.size();
+    const std::string name = value.substr(begin, end - begin);
+    if (name == "msf") {
+      protocols->push_back(dcf77::Protocol::MSF);
+    } else if (name == "wwvb") {
+      protocols->push_back(dcf77::Protocol::WWVB);
+    } else if (name == "jjy40") {
+      protocols->push_back(dcf77::Protocol::JJY40);
+    } else if (name == "jjy60") {
+      protocols->push_back(dcf77::Protocol::JJY60);
+    } else {
+      fprintf(stderr, "unknown protocol: %s\n", name.c_str());
+      return false;
+    }
+    begin = end + 1;
+  }
+  return true;
+}
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--days", &value)) {
+      options->days = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--start", &value)) {
+      options->start_epoch = strtoll(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--seed", &value)) {
+      options->seed = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--loop-latency-us", &value)) {
+      options->loop_latency_us = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--timer-latency-us", &value)) {
+      options->timer_latency_us = strtoul(value.c_str(), nullptr, 10);
+    } else if (parse_option(argv[i], "--log-level", &value)) {
+      options->log_level = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--led-pin", &value)) {
+      options->led_pin = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--protocols", &value)) {
+      if (!parse_protocols(value, &options->protocols))
+        return false;
+    } else if (parse_option(argv[i], "--ppm", &value)) {
+      options->ppm = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--ppm-swing", &value)) {
+      options->ppm_swing = strtod(value.c_str(), nullptr);
+    } else if (parse_option(argv[i], "--source", &value)) {
+      if (!parse_source(value, &options->sources))
+        return false;
+#ifdef DCF77_GPS
+    } else if (parse_option(argv[i], "--gps", &value)) {
+      if (!parse_gps(value, options))
+        return false;
+    } else if (parse_option(argv[i], "--nmea", &value)) {
+      options->nmea_file = value;
+    } else if (strcmp(argv[i], "--no-pps") == 0) {
+      options->pps = false;
+#endif
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (!options->nmea_file.empty() && !options->gps) {
+    fprintf(stderr, "--nmea needs --gps\n");
+    return false;
+  }
+  return options->days > 0 && options->protocols.size() <= 7;
+}
+
+struct Stat {
+  int64_t count{0};
+  int64_t min{INT64_MAX};
+  int64_t max{INT64_MIN};
+  int64_t sum{0};
+
+  void add(int64_t v) {
+    count++;
+    min = std::min(min, v);
+    max = std::max(max, v);
+    sum += v;
+  }
+  void print(const char *label) const {
+    if (count == 0) {
+      printf("  %-26s n=0\n", label);
+      return;
+    }
+    printf("  %-26s n=%-8" PRId64 " min=%7.2f avg=%7.2f max=%7.2f ms\n", label, count, min / 1e3,
+           static_cast<double>(sum) / count / 1e3, max / 1e3);
+  }
+};
+
+// Results of one extra transmitter channel.
+struct Channel {
+  explicit Channel(dcf77::Protocol protocol) : protocol(protocol), receiver(protocol) {}
+
+  dcf77::Protocol protocol;
+  host::TimeCodeReceiver receiver;
+  int64_t minutes{0};
+  int64_t decoded_ok{0};
+  int64_t wrong_time{0};
+  std::map<std::string, int64_t> failures;
+};
+
+void print_time(const host::Dcf77Time &t) {
+  printf("20%02d-%02d-%02d %02d:%02d dow=%d %s", t.year, t.month, t.day, t.hour, t.minute, t.day_of_week,
+         t.dst ? "DST" : "STD");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+
+  host::NmeaLog nmea_log;
+  if (!options.nmea_file.empty()) {
+    std::string error;
+    if (!nmea_log.load(options.nmea_file, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 2;
+    }
+    options.start_epoch = nmea_log.first_second() - 10;
+    options.gps_stop_us = std::min(options.gps_stop_us, (nmea_log.last_second() + 1 - options.start_epoch) * 1000000);
+  }
+  const bool track_clock = !options.sources.empty() || options.gps;
+
+  std::mt19937 rng(options.seed);
+  host::set_log_level(options.log_level);
+  host::reset(options.start_epoch * 1000000, options.tz.c_str());
+  host::set_oscillator_ppm(options.ppm, options.ppm_swing);
+  // With sources the system clock is unset until the first one synchronises
+  host::set_time_valid(!track_clock);
+
+  host::LoopModel model;
+  if (options.loop_latency_us > 0)
+    model.loop_latency_us = [&rng, &options]() {
+      return std::uniform_int_distribution<uint32_t>(0, options.loop_latency_us)(rng);
+    };
+  if (options.timer_latency_us > 0)
+    model.timer_latency_us = [&rng, &options]() {
+      return std::uniform_int_distribution<uint32_t>(0, options.timer_latency_us)(rng);
+    };
+  host::set_loop_model(model);
+
+  std::vector<std::string> selections;
+  std::vector<int64_t> selection_changes_us;
+  host::set_log_sink([&selections, &selection_changes_us](int level, const char *tag, const char *message) {
+    if (strncmp(message, "Time source: ", 13) != 0)
+      return;
+    selection_changes_us.push_back(host::now_us());
+    if (selections.size() < 20) {
+      char line[96];
+      snprintf(line, sizeof(line), "%9.3f h  %s", host::now_us() / 3600e6, message + 13);
+      selections.push_back(line);
+    }
+  });
+
+  host::Dcf77Receiver receiver;
+  Stat zero_width, one_width, phase, spacing;
+  // Every second's length, for the check around selection changes
+  std::vector<std::pair<int64_t, int64_t>> seconds;
+  int64_t fall_us = -1;
+  // Channel i + 1 carries protocols[i]
+  std::vector<Channel> channels(options.protocols.begin(), options.protocols.end());
+  for (auto &channel : channels) {
+    channel.receiver.set_callback([&options, &channel](const host::TimeCodeResult &result) {
+      channel.minutes++;
+      if (result.error != nullptr) {
+        channel.failures[result.error]++;
+        return;
+      }
+      const int64_t epoch_us = host::epoch_at(result.start_us);
+      const dcf77::TimeCodeMinute expected =
+          host::expected_time_code(channel.protocol, (epoch_us + 30000000) / 60000000);
+      const dcf77::TimeCodeFrame frame = dcf77::encode_time_code(channel.protocol, expected);
+      if (result.frame.a == frame.a && result.frame.b == frame.b) {
+        channel.decoded_ok++;
+      } else if (channel.wrong_time++ < 10) {
+        printf("  %s mismatch at t=%.3f s: got %016" PRIx64 "/%016" PRIx64 ", expected %016" PRIx64
+               "/%016" PRIx64 "\n",
+               dcf77::protocol_name(channel.protocol), result.start_us / 1e6, result.frame.a, result.frame.b,
+               frame.a, frame.b);
+      }
+    });
+  }
+
+  host::set_edge_sink([&](const host::Edge &edge) {
+    if (edge.source != host::EdgeSource::CARRIER)
+      return;
+    if (edge.id != LEDC_CHANNEL_0) {
+      if (edge.id <= channels.size())
+        channels[edge.id - 1].receiver.feed(edge.t_us, edge.level != 0);
+      return;
+    }
+    bool on = edge.level != 0;
+    if (!on) {
+      // Consecutive seconds; the length is in true time
+      if (fall_us >= 0 && edge.t_us - fall_us < 1500000) {
+        const int64_t length = host::epoch_at(edge.t_us) - host::epoch_at(fall_us) - 1000000;
+        spacing.add(length);
+        if (track_clock)
+          seconds.emplace_back(edge.t_us, length);
+      }
+      fall_us = edge.t_us;
+      phase.add((host::epoch_at(edge.t_us) % 1000000 + 1500000) % 1000000 - 500000);
+    } else if (fall_us >= 0) {
+      int64_t width = edge.t_us - fall_us;
+      (width < 150000 ? zero_width : one_width).add(width);
+    }
+    receiver.feed(edge.t_us, on);
+  });
+
+  int64_t markers = 0, decoded_ok = 0, wrong_time = 0, undecodable = 0;
+  std::map<std::string, int64_t> failures;
+  int reported = 0;
+  receiver.set_callback([&](const host::Dcf77Minute &minute) {
+    markers++;
+    if (minute.error != nullptr) {
+      undecodable++;
+      failures[minute.error]++;
+      return;
+    }
+    int64_t epoch_us = host::epoch_at(minute.marker_us);
+    host::Dcf77Time expected = host::dcf77_expected_time((epoch_us + 30000000) / 60000000);
+    if (minute.time == expected) {
+      decoded_ok++;
+      return;
+    }
+    wrong_time++;
+    if (reported++ < 10) {
+      printf("  mismatch at t=%.3f s: got ", minute.marker_us / 1e6);
+      print_time(minute.time);
+      printf(", expected ");
+      print_time(expected);
+      printf("\n");
+    }
+  });
+
+  esphome::time::RealTimeClock rtc;
+  esphome::switch_::Switch sync_switch;
+  sync_switch.publish_state(true);
+  host::RecordingPin antenna_pin(18);
+  host::RecordingPin led_pin(static_cast<uint8_t>(options.led_pin));
+
+  esphome::sensor::Sensor time_error;
+  esphome::text_sensor::TextSensor time_source;
+
+  esphome::uart::UARTComponent gps_uart;
+  host::RecordingPin pps_pin(4);
+
+  esphome::dcf77_emitter::DCF77Emitter emitter;
+  if (!track_clock)
+    emitter.set_time_id(&rtc);
+  for (auto &source : options.sources)
+    emitter.add_time_source(&source.clock, source.name.c_str(), source.resolution_us);
+#ifdef DCF77_GPS
+  if (options.gps) {
+    emitter.set_gps_uart(&gps_uart);
+    if (options.pps)
+      emitter.set_gps_pps_pin(&pps_pin);
+  }
+#endif
+  emitter.set_time_error_sensor(&time_error);
+  emitter.set_time_source_sensor(&time_source);
+  emitter.set_antenna_pin(&antenna_pin);
+  if (options.led_pin >= 0)
+    emitter.set_led_pin(&led_pin);
+  emitter.set_sync_switch(&sync_switch);
+  std::vector<std::unique_ptr<host::RecordingPin>> pins;
+  for (size_t i = 0; i < options.protocols.size(); i++) {
+    pins.emplace_back(new host::RecordingPin(static_cast<uint8_t>(19 + i)));
+    emitter.add_transmitter(options.protocols[i], pins.back().get());
+  }
+  host::add_component(&emitter);
+
+  const int64_t duration_us = static_cast<int64_t>(options.days * 86400e6);
+  // Error of the disciplined clock against true time, in buckets of whole
+  // hours, at most 24 of them
+  const int64_t bucket_us = std::max<int64_t>(1, (duration_us + 24 * 3600000000LL - 1) / (24 * 3600000000LL)) * 3600000000LL;
+  std::vector<Stat> clock_error((duration_us + bucket_us - 1) / bucket_us);
+  // Error once converged, with the bound of the selected source, and the
+  // seconds in holdover whose actual error exceeded the estimate
+  int64_t converged_seconds = 0;
+  double converged_error_us = 0, converged_bound_us = INFINITY;
+  int64_t holdover_seconds = 0, holdover_misses = 0;
+  double holdover_worst_us = 0, holdover_worst_estimate_us = 0;
+  int selected = -1;
+  int64_t selected_since_us = 0;
+  int64_t pulses = 0, bursts = 0;
+
+  // Timed actions in virtual time since boot; equal times run in insertion order
+  std::multimap<int64_t, std::function<void()>> events;
+  std::normal_distribution<double> gauss;
+  std::uniform_int_distribution<int64_t> within_second(0, 999999);
+  std::bernoulli_distribution dropped(options.gps_dropout);
+
+  std::function<void(SourceModel *)> schedule_sync = [&](SourceModel *source) {
+    if (source->next_us >= source->stop_us || source->next_us > duration_us)
+      return;
+    // Requests go out at any point within the second
+    events.emplace(source->next_us + within_second(rng), [&, source]() {
+      int64_t utc_us = host::epoch_us() + static_cast<int64_t>(gauss(rng) * source->jitter_us);
+      if (source->resolution_us > 0)
+        utc_us -= utc_us % source->resolution_us;
+      host::sync_time_source(&source->clock, utc_us, true);
+      source->syncs++;
+      source->next_us += source->interval_us;
+      schedule_sync(source);
+    });
+  };
+  for (auto &source : options.sources)
+    schedule_sync(&source);
+
+  // Every true second: sample the clock and, while the GPS runs, send its
+  // pulse and sentences
+  std::function<void(int64_t)> schedule_second = [&](int64_t second) {
+    const int64_t start_us = host::time_at_epoch(second * 1000000);
+    if (start_us > duration_us)
+      return;
+    events.emplace(start_us - 1000, [&, second, start_us]() {
+      const dcf77::TimeFusion &fusion = emitter.time_fusion();
+      if (fusion.valid()) {
+        const int64_t now_us = host::now_us();
+        const int64_t error_us = fusion.utc_us(now_us) - host::epoch_us();
+        clock_error[now_us / bucket_us].add(error_us);
+        const int current = fusion.selected(now_us);
+        if (current != selected) {
+          selected = current;
+          selected_since_us = now_us;
+        }
+        if (current < 0) {
+          // The reported time_error is error_us() of the minute it was published
+          const double estimate_us = fusion.error_us(now_us);
+          holdover_seconds++;
+          if (std::abs(error_us) > estimate_us) {
+            holdover_misses++;
+            if (std::abs(error_us) - estimate_us > holdover_worst_us - holdover_worst_estimate_us) {
+              holdover_worst_us = std::abs(error_us);
+              holdover_worst_estimate_us = estimate_us;
+            }
+          }
+        } else if (now_us - selected_since_us >= CONVERGENCE_US) {
+          const dcf77::TimeFusion::Source &source = fusion.sources()[current];
+          const bool pps = options.gps && options.pps && strcmp(source.name, "gps") == 0;
+          double bound_us = pps ? CONVERGED_PPS_US + 3 * options.pps_jitter_us : CONVERGED_US;
+          if (source.resolution_us >= WHOLE_SECOND_US)
+            bound_us += source.resolution_us / 2;
+          converged_seconds++;
+          if (std::abs(error_us) - bound_us > converged_error_us - converged_bound_us) {
+            converged_error_us = std::abs(error_us);
+            converged_bound_us = bound_us;
+          }
+        }
+      }
+      const std::string *burst = nullptr;
+      std::string synthetic;
+      if (options.gps && start_us >= options.gps_start_us && start_us < options.gps_stop_us) {
+        if (nmea_log.empty()) {
+          synthetic = host::nmea_rmc(second);
+          burst = &synthetic;
+        } else {
+          burst = nmea_log.burst(second);
+        }
+      }
+      if (burst != nullptr) {
+        if (options.pps && !dropped(rng)) {
+          const int64_t jitter_us = static_cast<int64_t>(gauss(rng) * options.pps_jitter_us);
+          events.emplace(std::max(host::now_us(), start_us + jitter_us), [&]() { pps_pin.interrupt(); });
+          pulses++;
+        }
+        if (!dropped(rng)) {
+          events.emplace(start_us + 100000 + within_second(rng) / 20,
+                         [&gps_uart, text = *burst]() { host::uart_receive(&gps_uart, text); });
+          bursts++;
+        }
+      }
+      schedule_second(second + 1);
+    });
+  };
+  if (track_clock)
+    schedule_second(options.start_epoch + 1);
+
+  auto wall_start = std::chrono::steady_clock::now();
+  while (!events.empty() && events.begin()->first <= duration_us) {
+    auto event = std::move(events.begin()->second);
+    host::run_until(events.begin()->first);
+    events.erase(events.begin());
+    event();
+  }
+  host::run_until(duration_us);
+  for (auto &channel : channels)
+    channel.receiver.advance(duration_us);
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+  printf("Simulated %.2f days in %.2f s (%.0fx real time)\n", options.days, wall_s, duration_us / 1e6 / wall_s);
+  printf("Minute markers: %" PRId64 ", decoded OK: %" PRId64 ", wrong time: %" PRId64 ", undecodable: %" PRId64
+         "\n",
+         markers, decoded_ok, wrong_time, undecodable);
+  for (const auto &failure : failures)
+    printf("  undecodable (%s): %" PRId64 "\n", failure.first.c_str(), failure.second);
+  printf("Receiver pulse errors: %u, spacing errors: %u\n", receiver.pulse_errors(), receiver.spacing_errors());
+  bool channels_ok = true;
+  for (const auto &channel : channels) {
+    printf("%s minutes: %" PRId64 ", decoded OK: %" PRId64 ", wrong time: %" PRId64 ", symbol errors: %u\n",
+           dcf77::protocol_name(channel.protocol), channel.minutes, channel.decoded_ok, channel.wrong_time,
+           channel.receiver.symbol_errors());
+    for (const auto &failure : channel.failures)
+      printf("  undecodable (%s): %" PRId64 "\n", failure.first.c_str(), failure.second);
+    channels_ok &= channel.minutes > 0 && channel.wrong_time == 0 &&
+                   channel.decoded_ok + emitter.tick_watchdog().blanks() >= channel.minutes;
+  }
+  zero_width.print("'0' pulse width");
+  one_width.print("'1' pulse width");
+  phase.print("pulse start after second");
+  spacing.print("second length - 1 s");
+  for (const auto &source : options.sources)
+    printf("Time source %s: %" PRId64 " synchronisations\n", source.name.c_str(), source.syncs);
+  if (options.gps)
+    printf("GPS: %" PRId64 " pulses, %" PRId64 " sentence bursts\n", pulses, bursts);
+  printf("Selected time source:\n");
+  for (const auto &line : selections)
+    printf("  %s\n", line.c_str());
+  if (track_clock) {
+    printf("Clock error against true time:\n");
+    for (size_t i = 0; i < clock_error.size(); i++) {
+      const Stat &e = clock_error[i];
+      if (e.count > 0)
+        printf("  %6.1f h  min=%10.1f avg=%10.1f max=%10.1f us\n", i * bucket_us / 3600e6, static_cast<double>(e.min),
+               static_cast<double>(e.sum) / e.count, static_cast<double>(e.max));
+    }
+  }
+  const dcf77::TimeFusion &fusion = emitter.time_fusion();
+  printf("Estimated time error at the end: %.3f ms, actual %.3f ms\n", time_error.state,
+         fusion.valid() ? (fusion.utc_us(host::now_us()) - host::epoch_us()) / 1e3 : 0.0);
+
+  // A second near a selection change may differ from 1 s by the slew, the
+  // scheduler's resolution, the oscillator and the latency of either of its
+  // edges
+  const int64_t slew_bound_us = dcf77::TimeFusion::MAX_SLEW_PPM + SCHEDULER_RESOLUTION_US +
+                                static_cast<int64_t>(std::abs(options.ppm) + std::abs(options.ppm_swing)) +
+                                options.loop_latency_us + 100;
+  int64_t slew_worst_us = 0;
+  for (const auto &second : seconds) {
+    for (int64_t change_us : selection_changes_us) {
+      if (std::abs(second.first - change_us) <= SELECTION_WINDOW_US) {
+        slew_worst_us = std::max(slew_worst_us, std::abs(second.second));
+        break;
+      }
+    }
+  }
+  const bool slew_ok = slew_worst_us <= slew_bound_us;
+  const bool converged_ok = converged_error_us <= converged_bound_us;
+  const bool holdover_ok = holdover_misses == 0;
+  if (track_clock) {
+    printf("Second length around %zu selection changes: max %.3f ms, bound %.3f ms%s\n",
+           selection_changes_us.size(), slew_worst_us / 1e3, slew_bound_us / 1e3, slew_ok ? "" : "  FAIL");
+    // The second closest to its bound, which depends on the selected source
+    if (converged_seconds > 0)
+      printf("Clock error after convergence: %" PRId64 " s, closest to the bound %.1f us of %.1f us%s\n",
+             converged_seconds, converged_error_us, converged_bound_us, converged_ok ? "" : "  FAIL");
+    printf("Holdover: %" PRId64 " s, actual error above the estimate in %" PRId64 " s", holdover_seconds,
+           holdover_misses);
+    if (!holdover_ok)
+      printf(" (worst %.3f ms against %.3f ms)  FAIL", holdover_worst_us / 1e3, holdover_worst_estimate_us / 1e3);
+    printf("\n");
+  }
+  const dcf77::TickWatchdog &watchdog = emitter.tick_watchdog();
+  printf("Tick stalls: %" PRIu32 " (late tick %" PRIu32 ", skipped ticks %" PRIu32 ", clock step %" PRIu32
+         "), blanked %" PRIu32 " times\n",
+         watchdog.total_stalls(), watchdog.stalls(dcf77::STALL_LATE_TICK),
+         watchdog.stalls(dcf77::STALL_SKIPPED_TICKS), watchdog.stalls(dcf77::STALL_CLOCK_STEP), watchdog.blanks());
+  const dcf77::IntegrityMonitor &integrity = emitter.integrity_monitor();
+  printf("Self-decode: %" PRIu32 " of %" PRIu32 " minutes correct; errors: %" PRIu32 " width, %" PRIu32
+         " spacing, %" PRIu32 " framing, %" PRIu32 " parity, %" PRIu32 " mismatch\n",
+         integrity.minutes_ok(), integrity.minutes_checked(),
+         integrity.errors(dcf77::IntegrityMonitor::ERROR_WIDTH),
+         integrity.errors(dcf77::IntegrityMonitor::ERROR_SPACING),
+         integrity.errors(dcf77::IntegrityMonitor::ERROR_FRAMING),
+         integrity.errors(dcf77::IntegrityMonitor::ERROR_PARITY),
+         integrity.errors(dcf77::IntegrityMonitor::ERROR_MISMATCH));
+  printf("Warnings: %u, errors: %u\n", host::log_count(ESPHOME_LOG_LEVEL_WARN),
+         host::log_count(ESPHOME_LOG_LEVEL_ERROR));
+#ifdef DCF77_PROFILING
+  printf("Profiling probes (host wall time):\n");
+  dcf77::probe::for_each([](const char *name, const char *unit, const dcf77::probe::Stats &s) {
+    printf("  %-26s n=%-8" PRIu32 " min=%-6" PRIu32 " avg=%-6" PRIu64 " max=%-6" PRIu32 " %s\n", name, s.count, s.min,
+           s.total / s.count, s.max, unit);
+  });
+#endif
+
+  // Each blank costs the receiver the minute it started in. The on-device
+  // decoder must agree that every minute it checked is the intended one.
+  return (markers > 0 && wrong_time == 0 && undecodable <= watchdog.blanks() && channels_ok &&
+          integrity.minutes_checked() > 0 && integrity.minutes_ok() == integrity.minutes_checked() && slew_ok &&
+          converged_ok && holdover_ok)
+             ? 0
+             : 1;
+}
@@ -0,0 +1,298 @@
+/*
+  Soak simulation of the sketch's tick schedule (time_base.h).
+
+  Months of 100 ms ticks run on a virtual esp_timer whose crystal is off by
+  --ppm. Every tick runs late by a uniform callback latency of up to
+  --jitter-us and takes --work-us before it re-arms the timer, as DcfOut()
+  does. A tick is stalled by --stall-ms with probability 1/--stall-every.
+  The time base is anchored to true UTC (with a Gaussian NTP error of
+  --ntp-error-ms) at the start and, with --resync-h, at every such interval,
+  the way a wake from deep sleep anchors it again. The timer starts just
+  before its 32-bit microsecond count wraps, and a run of more than 50 days
+  also passes the wrap of a 32-bit millisecond count.
+
+  For every 30 days the report gives the ticks, the tenths skipped after
+  stalls, the lag of the edges behind their deadlines on the time base
+  (leaving out stalled ticks) and the error of the edges against true UTC.
+  Beside it runs a timer re-armed 100 ms after each tick ran, as with
+  millis() deltas, whose accumulated lag is shown for comparison. Once a day it also computes the deep sleep
+  to the next sync window from a random time outside the windows and checks
+  that the wake lands on the start of a window to the microsecond.
+
+  The tool exits non-zero if the mean lag of any 30 days differs from the
+  first by more than a microsecond, if a tenth is skipped without a stall,
+  or if a wake misses its window start.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -I. -o dcf77_soak host/dcf77_soak.cpp
+
+  Usage:
+    dcf77_soak [--days=180] [--ppm=20] [--jitter-us=50] [--work-us=30]
+               [--stall-every=N] [--stall-ms=250] [--resync-h=H]
+               [--ntp-error-ms=5] [--tz=POSIX_TZ] [--seed=N]
+*/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sync_schedule.h"
+#include "time_base.h"
+#include "tool_args.h"
+
+namespace {
+
+struct Options {
+  double days{180};
+  double ppm{20};
+  int64_t jitter_us{50};
+  int64_t work_us{30};
+  int64_t stall_every{0};
+  int64_t stall_ms{250};
+  double resync_h{0};
+  double ntp_error_ms{5};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  uint64_t seed{1};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--days", &value)) {
+      options->days = atof(value.c_str());
+    } else if (parse_option(argv[i], "--ppm", &value)) {
+      options->ppm = atof(value.c_str());
+    } else if (parse_option(argv[i], "--jitter-us", &value)) {
+      options->jitter_us = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--work-us", &value)) {
+      options->work_us = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--stall-every", &value)) {
+      options->stall_every = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--stall-ms", &value)) {
+      options->stall_ms = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--resync-h", &value)) {
+      options->resync_h = atof(value.c_str());
+    } else if (parse_option(argv[i], "--ntp-error-ms", &value)) {
+      options->ntp_error_ms = atof(value.c_str());
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--seed", &value)) {
+      options->seed = strtoull(value.c_str(), nullptr, 10);
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options->days <= 0 || options->jitter_us < 0 || options->work_us < 0 || options->stall_every < 0 ||
+      options->jitter_us + options->work_us >= tickPeriodUs - tickMarginUs) {
+    fprintf(stderr, "--days must be positive, and --jitter-us plus --work-us below %" PRId64 "\n",
+            tickPeriodUs - tickMarginUs);
+    return false;
+  }
+  return true;
+}
+
+// The sketch's sync windows
+const SyncWindow syncWindows[] = {
+    {0, 0}, {1, 30}, {2, 0}, {3, 0}, {4, 0}, {5, 0}, {6, 0}, {9, 30}, {17, 30},
+};
+const int numSyncWindows = sizeof(syncWindows) / sizeof(syncWindows[0]);
+
+const int64_t kPeriodDays = 30;
+const int64_t kDayUs = 86400 * 1000000LL;
+// The esp_timer count starts this close to the 32-bit microsecond wrap
+const int64_t kMonoStartUs = (1LL << 32) - 60 * 1000000LL;
+
+// The emitter's crystal: monotonic microseconds against true time
+struct Crystal {
+  int64_t mono0_us;
+  int64_t true0_us;
+  double rate;
+
+  int64_t mono_at(int64_t true_us) const { return mono0_us + std::llround((true_us - true0_us) * rate); }
+  int64_t true_at(int64_t mono_us) const { return true0_us + std::llround((mono_us - mono0_us) / rate); }
+};
+
+struct Period {
+  int64_t ticks = 0;
+  int64_t skipped = 0;
+  int64_t stalls = 0;
+  int64_t unstalled = 0;
+  double lag_sum_us = 0;        // without stalled ticks
+  int64_t lag_max_us = 0;
+  int64_t utc_error_max_us = 0;
+  int64_t relative_lag_us = 0;  // accumulated by relative re-arming at the end
+};
+
+// Sleeps to the next window from a random local time outside the windows
+// and checks the wake. Returns false if the wake misses a window start;
+// sets |across_dst| for a sleep over a change of the UTC offset, which
+// minute arithmetic cannot see.
+bool check_sleep(const TimeBase &base, int64_t mono_us, bool *across_dst) {
+  const int64_t wall_us = timeBaseWallUs(base, mono_us);
+  time_t second = static_cast<time_t>(wall_us / 1000000);
+  struct tm local;
+  localtime_r(&second, &local);
+  const int now_minutes = local.tm_hour * 60 + local.tm_min;
+  if (activeSyncWindow(syncWindows, numSyncWindows, now_minutes) >= 0)
+    return true;
+  const int64_t us_into_minute = local.tm_sec * 1000000LL + wall_us % 1000000;
+  const int64_t sleep_us = microsToNextSyncWindow(syncWindows, numSyncWindows, now_minutes, us_into_minute);
+  const int64_t wake_us = wall_us + sleep_us;
+  time_t wake_second = static_cast<time_t>(wake_us / 1000000);
+  struct tm wake;
+  localtime_r(&wake_second, &wake);
+  *across_dst = wake.tm_gmtoff != local.tm_gmtoff;
+  if (*across_dst)
+    return true;
+  return wake_us % 1000000 == 0 && wake.tm_sec == 0 &&
+         activeSyncWindow(syncWindows, numSyncWindows, wake.tm_hour * 60 + wake.tm_min) >= 0 &&
+         minutesToNextSyncWindow(syncWindows, numSyncWindows, wake.tm_hour * 60 + wake.tm_min) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  std::mt19937_64 rng(options.seed);
+  std::uniform_int_distribution<int64_t> jitter(0, options.jitter_us);
+  std::uniform_int_distribution<int64_t> stall(0, options.stall_every > 0 ? options.stall_every - 1 : 0);
+  std::uniform_int_distribution<int64_t> time_of_day(0, kDayUs - 1);
+  std::normal_distribution<double> ntp_error(0, options.ntp_error_ms * 1000);
+
+  const int64_t start_true_us = 1735689600LL * 1000000;  // 2025-01-01
+  const int64_t end_true_us = start_true_us + std::llround(options.days * kDayUs);
+  const int64_t resync_us = std::llround(options.resync_h * 3600e6);
+  const Crystal crystal = {kMonoStartUs, start_true_us, 1 + options.ppm * 1e-6};
+
+  TimeBase base = {};
+  auto anchor = [&](int64_t mono_us) {
+    timeBaseAnchor(base, mono_us, crystal.true_at(mono_us) + std::llround(ntp_error(rng)));
+  };
+  anchor(kMonoStartUs);
+
+  printf("Soak over %.0f days, %.1f ppm, latency up to %" PRId64 " us, %" PRId64 " us per tick", options.days,
+         options.ppm, options.jitter_us, options.work_us);
+  if (options.stall_every > 0)
+    printf(", a %" PRId64 " ms stall every %" PRId64 " ticks", options.stall_ms, options.stall_every);
+  if (resync_us > 0)
+    printf(", resync every %.1f h", options.resync_h);
+  printf("\n");
+
+  std::vector<Period> periods;
+  int64_t unstalled_skips = 0, sleeps = 0, sleeps_across_dst = 0, missed_wakes = 0;
+  bool passed_us_wrap = false, passed_ms_wrap = false;
+  // First tick: the start of the next second, as setup() arms it
+  int64_t tick = (tickIndex(base, kMonoStartUs) / 10 + 1) * 10;
+  int64_t due_us = tickDeadlineUs(base, tick);
+  int64_t last_tick = tick - 1;
+  // Relative re-arming: 100 ms after each tick ran
+  int64_t relative_due_us = due_us, relative_ticks = 0;
+  const int64_t relative_start_us = due_us;
+  int64_t next_resync_us = resync_us > 0 ? kMonoStartUs + resync_us : INT64_MAX;
+  int64_t next_sleep_check_us = kMonoStartUs + time_of_day(rng);
+
+  for (;;) {
+    // The timer fires
+    const bool stalled = options.stall_every > 0 && stall(rng) == 0;
+    const int64_t latency_us = jitter(rng) + (stalled ? options.stall_ms * 1000 : 0);
+    const int64_t run_us = due_us + latency_us;
+    if (crystal.true_at(run_us) >= end_true_us)
+      break;
+    const size_t index = static_cast<size_t>((crystal.true_at(run_us) - start_true_us) / (kPeriodDays * kDayUs));
+    if (index >= periods.size())
+      periods.resize(index + 1);
+    Period &period = periods[index];
+
+    // DcfOut(): the tenth served, its edge and the re-arm
+    tick = tickIndex(base, run_us);
+    const int64_t skipped = tick - last_tick - 1;
+    period.skipped += skipped;
+    period.stalls += stalled;
+    if (skipped != 0 && !stalled)
+      unstalled_skips++;
+    last_tick = tick;
+    const int64_t lag_us = run_us - tickDeadlineUs(base, tick);
+    period.ticks++;
+    if (!stalled) {
+      period.unstalled++;
+      period.lag_sum_us += lag_us;
+      period.lag_max_us = std::max(period.lag_max_us, lag_us);
+    }
+    period.utc_error_max_us =
+        std::max(period.utc_error_max_us, std::abs(crystal.true_at(run_us) - tick * tickPeriodUs));
+    passed_us_wrap |= run_us >= (1LL << 32);
+    passed_ms_wrap |= run_us / 1000 >= (1LL << 32);
+    due_us = run_us + options.work_us + tickDelayUs(base, tick + 1, run_us + options.work_us);
+
+    relative_due_us += tickPeriodUs + latency_us + options.work_us;
+    relative_ticks++;
+    period.relative_lag_us = relative_due_us - relative_start_us - relative_ticks * tickPeriodUs;
+
+    if (run_us >= next_sleep_check_us) {
+      bool across_dst = false;
+      const int64_t check_mono_us = run_us - run_us % kDayUs + time_of_day(rng);
+      if (!check_sleep(base, check_mono_us, &across_dst))
+        missed_wakes++;
+      sleeps++;
+      sleeps_across_dst += across_dst;
+      next_sleep_check_us += kDayUs;
+    }
+    if (run_us >= next_resync_us) {
+      // Woken from deep sleep: anchored again, the first tick at the next second
+      anchor(run_us);
+      tick = (tickIndex(base, run_us) / 10 + 1) * 10;
+      due_us = tickDeadlineUs(base, tick);
+      last_tick = tick - 1;
+      next_resync_us += resync_us;
+    }
+  }
+
+  printf("\n  Days     Ticks  Stalls  Skipped  Mean lag  Max lag  Max UTC error  Relative re-arm lag\n");
+  double first_mean_us = NAN;
+  bool drift = false;
+  for (size_t i = 0; i < periods.size(); i++) {
+    const Period &period = periods[i];
+    if (period.unstalled == 0)
+      continue;
+    const double mean_us = period.lag_sum_us / period.unstalled;
+    if (std::isnan(first_mean_us))
+      first_mean_us = mean_us;
+    drift |= std::abs(mean_us - first_mean_us) > 1.0;
+    printf("  %3zu-%-3zu %9" PRId64 "  %6" PRId64 "  %7" PRId64 "  %6.2f us  %4" PRId64 " us  %10.3f ms  %15.1f s\n",
+           i * kPeriodDays, std::min<int64_t>((i + 1) * kPeriodDays, std::ceil(options.days)), period.ticks, period.stalls, period.skipped, mean_us,
+           period.lag_max_us, period.utc_error_max_us / 1e3, period.relative_lag_us / 1e6);
+  }
+  printf("\nTimer passed the 32-bit microsecond wrap: %s, the 32-bit millisecond wrap: %s\n",
+         passed_us_wrap ? "yes" : "no", passed_ms_wrap ? "yes" : "no");
+  printf("Sleeps to the next window: %" PRId64 ", missed window starts: %" PRId64 ", across a DST change: %" PRId64
+         "\n",
+         sleeps, missed_wakes, sleeps_across_dst);
+
+  int status = 0;
+  if (drift) {
+    printf("FAIL: the mean edge lag drifts\n");
+    status = 1;
+  }
+  if (unstalled_skips > 0) {
+    printf("FAIL: %" PRId64 " tenths skipped without a stall\n", unstalled_skips);
+    status = 1;
+  }
+  if (missed_wakes > 0) {
+    printf("FAIL: %" PRId64 " wakes missed the start of a window\n", missed_wakes);
+    status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+// GPS receiver stand-in for the host tools: the NMEA sentences a receiver
+// sends after each second's PPS pulse, synthesised from the true time or
+// replayed from a log.
+//
+// A log is split into per-second bursts where the time of day in the
+// sentences (field 1 of GGA, RMC, ZDA, ...) changes; sentences without one
+// (GSA, GSV) stay in the burst they arrive in. Each burst is filed under
+// the UTC second that its RMC or ZDA names, read with the component's own
+// dcf77::NmeaTime. Bursts without a valid date and time, as before the
+// first fix, are dropped, since no second can be assigned to them.
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "esphome/components/dcf77_emitter/nmea.h"
+
+namespace host {
+
+/// "$|body|*hh" plus CR LF, with the checksum of |body|.
+inline std::string nmea_sentence(const std::string &body) {
+  uint8_t sum = 0;
+  for (char c : body)
+    sum ^= static_cast<uint8_t>(c);
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+  return "$" + body + tail;
+}
+
+/// RMC sentence with a fix for UTC second |epoch|.
+inline std::string nmea_rmc(int64_t epoch) {
+  const time_t t = static_cast<time_t>(epoch);
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char body[96];
+  snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.00,A,4807.0380,N,01131.0000,E,0.02,,%02d%02d%02d,,,A", tm.tm_hour,
+           tm.tm_min, tm.tm_sec, tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+  return nmea_sentence(body);
+}
+
+/// The bursts of an NMEA log by UTC second.
+class NmeaLog {
+ public:
+  bool load(const std::string &path, std::string *error) {
+    std::ifstream in(path);
+    if (!in) {
+      *error = path + ": cannot open";
+      return false;
+    }
+    std::string line, burst, time_of_day;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (line.empty() || line[0] != '$')
+        continue;
+      const std::string tod = time_of_day_(line);
+      if (!tod.empty() && tod != time_of_day) {
+        this->add_burst_(burst);
+        burst.clear();
+        time_of_day = tod;
+      }
+      burst += line + "\r\n";
+    }
+    this->add_burst_(burst);
+    if (this->bursts_.empty()) {
+      *error = path + ": no RMC or ZDA sentence with a valid time";
+      return false;
+    }
+    return true;
+  }
+
+  bool empty() const { return this->bursts_.empty(); }
+  int64_t first_second() const { return this->bursts_.begin()->first; }
+  int64_t last_second() const { return this->bursts_.rbegin()->first; }
+  size_t size() const { return this->bursts_.size(); }
+
+  /// Sentences sent after the pulse of |second|; null if the log has none.
+  const std::string *burst(int64_t second) const {
+    const auto it = this->bursts_.find(second);
+    return it == this->bursts_.end() ? nullptr : &it->second;
+  }
+
+ protected:
+  // hhmmss of field 1, empty if the sentence has no time there
+  static std::string time_of_day_(const std::string &line) {
+    const size_t comma = line.find(',');
+    if (comma == std::string::npos || line.size() < comma + 7)
+      return "";
+    for (size_t i = comma + 1; i < comma + 7; i++) {
+      if (line[i] < '0' || line[i] > '9')
+        return "";
+    }
+    return line.substr(comma + 1, 6);
+  }
+
+  void add_burst_(const std::string &burst) {
+    dcf77::NmeaTime nmea;
+    bool timed = false;
+    for (char c : burst)
+      timed |= nmea.feed(c);
+    if (timed && nmea.epoch_ms() % 1000 == 0)
+      this->bursts_[nmea.epoch_ms() / 1000] += burst;
+  }
+
+  std::map<int64_t, std::string> bursts_;
+};
+
+}  // namespace host
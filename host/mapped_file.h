@@ -0,0 +1,88 @@
+#pragma once
+
+// Read-only memory mapping of a capture file for the host tools.
+//
+// Captures can be many gigabytes. The tools walk them front to back and call
+// release() on the part they are done with, which drops those pages from the
+// process again, so resident memory stays bounded by the chunk size rather
+// than the file size.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace host {
+
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { this->close(); }
+
+  /// Maps |path|. Returns false and sets error() on failure.
+  bool open(const std::string &path) {
+    this->close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return this->fail_(path);
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      return this->fail_(path);
+    }
+    this->size_ = static_cast<size_t>(st.st_size);
+    if (this->size_ > 0) {
+      void *data = mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        this->size_ = 0;
+        return this->fail_(path);
+      }
+      this->data_ = static_cast<const uint8_t *>(data);
+      madvise(data, this->size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+    return true;
+  }
+
+  void close() {
+    if (this->data_ != nullptr)
+      munmap(const_cast<uint8_t *>(this->data_), this->size_);
+    this->data_ = nullptr;
+    this->size_ = 0;
+  }
+
+  const uint8_t *data() const { return this->data_; }
+  size_t size() const { return this->size_; }
+  const std::string &error() const { return this->error_; }
+
+  /// Drops the whole pages inside [offset, offset + length) from memory. The
+  /// data stays readable; it is paged in again if touched.
+  void release(size_t offset, size_t length) {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + length, this->size_) / page * page;
+    if (this->data_ != nullptr && end > begin)
+      madvise(const_cast<uint8_t *>(this->data_) + begin, end - begin, MADV_DONTNEED);
+  }
+
+ protected:
+  bool fail_(const std::string &path) {
+    this->error_ = path + ": " + strerror(errno);
+    return false;
+  }
+
+  const uint8_t *data_{nullptr};
+  size_t size_{0};
+  std::string error_;
+};
+
+}  // namespace host
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_attr.h. The host has no RTC memory, so
+// variables placed there are ordinary globals.
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_idf_version.h. The stubs follow the
+// 5.1 driver and HAL signatures.
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(5, 1, 4)
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_log.h. The component logs through the
+// ESPHome macros, which esphome/core/log.h provides.
+
+#include "esphome/core/log.h"
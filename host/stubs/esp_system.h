@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_system.h.
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+void esp_restart();
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
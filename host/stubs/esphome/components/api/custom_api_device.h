@@ -0,0 +1,59 @@
+#pragma once
+
+// Host stand-in for esphome/components/api/custom_api_device.h. Services a
+// component registers are called by name with host::call_service(); events
+// it fires go to the sink set with host::set_event_sink(). Arguments travel
+// as strings, as they do in Home Assistant templates.
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace host {
+using ServiceArgs = std::map<std::string, std::string>;
+void register_service(const std::string &name, std::function<void(const ServiceArgs &)> service);
+void fire_event(const std::string &name, const ServiceArgs &data);
+}  // namespace host
+
+namespace esphome {
+namespace api {
+
+class CustomAPIDevice {
+ public:
+  template <typename T, typename... Ts>
+  void register_service(void (T::*callback)(Ts...), const std::string &name,
+                        const std::array<std::string, sizeof...(Ts)> &arg_names) {
+    T *obj = static_cast<T *>(this);
+    host::register_service(name, [obj, callback, arg_names](const host::ServiceArgs &args) {
+      call_(obj, callback, arg_names, args, std::index_sequence_for<Ts...>{});
+    });
+  }
+
+  void fire_homeassistant_event(const std::string &event_name, const std::map<std::string, std::string> &data = {}) {
+    host::fire_event(event_name, data);
+  }
+
+ protected:
+  template <typename T, typename... Ts, size_t... Is>
+  static void call_(T *obj, void (T::*callback)(Ts...), const std::array<std::string, sizeof...(Ts)> &arg_names,
+                    const host::ServiceArgs &args, std::index_sequence<Is...>) {
+    (obj->*callback)(arg_<typename std::decay<Ts>::type>(args, arg_names[Is])...);
+  }
+
+  // Missing arguments read as empty or zero
+  template <typename A> static A arg_(const host::ServiceArgs &args, const std::string &name) {
+    const auto it = args.find(name);
+    return convert_(it == args.end() ? std::string() : it->second, static_cast<A *>(nullptr));
+  }
+  static std::string convert_(const std::string &value, std::string *) { return value; }
+  static int32_t convert_(const std::string &value, int32_t *) { return atoi(value.c_str()); }
+  static float convert_(const std::string &value, float *) { return strtof(value.c_str(), nullptr); }
+  static bool convert_(const std::string &value, bool *) { return value == "true"; }
+};
+
+}  // namespace api
+}  // namespace esphome
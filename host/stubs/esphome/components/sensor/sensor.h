@@ -0,0 +1,31 @@
+#pragma once
+
+// Host stand-in for esphome/components/sensor/sensor.h. publish_state()
+// only stores the value, for simulations to read back.
+
+#include "esphome/core/log.h"
+
+#define LOG_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) { \
+    ESP_LOGCONFIG(TAG, "%s%s", prefix, type); \
+  }
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    this->has_state_ = true;
+  }
+  bool has_state() const { return this->has_state_; }
+
+  float state{0};
+
+ protected:
+  bool has_state_{false};
+};
+
+}  // namespace sensor
+}  // namespace esphome
@@ -0,0 +1,27 @@
+#pragma once
+
+// Host stand-in for esphome/components/switch/switch.h.
+
+#include <string>
+
+namespace esphome {
+namespace switch_ {
+
+class Switch {
+ public:
+  virtual ~Switch() = default;
+
+  void turn_on() { this->write_state(true); }
+  void turn_off() { this->write_state(false); }
+  void toggle() { this->write_state(!this->state); }
+  void publish_state(bool state) { this->state = state; }
+
+  /// The current reported state of this switch.
+  bool state{false};
+
+ protected:
+  virtual void write_state(bool state) { this->publish_state(state); }
+};
+
+}  // namespace switch_
+}  // namespace esphome
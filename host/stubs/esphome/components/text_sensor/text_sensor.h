@@ -0,0 +1,32 @@
+#pragma once
+
+// Host stand-in for esphome/components/text_sensor/text_sensor.h.
+
+#include <string>
+
+#include "esphome/core/log.h"
+
+#define LOG_TEXT_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) { \
+    ESP_LOGCONFIG(TAG, "%s%s", prefix, type); \
+  }
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->has_state_ = true;
+  }
+  bool has_state() const { return this->has_state_; }
+
+  std::string state;
+
+ protected:
+  bool has_state_{false};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
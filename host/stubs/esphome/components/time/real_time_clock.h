@@ -0,0 +1,49 @@
+#pragma once
+
+// Host stand-in for esphome/components/time/real_time_clock.h. As on the
+// device, every RealTimeClock reads the one system clock, which runs on the
+// virtual local oscillator. host::sync_time_source() sets it as a source's
+// synchronize_epoch_() would; host::set_time_valid() simulates a time
+// source that has not synchronised yet or has been lost.
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/time.h"
+
+namespace esphome {
+namespace time {
+class RealTimeClock;
+}  // namespace time
+}  // namespace esphome
+
+namespace host {
+void sync_time_source(esphome::time::RealTimeClock *clock, int64_t utc_us, bool notify);
+}  // namespace host
+
+namespace esphome {
+namespace time {
+
+class RealTimeClock : public PollingComponent {
+ public:
+  void set_timezone(const std::string &tz) { this->timezone_ = tz; }
+  std::string get_timezone() { return this->timezone_; }
+
+  ESPTime now();
+  ESPTime utcnow();
+
+  void add_on_time_sync_callback(std::function<void()> &&callback) {
+    this->time_sync_callbacks_.push_back(std::move(callback));
+  }
+
+ protected:
+  friend void host::sync_time_source(RealTimeClock *clock, int64_t utc_us, bool notify);
+
+  std::string timezone_{};
+  std::vector<std::function<void()>> time_sync_callbacks_;
+};
+
+}  // namespace time
+}  // namespace esphome
@@ -0,0 +1,45 @@
+#pragma once
+
+// Host stand-in for esphome/components/uart/uart.h: the receive side only.
+// host::uart_receive() queues bytes as if they had arrived on the line.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+namespace esphome {
+namespace uart {
+class UARTComponent;
+}  // namespace uart
+}  // namespace esphome
+
+namespace host {
+void uart_receive(esphome::uart::UARTComponent *uart, const std::string &data);
+}  // namespace host
+
+namespace esphome {
+namespace uart {
+
+class UARTComponent {
+ public:
+  int available() { return static_cast<int>(this->rx_.size()); }
+  bool read_byte(uint8_t *data) { return this->read_array(data, 1); }
+  bool read_array(uint8_t *data, size_t len) {
+    if (this->rx_.size() < len)
+      return false;
+    for (size_t i = 0; i < len; i++) {
+      data[i] = this->rx_.front();
+      this->rx_.pop_front();
+    }
+    return true;
+  }
+
+ protected:
+  friend void host::uart_receive(UARTComponent *uart, const std::string &data);
+
+  std::deque<uint8_t> rx_;
+};
+
+}  // namespace uart
+}  // namespace esphome
@@ -0,0 +1,54 @@
+#pragma once
+
+// Host stand-in for esphome/core/application.h. The scheduler keeps the
+// millisecond deadline semantics of the real one; host::run_until() decides
+// when the main loop wakes up to service it. App is thread-local so that
+// independent simulations can run on parallel threads.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+class Scheduler {
+ public:
+  void set_timeout(Component *component, const std::string &name, uint32_t timeout, std::function<void()> func);
+  bool cancel_timeout(Component *component, const std::string &name);
+  void set_interval(Component *component, const std::string &name, uint32_t interval, std::function<void()> func);
+  bool cancel_interval(Component *component, const std::string &name);
+
+  /// Runs every item that is due at the current virtual time.
+  void call();
+  /// Milliseconds until the next item is due, or -1 if nothing is pending.
+  int64_t next_schedule_in() const;
+  void clear();
+
+ protected:
+  struct Item {
+    Component *component;
+    std::string name;
+    uint64_t next_execution_ms;
+    uint32_t interval;
+    bool is_interval;
+    uint64_t order;
+    std::function<void()> func;
+  };
+
+  bool cancel_(Component *component, const std::string &name, bool is_interval);
+
+  std::vector<Item> items_;
+  uint64_t order_{0};
+};
+
+class Application {
+ public:
+  Scheduler scheduler;
+};
+
+extern thread_local Application App;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace esphome
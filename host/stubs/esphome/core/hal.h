@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stand-in for esphome/core/hal.h. Time is read from the host virtual
+// clock, so a simulated day passes as fast as the code under test allows.
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "esphome/core/gpio.h"
+
+#define IRAM_ATTR
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+}  // namespace esphome
@@ -0,0 +1,46 @@
+#pragma once
+
+// Host stand-in for esphome/core/time.h. Conversions go through the host C
+// library, so POSIX TZ strings behave as they do with newlib on the device.
+
+#include <cstdint>
+#include <ctime>
+
+namespace esphome {
+
+struct ESPTime {
+  /// seconds after the minute [0-60]
+  uint8_t second;
+  /// minutes after the hour [0-59]
+  uint8_t minute;
+  /// hours since midnight [0-23]
+  uint8_t hour;
+  /// day of the week; sunday=1 [1-7]
+  uint8_t day_of_week;
+  /// day of the month [1-31]
+  uint8_t day_of_month;
+  /// day of the year [1-366]
+  uint16_t day_of_year;
+  /// month; january=1 [1-12]
+  uint8_t month;
+  /// year
+  uint16_t year;
+  /// daylight saving time flag
+  bool is_dst;
+  /// unix epoch time (seconds since UTC Midnight January 1, 1970)
+  time_t timestamp;
+
+  bool is_valid() const { return this->year >= 2019 && this->fields_in_range(); }
+
+  bool fields_in_range() const {
+    return this->second < 61 && this->minute < 60 && this->hour < 24 && this->day_of_week > 0 &&
+           this->day_of_week < 8 && this->day_of_month > 0 && this->day_of_month < 32 &&
+           this->day_of_year > 0 && this->day_of_year < 367 && this->month > 0 && this->month < 13;
+  }
+
+  static ESPTime from_c_tm(struct tm *c_tm, time_t c_time);
+  static ESPTime from_epoch_local(time_t epoch);
+  static ESPTime from_epoch_utc(time_t epoch);
+};
+
+}  // namespace esphome
@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's freertos/FreeRTOS.h: the basic types only.
+
+#include <cstdint>
+
+typedef uint8_t StackType_t;  // bytes, as on ESP-IDF
+typedef uint32_t UBaseType_t;
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's freertos/task.h. The host runs everything on
+// one thread and cannot measure stacks; the queries return fixed values.
+
+#include "FreeRTOS.h"
+
+struct tskTaskControlBlock;
+typedef tskTaskControlBlock *TaskHandle_t;
+
+/// Bytes of stack never used by |task| (nullptr: the calling task).
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
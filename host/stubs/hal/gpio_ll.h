@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's hal/gpio_ll.h. Level writes are reported to
+// the edge sink like RecordingPin writes.
+
+#include <cstdint>
+
+typedef struct gpio_dev_t gpio_dev_t;
+extern gpio_dev_t GPIO;
+
+void gpio_ll_set_level(gpio_dev_t *hw, uint32_t gpio_num, uint32_t level);
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's hal/ledc_ll.h, limited to the register-level
+// calls of the static-config output stage. The duty and the update use the
+// same channel state as the driver stubs in driver/ledc.h and report carrier
+// edges; the fade parameters and the output enable have no host effect.
+
+#include <cstdint>
+
+#include "driver/ledc.h"
+
+typedef struct ledc_dev_t ledc_dev_t;
+extern ledc_dev_t LEDC;
+
+void ledc_ll_set_duty_int_part(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                               uint32_t duty_val);
+inline void ledc_ll_set_duty_direction(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                                       ledc_duty_direction_t duty_direction) {}
+inline void ledc_ll_set_duty_num(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                                 uint32_t duty_num) {}
+inline void ledc_ll_set_duty_cycle(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                                   uint32_t duty_cycle) {}
+inline void ledc_ll_set_duty_scale(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                                   uint32_t duty_scale) {}
+inline void ledc_ll_set_sig_out_en(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                                   bool sig_out_en) {}
+inline void ledc_ll_set_duty_start(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                                   bool duty_start) {}
+void ledc_ll_ls_channel_update(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num);
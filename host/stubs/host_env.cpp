@@ -0,0 +1,616 @@
+#include "host_env.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "driver/ledc.h"
+#include "hal/gpio_ll.h"
+#include "hal/ledc_ll.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "esphome/components/time/real_time_clock.h"
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  uint64_t period_us;
+  int64_t due_us;       // nominal deadline
+  int64_t dispatch_us;  // deadline plus modelled task latency
+  bool armed;
+};
+
+namespace host {
+namespace {
+
+struct LedcChannel {
+  uint32_t duty;
+  uint32_t applied_duty;
+  ledc_timer_t timer;
+};
+
+struct State {
+  int64_t now_us{0};
+  int64_t boot_epoch_us{0};
+  bool time_valid{true};
+  double oscillator_ppm{0};
+  double oscillator_swing_ppm{0};
+  // The system clock read |system_anchor_utc_us| at local time |system_anchor_us|
+  int64_t system_anchor_us{0};
+  int64_t system_anchor_utc_us{0};
+  LoopModel loop_model{};
+
+  std::vector<esphome::Component *> components;
+  bool components_set_up{false};
+  uint64_t last_loop_ms{0};
+  bool app_wake_valid{false};
+  int64_t app_wake_us{0};
+
+  std::vector<std::unique_ptr<esp_timer>> timers;
+
+  LedcChannel ledc[LEDC_CHANNEL_MAX]{};
+  uint32_t ledc_freq[LEDC_TIMER_MAX]{};
+
+  std::function<void(const Edge &)> edge_sink;
+  std::function<void(int, const char *, const char *)> log_sink;
+  int log_level{ESPHOME_LOG_LEVEL_WARN};
+  uint32_t log_counts[ESPHOME_LOG_LEVEL_VERY_VERBOSE + 1]{};
+
+  time_t cached_epoch{-1};
+  esphome::ESPTime cached_local{};
+
+  std::map<std::string, std::function<void(const ServiceArgs &)>> services;
+  std::function<void(const std::string &, const ServiceArgs &)> event_sink;
+};
+
+// Thread-local so independent simulations can run on parallel threads.
+State &state() {
+  static thread_local State s;
+  return s;
+}
+
+uint32_t sample(const LatencyFn &fn) { return fn ? fn() : 0; }
+
+void emit_edge(EdgeSource source, uint8_t id, uint32_t level) {
+  auto &s = state();
+  if (s.edge_sink)
+    s.edge_sink(Edge{s.now_us, source, id, level});
+}
+
+int64_t app_wake_us() {
+  auto &s = state();
+  if (!s.app_wake_valid) {
+    uint64_t due_ms = s.last_loop_ms + s.loop_model.loop_interval_ms;
+    int64_t next = esphome::App.scheduler.next_schedule_in();
+    if (next >= 0)
+      due_ms = std::min<uint64_t>(due_ms, s.now_us / 1000 + next);
+    int64_t due_us = std::max<int64_t>(s.now_us, static_cast<int64_t>(due_ms) * 1000);
+    s.app_wake_us = due_us + sample(s.loop_model.loop_latency_us);
+    s.app_wake_valid = true;
+  }
+  return s.app_wake_us;
+}
+
+void run_app_iteration() {
+  auto &s = state();
+  s.last_loop_ms = s.now_us / 1000;
+  esphome::App.scheduler.call();
+  for (auto *component : s.components) {
+    // As in ESPHome, failed components no longer loop
+    if (!component->is_failed())
+      component->loop();
+  }
+  s.app_wake_valid = false;
+}
+
+void fire_timer(esp_timer *timer) {
+  auto &s = state();
+  if (timer->period_us != 0) {
+    timer->due_us += timer->period_us;
+    timer->dispatch_us = std::max(timer->due_us, s.now_us) + sample(s.loop_model.timer_latency_us);
+  } else {
+    timer->armed = false;
+  }
+  timer->callback(timer->arg);
+}
+
+}  // namespace
+
+void reset(int64_t boot_epoch_us, const char *tz) {
+  auto &s = state();
+  auto edge_sink = std::move(s.edge_sink);
+  auto log_sink = std::move(s.log_sink);
+  auto event_sink = std::move(s.event_sink);
+  int log_level = s.log_level;
+  s = State();
+  s.edge_sink = std::move(edge_sink);
+  s.log_sink = std::move(log_sink);
+  s.event_sink = std::move(event_sink);
+  s.log_level = log_level;
+  s.boot_epoch_us = boot_epoch_us;
+  s.system_anchor_utc_us = boot_epoch_us;
+  esphome::App.scheduler.clear();
+  const char *current = getenv("TZ");
+  if (current == nullptr || strcmp(current, tz) != 0) {
+    setenv("TZ", tz, 1);
+    tzset();
+  }
+}
+
+void set_loop_model(const LoopModel &model) {
+  state().loop_model = model;
+  state().app_wake_valid = false;
+}
+
+void set_edge_sink(std::function<void(const Edge &)> sink) { state().edge_sink = std::move(sink); }
+
+void set_log_sink(std::function<void(int, const char *, const char *)> sink) {
+  state().log_sink = std::move(sink);
+}
+
+void set_log_level(int level) { state().log_level = level; }
+
+uint32_t log_count(int level) {
+  if (level < 0 || level > ESPHOME_LOG_LEVEL_VERY_VERBOSE)
+    return 0;
+  return state().log_counts[level];
+}
+
+void set_time_valid(bool valid) { state().time_valid = valid; }
+
+void set_oscillator_ppm(double ppm, double daily_swing_ppm) {
+  state().oscillator_ppm = ppm;
+  state().oscillator_swing_ppm = daily_swing_ppm;
+}
+
+void sync_time_source(esphome::time::RealTimeClock *clock, int64_t utc_us, bool notify) {
+  auto &s = state();
+  s.system_anchor_us = s.now_us;
+  s.system_anchor_utc_us = utc_us;
+  s.time_valid = true;
+  s.cached_epoch = -1;
+  if (notify) {
+    for (auto &callback : clock->time_sync_callbacks_)
+      callback();
+  }
+}
+
+void register_service(const std::string &name, std::function<void(const ServiceArgs &)> service) {
+  state().services[name] = std::move(service);
+}
+
+bool call_service(const std::string &name, const ServiceArgs &args) {
+  auto &services = state().services;
+  const auto it = services.find(name);
+  if (it == services.end())
+    return false;
+  it->second(args);
+  return true;
+}
+
+void set_event_sink(std::function<void(const std::string &, const ServiceArgs &)> sink) {
+  state().event_sink = std::move(sink);
+}
+
+void fire_event(const std::string &name, const ServiceArgs &data) {
+  auto &s = state();
+  if (s.event_sink)
+    s.event_sink(name, data);
+}
+
+void uart_receive(esphome::uart::UARTComponent *uart, const std::string &data) {
+  uart->rx_.insert(uart->rx_.end(), data.begin(), data.end());
+}
+
+int64_t now_us() { return state().now_us; }
+
+int64_t epoch_us() { return epoch_at(state().now_us); }
+
+// The oscillator gains the integral of its ppm over the time since boot
+int64_t epoch_at(int64_t t_us) {
+  auto &s = state();
+  double gained = t_us * s.oscillator_ppm;
+  if (s.oscillator_swing_ppm != 0) {
+    const double omega = 2 * M_PI / 86400e6;
+    gained += s.oscillator_swing_ppm / omega * (1 - std::cos(omega * t_us));
+  }
+  return s.boot_epoch_us + t_us - static_cast<int64_t>(gained / 1e6);
+}
+
+int64_t time_at_epoch(int64_t epoch_us) {
+  // epoch_at() has a slope within a few ppm of 1
+  int64_t t_us = epoch_us - state().boot_epoch_us;
+  for (int i = 0; i < 4; i++)
+    t_us += epoch_us - epoch_at(t_us);
+  return t_us;
+}
+
+int64_t system_us() {
+  auto &s = state();
+  return s.system_anchor_utc_us + s.now_us - s.system_anchor_us;
+}
+
+void add_component(esphome::Component *component) {
+  auto &s = state();
+  s.components.push_back(component);
+  s.components_set_up = false;
+}
+
+void run_until(int64_t t_us) {
+  auto &s = state();
+  if (!s.components_set_up) {
+    std::stable_sort(s.components.begin(), s.components.end(),
+                     [](esphome::Component *a, esphome::Component *b) {
+                       return a->get_setup_priority() > b->get_setup_priority();
+                     });
+    for (auto *component : s.components)
+      component->setup();
+    s.components_set_up = true;
+    s.app_wake_valid = false;
+  }
+
+  for (;;) {
+    esp_timer *timer = nullptr;
+    int64_t timer_us = std::numeric_limits<int64_t>::max();
+    for (auto &t : s.timers) {
+      if (t->armed && t->dispatch_us < timer_us) {
+        timer = t.get();
+        timer_us = t->dispatch_us;
+      }
+    }
+    int64_t app_us = app_wake_us();
+    int64_t next_us = std::min(timer_us, app_us);
+    if (next_us > t_us) {
+      s.now_us = std::max(s.now_us, t_us);
+      return;
+    }
+    s.now_us = std::max(s.now_us, next_us);
+    if (timer != nullptr && timer_us <= app_us) {
+      fire_timer(timer);
+    } else {
+      run_app_iteration();
+    }
+  }
+}
+
+void RecordingPin::digital_write(bool value) {
+  if (value == this->level_)
+    return;
+  this->level_ = value;
+  emit_edge(EdgeSource::GPIO, this->pin_, value ? 1 : 0);
+}
+
+void log_message(int level, const char *tag, int line, const char *format, ...) {
+  auto &s = state();
+  if (level >= 0 && level <= ESPHOME_LOG_LEVEL_VERY_VERBOSE)
+    s.log_counts[level]++;
+  if (!s.log_sink && level > s.log_level)
+    return;
+
+  char message[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+  if (s.log_sink)
+    s.log_sink(level, tag, message);
+  if (level <= s.log_level) {
+    static const char *const LETTERS = "NEWICDVV";
+    fprintf(stderr, "[%10.3f][%c][%s:%d]: %s\n", s.now_us / 1e6, LETTERS[level], tag, line, message);
+  }
+}
+
+}  // namespace host
+
+// -----------------------------------------------------------------------------
+// ESPHome core
+// -----------------------------------------------------------------------------
+namespace esphome {
+
+namespace setup_priority {
+const float BUS = 1000.0f;
+const float IO = 900.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float PROCESSOR = 400.0f;
+const float WIFI = 250.0f;
+const float AFTER_WIFI = 200.0f;
+const float AFTER_CONNECTION = 100.0f;
+const float LATE = -100.0f;
+}  // namespace setup_priority
+
+thread_local Application App;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+uint32_t millis() { return static_cast<uint32_t>(host::now_us() / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(host::now_us()); }
+void delay(uint32_t ms) { host::state().now_us += static_cast<int64_t>(ms) * 1000; }
+void delayMicroseconds(uint32_t us) { host::state().now_us += us; }
+void yield() {}
+
+void Scheduler::set_timeout(Component *component, const std::string &name, uint32_t timeout,
+                            std::function<void()> func) {
+  this->cancel_(component, name, false);
+  this->items_.push_back(Item{component, name, static_cast<uint64_t>(host::now_us() / 1000) + timeout, timeout,
+                              false, this->order_++, std::move(func)});
+}
+
+bool Scheduler::cancel_timeout(Component *component, const std::string &name) {
+  return this->cancel_(component, name, false);
+}
+
+void Scheduler::set_interval(Component *component, const std::string &name, uint32_t interval,
+                             std::function<void()> func) {
+  this->cancel_(component, name, true);
+  this->items_.push_back(Item{component, name, static_cast<uint64_t>(host::now_us() / 1000) + interval, interval,
+                              true, this->order_++, std::move(func)});
+}
+
+bool Scheduler::cancel_interval(Component *component, const std::string &name) {
+  return this->cancel_(component, name, true);
+}
+
+bool Scheduler::cancel_(Component *component, const std::string &name, bool is_interval) {
+  auto it = std::remove_if(this->items_.begin(), this->items_.end(), [&](const Item &item) {
+    return item.component == component && item.is_interval == is_interval && item.name == name;
+  });
+  bool found = it != this->items_.end();
+  this->items_.erase(it, this->items_.end());
+  return found;
+}
+
+void Scheduler::call() {
+  const uint64_t now_ms = host::now_us() / 1000;
+  for (;;) {
+    auto due = this->items_.end();
+    for (auto it = this->items_.begin(); it != this->items_.end(); ++it) {
+      if (it->next_execution_ms > now_ms)
+        continue;
+      if (due == this->items_.end() || it->next_execution_ms < due->next_execution_ms ||
+          (it->next_execution_ms == due->next_execution_ms && it->order < due->order))
+        due = it;
+    }
+    if (due == this->items_.end())
+      return;
+
+    Item item = std::move(*due);
+    this->items_.erase(due);
+    if (item.is_interval) {
+      Item next = item;
+      next.next_execution_ms = now_ms + item.interval;
+      next.order = this->order_++;
+      this->items_.push_back(std::move(next));
+    }
+    item.func();
+  }
+}
+
+int64_t Scheduler::next_schedule_in() const {
+  if (this->items_.empty())
+    return -1;
+  uint64_t next = std::numeric_limits<uint64_t>::max();
+  for (const auto &item : this->items_)
+    next = std::min(next, item.next_execution_ms);
+  const uint64_t now_ms = host::now_us() / 1000;
+  return next > now_ms ? static_cast<int64_t>(next - now_ms) : 0;
+}
+
+void Scheduler::clear() {
+  this->items_.clear();
+  this->order_ = 0;
+}
+
+ESPTime ESPTime::from_c_tm(struct tm *c_tm, time_t c_time) {
+  ESPTime res{};
+  res.second = static_cast<uint8_t>(c_tm->tm_sec);
+  res.minute = static_cast<uint8_t>(c_tm->tm_min);
+  res.hour = static_cast<uint8_t>(c_tm->tm_hour);
+  res.day_of_week = static_cast<uint8_t>(c_tm->tm_wday + 1);
+  res.day_of_month = static_cast<uint8_t>(c_tm->tm_mday);
+  res.day_of_year = static_cast<uint16_t>(c_tm->tm_yday + 1);
+  res.month = static_cast<uint8_t>(c_tm->tm_mon + 1);
+  res.year = static_cast<uint16_t>(c_tm->tm_year + 1900);
+  res.is_dst = c_tm->tm_isdst != 0;
+  res.timestamp = c_time;
+  return res;
+}
+
+ESPTime ESPTime::from_epoch_local(time_t epoch) {
+  struct tm c_tm {};
+  localtime_r(&epoch, &c_tm);
+  return from_c_tm(&c_tm, epoch);
+}
+
+ESPTime ESPTime::from_epoch_utc(time_t epoch) {
+  struct tm c_tm {};
+  gmtime_r(&epoch, &c_tm);
+  return from_c_tm(&c_tm, epoch);
+}
+
+namespace time {
+
+ESPTime RealTimeClock::now() {
+  auto &s = host::state();
+  if (!s.time_valid)
+    return ESPTime{};
+  // SNTP and Home Assistant sources both update the system clock, which the
+  // real now() reads at whole-second resolution via ::time().
+  time_t epoch = static_cast<time_t>(host::system_us() / 1000000);
+  if (epoch != s.cached_epoch) {
+    s.cached_epoch = epoch;
+    s.cached_local = ESPTime::from_epoch_local(epoch);
+  }
+  return s.cached_local;
+}
+
+ESPTime RealTimeClock::utcnow() {
+  if (!host::state().time_valid)
+    return ESPTime{};
+  return ESPTime::from_epoch_utc(static_cast<time_t>(host::system_us() / 1000000));
+}
+
+}  // namespace time
+}  // namespace esphome
+
+// -----------------------------------------------------------------------------
+// ESP-IDF
+// -----------------------------------------------------------------------------
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+  if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr)
+    return ESP_ERR_INVALID_ARG;
+  auto timer = std::make_unique<esp_timer>();
+  timer->callback = create_args->callback;
+  timer->arg = create_args->arg;
+  timer->name = create_args->name;
+  *out_handle = timer.get();
+  host::state().timers.push_back(std::move(timer));
+  return ESP_OK;
+}
+
+static esp_err_t start_timer(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+  if (timer == nullptr)
+    return ESP_ERR_INVALID_ARG;
+  if (timer->armed)
+    return ESP_ERR_INVALID_STATE;
+  auto &s = host::state();
+  timer->period_us = period_us;
+  timer->due_us = s.now_us + static_cast<int64_t>(timeout_us);
+  timer->dispatch_us = timer->due_us + host::sample(s.loop_model.timer_latency_us);
+  timer->armed = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return start_timer(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  return start_timer(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (timer == nullptr || !timer->armed)
+    return ESP_ERR_INVALID_STATE;
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  auto &timers = host::state().timers;
+  auto it = std::find_if(timers.begin(), timers.end(), [timer](const auto &t) { return t.get() == timer; });
+  if (it == timers.end())
+    return ESP_ERR_INVALID_ARG;
+  timers.erase(it);
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() { return host::now_us(); }
+
+// Replaces the C library's, so the component reads the virtual system clock
+extern "C" int gettimeofday(struct timeval *tv, void *) {
+  if (!host::state().time_valid) {
+    tv->tv_sec = 0;
+    tv->tv_usec = 0;
+    return 0;
+  }
+  const int64_t us = host::system_us();
+  tv->tv_sec = static_cast<time_t>(us / 1000000);
+  tv->tv_usec = static_cast<suseconds_t>(us % 1000000);
+  return 0;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf) {
+  if (timer_conf == nullptr || timer_conf->timer_num >= LEDC_TIMER_MAX)
+    return ESP_ERR_INVALID_ARG;
+  host::state().ledc_freq[timer_conf->timer_num] = timer_conf->freq_hz;
+  return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf) {
+  if (ledc_conf == nullptr || ledc_conf->channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  auto &channel = host::state().ledc[ledc_conf->channel];
+  channel.timer = ledc_conf->timer_sel;
+  channel.duty = ledc_conf->duty;
+  if (channel.applied_duty != ledc_conf->duty) {
+    channel.applied_duty = ledc_conf->duty;
+    host::emit_edge(host::EdgeSource::CARRIER, ledc_conf->channel, ledc_conf->duty);
+  }
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty) {
+  if (channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  host::state().ledc[channel].duty = duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+  if (channel >= LEDC_CHANNEL_MAX)
+    return ESP_ERR_INVALID_ARG;
+  auto &ch = host::state().ledc[channel];
+  if (ch.applied_duty != ch.duty) {
+    ch.applied_duty = ch.duty;
+    host::emit_edge(host::EdgeSource::CARRIER, channel, ch.duty);
+  }
+  return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+  return channel < LEDC_CHANNEL_MAX ? host::state().ledc[channel].applied_duty : 0;
+}
+
+uint32_t ledc_get_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num) {
+  return timer_num < LEDC_TIMER_MAX ? host::state().ledc_freq[timer_num] : 0;
+}
+
+struct ledc_dev_t {};
+ledc_dev_t LEDC;
+
+void ledc_ll_set_duty_int_part(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num,
+                               uint32_t duty_val) {
+  ledc_set_duty(speed_mode, channel_num, duty_val);
+}
+
+void ledc_ll_ls_channel_update(ledc_dev_t *hw, ledc_mode_t speed_mode, ledc_channel_t channel_num) {
+  ledc_update_duty(speed_mode, channel_num);
+}
+
+struct gpio_dev_t {};
+gpio_dev_t GPIO;
+
+void gpio_ll_set_level(gpio_dev_t *hw, uint32_t gpio_num, uint32_t level) {
+  host::emit_edge(host::EdgeSource::GPIO, static_cast<uint8_t>(gpio_num), level != 0 ? 1 : 0);
+}
+
+void esp_restart() {
+  fprintf(stderr, "esp_restart() called at %.3f s\n", host::now_us() / 1e6);
+  std::abort();
+}
+
+uint32_t esp_get_free_heap_size() { return 200 * 1024; }
+uint32_t esp_get_minimum_free_heap_size() { return 200 * 1024; }
+
+struct tskTaskControlBlock {
+  UBaseType_t high_water;
+};
+static tskTaskControlBlock loop_task{4096};
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return (task != nullptr ? task : &loop_task)->high_water;
+}
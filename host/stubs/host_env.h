@@ -0,0 +1,132 @@
+#pragma once
+
+// Control surface of the host stub layer.
+//
+// The stand-in ESPHome and ESP-IDF headers in this directory let the
+// unmodified component sources compile on Linux. Everything they do runs on a
+// deterministic virtual clock: esp_timer callbacks, the ESPHome scheduler and
+// the component loop() are dispatched by run_until() in deadline order, with
+// optional latency models standing in for the timer task and for other
+// components blocking the main loop. LEDC duty updates and GPIO writes are
+// reported to an edge sink instead of driving hardware.
+//
+// The local oscillator (esp_timer, millis()) may run off true time by a set
+// number of ppm, optionally swinging around it over the day as with room
+// temperature. The system clock behind RealTimeClock::now() and
+// gettimeofday() runs on it from the boot time until a time source sets it
+// with sync_time_source().
+//
+// All state is per thread: each thread can run its own simulation. The TZ
+// environment variable is process-wide, so concurrent simulations must share
+// the same time zone.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "esphome/components/api/custom_api_device.h"
+#include "esphome/components/time/real_time_clock.h"
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/component.h"
+#include "esphome/core/gpio.h"
+
+namespace host {
+
+enum class EdgeSource : uint8_t {
+  CARRIER,  // LEDC channel duty change, id = channel
+  GPIO,     // digital_write() level change, id = pin
+};
+
+struct Edge {
+  int64_t t_us;  // virtual time since boot
+  EdgeSource source;
+  uint8_t id;
+  uint32_t level;  // duty for the carrier, 0/1 for GPIO
+};
+
+using LatencyFn = std::function<uint32_t()>;
+
+struct LoopModel {
+  /// Main loop period when nothing is scheduled earlier (ESPHome default 16 ms).
+  uint32_t loop_interval_ms{16};
+  /// Delay between a due main loop wake-up and the loop actually running.
+  LatencyFn loop_latency_us;
+  /// Delay between an esp_timer deadline and its callback in the timer task.
+  LatencyFn timer_latency_us;
+};
+
+/// Resets the virtual clock, scheduler, timers and drivers. The device boots
+/// at UTC |boot_epoch_us|; |tz| is a POSIX TZ string used for local time.
+void reset(int64_t boot_epoch_us, const char *tz);
+void set_loop_model(const LoopModel &model);
+
+void set_edge_sink(std::function<void(const Edge &)> sink);
+void set_log_sink(std::function<void(int level, const char *tag, const char *message)> sink);
+/// Messages at or below |level| are also printed to stderr.
+void set_log_level(int level);
+uint32_t log_count(int level);
+
+/// Makes RealTimeClock::now() return an invalid time while false.
+void set_time_valid(bool valid);
+/// Makes the local oscillator run fast by |ppm| (slow if negative), plus
+/// |daily_swing_ppm| times a sine with a period of one day.
+void set_oscillator_ppm(double ppm, double daily_swing_ppm = 0);
+/// Sets the system clock to |utc_us| now, as |clock|'s synchronize_epoch_()
+/// does, makes it valid and calls the clock's time sync callbacks if
+/// |notify|.
+void sync_time_source(esphome::time::RealTimeClock *clock, int64_t utc_us, bool notify);
+
+/// Calls the API service |name| registered by a component, as Home
+/// Assistant would; false if there is none.
+bool call_service(const std::string &name, const ServiceArgs &args);
+/// Receives the Home Assistant events components fire.
+void set_event_sink(std::function<void(const std::string &name, const ServiceArgs &data)> sink);
+
+/// Virtual time since boot.
+int64_t now_us();
+/// True UTC wall time now.
+int64_t epoch_us();
+/// True UTC wall time at |t_us| since boot.
+int64_t epoch_at(int64_t t_us);
+/// Virtual time since boot at which true UTC is |epoch_us|.
+int64_t time_at_epoch(int64_t epoch_us);
+/// System clock now.
+int64_t system_us();
+
+/// Registers a component; setup() runs on the next run_until().
+void add_component(esphome::Component *component);
+/// Dispatches timers and main loop iterations until |t_us| since boot.
+void run_until(int64_t t_us);
+
+/// GPIO pin that reports level changes to the edge sink.
+class RecordingPin : public esphome::InternalGPIOPin {
+ public:
+  explicit RecordingPin(uint8_t pin, bool inverted = false) : pin_(pin), inverted_(inverted) {}
+
+  void setup() override {}
+  void pin_mode(esphome::gpio::Flags flags) override {}
+  bool digital_read() override { return this->level_; }
+  void digital_write(bool value) override;
+  std::string dump_summary() const override { return "GPIO" + std::to_string(this->pin_); }
+  uint8_t get_pin() const override { return this->pin_; }
+  bool is_inverted() const override { return this->inverted_; }
+  /// Calls the attached interrupt handler, as an edge on the input would.
+  void interrupt() {
+    if (this->isr_ != nullptr)
+      this->isr_(this->isr_arg_);
+  }
+
+ protected:
+  void attach_interrupt(void (*func)(void *), void *arg, esphome::gpio::InterruptType) const override {
+    this->isr_ = func;
+    this->isr_arg_ = arg;
+  }
+
+  uint8_t pin_;
+  bool inverted_;
+  bool level_{false};
+  mutable void (*isr_)(void *){nullptr};
+  mutable void *isr_arg_{nullptr};
+};
+
+}  // namespace host
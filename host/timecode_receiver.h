@@ -0,0 +1,192 @@
+#pragma once
+
+// Loopback receiver for the time codes in time_codes.h (DCF77, MSF, WWVB,
+// JJY), used by dcf77_sim to check every transmitter channel.
+//
+// Each second starts at the edge every symbol of the code begins with (the
+// carrier drop, or the return of the carrier for JJY) and free-runs across
+// seconds without one, such as DCF77's second 59. The carrier is sampled in
+// the middle of every tenth after that edge, which tolerates up to 50 ms of
+// drift within the second. Each second's sample mask is mapped back to a
+// symbol, the minute is found with the code's own marker rule and the
+// collected frame is decoded with decode_time_code().
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+
+#include "esphome/components/dcf77_emitter/time_codes.h"
+
+namespace host {
+
+struct TimeCodeResult {
+  int64_t start_us;  // start of second 0 of the frame
+  dcf77::TimeCodeFrame frame;
+  const char *error;  // nullptr when the frame decoded cleanly
+  dcf77::TimeCodeMinute time;
+};
+
+/// Time a correct |protocol| transmitter sends during UTC epoch minute
+/// |epoch_minute|, using the process TZ for local time.
+inline dcf77::TimeCodeMinute expected_time_code(dcf77::Protocol protocol, int64_t epoch_minute) {
+  const time_t sent = static_cast<time_t>(epoch_minute * 60);
+  const time_t announced = dcf77::protocol_sends_next_minute(protocol) ? sent + 60 : sent;
+  struct tm tm {};
+  if (dcf77::protocol_uses_utc(protocol)) {
+    gmtime_r(&announced, &tm);
+  } else {
+    localtime_r(&announced, &tm);
+  }
+  const int year = tm.tm_year + 1900;
+  dcf77::TimeCodeMinute t{};
+  t.minute = static_cast<uint8_t>(tm.tm_min);
+  t.hour = static_cast<uint8_t>(tm.tm_hour);
+  t.day = static_cast<uint8_t>(tm.tm_mday);
+  t.day_of_week = static_cast<uint8_t>(tm.tm_wday == 0 ? 7 : tm.tm_wday);
+  t.month = static_cast<uint8_t>(tm.tm_mon + 1);
+  t.year = static_cast<uint8_t>(year % 100);
+  t.dst = tm.tm_isdst > 0;
+  t.day_of_year = static_cast<uint16_t>(tm.tm_yday + 1);
+  t.leap_year = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+
+  auto is_dst = [](time_t epoch) {
+    struct tm local {};
+    localtime_r(&epoch, &local);
+    return local.tm_isdst > 0;
+  };
+  t.dst_change_soon = is_dst(sent) != is_dst(sent + 61 * 60);
+  const time_t day_start = sent - ((sent % 86400) + 86400) % 86400;
+  t.dst_day_start = is_dst(day_start);
+  t.dst_day_end = is_dst(day_start + 86400);
+  return t;
+}
+
+/// Sampling receiver for one transmitter channel. Feed it the channel's
+/// carrier level changes in time order, then advance() to the end of the
+/// run; every complete minute produces one TimeCodeResult.
+class TimeCodeReceiver {
+ public:
+  explicit TimeCodeReceiver(dcf77::Protocol protocol) : protocol_(protocol) {}
+
+  void set_callback(std::function<void(const TimeCodeResult &)> callback) { this->callback_ = std::move(callback); }
+
+  void feed(int64_t t_us, bool carrier_on) {
+    this->advance(t_us);
+    const bool starts_second =
+        carrier_on == (this->protocol_ == dcf77::Protocol::JJY40 || this->protocol_ == dcf77::Protocol::JJY60);
+    if (starts_second && t_us >= this->second_start_us_ + 900000) {
+      // The samples still due in this second see the level before the edge
+      while (this->tenth_ < 10)
+        this->sample_();
+      this->end_second_(t_us);
+    }
+    this->carrier_on_ = carrier_on;
+  }
+
+  /// Takes the samples due before |t_us|.
+  void advance(int64_t t_us) {
+    for (;;) {
+      if (this->tenth_ < 10 && this->second_start_us_ + this->tenth_ * 100000 + 50000 < t_us) {
+        this->sample_();
+      } else if (this->tenth_ == 10 && this->second_start_us_ + 1100000 < t_us) {
+        this->end_second_(this->second_start_us_ + 1000000);
+      } else {
+        break;
+      }
+    }
+  }
+
+  uint32_t symbol_errors() const { return this->symbol_errors_; }
+
+ protected:
+  void sample_() {
+    if (!this->carrier_on_)
+      this->tenths_ |= 1u << this->tenth_;
+    this->tenth_++;
+  }
+
+  void end_second_(int64_t next_start_us) {
+    this->on_second_();
+    this->second_start_us_ = next_start_us;
+    this->tenth_ = 0;
+    this->tenths_ = 0;
+  }
+
+  void on_second_() {
+    bool a, b, marker;
+    if (!dcf77::symbol_from_tenths(this->protocol_, this->tenths_, &a, &b, &marker)) {
+      this->symbol_errors_ += this->synced_;
+      this->broken_ = true;
+    }
+
+    bool starts_minute;
+    switch (this->protocol_) {
+      case dcf77::Protocol::DCF77:
+        starts_minute = this->last_marker_;  // the missing pulse is second 59
+        break;
+      case dcf77::Protocol::MSF:
+        starts_minute = marker;  // the 500 ms pulse is second 0
+        break;
+      default:
+        starts_minute = marker && this->last_marker_;  // markers at 59 and 0
+        break;
+    }
+    this->last_marker_ = marker;
+
+    if (starts_minute) {
+      if (this->synced_)
+        this->emit_();
+      this->synced_ = true;
+      this->start_us_ = this->second_start_us_;
+      this->frame_ = dcf77::TimeCodeFrame{0, 0};
+      this->markers_ = 0;
+      this->second_ = 0;
+      this->broken_ = false;
+    }
+    if (this->second_ < 64) {
+      const uint64_t bit = uint64_t{1} << this->second_;
+      this->frame_.a |= a ? bit : 0;
+      this->frame_.b |= b ? bit : 0;
+      this->markers_ |= marker ? bit : 0;
+    }
+    this->second_++;
+  }
+
+  void emit_() {
+    TimeCodeResult result{this->start_us_, this->frame_, nullptr, {}};
+    uint64_t markers = dcf77::MARKER_SECONDS;
+    if (this->protocol_ == dcf77::Protocol::DCF77) {
+      markers = uint64_t{1} << 59;
+    } else if (this->protocol_ == dcf77::Protocol::MSF) {
+      markers = 1;
+    }
+    if (this->broken_) {
+      result.error = "bad symbol";
+    } else if (this->second_ != 60) {
+      result.error = "second count";
+    } else if (this->markers_ != markers) {
+      result.error = "marker position";
+    } else if (!dcf77::decode_time_code(this->protocol_, this->frame_, &result.time)) {
+      result.error = "decode";
+    }
+    if (this->callback_)
+      this->callback_(result);
+  }
+
+  dcf77::Protocol protocol_;
+  std::function<void(const TimeCodeResult &)> callback_;
+  bool carrier_on_{false};
+  int64_t second_start_us_{0};
+  int tenth_{0};
+  uint16_t tenths_{0};
+  bool last_marker_{false};
+  bool synced_{false};
+  bool broken_{false};
+  int64_t start_us_{0};
+  dcf77::TimeCodeFrame frame_{0, 0};
+  uint64_t markers_{0};
+  int second_{0};
+  uint32_t symbol_errors_{0};
+};
+
+}  // namespace host
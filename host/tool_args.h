@@ -0,0 +1,61 @@
+#pragma once
+
+// Command-line helpers shared by the host tools. Options are "--name=value".
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace host {
+
+/// Returns true and stores the value if |arg| is "--name=value" for |name|.
+inline bool parse_option(const char *arg, const char *name, std::string *value) {
+  size_t len = strlen(name);
+  if (strncmp(arg, name, len) != 0 || arg[len] != '=')
+    return false;
+  *value = arg + len + 1;
+  return true;
+}
+
+/// Splits "a,b,c" into numbers.
+inline std::vector<double> parse_list(const std::string &value) {
+  std::vector<double> out;
+  const char *p = value.c_str();
+  while (*p != '\0') {
+    char *end;
+    out.push_back(strtod(p, &end));
+    if (end == p)
+      break;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return out;
+}
+
+/// Parses a UTC time given as YYYY-MM-DD[THH:MM] or epoch seconds into
+/// minutes since the epoch.
+inline bool parse_utc_minute(const std::string &value, int64_t *minute) {
+  int year, month, day, hour = 0, min = 0;
+  int64_t seconds;
+  if (sscanf(value.c_str(), "%d-%d-%dT%d:%d", &year, &month, &day, &hour, &min) >= 3) {
+    struct tm tm {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    seconds = timegm(&tm);
+  } else {
+    char *end;
+    seconds = strtoll(value.c_str(), &end, 10);
+    if (*end != '\0' || value.empty())
+      return false;
+  }
+  *minute = seconds >= 0 ? seconds / 60 : (seconds - 59) / 60;
+  return true;
+}
+
+}  // namespace host
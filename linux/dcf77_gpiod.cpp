@@ -0,0 +1,400 @@
+/*
+  DCF77 transmitter for Linux boards: keys one GPIO line through libgpiod
+  with the schedule of DcfOut() in the sketch (edge_schedule.h).
+
+  The line is active while the carrier is on. It gates an external 77.5 kHz
+  oscillator or the enable input of a transmitter module, so it only has to
+  switch at the pulse edges. Each edge is a CLOCK_REALTIME deadline reached
+  with clock_nanosleep(TIMER_ABSTIME), so the phase follows the system clock
+  (NTP, PTP or a GPS-disciplined chrony) without drift. For low jitter the
+  process runs under SCHED_FIFO, locks its memory with mlockall() and can be
+  pinned to a CPU isolated with isolcpus= or cpusets.
+
+  Every edge is stamped after the line write. The difference to its
+  deadline goes into a cyclictest-style histogram (1 us buckets up to
+  10 ms), reported as percentiles at exit. The stamps also feed the
+  reference receiver from host/dcf77_decoder.h, which decodes every minute
+  and compares it with the expected local time. The exit status is non-zero
+  if any minute decodes wrong.
+
+  With --ring=NAME the edges come from the shared-memory ring of
+  dcf77_ringd (schedule_ring.h) instead of being computed here. The carrier
+  stays off while the ring lacks the current minute, and the stall is
+  counted.
+
+  Without --chip nothing is written, so scheduling latency can be measured
+  anywhere. linux/gpio_sim.sh runs the tool against a simulated chip from
+  the kernel's gpio-sim module, without hardware.
+
+  Build from the repository root (libgpiod 2.x for the GPIO output):
+    g++ -std=gnu++17 -O2 -I. -DDCF77_HAVE_GPIOD -o dcf77_gpiod linux/dcf77_gpiod.cpp -lgpiod
+  or, for dry runs only:
+    g++ -std=gnu++17 -O2 -I. -o dcf77_gpiod linux/dcf77_gpiod.cpp
+
+  Usage:
+    dcf77_gpiod [--chip=gpiochip0 --line=N [--active-low]] [--tz=POSIX_TZ]
+                [--seconds=N] [--priority=N] [--cpu=N] [--late-us=N]
+                [--histogram] [--ring=/dcf77]
+
+  --seconds=0 (the default) runs until SIGINT or SIGTERM. --priority is the
+  SCHED_FIFO priority (default 80, 0 keeps SCHED_OTHER). --cpu pins the
+  process to one CPU. --late-us is the deviation counted as a late edge
+  (default 1000). --histogram prints the non-empty buckets, one per line.
+*/
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#ifdef DCF77_HAVE_GPIOD
+#include <gpiod.h>
+#endif
+
+#include "host/dcf77_decoder.h"
+#include "host/tool_args.h"
+#include "linux/edge_schedule.h"
+#include "linux/schedule_ring.h"
+
+namespace {
+
+struct Options {
+  std::string chip;
+  unsigned line{0};
+  bool active_low{false};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  int64_t seconds{0};
+  int priority{80};
+  int cpu{-1};
+  int64_t late_us{1000};
+  bool histogram{false};
+  std::string ring;
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--chip", &value)) {
+      options->chip = value.find('/') == std::string::npos ? "/dev/" + value : value;
+    } else if (parse_option(argv[i], "--line", &value)) {
+      options->line = static_cast<unsigned>(atoi(value.c_str()));
+    } else if (strcmp(argv[i], "--active-low") == 0) {
+      options->active_low = true;
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--seconds", &value)) {
+      options->seconds = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--priority", &value)) {
+      options->priority = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--cpu", &value)) {
+      options->cpu = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--late-us", &value)) {
+      options->late_us = atoll(value.c_str());
+    } else if (strcmp(argv[i], "--histogram") == 0) {
+      options->histogram = true;
+    } else if (parse_option(argv[i], "--ring", &value)) {
+      options->ring = value;
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  return options->seconds >= 0;
+}
+
+// -----------------------------------------------------------------------------
+// GPIO line
+// -----------------------------------------------------------------------------
+
+/// One output line requested through libgpiod; without a chip every write
+/// is dropped.
+class LineOutput {
+ public:
+  ~LineOutput() {
+#ifdef DCF77_HAVE_GPIOD
+    if (this->request_ != nullptr)
+      gpiod_line_request_release(this->request_);
+    if (this->chip_ != nullptr)
+      gpiod_chip_close(this->chip_);
+#endif
+  }
+
+  bool open(const Options &options) {
+    if (options.chip.empty())
+      return true;
+#ifdef DCF77_HAVE_GPIOD
+    this->line_ = options.line;
+    if ((this->chip_ = gpiod_chip_open(options.chip.c_str())) == nullptr) {
+      perror(options.chip.c_str());
+      return false;
+    }
+    gpiod_line_settings *settings = gpiod_line_settings_new();
+    gpiod_line_config *line_config = gpiod_line_config_new();
+    gpiod_request_config *request_config = gpiod_request_config_new();
+    if (settings != nullptr && line_config != nullptr && request_config != nullptr) {
+      // Carrier off until the first edge
+      gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
+      gpiod_line_settings_set_output_value(settings, GPIOD_LINE_VALUE_INACTIVE);
+      gpiod_line_settings_set_active_low(settings, options.active_low);
+      gpiod_request_config_set_consumer(request_config, "dcf77_gpiod");
+      if (gpiod_line_config_add_line_settings(line_config, &this->line_, 1, settings) == 0)
+        this->request_ = gpiod_chip_request_lines(this->chip_, request_config, line_config);
+    }
+    gpiod_request_config_free(request_config);
+    gpiod_line_config_free(line_config);
+    gpiod_line_settings_free(settings);
+    if (this->request_ == nullptr) {
+      fprintf(stderr, "%s: cannot request line %u: %s\n", options.chip.c_str(), this->line_, strerror(errno));
+      return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "built without libgpiod; rebuild with -DDCF77_HAVE_GPIOD ... -lgpiod\n");
+    return false;
+#endif
+  }
+
+  void set(bool carrier_on) {
+#ifdef DCF77_HAVE_GPIOD
+    if (this->request_ != nullptr)
+      gpiod_line_request_set_value(this->request_, this->line_,
+                                   carrier_on ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE);
+#else
+    (void) carrier_on;
+#endif
+  }
+
+ protected:
+#ifdef DCF77_HAVE_GPIOD
+  gpiod_chip *chip_{nullptr};
+  gpiod_line_request *request_{nullptr};
+  unsigned line_{0};
+#endif
+};
+
+// -----------------------------------------------------------------------------
+// Real-time setup
+// -----------------------------------------------------------------------------
+
+// Touches the stack the loop will use so it is resident before the first
+// edge, as rt-tests do after mlockall().
+void prefault_stack() {
+  volatile char stack[64 * 1024];
+  for (size_t i = 0; i < sizeof(stack); i += 4096)
+    stack[i] = 0;
+}
+
+// Applies --cpu and --priority and locks memory. Failures only warn, so the
+// tool also runs unprivileged; the report names the policy in effect.
+void setup_realtime(const Options &options) {
+  if (options.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(options.cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+      fprintf(stderr, "warning: cannot pin to CPU %d: %s\n", options.cpu, strerror(errno));
+  }
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    fprintf(stderr, "warning: mlockall: %s\n", strerror(errno));
+  prefault_stack();
+  if (options.priority > 0) {
+    sched_param param{};
+    param.sched_priority = options.priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+      fprintf(stderr, "warning: SCHED_FIFO %d: %s\n", options.priority, strerror(errno));
+  }
+}
+
+const char *policy_name() {
+  switch (sched_getscheduler(0)) {
+    case SCHED_FIFO:
+      return "SCHED_FIFO";
+    case SCHED_RR:
+      return "SCHED_RR";
+    default:
+      return "SCHED_OTHER";
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Edge deviation histogram
+// -----------------------------------------------------------------------------
+
+class Histogram {
+ public:
+  static const int64_t BUCKETS = 10000;  // 1 us each; later edges overflow
+
+  void add(int64_t deviation_ns) {
+    const int64_t us = std::max<int64_t>(deviation_ns, 0) / 1000;
+    this->buckets_[std::min(us, BUCKETS)]++;
+    this->count_++;
+    this->sum_ns_ += deviation_ns;
+    this->min_ns_ = std::min(this->min_ns_, deviation_ns);
+    this->max_ns_ = std::max(this->max_ns_, deviation_ns);
+  }
+
+  /// Upper bound in us of the |q| quantile; BUCKETS means overflow. Uses
+  /// the nearest rank, so with fewer than 1/(1-q) edges the quantile is the
+  /// latest one rather than an interpolation below it.
+  int64_t percentile_us(double q) const {
+    // The small slack keeps q * count from rounding up past a whole rank
+    const double nearest = std::ceil(q * this->count_ - 1e-9);
+    const uint64_t rank = nearest > 1 ? static_cast<uint64_t>(nearest) - 1 : 0;
+    uint64_t seen = 0;
+    for (int64_t i = 0; i <= BUCKETS; i++) {
+      seen += this->buckets_[i];
+      if (seen > rank)
+        return i + 1;
+    }
+    return BUCKETS;
+  }
+
+  uint64_t count() const { return this->count_; }
+  int64_t min_ns() const { return this->min_ns_; }
+  int64_t max_ns() const { return this->max_ns_; }
+  double mean_ns() const { return this->count_ == 0 ? 0.0 : static_cast<double>(this->sum_ns_) / this->count_; }
+  uint64_t bucket(int64_t i) const { return this->buckets_[i]; }
+
+ protected:
+  std::vector<uint64_t> buckets_ = std::vector<uint64_t>(BUCKETS + 1);
+  uint64_t count_{0};
+  int64_t sum_ns_{0};
+  int64_t min_ns_{INT64_MAX};
+  int64_t max_ns_{INT64_MIN};
+};
+
+volatile sig_atomic_t stop_requested = 0;
+
+void on_signal(int) { stop_requested = 1; }
+
+int64_t realtime_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * host::NS_PER_SECOND + ts.tv_nsec;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  host::ScheduleRingReader ring;
+  std::string error;
+  if (!options.ring.empty() && !ring.attach(options.ring, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  LineOutput output;
+  if (!output.open(options))
+    return 1;
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  setup_realtime(options);
+
+  uint32_t good_minutes = 0, bad_minutes = 0;
+  host::Dcf77Receiver receiver;
+  receiver.set_callback([&](const host::Dcf77Minute &minute) {
+    // The marker starts the minute the frame announces
+    const int64_t epoch_minute = (minute.marker_us + 30000000) / 60000000;
+    const host::Dcf77Time expected = host::dcf77_expected_time(epoch_minute);
+    const bool ok = minute.error == nullptr && minute.time == expected;
+    (ok ? good_minutes : bad_minutes)++;
+    printf("%02d:%02d %s\n", expected.hour, expected.minute,
+           ok ? "ok" : (minute.error != nullptr ? minute.error : "wrong time"));
+    fflush(stdout);
+  });
+
+  Histogram histogram;
+  uint64_t late = 0, resyncs = 0, ring_stalls = 0;
+  const int64_t start_ns = realtime_ns();
+  const int64_t end_ns = options.seconds > 0 ? start_ns + options.seconds * host::NS_PER_SECOND : INT64_MAX;
+  host::EdgeSchedule schedule(start_ns);
+  host::RingEdgeSchedule ring_schedule(ring, start_ns);
+  auto next_edge = [&](host::Edge *edge) {
+    if (options.ring.empty()) {
+      *edge = schedule.next();
+      return true;
+    }
+    return ring_schedule.next(edge);
+  };
+  printf("keying %s line %u from the next second, %s%s, edges from %s\n",
+         options.chip.empty() ? "no chip" : options.chip.c_str(), options.line, policy_name(),
+         options.cpu >= 0 ? " pinned" : "", options.ring.empty() ? "edge_schedule.h" : options.ring.c_str());
+  fflush(stdout);
+
+  while (!stop_requested) {
+    host::Edge edge;
+    if (!next_edge(&edge)) {
+      // The producer is behind or gone: carrier off, look again shortly
+      output.set(false);
+      ring_stalls++;
+      const struct timespec pause = {0, 100 * host::NS_PER_MS};
+      nanosleep(&pause, nullptr);
+      if (realtime_ns() >= end_ns)
+        break;
+      continue;
+    }
+    if (edge.t_ns >= end_ns)
+      break;
+    struct timespec deadline;
+    deadline.tv_sec = static_cast<time_t>(edge.t_ns / host::NS_PER_SECOND);
+    deadline.tv_nsec = static_cast<long>(edge.t_ns % host::NS_PER_SECOND);
+    int err;
+    while ((err = clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &deadline, nullptr)) == EINTR && !stop_requested) {
+    }
+    if (stop_requested)
+      break;
+    output.set(edge.carrier_on);
+    const int64_t now_ns = realtime_ns();
+    const int64_t deviation_ns = now_ns - edge.t_ns;
+    if (deviation_ns > host::NS_PER_SECOND) {
+      // The clock stepped or the process was stopped: restart the schedule
+      // at the next second instead of replaying the missed edges
+      schedule = host::EdgeSchedule(now_ns);
+      ring_schedule = host::RingEdgeSchedule(ring, now_ns);
+      resyncs++;
+      continue;
+    }
+    histogram.add(deviation_ns);
+    late += deviation_ns > options.late_us * 1000;
+    receiver.feed(now_ns / 1000, edge.carrier_on);
+  }
+  output.set(false);
+
+  if (histogram.count() == 0) {
+    printf("no edges\n");
+    return 0;
+  }
+  printf("%" PRIu64 " edges, deviation min %.1f us, mean %.1f us, max %.1f us\n", histogram.count(),
+         histogram.min_ns() / 1e3, histogram.mean_ns() / 1e3, histogram.max_ns() / 1e3);
+  printf("percentiles (us): p50 <%" PRId64 " p90 <%" PRId64 " p99 <%" PRId64 " p99.9 <%" PRId64 " p99.99 <%" PRId64
+         "\n",
+         histogram.percentile_us(0.5), histogram.percentile_us(0.9), histogram.percentile_us(0.99),
+         histogram.percentile_us(0.999), histogram.percentile_us(0.9999));
+  printf("%" PRIu64 " edges later than %" PRId64 " us, %" PRIu64 " resyncs, %" PRIu64 " ring stalls, %s\n", late,
+         options.late_us, resyncs, ring_stalls, policy_name());
+  printf("%u minutes decoded, %u wrong, %u pulse errors, %u spacing errors\n", good_minutes, bad_minutes,
+         receiver.pulse_errors(), receiver.spacing_errors());
+  if (options.histogram) {
+    for (int64_t i = 0; i <= Histogram::BUCKETS; i++) {
+      if (histogram.bucket(i) != 0)
+        printf("%s%06" PRId64 " %" PRIu64 "\n", i == Histogram::BUCKETS ? ">" : "", i, histogram.bucket(i));
+    }
+  }
+  return bad_minutes == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+/*
+  Benchmark for the shared-memory schedule ring (schedule_ring.h): one
+  producer and many concurrent readers.
+
+  The producer publishes synthetic consecutive minutes at --rate per second,
+  far faster than the real one per minute, so that a few seconds give
+  stable statistics. Every reader thread maps the ring on its own, as a
+  separate consumer process would, and polls the newest minute. Whenever
+  it advances, the reader copies the minute and records the publication
+  latency (from the producer's stamp to the end of the copy) and the cost
+  of the read. Between publications each reader looks up single edges in
+  place, as a keyer does before every edge, and times those lookups in
+  batches. Every minute read is checked for consistency: its edges must
+  belong to its minute and its pulses must be 100 or 200 ms. A torn read
+  that passes the seqlock makes the exit status non-zero.
+
+  Readers yield the CPU after a short idle spin, so the tool also runs on
+  machines with fewer cores than readers; the latency then includes
+  scheduling delays.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -pthread -I. -o dcf77_ring_bench linux/dcf77_ring_bench.cpp
+
+  Usage:
+    dcf77_ring_bench [--readers=N] [--rate=HZ] [--seconds=N]
+
+  Defaults: 8 readers, 1000 publications per second, 5 seconds.
+*/
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host/tool_args.h"
+#include "linux/schedule_ring.h"
+
+namespace {
+
+struct Options {
+  int readers{8};
+  int64_t rate{1000};
+  int64_t seconds{5};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--readers", &value)) {
+      options->readers = atoi(value.c_str());
+    } else if (parse_option(argv[i], "--rate", &value)) {
+      options->rate = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--seconds", &value)) {
+      options->seconds = atoll(value.c_str());
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  return options->readers > 0 && options->rate > 0 && options->seconds > 0;
+}
+
+int64_t realtime_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * host::NS_PER_SECOND + ts.tv_nsec;
+}
+
+// Edges belong to the minute and pulses are 100 or 200 ms
+bool consistent(const host::RingMinute &minute) {
+  for (int s = 0; s < 60; s++) {
+    if (minute.fall_ns[s] == 0)
+      continue;
+    const int64_t width = minute.rise_ns[s] - minute.fall_ns[s];
+    if (minute.fall_ns[s] != (minute.epoch_minute * 60 + s) * host::NS_PER_SECOND ||
+        (width != 100 * host::NS_PER_MS && width != 200 * host::NS_PER_MS))
+      return false;
+  }
+  return minute.fall_ns[0] != 0;
+}
+
+struct ReaderStats {
+  std::vector<int64_t> latency_ns;
+  std::vector<int64_t> read_ns;
+  uint64_t lookups{0};
+  int64_t lookup_ns{0};
+  uint64_t inconsistent{0};
+  uint64_t retries{0};
+  uint64_t misses{0};  // newest minute already overwritten when read
+};
+
+void reader(const std::string &name, const std::atomic<bool> &done, int64_t expected, ReaderStats *stats) {
+  stats->latency_ns.reserve(expected);
+  stats->read_ns.reserve(expected);
+  host::ScheduleRingReader ring;
+  std::string error;
+  if (!ring.attach(name, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    stats->inconsistent++;
+    return;
+  }
+  host::RingMinute copy;
+  int64_t seen = INT64_MIN;
+  uint32_t idle = 0;
+  while (!done.load(std::memory_order_relaxed)) {
+    const int64_t newest = ring.newest_minute();
+    if (newest != seen && newest != INT64_MIN) {
+      seen = newest;
+      const int64_t t0 = realtime_ns();
+      const bool ok = ring.read(newest, &copy);
+      const int64_t t1 = realtime_ns();
+      if (!ok) {
+        stats->misses++;
+        continue;
+      }
+      stats->latency_ns.push_back(t1 - copy.published_ns);
+      stats->read_ns.push_back(t1 - t0);
+      stats->inconsistent += !consistent(copy);
+      idle = 0;
+      continue;
+    }
+    // A keyer's per-edge lookup: one drop/rise pair of the newest minute
+    const int LOOKUPS = 64;
+    const int64_t t0 = realtime_ns();
+    int64_t sum = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+      const int s = i % 59;
+      ring.read_in_place(seen, [&](const host::RingMinute &minute) { sum += minute.rise_ns[s] - minute.fall_ns[s]; });
+    }
+    stats->lookup_ns += realtime_ns() - t0;
+    stats->lookups += LOOKUPS;
+    if (sum == 1)
+      stats->inconsistent++;  // keeps the lookups from being optimized away
+    if (++idle % 16 == 0)
+      sched_yield();
+  }
+  stats->retries = ring.retries();
+}
+
+int64_t percentile(std::vector<int64_t> *samples, double q) {
+  if (samples->empty())
+    return 0;
+  const size_t rank = static_cast<size_t>(q * (samples->size() - 1));
+  std::nth_element(samples->begin(), samples->begin() + rank, samples->end());
+  return (*samples)[rank];
+}
+
+void print_percentiles(const char *label, std::vector<int64_t> *samples) {
+  printf("%-22s p50 %8.2f us  p90 %8.2f us  p99 %8.2f us  p99.9 %8.2f us  max %8.2f us\n", label,
+         percentile(samples, 0.5) / 1e3, percentile(samples, 0.9) / 1e3, percentile(samples, 0.99) / 1e3,
+         percentile(samples, 0.999) / 1e3, percentile(samples, 1.0) / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+
+  const std::string name = "/dcf77_ring_bench." + std::to_string(getpid());
+  host::ScheduleRingWriter writer;
+  std::string error;
+  if (!writer.create(name, "CET-1CEST,M3.5.0,M10.5.0/3", &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  const int64_t total = options.rate * options.seconds;
+  std::atomic<bool> done{false};
+  std::vector<ReaderStats> stats(options.readers);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < options.readers; r++)
+    readers.emplace_back(reader, name, std::cref(done), total, &stats[r]);
+
+  // Minutes are built ahead of time so the loop times publish() alone
+  const int64_t first_minute = realtime_ns() / host::NS_PER_SECOND / 60;
+  std::vector<host::RingMinute> minutes(host::RING_SLOTS);
+  for (size_t i = 0; i < minutes.size(); i++)
+    minutes[i] = host::ring_minute(first_minute + i);
+  std::vector<int64_t> publish_ns;
+  publish_ns.reserve(total);
+  const int64_t period_ns = host::NS_PER_SECOND / options.rate;
+  int64_t next_ns = realtime_ns();
+  for (int64_t k = 0; k < total; k++) {
+    next_ns += period_ns;
+    const struct timespec deadline = {static_cast<time_t>(next_ns / host::NS_PER_SECOND),
+                                      static_cast<long>(next_ns % host::NS_PER_SECOND)};
+    clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &deadline, nullptr);
+    // Moves the slot's template RING_SLOTS minutes on; the frame bits stay,
+    // which the consistency check does not look at
+    host::RingMinute &minute = minutes[k % host::RING_SLOTS];
+    if (k >= static_cast<int64_t>(host::RING_SLOTS)) {
+      const int64_t shift_ns = static_cast<int64_t>(host::RING_SLOTS) * 60 * host::NS_PER_SECOND;
+      minute.epoch_minute += host::RING_SLOTS;
+      for (int s = 0; s < 60; s++) {
+        if (minute.fall_ns[s] != 0) {
+          minute.fall_ns[s] += shift_ns;
+          minute.rise_ns[s] += shift_ns;
+        }
+      }
+    }
+    const int64_t t0 = realtime_ns();
+    minute.published_ns = t0;
+    writer.publish(minute);
+    publish_ns.push_back(realtime_ns() - t0);
+  }
+  done = true;
+  for (auto &thread : readers)
+    thread.join();
+
+  std::vector<int64_t> latency, read;
+  uint64_t lookups = 0, inconsistent = 0, retries = 0, misses = 0;
+  int64_t lookup_ns = 0;
+  for (const ReaderStats &s : stats) {
+    latency.insert(latency.end(), s.latency_ns.begin(), s.latency_ns.end());
+    read.insert(read.end(), s.read_ns.begin(), s.read_ns.end());
+    lookups += s.lookups;
+    lookup_ns += s.lookup_ns;
+    inconsistent += s.inconsistent;
+    retries += s.retries;
+    misses += s.misses;
+  }
+  printf("%" PRId64 " publications at %" PRId64 " Hz, %d readers on %u CPUs, %zu-byte slots\n", total, options.rate,
+         options.readers, std::thread::hardware_concurrency(), sizeof(host::RingSlot));
+  print_percentiles("publish()", &publish_ns);
+  print_percentiles("publication latency", &latency);
+  print_percentiles("read() copy", &read);
+  printf("in-place edge lookup   %.1f ns mean over %" PRIu64 " lookups\n",
+         lookups == 0 ? 0.0 : static_cast<double>(lookup_ns) / lookups, lookups);
+  printf("%zu minutes read (%.1f%% of publications per reader), %" PRIu64 " seqlock retries, %" PRIu64
+         " overwritten before read, %" PRIu64 " inconsistent\n",
+         latency.size(), 100.0 * latency.size() / (static_cast<double>(total) * options.readers), retries, misses,
+         inconsistent);
+  return inconsistent == 0 ? 0 : 1;
+}
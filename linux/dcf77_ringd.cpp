@@ -0,0 +1,137 @@
+/*
+  DCF77 schedule producer: publishes the frame and the per-second carrier
+  edge deadlines of the current and the next few minutes into a
+  shared-memory ring (schedule_ring.h), for any number of local consumers.
+
+  At every minute boundary it publishes the minute --lookahead minutes
+  ahead and refreshes the heartbeat in the ring header, so consumers always
+  find the minute they are in plus a few more. If the system clock steps,
+  the ring is refilled from the current minute. The ring is removed on
+  SIGINT or SIGTERM.
+
+  Consumers map the ring read-only with host::ScheduleRingReader, e.g.
+  dcf77_gpiod --ring=/dcf77.
+
+  Build from the repository root:
+    g++ -std=gnu++17 -O2 -I. -o dcf77_ringd linux/dcf77_ringd.cpp
+
+  Usage:
+    dcf77_ringd [--name=/dcf77] [--tz=POSIX_TZ] [--lookahead=N] [--seconds=N]
+
+  --lookahead defaults to 4 minutes (at most 14). --seconds=0 (the default)
+  runs until stopped.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "host/tool_args.h"
+#include "linux/schedule_ring.h"
+
+namespace {
+
+struct Options {
+  std::string name{"/dcf77"};
+  std::string tz{"CET-1CEST,M3.5.0,M10.5.0/3"};
+  int64_t lookahead{4};
+  int64_t seconds{0};
+};
+
+bool parse_args(int argc, char **argv, Options *options) {
+  using host::parse_option;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--name", &value)) {
+      options->name = value;
+    } else if (parse_option(argv[i], "--tz", &value)) {
+      options->tz = value;
+    } else if (parse_option(argv[i], "--lookahead", &value)) {
+      options->lookahead = atoll(value.c_str());
+    } else if (parse_option(argv[i], "--seconds", &value)) {
+      options->seconds = atoll(value.c_str());
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  // Two slots stay free: the minute just left and the one being replaced
+  if (options->lookahead < 0 || options->lookahead > static_cast<int64_t>(host::RING_SLOTS) - 2) {
+    fprintf(stderr, "--lookahead must be 0..%u\n", host::RING_SLOTS - 2);
+    return false;
+  }
+  return options->seconds >= 0;
+}
+
+volatile sig_atomic_t stop_requested = 0;
+
+void on_signal(int) { stop_requested = 1; }
+
+int64_t realtime_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * host::NS_PER_SECOND + ts.tv_nsec;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_args(argc, argv, &options))
+    return 2;
+  setenv("TZ", options.tz.c_str(), 1);
+  tzset();
+
+  host::ScheduleRingWriter writer;
+  std::string error;
+  if (!writer.create(options.name, options.tz, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  printf("publishing %s: %" PRId64 " minutes ahead, TZ %s\n", options.name.c_str(), options.lookahead,
+         options.tz.c_str());
+  fflush(stdout);
+
+  const int64_t start_ns = realtime_ns();
+  const int64_t end_ns = options.seconds > 0 ? start_ns + options.seconds * host::NS_PER_SECOND : INT64_MAX;
+  int64_t published = INT64_MIN;  // newest minute in the ring
+  uint64_t minutes = 0, refills = 0;
+  while (!stop_requested) {
+    const int64_t now_ns = realtime_ns();
+    if (now_ns >= end_ns)
+      break;
+    const int64_t current = host::minute_of_second(now_ns / host::NS_PER_SECOND);
+    const int64_t last = current + options.lookahead;
+    if (published != INT64_MIN && (published < current - 1 || published > last)) {
+      // The clock stepped: the ring holds minutes of another time
+      published = INT64_MIN;
+      refills++;
+    }
+    for (int64_t minute = std::max(current, published == INT64_MIN ? current : published + 1); minute <= last;
+         minute++) {
+      host::RingMinute ring_minute = host::ring_minute(minute);
+      ring_minute.published_ns = realtime_ns();
+      writer.publish(ring_minute);
+      published = minute;
+      minutes++;
+    }
+    writer.heartbeat(now_ns);
+
+    const int64_t wake_ns = std::min((current + 1) * 60 * host::NS_PER_SECOND, end_ns);
+    struct timespec deadline;
+    deadline.tv_sec = static_cast<time_t>(wake_ns / host::NS_PER_SECOND);
+    deadline.tv_nsec = static_cast<long>(wake_ns % host::NS_PER_SECOND);
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &deadline, nullptr) == EINTR && !stop_requested) {
+    }
+  }
+  printf("%" PRIu64 " minutes published, %" PRIu64 " refills after clock steps\n", minutes, refills);
+  return 0;
+}
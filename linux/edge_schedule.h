@@ -0,0 +1,84 @@
+#pragma once
+
+// Carrier edges of the DCF77 signal on the CLOCK_REALTIME second grid, for
+// the Linux backends.
+//
+// This is the schedule DcfOut() in the sketch produces, without the 100 ms
+// ticks. The frame for each minute is built as CodeTime() does: the local
+// civil time of the next minute via localtime_r(), civil_from_tm() and
+// encode_frame(). dcf77::pulse_ms() gives the pulse of each second. A
+// second with a pulse drops the carrier at its start and restores it 100 or
+// 200 ms later; second 59 keeps the carrier on. The second of the minute
+// comes from the UTC second, which equals tm_sec for every zone whose offset
+// is a whole number of minutes.
+
+#include <cstdint>
+#include <ctime>
+
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"
+
+namespace host {
+
+const int64_t NS_PER_SECOND = 1000000000;
+const int64_t NS_PER_MS = 1000000;
+
+/// Frame sent during UTC epoch minute |minute|, as CodeTime() builds it:
+/// the local civil time of the minute after it.
+inline uint64_t minute_frame(int64_t minute) {
+  const time_t next = static_cast<time_t>((minute + 1) * 60);
+  struct tm tm {};
+  localtime_r(&next, &tm);
+  return dcf77::encode_frame(dcf77::civil_from_tm(tm));
+}
+
+/// UTC epoch minute containing |second|.
+inline int64_t minute_of_second(int64_t second) { return (second >= 0 ? second : second - 59) / 60; }
+
+/// One carrier change.
+struct Edge {
+  int64_t t_ns;          // CLOCK_REALTIME deadline
+  bool carrier_on;       // level after the edge
+  int64_t epoch_second;  // second the edge belongs to
+};
+
+/// Edges in time order, starting with the first second at or after the
+/// start time. Uses the process TZ.
+class EdgeSchedule {
+ public:
+  explicit EdgeSchedule(int64_t start_ns)
+      : second_(start_ns >= 0 ? (start_ns + NS_PER_SECOND - 1) / NS_PER_SECOND : start_ns / NS_PER_SECOND) {}
+
+  Edge next() {
+    if (this->pulse_ms_ != 0) {
+      const Edge rise{this->second_ * NS_PER_SECOND + this->pulse_ms_ * NS_PER_MS, true, this->second_};
+      this->pulse_ms_ = 0;
+      this->second_++;
+      return rise;
+    }
+    for (;; this->second_++) {
+      const int64_t minute = minute_of_second(this->second_);
+      if (minute != this->minute_) {
+        this->minute_ = minute;
+        this->frame_ = minute_frame(minute);
+      }
+      const int pulse = dcf77::pulse_ms(this->frame_, static_cast<int>(this->second_ - minute * 60));
+      if (pulse != 0) {
+        this->pulse_ms_ = pulse;
+        return Edge{this->second_ * NS_PER_SECOND, false, this->second_};
+      }
+    }
+  }
+
+  /// UTC epoch minute of the frame used by the last edge.
+  int64_t minute() const { return this->minute_; }
+  /// Frame sent during minute(), announcing the minute after it.
+  uint64_t frame() const { return this->frame_; }
+
+ protected:
+  int64_t second_;
+  int pulse_ms_{0};  // rise of the current second still due
+  int64_t minute_{INT64_MIN};
+  uint64_t frame_{0};
+};
+
+}  // namespace host
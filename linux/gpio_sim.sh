@@ -0,0 +1,65 @@
+#!/bin/sh
+# Runs the Linux transmitter against a simulated GPIO chip, without hardware.
+#
+# Creates a one-line chip with the kernel's gpio-sim module (configfs), runs
+# dcf77_gpiod on it for a few minutes and samples the line through the
+# simulator's sysfs value while it runs. Fails if the transmitter reports a
+# wrongly decoded minute or the line did not toggle about twice per second.
+# The transmitter's own edge deviation report and histogram are printed as
+# it exits.
+#
+# Needs root and a kernel with CONFIG_GPIO_SIM. Run from the repository
+# root after building dcf77_gpiod with -DDCF77_HAVE_GPIOD:
+#   sudo sh linux/gpio_sim.sh [SECONDS] [dcf77_gpiod options...]
+# SECONDS defaults to 150 (two decoded minutes need at least 121). BIN
+# overrides the transmitter binary (default ./dcf77_gpiod).
+
+set -eu
+
+RUN_SECONDS=${1:-150}
+[ $# -gt 0 ] && shift
+BIN=${BIN:-./dcf77_gpiod}
+CONFIG=/sys/kernel/config/gpio-sim/dcf77
+
+modprobe gpio-sim
+mountpoint -q /sys/kernel/config || mount -t configfs none /sys/kernel/config
+
+cleanup() {
+  [ -e "$CONFIG/live" ] && echo 0 > "$CONFIG/live"
+  rmdir "$CONFIG/bank0" "$CONFIG" 2>/dev/null || true
+}
+trap cleanup EXIT
+
+mkdir "$CONFIG" "$CONFIG/bank0"
+echo 1 > "$CONFIG/bank0/num_lines"
+echo 1 > "$CONFIG/live"
+CHIP=$(cat "$CONFIG/bank0/chip_name")
+VALUE=/sys/devices/platform/$(cat "$CONFIG/dev_name")/$CHIP/sim_gpio0/value
+echo "simulated chip $CHIP, line value in $VALUE"
+
+"$BIN" --chip="$CHIP" --line=0 --seconds="$RUN_SECONDS" --histogram "$@" &
+PID=$!
+
+changes=0
+last=
+while kill -0 "$PID" 2>/dev/null; do
+  read -r value < "$VALUE" || break
+  if [ "$value" != "$last" ]; then
+    changes=$((changes + 1))
+    last=$value
+  fi
+  sleep 0.01
+done
+status=0
+wait "$PID" || status=$?
+
+echo "line changed $changes times in $RUN_SECONDS s"
+if [ "$status" -ne 0 ]; then
+  echo "FAIL: dcf77_gpiod exited with $status"
+  exit 1
+fi
+if [ "$changes" -lt "$RUN_SECONDS" ]; then
+  echo "FAIL: the line did not follow the pulses"
+  exit 1
+fi
+echo "PASS"
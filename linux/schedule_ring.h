@@ -0,0 +1,276 @@
+#pragma once
+
+// Shared-memory ring of upcoming DCF77 minutes for local consumers on Linux.
+//
+// One producer (dcf77_ringd) computes each minute once: the frame and the
+// carrier drop and rise deadlines of every second, on the CLOCK_REALTIME
+// grid of edge_schedule.h. It publishes the minutes into a POSIX
+// shared-memory object. Consumers such as a GPIO keyer, a PCM renderer or a
+// dashboard map it read-only and read the minutes in place, with no copy
+// through the kernel and no lock.
+//
+// The object is a RingHeader followed by RING_SLOTS slots, one per minute
+// (epoch_minute % RING_SLOTS). Each slot is a seqlock. The producer makes
+// the sequence odd, writes the minute, then makes it even again. A reader
+// that sees the same even sequence before and after its read got a
+// consistent minute, and retries otherwise. Readers never write, so any
+// number can attach, and a stuck or dead reader cannot block the producer.
+// The header carries the newest published minute and a heartbeat, which
+// tells readers whether the producer is still running.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "linux/edge_schedule.h"
+
+namespace host {
+
+const uint32_t RING_MAGIC = 0x37374644;  // "DF77"
+const uint32_t RING_VERSION = 1;
+const uint32_t RING_SLOTS = 16;
+
+/// One minute of the signal.
+struct RingMinute {
+  int64_t epoch_minute;  // UTC minute the frame is sent in
+  uint64_t frame;        // announces epoch_minute + 1
+  int64_t published_ns;  // CLOCK_REALTIME when the producer wrote it
+  int64_t fall_ns[60];   // carrier drop of each second, 0 in second 59
+  int64_t rise_ns[60];   // carrier back to full, 0 in second 59
+};
+
+struct alignas(64) RingSlot {
+  std::atomic<uint32_t> sequence;  // odd while the producer writes
+  RingMinute minute;
+};
+
+struct alignas(64) RingHeader {
+  std::atomic<uint32_t> magic;  // written last, once the header is complete
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_size;
+  int32_t producer_pid;
+  char tz[64];
+  alignas(64) std::atomic<int64_t> newest_minute;  // published last; minutes go up except after clock steps
+  std::atomic<int64_t> heartbeat_ns;  // CLOCK_REALTIME of the last publish
+};
+
+struct RingLayout {
+  RingHeader header;
+  RingSlot slots[RING_SLOTS];
+};
+
+static_assert(std::atomic<int64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+
+/// Minute |epoch_minute| with the frame and edges of edge_schedule.h, using
+/// the process TZ.
+inline RingMinute ring_minute(int64_t epoch_minute) {
+  RingMinute minute{};
+  minute.epoch_minute = epoch_minute;
+  minute.frame = minute_frame(epoch_minute);
+  for (int s = 0; s < 60; s++) {
+    const int pulse = dcf77::pulse_ms(minute.frame, s);
+    if (pulse != 0) {
+      minute.fall_ns[s] = (epoch_minute * 60 + s) * NS_PER_SECOND;
+      minute.rise_ns[s] = minute.fall_ns[s] + pulse * NS_PER_MS;
+    }
+  }
+  return minute;
+}
+
+// -----------------------------------------------------------------------------
+// Producer
+// -----------------------------------------------------------------------------
+
+class ScheduleRingWriter {
+ public:
+  ~ScheduleRingWriter() {
+    if (this->ring_ != nullptr) {
+      munmap(this->ring_, sizeof(RingLayout));
+      shm_unlink(this->name_.c_str());
+    }
+  }
+
+  /// Creates or replaces the shared-memory object |name| ("/dcf77").
+  bool create(const std::string &name, const std::string &tz, std::string *error) {
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(RingLayout)) != 0) {
+      *error = name + ": " + strerror(errno);
+      if (fd >= 0)
+        close(fd);
+      return false;
+    }
+    void *p = mmap(nullptr, sizeof(RingLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      *error = name + ": " + strerror(errno);
+      shm_unlink(name.c_str());
+      return false;
+    }
+    // ftruncate() zero-fills; zero is a valid state for the atomics
+    this->ring_ = static_cast<RingLayout *>(p);
+    this->name_ = name;
+    RingHeader &header = this->ring_->header;
+    header.version = RING_VERSION;
+    header.slot_count = RING_SLOTS;
+    header.slot_size = sizeof(RingSlot);
+    header.producer_pid = static_cast<int32_t>(getpid());
+    strncpy(header.tz, tz.c_str(), sizeof(header.tz) - 1);
+    header.newest_minute.store(INT64_MIN, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header.magic.store(RING_MAGIC, std::memory_order_release);
+    return true;
+  }
+
+  void publish(const RingMinute &minute) {
+    RingSlot &slot = this->ring_->slots[static_cast<uint64_t>(minute.epoch_minute) % RING_SLOTS];
+    const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.minute, &minute, sizeof(minute));
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    RingHeader &header = this->ring_->header;
+    header.newest_minute.store(minute.epoch_minute, std::memory_order_release);
+    header.heartbeat_ns.store(minute.published_ns, std::memory_order_release);
+  }
+
+  void heartbeat(int64_t now_ns) { this->ring_->header.heartbeat_ns.store(now_ns, std::memory_order_release); }
+
+ protected:
+  RingLayout *ring_{nullptr};
+  std::string name_;
+};
+
+// -----------------------------------------------------------------------------
+// Consumers
+// -----------------------------------------------------------------------------
+
+class ScheduleRingReader {
+ public:
+  ScheduleRingReader() = default;
+  ScheduleRingReader(const ScheduleRingReader &) = delete;
+  ScheduleRingReader &operator=(const ScheduleRingReader &) = delete;
+  ~ScheduleRingReader() {
+    if (this->ring_ != nullptr)
+      munmap(const_cast<RingLayout *>(this->ring_), sizeof(RingLayout));
+  }
+
+  /// Maps the ring |name| read-only.
+  bool attach(const std::string &name, std::string *error) {
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat st {};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      *error = name + ": " + strerror(errno);
+      if (fd >= 0)
+        close(fd);
+      return false;
+    }
+    if (static_cast<size_t>(st.st_size) < sizeof(RingLayout)) {
+      close(fd);
+      *error = name + ": too small for a schedule ring";
+      return false;
+    }
+    void *p = mmap(nullptr, sizeof(RingLayout), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      *error = name + ": " + strerror(errno);
+      return false;
+    }
+    const RingLayout *ring = static_cast<const RingLayout *>(p);
+    const RingHeader &header = ring->header;
+    if (header.magic.load(std::memory_order_acquire) != RING_MAGIC || header.version != RING_VERSION ||
+        header.slot_count != RING_SLOTS || header.slot_size != sizeof(RingSlot)) {
+      munmap(p, sizeof(RingLayout));
+      *error = name + ": not a version " + std::to_string(RING_VERSION) + " schedule ring";
+      return false;
+    }
+    this->ring_ = ring;
+    return true;
+  }
+
+  const RingHeader &header() const { return this->ring_->header; }
+  int64_t newest_minute() const { return this->ring_->header.newest_minute.load(std::memory_order_acquire); }
+  int64_t heartbeat_ns() const { return this->ring_->header.heartbeat_ns.load(std::memory_order_acquire); }
+
+  /// Calls |f| with the mapped slot of |epoch_minute| and returns true if the
+  /// slot held that minute, unchanged, for the whole call. |f| may see a
+  /// half-written minute when it returns false, so it must only read, and
+  /// its results only count on success; it is called again on a retry.
+  template <class F> bool read_in_place(int64_t epoch_minute, F &&f) const {
+    const RingSlot &slot = this->ring_->slots[static_cast<uint64_t>(epoch_minute) % RING_SLOTS];
+    for (int attempt = 0; attempt < 100; attempt++) {
+      const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if ((sequence & 1) == 0) {
+        const int64_t held = slot.minute.epoch_minute;
+        f(slot.minute);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+          return held == epoch_minute;
+      }
+      this->retries_++;
+    }
+    return false;
+  }
+
+  /// Copies |epoch_minute| into |out|; false if the ring does not hold it.
+  bool read(int64_t epoch_minute, RingMinute *out) const {
+    return this->read_in_place(epoch_minute, [out](const RingMinute &minute) { memcpy(out, &minute, sizeof(*out)); });
+  }
+
+  /// Reads that saw a slot being written and had to start over.
+  uint64_t retries() const { return this->retries_; }
+
+ protected:
+  const RingLayout *ring_{nullptr};
+  mutable uint64_t retries_{0};
+};
+
+/// Edges of the minutes in a ring, in time order, for keyers that take their
+/// schedule from the producer instead of computing it.
+class RingEdgeSchedule {
+ public:
+  RingEdgeSchedule(const ScheduleRingReader &ring, int64_t start_ns)
+      : ring_(&ring), second_(start_ns >= 0 ? (start_ns + NS_PER_SECOND - 1) / NS_PER_SECOND : start_ns / NS_PER_SECOND) {}
+
+  /// Stores the next edge; false if the ring does not hold its minute (yet).
+  bool next(Edge *edge) {
+    for (;;) {
+      const int64_t minute = minute_of_second(this->second_);
+      if (minute != this->minute_.epoch_minute || !this->loaded_) {
+        if (!this->ring_->read(minute, &this->minute_))
+          return false;
+        this->loaded_ = true;
+      }
+      const int s = static_cast<int>(this->second_ - minute * 60);
+      if (this->rise_pending_) {
+        this->rise_pending_ = false;
+        *edge = Edge{this->minute_.rise_ns[s], true, this->second_++};
+        return true;
+      }
+      if (this->minute_.fall_ns[s] != 0) {
+        this->rise_pending_ = true;
+        *edge = Edge{this->minute_.fall_ns[s], false, this->second_};
+        return true;
+      }
+      this->second_++;
+    }
+  }
+
+ protected:
+  const ScheduleRingReader *ring_;
+  int64_t second_;
+  bool loaded_{false};
+  bool rise_pending_{false};
+  RingMinute minute_{};
+};
+
+}  // namespace host
@@ -0,0 +1,210 @@
+#ifndef PEER_TIME_H
+#define PEER_TIME_H
+
+// Peer time distribution for the Arduino sketch. In a building with several
+// transmitters, one unit (the leader) connects to WiFi, syncs NTP and
+// broadcasts beacons with its time and an estimate of its error. The others
+// (followers) take the time from the beacons they receive in a short listen
+// window and skip WiFi association and NTP altogether.
+//
+// Roles are kept in RTC memory across deep sleep. The leader wakes
+// peerLeaderLeadSeconds before each sync window, so its beacons are on air
+// when the others wake. A follower that hears no usable beacon falls back
+// to WiFi and NTP and leads from then on. Of several leaders, all but the
+// one with the lowest unit id yield when they hear its beacons, so the
+// group settles on one. After power-on the units do not know the WiFi
+// channel to listen on yet, so each syncs by itself once and all but one
+// yield within that first window.
+//
+// The transport is not part of this file: the sketch sends beacons by
+// ESP-NOW broadcast, the host test over UDP. Free of Serial output so it can
+// also run on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint32_t peerBeaconMagic = 0x54464344;  // "DCFT"
+const uint8_t peerBeaconVersion = 1;
+const size_t peerBeaconSize = 28;
+
+const int64_t peerBeaconIntervalUs = 500000;   // leader beacon period
+const int64_t peerListenUs = 2000000;          // follower listen window
+const int peerLeaderLeadSeconds = 60;          // leader wakes this much earlier
+const int64_t peerNtpErrorUs = 20000;          // error of a fresh NTP sync
+const int64_t peerDriftPpm = 50;               // crystal, over temperature
+const int64_t peerAirLatencyUs = 500;          // typical send to receive
+const int64_t peerLatencyBoundUs = 10000;      // delay of the least delayed beacon
+const int64_t peerMaxErrorUs = 200000;         // worst error a follower adopts
+
+enum PeerRole : uint8_t {
+  PEER_ROLE_UNKNOWN,   // after power-on
+  PEER_ROLE_LEADER,    // syncs NTP and beacons
+  PEER_ROLE_FOLLOWER,  // listens
+};
+
+// One beacon. On the wire it is little-endian, peerBeaconSize bytes, with
+// an FNV-1a check over the bytes before it.
+struct PeerBeacon {
+  uint8_t channel;    // WiFi channel the leader's network is on
+  uint16_t sequence;
+  uint32_t unitId;
+  uint32_t errorUs;   // sender's estimated error when sending
+  int64_t utcUs;      // sender's UTC when handing the beacon to the radio
+};
+
+// Role and statistics, kept across deep sleep (RTC_DATA_ATTR)
+struct PeerTimeState {
+  uint32_t magic;
+  uint8_t role;       // PeerRole
+  uint8_t channel;    // 0 until a WiFi connection told it
+  uint16_t sequence;  // beacons sent
+  uint32_t leaderId;  // unit followed last, 0 if none
+  uint32_t windowsLed;
+  uint32_t windowsFollowed;
+  uint32_t fallbacks;  // listen windows without a usable beacon
+};
+
+// What a listening unit has heard
+struct PeerListen {
+  int beacons;        // valid beacons received
+  uint32_t leaderId;  // best sender, 0 if none
+  uint32_t errorUs;   // its estimated error
+  int64_t offsetUs;   // UTC minus local time, from its least delayed beacon
+};
+
+inline void peerTimeInit(PeerTimeState& state) {
+  if (state.magic != peerBeaconMagic) {
+    state = PeerTimeState();
+    state.magic = peerBeaconMagic;
+  }
+}
+
+inline uint32_t peerFnv1a(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+inline void peerPut(uint8_t* out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+inline uint64_t peerGet(const uint8_t* in, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+inline void peerBeaconEncode(const PeerBeacon& beacon, uint8_t* out) {
+  peerPut(out, peerBeaconMagic, 4);
+  out[4] = peerBeaconVersion;
+  out[5] = beacon.channel;
+  peerPut(out + 6, beacon.sequence, 2);
+  peerPut(out + 8, beacon.unitId, 4);
+  peerPut(out + 12, beacon.errorUs, 4);
+  peerPut(out + 16, (uint64_t)beacon.utcUs, 8);
+  peerPut(out + 24, peerFnv1a(out, 24), 4);
+}
+
+// Returns false for anything that is not an intact beacon of this version
+inline bool peerBeaconDecode(const uint8_t* in, size_t length, PeerBeacon* beacon) {
+  if (length != peerBeaconSize || peerGet(in, 4) != peerBeaconMagic || in[4] != peerBeaconVersion ||
+      peerGet(in + 24, 4) != peerFnv1a(in, 24)) {
+    return false;
+  }
+  beacon->channel = in[5];
+  beacon->sequence = (uint16_t)peerGet(in + 6, 2);
+  beacon->unitId = (uint32_t)peerGet(in + 8, 4);
+  beacon->errorUs = (uint32_t)peerGet(in + 12, 4);
+  beacon->utcUs = (int64_t)peerGet(in + 16, 8);
+  return true;
+}
+
+// Estimated error of a clock synced by NTP |ageUs| ago
+inline uint32_t peerLeaderErrorUs(int64_t ageUs) {
+  return (uint32_t)(peerNtpErrorUs + ageUs * peerDriftPpm / 1000000);
+}
+
+// Estimated error of a time taken from a beacon
+inline uint32_t peerFollowerErrorUs(const PeerListen& listen) {
+  return listen.errorUs + (uint32_t)peerLatencyBoundUs;
+}
+
+// Adds a beacon received at local time |localUs|. The sender with the
+// lowest id is followed. Of its beacons, the one that gives the largest
+// offset was delayed least, since delays only make the time look earlier.
+inline void peerListenAdd(PeerListen& listen, const PeerBeacon& beacon, int64_t localUs) {
+  listen.beacons++;
+  const int64_t offsetUs = beacon.utcUs + peerAirLatencyUs - localUs;
+  if (listen.leaderId == 0 || beacon.unitId < listen.leaderId) {
+    listen.leaderId = beacon.unitId;
+    listen.errorUs = beacon.errorUs;
+    listen.offsetUs = offsetUs;
+  } else if (beacon.unitId == listen.leaderId) {
+    listen.errorUs = beacon.errorUs;
+    if (offsetUs > listen.offsetUs) {
+      listen.offsetUs = offsetUs;
+    }
+  }
+}
+
+inline bool peerListenUsable(const PeerListen& listen) {
+  return listen.leaderId != 0 && peerFollowerErrorUs(listen) <= peerMaxErrorUs;
+}
+
+// How long a unit listens before falling back to WiFi: not at all for a
+// leader, or while the channel is unknown
+inline int64_t peerListenWindowUs(const PeerTimeState& state) {
+  return state.role == PEER_ROLE_LEADER || state.channel == 0 ? 0 : peerListenUs;
+}
+
+// Ends a listen window: follows the heard leader or, without one, leads
+inline bool peerListenDone(PeerTimeState& state, const PeerListen& listen) {
+  if (peerListenUsable(listen)) {
+    state.role = PEER_ROLE_FOLLOWER;
+    state.leaderId = listen.leaderId;
+    state.windowsFollowed++;
+    return true;
+  }
+  state.fallbacks++;
+  state.role = PEER_ROLE_LEADER;
+  state.leaderId = 0;
+  return false;
+}
+
+// Starts leading a window, once NTP synced over the network on |channel|
+inline void peerLeaderStart(PeerTimeState& state, uint8_t channel) {
+  state.role = PEER_ROLE_LEADER;
+  state.channel = channel;
+  state.windowsLed++;
+}
+
+// Next beacon of a leader with UTC |utcUs| and NTP sync age |ageUs|
+inline PeerBeacon peerLeaderBeacon(PeerTimeState& state, uint32_t unitId, int64_t utcUs, int64_t ageUs) {
+  PeerBeacon beacon;
+  beacon.channel = state.channel;
+  beacon.sequence = state.sequence++;
+  beacon.unitId = unitId;
+  beacon.errorUs = peerLeaderErrorUs(ageUs);
+  beacon.utcUs = utcUs;
+  return beacon;
+}
+
+// A leader hearing another leader's beacon. Returns true if it yields: it
+// stops beaconing and follows from the next window.
+inline bool peerLeaderHeard(PeerTimeState& state, uint32_t unitId, const PeerBeacon& beacon) {
+  if (state.role != PEER_ROLE_LEADER || beacon.unitId >= unitId) {
+    return false;
+  }
+  state.role = PEER_ROLE_FOLLOWER;
+  state.leaderId = beacon.unitId;
+  return true;
+}
+
+#endif // PEER_TIME_H
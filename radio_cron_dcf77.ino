@@ -14,10 +14,43 @@
 */
 
 #include <WiFi.h>
-#include <Ticker.h>
 #include <Time.h>   // Depending on your environment, you may still need this
 #include <time.h>
+#include <esp_timer.h>
 #include "wifi.h"   // Includes multiple networks: WIFI_SSIDS[], WIFI_PASSWORDS[], etc.
+#include "sync_schedule.h"
+#include "boot_timeline.h"
+#include "time_base.h"
+#include "esphome/components/dcf77_emitter/dcf77_frame.h"  // DCF77 frame encoder shared with the ESPHome component
+#include "esphome/components/dcf77_emitter/tick_watchdog.h"  // Stall detection shared with the ESPHome component
+#include "esphome/components/dcf77_emitter/integrity_monitor.h"  // Decoder of the emitted edges, shared as well
+
+// To time WiFi, NTP and the DCF77 tick path, uncomment the following line.
+// Send 'p' over the serial monitor to print the collected statistics.
+// #define DCF77_PROFILING
+#include "esphome/components/dcf77_emitter/dcf77_probe.h"
+
+// To share one NTP sync between several transmitters, uncomment the following
+// line. One unit syncs and broadcasts its time by ESP-NOW; the others take it
+// from there without joining WiFi (see peer_time.h).
+// #define PEER_TIME
+#ifdef PEER_TIME
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <sys/time.h>
+#include "peer_time.h"
+#endif
+
+// To keep the last edges, frames and stalls in a ring and dump it to the
+// serial monitor when a stall or a self-decode error occurs, uncomment the
+// first line; host/dcf77_flight.cpp analyses the dump. With the second
+// line the ring is kept in RTC memory, so it is also dumped after a crash
+// or watchdog reset.
+// #define FLIGHT_RECORDER
+// #define FLIGHT_RECORDER_RTC
+#ifdef FLIGHT_RECORDER
+#include "esphome/components/dcf77_emitter/flight_recorder.h"
+#endif
 
 // ----------------------
 // Pin and constant definitions
@@ -34,18 +67,55 @@
 struct tm timeinfo;          // Structure for storing local time
 const int pwmChannel = 0;    // PWM channel for ledc
 
-Ticker tickerDecisec;        // Ticker object to call DcfOut function every 100 ms
+// Wall time on the microsecond timer, and the one-shot timer that calls
+// DcfOut() at every tenth of a second of it
+TimeBase timeBase;
+esp_timer_handle_t tickTimer;
+time_t codedSecond = 0;      // second that timeinfo and the frame were coded for
+
+// Blanks the rest of a minute after a late tick (see tick_watchdog.h)
+dcf77::TickWatchdog tickWatchdog;
+uint16_t edgeTenths = 0;     // tenths of the last served second with a carrier change
+uint32_t stallsReported = 0;
+
+// Decodes the emitted edges and compares each minute with the frame's time
+dcf77::IntegrityMonitor integrityMonitor;
+uint32_t integrityErrorsReported = 0;
+
+#ifdef FLIGHT_RECORDER
+// About two minutes of edges, frames and events, 20 bytes each
+#ifdef FLIGHT_RECORDER_RTC
+RTC_NOINIT_ATTR dcf77::FlightRecorder<256> flightRing;
+#else
+dcf77::FlightRecorder<256> flightRing;
+#endif
+dcf77::FlightDump flightDump;
+uint32_t flightIntegrityErrors = 0;
+#endif
 
-// Array of pulses to form the DCF77 signal (60 seconds)
-int impulseArray[60];
-int impulseCount = 0;
+// DCF77 frame for the next minute (bit n = value sent in second n)
+uint64_t dcfFrame = 0;
 int actualHours, actualMinutes, actualSecond, actualDay, actualMonth, actualYear, DayOfW;
 
-// The total time we allow for WiFi connection or initial active period
-long dontGoToSleep = 0;                // ESP32 startup time (in milliseconds)
-const long onTimeAfterReset = 1200000;  // 20 minutes in milliseconds
+// The total time we allow for WiFi connection or initial active period,
+// in microseconds of esp_timer_get_time()
+int64_t dontGoToSleepUs = 0;                       // ESP32 startup time
+const int64_t onTimeAfterResetUs = 1200000000LL;   // 20 minutes
+const int64_t wifiConnectTimeoutUs = 15000000;     // per network
 int timeRunningContinuous = 0;          // Counter for continuous transmission mode
 
+// Startup phase timeline of this boot, and the history of earlier boots
+// (kept in RTC memory, so it survives deep sleep)
+BootTimeline bootTimeline;
+RTC_DATA_ATTR BootHistory bootHistory;
+esp_sleep_wakeup_cause_t wakeCause;
+bool bootTimelineReported = false;
+
+// Stamps the end of a startup phase
+void markBootPhase(BootPhase phase) {
+  bootTimeline.phaseEnd[phase] = esp_timer_get_time();
+}
+
 // ----------------------
 // Functions for WiFi and NTP
 // ----------------------
@@ -53,21 +123,22 @@ int timeRunningContinuous = 0;          // Counter for continuous transmission m
 // This function tries one pass over all networks; returns true if connected
 // and false if it failed to connect to every network in the list.
 bool WiFi_on() {
+  DCF77_PROBE_LONG(WIFI_ON);
   Serial.println("=== WiFi ON ===");
   WiFi.mode(WIFI_STA);
 
   bool connected = false;
-  unsigned long startAttemptTime;
+  int64_t startAttemptUs;
 
   for (int i = 0; i < WIFI_NETWORK_COUNT; i++) {
     Serial.print("Connecting to WiFi network: ");
     Serial.println(WIFI_SSIDS[i]);
 
     WiFi.begin(WIFI_SSIDS[i], WIFI_PASSWORDS[i]);
-    startAttemptTime = millis();
+    startAttemptUs = esp_timer_get_time();
 
     // Give 15 seconds to connect to this network
-    while (WiFi.status() != WL_CONNECTED && (millis() - startAttemptTime) < 15000) {
+    while (WiFi.status() != WL_CONNECTED && esp_timer_get_time() - startAttemptUs < wifiConnectTimeoutUs) {
       delay(500);
       Serial.print(".");
     }
@@ -92,6 +163,7 @@ bool WiFi_on() {
 }
 
 void getNTP() {
+  DCF77_PROBE_LONG(GET_NTP);
   Serial.println("=== Getting NTP time ===");
   // Set system time via NTP (UTC)
   configTime(0, 0, ntpServer);
@@ -118,136 +190,268 @@ void show_time() {
   Serial.printf("Current Local Time: %02d:%02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
 }
 
+// Anchors the time base to the system clock just set by NTP or a peer
+void anchorTimeBase() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  int64_t monoUs = esp_timer_get_time();
+  int64_t wallUs = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#ifdef FLIGHT_RECORDER
+  int64_t offsetUs = timeBase.anchored ? wallUs - timeBaseWallUs(timeBase, monoUs) : 0;
+  flightRing.record(dcf77::flight_record(dcf77::FLIGHT_READING, wallUs, offsetUs, 1));
+#endif
+  timeBaseAnchor(timeBase, monoUs, wallUs);
+}
+
+// Local time now from the time base; returns the microseconds into the
+// current minute
+int64_t localTimeNow(struct tm* local) {
+  int64_t wallUs = timeBaseWallUs(timeBase, esp_timer_get_time());
+  time_t second = (time_t)(wallUs / 1000000);
+  localtime_r(&second, local);
+  return local->tm_sec * 1000000LL + wallUs % 1000000;
+}
+
+#ifdef PEER_TIME
 // ----------------------
-// DCF77 signal generation
+// Peer time distribution
 // ----------------------
+RTC_DATA_ATTR PeerTimeState peerState;  // role, kept across deep sleep
+uint32_t peerUnitId;                    // last four bytes of the MAC address
+int64_t peerSyncedUs = 0;               // esp_timer time of this unit's NTP sync
+int64_t peerLastBeaconUs = 0;
+bool peerBeaconing = false;
+const uint8_t peerBroadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Last beacon received, handed over from the WiFi task
+volatile bool peerReceived = false;
+uint8_t peerPacket[peerBeaconSize];
+int64_t peerPacketUs;
+
+void onPeerReceive(const uint8_t* mac, const uint8_t* data, int len) {
+  if (peerReceived || len != (int)peerBeaconSize) {
+    return;
+  }
+  peerPacketUs = esp_timer_get_time();
+  memcpy(peerPacket, data, len);
+  peerReceived = true;
+}
 
-// Convert a decimal number to BCD
-int Bin2Bcd(int dato) {
-  int msb, lsb;
-  if (dato < 10)
-    return dato;
-  msb = (dato / 10) << 4;
-  lsb = dato % 10;
-  return msb + lsb;
+// Starts ESP-NOW on the given channel without joining a network
+bool peerRadioOn(uint8_t channel) {
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  if (esp_now_init() != ESP_OK) {
+    return false;
+  }
+  esp_now_register_recv_cb(onPeerReceive);
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, peerBroadcast, sizeof(peerBroadcast));
+  peer.channel = channel;
+  peer.encrypt = false;
+  return esp_now_add_peer(&peer) == ESP_OK;
 }
 
-// The CodeTime() function forms the impulseArray for the DCF77 signal
-void CodeTime() {
-  // Determine the day of the week (0 -> 7 for DCF77)
-  DayOfW = timeinfo.tm_wday;
-  if (DayOfW == 0) DayOfW = 7;
-  
-  actualDay    = timeinfo.tm_mday;
-  actualMonth  = timeinfo.tm_mon + 1;
-  actualYear   = timeinfo.tm_year - 100;  // use a 2-digit year
-  actualHours  = timeinfo.tm_hour;
-  // DCF77 transmits time for the next minute
-  actualMinutes = timeinfo.tm_min + 1;
-  if (actualMinutes >= 60) {
-    actualMinutes = 0;
-    actualHours++;
+void peerRadioOff() {
+  esp_now_deinit();
+  WiFi_off();
+}
+
+// Takes the last received beacon, if there is a valid one
+bool peerTakeBeacon(PeerBeacon* beacon, int64_t* receivedUs) {
+  if (!peerReceived) {
+    return false;
+  }
+  bool valid = peerBeaconDecode(peerPacket, peerBeaconSize, beacon);
+  *receivedUs = peerPacketUs;
+  peerReceived = false;
+  return valid;
+}
+
+// Listens for the leader's beacons. Returns true if it set the clock from
+// them, false if the unit has to sync by WiFi and NTP itself.
+bool peerTimeListen() {
+  int64_t windowUs = peerListenWindowUs(peerState);
+  if (windowUs == 0 || !peerRadioOn(peerState.channel)) {
+    return false;
+  }
+  Serial.printf("Listening for peer beacons on channel %d...\n", peerState.channel);
+  PeerListen listen = {};
+  int64_t endUs = esp_timer_get_time() + windowUs;
+  while (esp_timer_get_time() < endUs) {
+    PeerBeacon beacon;
+    int64_t receivedUs;
+    if (peerTakeBeacon(&beacon, &receivedUs)) {
+      peerListenAdd(listen, beacon, receivedUs);
+    }
+    delay(1);
+  }
+  peerRadioOff();
+  if (!peerListenDone(peerState, listen)) {
+    Serial.printf("No usable peer beacon (%d heard). Syncing by WiFi.\n", listen.beacons);
+    return false;
+  }
+
+  int64_t utcUs = esp_timer_get_time() + listen.offsetUs;
+  struct timeval tv;
+  tv.tv_sec = (time_t)(utcUs / 1000000);
+  tv.tv_usec = (suseconds_t)(utcUs % 1000000);
+  settimeofday(&tv, NULL);
+  setenv("TZ", TZ_INFO, 1);
+  tzset();
+  getLocalTime(&timeinfo);
+  Serial.printf("Time from unit %08x (%d beacons), estimated error %.1f ms\n", (unsigned)listen.leaderId,
+                listen.beacons, peerFollowerErrorUs(listen) / 1000.0);
+  return true;
+}
+
+// Starts beaconing after this unit's own NTP sync
+void peerTimeLead() {
+  peerLeaderStart(peerState, (uint8_t)WiFi.channel());
+  peerSyncedUs = esp_timer_get_time();
+  peerBeaconing = peerRadioOn(peerState.channel);
+  Serial.printf("Leading peer time on channel %d\n", peerState.channel);
+}
+
+// Called from loop(): sends a beacon every peerBeaconIntervalUs and yields
+// to a leader with a lower id
+void peerTimeBeacon() {
+  PeerBeacon heard;
+  int64_t receivedUs;
+  if (peerTakeBeacon(&heard, &receivedUs) && peerLeaderHeard(peerState, peerUnitId, heard)) {
+    Serial.printf("Unit %08x leads; following it from the next window\n", (unsigned)heard.unitId);
+    peerBeaconing = false;
+    peerRadioOff();
+    return;
   }
+  int64_t nowUs = esp_timer_get_time();
+  if (nowUs - peerLastBeaconUs < peerBeaconIntervalUs) {
+    return;
+  }
+  peerLastBeaconUs = nowUs;
+  PeerBeacon beacon = peerLeaderBeacon(peerState, peerUnitId, timeBaseWallUs(timeBase, nowUs),
+                                       nowUs - peerSyncedUs);
+  uint8_t packet[peerBeaconSize];
+  peerBeaconEncode(beacon, packet);
+  esp_now_send(peerBroadcast, packet, sizeof(packet));
+}
+#endif
+
+// ----------------------
+// DCF77 signal generation
+// ----------------------
+
+// The CodeTime() function forms the DCF77 frame for the next minute
+void CodeTime() {
+  DCF77_PROBE(CODE_TIME);
+  // DCF77 transmits the time for the next minute. Going through time_t
+  // keeps the date and DST flag right when that minute crosses midnight,
+  // the end of a month or a DST change.
+  struct tm current = timeinfo;
+  time_t next = mktime(&current) + 60;
+  struct tm nextinfo;
+  localtime_r(&next, &nextinfo);
+  dcf77::CivilMinute civil = dcf77::civil_from_tm(nextinfo);
+
+  DayOfW        = civil.day_of_week;
+  actualDay     = civil.day;
+  actualMonth   = civil.month;
+  actualYear    = civil.year;  // 2-digit year
+  actualHours   = civil.hour;
+  actualMinutes = civil.minute;
   actualSecond = timeinfo.tm_sec;
   if (actualSecond == 60) actualSecond = 0;
 
-  int n, Tmp, TmpIn;
-  int ParityCount = 0;
-
-  // First 20 seconds – logical "0" (100 ms pulse)
-  for (n = 0; n < 20; n++) {
-    impulseArray[n] = 1;
+  uint64_t frame = dcf77::encode_frame(civil);
+#ifdef FLIGHT_RECORDER
+  if (frame != dcfFrame) {
+    time_t minuteStart = next - 60 - timeinfo.tm_sec;
+    flightRing.record(dcf77::flight_record(dcf77::FLIGHT_FRAME, minuteStart * 1000000LL,
+                                           (int32_t)(frame >> 32), (uint32_t)frame));
   }
+#endif
+  dcfFrame = frame;
+  integrityMonitor.expect(civil);
+}
 
-  // Set bits for DST: if tm_isdst == 0, DST is off
-  if (timeinfo.tm_isdst == 0) {
-    impulseArray[18] = 2;  // 200 ms pulse – DST OFF
-  } else {
-    impulseArray[17] = 2;  // 200 ms pulse – DST ON
-  }
-
-  // Bit 20 – active time indicator
-  impulseArray[20] = 2;
-
-  // Form bits for minutes (bits 21..27) and parity bit (28)
-  ParityCount = 0;
-  TmpIn = Bin2Bcd(actualMinutes);
-  for (n = 21; n < 28; n++) {
-    Tmp = TmpIn & 1;
-    impulseArray[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  impulseArray[28] = ((ParityCount & 1) == 0) ? 1 : 2;
-
-  // Form bits for hours (bits 29..34) and parity bit (35)
-  ParityCount = 0;
-  TmpIn = Bin2Bcd(actualHours);
-  for (n = 29; n < 35; n++) {
-    Tmp = TmpIn & 1;
-    impulseArray[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  impulseArray[35] = ((ParityCount & 1) == 0) ? 1 : 2;
-
-  // Form bits for the date: day, day of the week, month, year, and the parity bit (58)
-  ParityCount = 0;
-  TmpIn = Bin2Bcd(actualDay);
-  for (n = 36; n < 42; n++) {
-    Tmp = TmpIn & 1;
-    impulseArray[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  TmpIn = Bin2Bcd(DayOfW);
-  for (n = 42; n < 45; n++) {
-    Tmp = TmpIn & 1;
-    impulseArray[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  TmpIn = Bin2Bcd(actualMonth);
-  for (n = 45; n < 50; n++) {
-    Tmp = TmpIn & 1;
-    impulseArray[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  TmpIn = Bin2Bcd(actualYear);
-  for (n = 50; n < 58; n++) {
-    Tmp = TmpIn & 1;
-    impulseArray[n] = Tmp + 1;
-    ParityCount += Tmp;
-    TmpIn >>= 1;
-  }
-  impulseArray[58] = ((ParityCount & 1) == 0) ? 1 : 2;
-
-  // The last second – no pulse
-  impulseArray[59] = 0;
+// Reports a DCF77 carrier edge just written for tick |tick| to the
+// integrity monitor and the flight recorder
+void noteEdge(int64_t tick, bool reduced) {
+  int64_t writtenUs = esp_timer_get_time();
+  integrityMonitor.edge(writtenUs, reduced);
+#ifdef FLIGHT_RECORDER
+  int64_t dueUs = tick * tickPeriodUs;
+  int64_t wallUs = timeBaseWallUs(timeBase, writtenUs);
+  flightRing.record(dcf77::flight_record(dcf77::FLIGHT_EDGE, dueUs, wallUs - dueUs, reduced ? 1 : 0));
+  if (integrityMonitor.total_errors() != flightIntegrityErrors) {
+    flightIntegrityErrors = integrityMonitor.total_errors();
+    flightRing.record(dcf77::flight_record(dcf77::FLIGHT_INTEGRITY, wallUs, 0, flightIntegrityErrors,
+                                           integrityMonitor.last_error()));
+    flightRing.trigger_dump(dcf77::FLIGHT_TRIGGER_INTEGRITY);
+  }
+#endif
 }
 
-// The DcfOut() function is called every 100 ms and generates the DCF77 signal
+// Called by tickTimer at every tenth of a second of wall time; generates the
+// DCF77 signal and arms the timer for the next tenth
 void DcfOut() {
-  switch (impulseCount++) {
+  DCF77_PROBE(DCF_OUT);
+  int64_t nowUs = esp_timer_get_time();
+  int64_t tick = tickIndex(timeBase, nowUs);
+  int stall = tickWatchdog.check(tick, nowUs - tickDeadlineUs(timeBase, tick), edgeTenths, false);
+  time_t second = (time_t)(tick / 10);
+  if (second != codedSecond) {
+    // Recalculate the frame for the new second
+    codedSecond = second;
+    localtime_r(&second, &timeinfo);
+    CodeTime();
+  }
+  int pulse = dcf77::pulse_ms(dcfFrame, actualSecond);
+  edgeTenths = pulse == 0 ? 0 : (1 | 1 << (pulse / 100));
+  if (stall >= 0) {
+    // Carrier on without reductions until the next minute marker
+    digitalWrite(LEDBUILTIN, HIGH);
+    ledcWrite(pwmChannel, 127);
+#ifdef FLIGHT_RECORDER
+    flightRing.record(dcf77::flight_record(dcf77::FLIGHT_STALL, tick * tickPeriodUs,
+                                           nowUs - tickDeadlineUs(timeBase, tick), 0, (uint8_t)stall));
+    flightRing.trigger_dump(dcf77::FLIGHT_TRIGGER_STALL);
+#endif
+  }
+  if (!tickWatchdog.modulating()) {
+    integrityMonitor.restart();
+    esp_timer_start_once(tickTimer, tickDelayUs(timeBase, tick + 1, esp_timer_get_time()));
+    return;
+  }
+  switch (tick % 10) {
     case 0:
-      if (impulseArray[actualSecond] != 0) {
+      if (pulse != 0) {
         digitalWrite(LEDBUILTIN, LOW);
         ledcWrite(pwmChannel, 0);
+        noteEdge(tick, true);
+        if (bootTimeline.phaseEnd[PHASE_FIRST_PULSE] == 0) {
+          markBootPhase(PHASE_FIRST_PULSE);
+        }
       }
       break;
     case 1:
-      if (impulseArray[actualSecond] == 1) {
+      if (pulse == 100) {
         digitalWrite(LEDBUILTIN, HIGH);
         ledcWrite(pwmChannel, 127);
+        noteEdge(tick, false);
       }
       break;
     case 2:
       digitalWrite(LEDBUILTIN, HIGH);
       ledcWrite(pwmChannel, 127);
+      // Only the end of a 200 ms pulse changes the carrier here; after a
+      // 100 ms pulse or none it is already on and no edge is written
+      if (pulse == 200) {
+        noteEdge(tick, false);
+      }
       break;
     case 9:
-      impulseCount = 0;
       // Print bit information for the current second to the console
       if (actualSecond == 1 || actualSecond == 15 ||
           actualSecond == 21 || actualSecond == 29)
@@ -258,9 +462,9 @@ void DcfOut() {
       if (actualSecond == 28 || actualSecond == 35 ||
           actualSecond == 58)
         Serial.print("P");
-      if (impulseArray[actualSecond] == 1)
+      if (pulse == 100)
         Serial.print("0");
-      if (impulseArray[actualSecond] == 2)
+      if (pulse == 200)
         Serial.print("1");
       if (actualSecond == 59) {
         Serial.println();
@@ -268,25 +472,41 @@ void DcfOut() {
       }
       break;
   }
-  // Update time and recalculate the pulse array
-  if (!getLocalTime(&timeinfo)) {
-    Serial.println("Error obtaining time...");
-    delay(3000);
-    ESP.restart();
+  esp_timer_start_once(tickTimer, tickDelayUs(timeBase, tick + 1, esp_timer_get_time()));
+}
+
+#ifdef FLIGHT_RECORDER
+// Writes a due flight recorder dump, a few lines per call so the loop
+// stays responsive
+void writeFlightDump() {
+  if (!flightDump.active()) {
+    dcf77::FlightTrigger trigger = flightRing.due();
+    if (trigger == dcf77::FLIGHT_TRIGGER_NONE) {
+      return;
+    }
+    flightDump.begin(flightRing, trigger);
+    Serial.printf("\nFlight recorder dump (%s), analyse with host/dcf77_flight:\n",
+                  dcf77::flight_trigger_name(trigger));
+  }
+  char line[dcf77::FlightDump::LINE_SIZE];
+  for (int i = 0; i < 8 && flightDump.next_line(flightRing, line); i++) {
+    // One write per line, so the bits printed by DcfOut() fall between lines
+    Serial.printf("%s\n", line);
+  }
+  if (!flightDump.active() && flightDump.lost() != 0) {
+    Serial.printf("Flight recorder: %u records were overwritten during the dump\n", (unsigned)flightDump.lost());
   }
-  CodeTime();
+}
+#endif
+
+void onTick(void* arg) {
+  DcfOut();
 }
 
 // ----------------------
 // Sync windows and deep sleep logic
 // ----------------------
 
-// Structure of a sync window (start time and duration)
-struct SyncWindow {
-  int hour;   // Start hour
-  int minute; // Start minute
-};
-
 // Define the synchronization windows
 // (each window lasted 20 minutes in the original code; now modified to 10 minutes)
 // Added new window at 00:00.
@@ -303,50 +523,88 @@ const SyncWindow syncWindows[] = {
 };
 const int numSyncWindows = sizeof(syncWindows) / sizeof(syncWindows[0]);
 
-// Checks if the current time is within one of the sync windows
-bool isSyncWindowActive() {
-  int nowMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-  for (int i = 0; i < numSyncWindows; i++) {
-    int start = syncWindows[i].hour * 60 + syncWindows[i].minute;
-    int end = start + 10; // each window now lasts 10 minutes
-    if (nowMinutes >= start && nowMinutes < end) {
-      Serial.printf("Sync window active: %02d:%02d to %02d:%02d\n",
-                    syncWindows[i].hour, syncWindows[i].minute,
-                    syncWindows[i].hour, syncWindows[i].minute + 10);
-      return true;
-    }
+// Checks if the given local time is within one of the sync windows
+bool isSyncWindowActive(const struct tm& local) {
+  int nowMinutes = local.tm_hour * 60 + local.tm_min;
+  int i = activeSyncWindow(syncWindows, numSyncWindows, nowMinutes);
+  if (i < 0) {
+    return false;
   }
-  return false;
+  Serial.printf("Sync window active: %02d:%02d to %02d:%02d\n",
+                syncWindows[i].hour, syncWindows[i].minute,
+                syncWindows[i].hour, syncWindows[i].minute + syncWindowMinutes);
+  return true;
 }
 
-// Calculates the time (in seconds) until the start of the next sync window
-unsigned long secondsToNextSyncWindow() {
-  int nowMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-  int minDiff = 24 * 60; // maximum value for a day
-  for (int i = 0; i < numSyncWindows; i++) {
-    int start = syncWindows[i].hour * 60 + syncWindows[i].minute;
-    int diff = start - nowMinutes;
-    if (diff < 0) diff += 24 * 60; // if the window has already passed, add a day
-    if (diff < minDiff) {
-      minDiff = diff;
-    }
-  }
-  Serial.printf("Next sync window in %d minutes (~%lu seconds)\n", minDiff, minDiff * 60UL);
-  return minDiff * 60UL; // convert minutes to seconds
+// Calculates the time (in microseconds) from the given local time until the
+// start of the next sync window
+int64_t microsToNextSyncWindow(const struct tm& local, int64_t usIntoMinute) {
+  int nowMinutes = local.tm_hour * 60 + local.tm_min;
+  int64_t sleepUs = microsToNextSyncWindow(syncWindows, numSyncWindows, nowMinutes, usIntoMinute);
+  Serial.printf("Next sync window in %.3f seconds\n", sleepUs / 1e6);
+  return sleepUs;
+}
+
+// Prints the RAM taken by the sketch's globals, the stack the loop and
+// esp_timer tasks never used, and the heap low-water mark. Send 'm' over the
+// serial monitor for the current values; they are also printed after the
+// first pulse and before deep sleep.
+void reportMemory() {
+  Serial.println("=== Memory (bytes) ===");
+  Serial.printf("Frame and time:    %u\n",
+                (unsigned)(sizeof(dcfFrame) + sizeof(timeinfo) + sizeof(timeBase) + sizeof(codedSecond) +
+                           sizeof(actualHours) + sizeof(actualMinutes) + sizeof(actualSecond) + sizeof(actualDay) +
+                           sizeof(actualMonth) + sizeof(actualYear) + sizeof(DayOfW)));
+  Serial.printf("Sync windows:      %u (%d windows, in flash)\n", (unsigned)sizeof(syncWindows), numSyncWindows);
+  Serial.printf("WiFi credentials:  %u (%d networks, strings in flash)\n",
+                (unsigned)(sizeof(WIFI_SSIDS) + sizeof(WIFI_PASSWORDS)), WIFI_NETWORK_COUNT);
+  Serial.printf("Tick watchdog:     %u\n", (unsigned)sizeof(tickWatchdog));
+  Serial.printf("Integrity monitor: %u\n", (unsigned)sizeof(integrityMonitor));
+  Serial.printf("Boot history:      %u (RTC memory)\n", (unsigned)sizeof(bootHistory));
+#ifdef PEER_TIME
+  Serial.printf("Peer time state:   %u (RTC memory)\n", (unsigned)sizeof(peerState));
+#endif
+#ifdef FLIGHT_RECORDER
+#ifdef FLIGHT_RECORDER_RTC
+  Serial.printf("Flight recorder:   %u (RTC memory)\n", (unsigned)(sizeof(flightRing) + sizeof(flightDump)));
+#else
+  Serial.printf("Flight recorder:   %u\n", (unsigned)(sizeof(flightRing) + sizeof(flightDump)));
+#endif
+#endif
+#ifdef DCF77_PROFILING
+  Serial.printf("Probe table:       %u\n", (unsigned)(sizeof(dcf77::probe::Stats) * dcf77::probe::COUNT));
+#endif
+  // DcfOut() runs in the esp_timer task, everything else in the loop task
+  TaskHandle_t timerTask = xTaskGetHandle("esp_timer");
+  Serial.printf("Stack never used:  loop task %u, esp_timer task %u\n",
+                (unsigned)uxTaskGetStackHighWaterMark(NULL),
+                timerTask != NULL ? (unsigned)uxTaskGetStackHighWaterMark(timerTask) : 0);
+  Serial.printf("Heap free:         %u, minimum since boot %u\n", (unsigned)ESP.getFreeHeap(),
+                (unsigned)ESP.getMinFreeHeap());
 }
 
 // Goes into deep sleep if outside the sync window (unless CONTINUOUSMODE is defined)
 void checkSleep() {
+  DCF77_PROBE_LONG(CHECK_SLEEP);
 #ifdef CONTINUOUSMODE
   Serial.println("Continuous mode enabled. Skipping sleep check.");
   return;
 #else
   // If more than 20 minutes have passed since power on, check the sync window
-  if (millis() - dontGoToSleep > onTimeAfterReset) {
-    if (!isSyncWindowActive()) {
-      unsigned long sleepSeconds = secondsToNextSyncWindow();
-      Serial.printf("Outside sync window. Going to deep sleep for %lu seconds...\n", sleepSeconds);
-      ESP.deepSleep(sleepSeconds * 1000000ULL);
+  if (esp_timer_get_time() - dontGoToSleepUs > onTimeAfterResetUs) {
+    struct tm local;
+    int64_t usIntoMinute = localTimeNow(&local);
+    if (!isSyncWindowActive(local)) {
+      int64_t sleepUs = microsToNextSyncWindow(local, usIntoMinute);
+#ifdef PEER_TIME
+      // The leader wakes early, so its beacons are on air when the others wake
+      if (peerState.role == PEER_ROLE_LEADER && sleepUs > peerLeaderLeadSeconds * 1000000LL) {
+        sleepUs -= peerLeaderLeadSeconds * 1000000LL;
+      }
+#endif
+      Serial.printf("Outside sync window. Going to deep sleep for %.3f seconds...\n", sleepUs / 1e6);
+      reportMemory();
+      ESP.deepSleep((uint64_t)sleepUs);
     } else {
       Serial.println("Within sync window. Staying awake.");
     }
@@ -356,10 +614,49 @@ void checkSleep() {
 #endif
 }
 
+#ifdef DCF77_PROFILING
+// Prints the profiling statistics collected so far
+void dumpProbes() {
+  Serial.println("=== Profiling probes ===");
+  dcf77::probe::for_each([](const char *name, const char *unit, const dcf77::probe::Stats &s) {
+    Serial.printf("%-20s count=%u min=%u avg=%u max=%u %s\n", name, (unsigned)s.count, (unsigned)s.min,
+                  (unsigned)(s.total / s.count), (unsigned)s.max, unit);
+  });
+}
+#endif
+
+// Prints this boot's phase timeline and the time to first pulse of the
+// boots kept in the history, then adds this boot to it
+void reportBootTimeline() {
+  bootHistoryAdd(bootHistory, bootTimeline, wakeCause);
+  const BootRecord& record = bootHistoryRecord(bootHistory, bootHistoryLength(bootHistory) - 1);
+
+  Serial.printf("=== Boot timeline (wake-up cause %d) ===\n", (int)wakeCause);
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    if (bootTimeline.phaseEnd[i] == 0) {
+      Serial.printf("%-13s skipped\n", bootPhaseName(i));
+    } else {
+      Serial.printf("%-13s %10.1f ms  (at %10.1f ms)\n", bootPhaseName(i),
+                    record.phaseUs[i] / 1000.0, bootTimeline.phaseEnd[i] / 1000.0);
+    }
+  }
+  Serial.printf("Time to first pulse: %.1f ms\n", bootTimeToFirstPulseUs(record) / 1000.0);
+
+  Serial.printf("Last %d boots (time to first pulse in ms, oldest first):", bootHistoryLength(bootHistory));
+  for (int i = 0; i < bootHistoryLength(bootHistory); i++) {
+    Serial.printf(" %.0f", bootTimeToFirstPulseUs(bootHistoryRecord(bootHistory, i)) / 1000.0);
+  }
+  Serial.println();
+}
+
 // ----------------------
 // setup() and loop()
 // ----------------------
 void setup() {
+  markBootPhase(PHASE_BOOT);
+  bootHistoryInit(bootHistory);
+  wakeCause = esp_sleep_get_wakeup_cause();
+
   // Disable wake-up from other sources
   esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
   
@@ -367,42 +664,80 @@ void setup() {
   Serial.println();
   Serial.println("=== DCF77 Transmitter with Scheduled Sync Windows ===");
 
-  // Record the time the device was started (not from deep sleep)
-  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
-    dontGoToSleep = millis();
-    Serial.printf("Device started at millis: %lu\n", dontGoToSleep);
+#ifdef FLIGHT_RECORDER
+  // A ring in RTC memory still holds what led up to a crash or watchdog
+  // reset; dump it once the loop runs
+  esp_reset_reason_t resetReason = esp_reset_reason();
+  if (flightRing.init() && (resetReason == ESP_RST_PANIC || resetReason == ESP_RST_INT_WDT ||
+                            resetReason == ESP_RST_TASK_WDT || resetReason == ESP_RST_WDT ||
+                            resetReason == ESP_RST_BROWNOUT)) {
+    Serial.printf("Flight recorder kept records across the reset (reason %d)\n", (int)resetReason);
+    flightRing.trigger_dump(dcf77::FLIGHT_TRIGGER_RESET);
   }
+#endif
 
-  // Keep trying to connect to WiFi for up to 20 minutes
-  bool connected = false;
-  while ((millis() - dontGoToSleep) < onTimeAfterReset) {
-    if (WiFi_on()) {
-      // If we got connected during this pass, break
-      connected = true;
-      break;
-    } else {
-      // Failed to connect in this pass — wait a bit before retrying
-      Serial.println("Will try again in 5 seconds...");
-      delay(5000);
-    }
+  // Record the time the device was started (not from deep sleep)
+  if (wakeCause == ESP_SLEEP_WAKEUP_UNDEFINED) {
+    dontGoToSleepUs = esp_timer_get_time();
+    Serial.printf("Device started at %.3f s\n", dontGoToSleepUs / 1e6);
   }
 
-  // If, after 20 minutes, we are still not connected, go to deep sleep
-  if (!connected) {
-    Serial.println("No WiFi connection after 20 minutes. Going to deep sleep...");
-    // You can choose how long to sleep (e.g., 1 hour) or go back to scheduling logic
-    // For now, let's just deep sleep for 1 hour as an example:
-    ESP.deepSleep(3600ULL * 1000000ULL);
+#ifdef PEER_TIME
+  // A follower takes the time from the leader's beacons and skips WiFi
+  peerTimeInit(peerState);
+  peerUnitId = (uint32_t)(ESP.getEfuseMac() >> 16);
+  bool timeFromPeers = peerTimeListen();
+  if (timeFromPeers) {
+    markBootPhase(PHASE_NTP);
   }
+#else
+  bool timeFromPeers = false;
+#endif
 
-  // Otherwise, if we are connected, proceed with NTP sync
-  getNTP();
-  WiFi_off();
+  if (!timeFromPeers) {
+    // Keep trying to connect to WiFi for up to 20 minutes
+    bool connected = false;
+    while (esp_timer_get_time() - dontGoToSleepUs < onTimeAfterResetUs) {
+      if (WiFi_on()) {
+        // If we got connected during this pass, break
+        connected = true;
+        break;
+      } else {
+        // Failed to connect in this pass — wait a bit before retrying
+        Serial.println("Will try again in 5 seconds...");
+        delay(5000);
+      }
+    }
+
+    // If, after 20 minutes, we are still not connected, go to deep sleep
+    if (!connected) {
+      Serial.println("No WiFi connection after 20 minutes. Going to deep sleep...");
+      // You can choose how long to sleep (e.g., 1 hour) or go back to scheduling logic
+      // For now, let's just deep sleep for 1 hour as an example:
+      ESP.deepSleep(3600ULL * 1000000ULL);
+    }
+    markBootPhase(PHASE_WIFI);
+
+    // Otherwise, if we are connected, proceed with NTP sync
+    getNTP();
+    markBootPhase(PHASE_NTP);
+#ifdef PEER_TIME
+    peerTimeLead();
+    if (!peerBeaconing) {
+      WiFi_off();
+    }
+#else
+    WiFi_off();
+#endif
+    markBootPhase(PHASE_WIFI_OFF);
+  }
+  anchorTimeBase();
   show_time();
 
 #ifndef CONTINUOUSMODE
   // If more than 20 minutes have passed and we're outside the sync window, go to deep sleep
   checkSleep();
+  markBootPhase(PHASE_CHECK_SLEEP);
 #else
   Serial.println("Continuous mode active. Device will not enter deep sleep.");
 #endif
@@ -414,45 +749,65 @@ void setup() {
 
   pinMode(LEDBUILTIN, OUTPUT);
   digitalWrite(LEDBUILTIN, LOW);
+  markBootPhase(PHASE_LEDC);
 
   // Build the initial DCF77 pulse array
+  localTimeNow(&timeinfo);
   CodeTime();
+  markBootPhase(PHASE_CODE_TIME);
+
+  // The first tick starts the next second
+  esp_timer_create_args_t tickArgs = {};
+  tickArgs.callback = onTick;
+  tickArgs.name = "dcf_tick";
+  esp_timer_create(&tickArgs, &tickTimer);
+  int64_t firstTick = (tickIndex(timeBase, esp_timer_get_time()) / 10 + 1) * 10;
+  esp_timer_start_once(tickTimer, tickDelayUs(timeBase, firstTick, esp_timer_get_time()));
+  Serial.printf("First tick in %.3f ms\n", tickDelayUs(timeBase, firstTick, esp_timer_get_time()) / 1000.0);
+  markBootPhase(PHASE_SECOND_ALIGN);
+}
 
-  // Synchronize with the start of a second for accurate transmission
-  Serial.print("Syncing with start of a second... ");
-  int startSecond = timeinfo.tm_sec;
-  long count = 0;
-  while (true) {
-    count++;
-    if (!getLocalTime(&timeinfo)) {
-      Serial.println("Error obtaining time...");
-      delay(3000);
-      ESP.restart();
-    }
-    if (timeinfo.tm_sec != startSecond) break;
+void loop() {
+  // The first pulse is stamped in DcfOut(); report it from here rather than
+  // from the timer callback
+  if (!bootTimelineReported && bootTimeline.phaseEnd[PHASE_FIRST_PULSE] != 0) {
+    bootTimelineReported = true;
+    reportBootTimeline();
+    reportMemory();
   }
-  Serial.print("Synced after ");
-  Serial.print(count);
-  Serial.println(" checks.");
 
-  // Start the Ticker which calls DcfOut() every 100 ms
-  tickerDecisec.attach_ms(100, DcfOut);
-}
+  // Stalls are counted in DcfOut(); report them from here as well
+  if (tickWatchdog.total_stalls() != stallsReported) {
+    stallsReported = tickWatchdog.total_stalls();
+    Serial.printf("\nTick stalls: %u late tick, %u skipped ticks; blanked %u times\n",
+                  (unsigned)tickWatchdog.stalls(dcf77::STALL_LATE_TICK),
+                  (unsigned)tickWatchdog.stalls(dcf77::STALL_SKIPPED_TICKS), (unsigned)tickWatchdog.blanks());
+  }
+  if (integrityMonitor.total_errors() != integrityErrorsReported) {
+    integrityErrorsReported = integrityMonitor.total_errors();
+    Serial.printf("\nSelf-decode: %u of %u minutes correct; errors: %u width, %u spacing, %u framing, %u parity, "
+                  "%u mismatch\n",
+                  (unsigned)integrityMonitor.minutes_ok(), (unsigned)integrityMonitor.minutes_checked(),
+                  (unsigned)integrityMonitor.errors(dcf77::IntegrityMonitor::ERROR_WIDTH),
+                  (unsigned)integrityMonitor.errors(dcf77::IntegrityMonitor::ERROR_SPACING),
+                  (unsigned)integrityMonitor.errors(dcf77::IntegrityMonitor::ERROR_FRAMING),
+                  (unsigned)integrityMonitor.errors(dcf77::IntegrityMonitor::ERROR_PARITY),
+                  (unsigned)integrityMonitor.errors(dcf77::IntegrityMonitor::ERROR_MISMATCH));
+  }
 
-void loop() {
 #ifndef CONTINUOUSMODE
   // Every 30 seconds, check if the sync window has ended
-  static unsigned long lastCheck = 0;
-  if (millis() - lastCheck > 30000) {
-    lastCheck = millis();
+  static int64_t lastCheckUs = 0;
+  if (esp_timer_get_time() - lastCheckUs > 30000000) {
+    lastCheckUs = esp_timer_get_time();
     Serial.println("Periodic check of sync window...");
     // If the initial 20-minute period has passed
-    if (millis() - dontGoToSleep > onTimeAfterReset) {
-      if (!isSyncWindowActive()) {
+    if (esp_timer_get_time() - dontGoToSleepUs > onTimeAfterResetUs) {
+      struct tm local;
+      localTimeNow(&local);
+      if (!isSyncWindowActive(local)) {
         Serial.println("Sync window ended. Preparing to enter deep sleep.");
-        if (getLocalTime(&timeinfo)) {
-          checkSleep();
-        }
+        checkSleep();
       } else {
         Serial.println("Still within sync window. Continuing operation.");
       }
@@ -461,5 +816,24 @@ void loop() {
     }
   }
 #endif
-  // All other work is performed via the Ticker (DcfOut function)
+#ifdef PEER_TIME
+  if (peerBeaconing) {
+    peerTimeBeacon();
+  }
+#endif
+#ifdef FLIGHT_RECORDER
+  writeFlightDump();
+#endif
+  if (Serial.available()) {
+    char command = Serial.read();
+    if (command == 'm') {
+      reportMemory();
+    }
+#ifdef DCF77_PROFILING
+    if (command == 'p') {
+      dumpProbes();
+    }
+#endif
+  }
+  // All other work is performed by tickTimer (DcfOut function)
 }
@@ -0,0 +1,49 @@
+#ifndef SYNC_SCHEDULE_H
+#define SYNC_SCHEDULE_H
+
+// Sync window arithmetic for the Arduino sketch, kept free of Serial output
+// so it can also be measured on the host.
+
+#include <stdint.h>
+
+// Structure of a sync window (start time)
+struct SyncWindow {
+  int hour;   // Start hour
+  int minute; // Start minute
+};
+
+const int syncWindowMinutes = 10;  // each window lasts 10 minutes
+
+// Returns the index of the window containing the given minute of the day,
+// or -1 if none does
+inline int activeSyncWindow(const SyncWindow* windows, int count, int nowMinutes) {
+  for (int i = 0; i < count; i++) {
+    int start = windows[i].hour * 60 + windows[i].minute;
+    if (nowMinutes >= start && nowMinutes < start + syncWindowMinutes) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Returns the number of minutes from the given minute of the day until the
+// start of the next window
+inline int minutesToNextSyncWindow(const SyncWindow* windows, int count, int nowMinutes) {
+  int minDiff = 24 * 60; // maximum value for a day
+  for (int i = 0; i < count; i++) {
+    int diff = windows[i].hour * 60 + windows[i].minute - nowMinutes;
+    if (diff < 0) diff += 24 * 60; // if the window has already passed, add a day
+    if (diff < minDiff) {
+      minDiff = diff;
+    }
+  }
+  return minDiff;
+}
+
+// Returns the number of microseconds from |usIntoMinute| into the given
+// minute of the day until the start of the next window
+inline int64_t microsToNextSyncWindow(const SyncWindow* windows, int count, int nowMinutes, int64_t usIntoMinute) {
+  return minutesToNextSyncWindow(windows, count, nowMinutes) * 60000000LL - usIntoMinute;
+}
+
+#endif // SYNC_SCHEDULE_H
@@ -0,0 +1,52 @@
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+// Monotonic time base for the Arduino sketch. All timing runs on
+// esp_timer_get_time(): 64-bit microseconds since boot, which do not wrap
+// in the lifetime of a device. Wall time is that count plus one offset,
+// anchored when NTP or a peer beacon has set the clock.
+//
+// The 100 ms ticks that shape the pulses are deadlines on whole tenths of
+// wall time. Each tick computes the next deadline from the tenth it serves,
+// not from the time it ran, so a late tick never delays the ones after it
+// and the edges cannot drift against the wall clock. Free of Serial output
+// so it can also run on the host.
+
+#include <stdint.h>
+
+const int64_t tickPeriodUs = 100000;
+// A tick that runs slightly early still serves the coming tenth
+const int64_t tickMarginUs = 20000;
+
+struct TimeBase {
+  int64_t wallOffsetUs;  // UTC minus monotonic time
+  bool anchored;
+};
+
+// Anchors wall time: UTC was |wallUs| at monotonic time |monoUs|
+inline void timeBaseAnchor(TimeBase& base, int64_t monoUs, int64_t wallUs) {
+  base.wallOffsetUs = wallUs - monoUs;
+  base.anchored = true;
+}
+
+inline int64_t timeBaseWallUs(const TimeBase& base, int64_t monoUs) {
+  return monoUs + base.wallOffsetUs;
+}
+
+// Tenth of a second since the epoch that a tick running at |monoUs| serves
+inline int64_t tickIndex(const TimeBase& base, int64_t monoUs) {
+  return (timeBaseWallUs(base, monoUs) + tickMarginUs) / tickPeriodUs;
+}
+
+// Monotonic time at which tick |index| is due
+inline int64_t tickDeadlineUs(const TimeBase& base, int64_t index) {
+  return index * tickPeriodUs - base.wallOffsetUs;
+}
+
+// Delay from |monoUs| until tick |index|, never negative
+inline int64_t tickDelayUs(const TimeBase& base, int64_t index, int64_t monoUs) {
+  int64_t delayUs = tickDeadlineUs(base, index) - monoUs;
+  return delayUs > 0 ? delayUs : 0;
+}
+
+#endif // TIME_BASE_H